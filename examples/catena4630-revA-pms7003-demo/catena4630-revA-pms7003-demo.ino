@@ -23,6 +23,7 @@ Author:
 #include <Adafruit_BME280.h>
 #include <Catena-PMS7003.h>
 #include <Catena-PMS7003Hal-4630.h>
+#include <Catena-PMS7003-ConsoleStream.h>
 #include <mcciadk_baselib.h>
 
 #include <cstdint>
@@ -70,6 +71,10 @@ cPMS7003Hal_4630 gPmsHal
 
 cPMS7003 gPms7003 { Serial2, gPmsHal };
 
+// with "stream on", the readings go to the console as binary records
+// (see Catena-PMS7003-ConsoleStream.h) instead of being printed.
+cConsoleStream gConsoleStream;
+
 // forward reference to the command functions
 cCommandStream::CommandFn cmdBegin;
 cCommandStream::CommandFn cmdEnd;
@@ -83,9 +88,13 @@ cCommandStream::CommandFn cmdMeasure;
 cCommandStream::CommandFn cmdWake;
 cCommandStream::CommandFn cmdStats;
 cCommandStream::CommandFn cmdDebugMask;
+cCommandStream::CommandFn cmdStream;
 
 // the measurement callback.
-cPMS7003::MeasurementCb_t measurementAvailable;
+cPMS7003::TimedMeasurementCb_t measurementAvailable;
+
+// sends the change in the receive statistics, when due.
+void streamRxStats(bool fForce);
 
 // the individual commmands are put in this table
 static const cCommandStream::cEntry sMyExtraCommmands[] =
@@ -102,6 +111,7 @@ static const cCommandStream::cEntry sMyExtraCommmands[] =
         { "wake", cmdWake },
         { "stats", cmdStats },
         { "debugmask", cmdDebugMask },
+        { "stream", cmdStream },
         // other commands go here....
         };
 
@@ -232,6 +242,10 @@ void setup_commands()
 void loop()
     {
     gCatena.poll();
+
+    // the receive statistics go out even while no readings do.
+    if (gConsoleStream.isRunning())
+        streamRxStats(false);
     }
 
 /****************************************************************************\
@@ -243,9 +257,19 @@ void loop()
 void measurementAvailable(
     void *pUserData,
     const cPMS7003::Measurements<std::uint16_t> *pData,
-    bool fWarmedUp
+    bool fWarmedUp,
+    std::uint32_t tFrameMs
     )
     {
+    if (gConsoleStream.isRunning())
+        {
+        cConsoleStream::Frame_t frame;
+
+        streamRxStats(false);
+        Serial.write(frame, gConsoleStream.encodeMeasurement(frame, tFrameMs, *pData, fWarmedUp));
+        return;
+        }
+
     gCatena.SafePrintf(
         "CF1 pm 1.0=%-5u 2.5=%-5u 10=%-5u ",
         pData->cf1.m1p0, pData->cf1.m2p5, pData->cf1.m10
@@ -264,6 +288,17 @@ void measurementAvailable(
         );
     }
 
+// send the change in the receive statistics, if it's due (or forced).
+void streamRxStats(bool fForce)
+    {
+    cConsoleStream::Frame_t frame;
+    std::uint32_t const tNow = millis();
+    const auto stats = gPms7003.getRxStats();
+
+    if (fForce || gConsoleStream.isRxStatsDue(tNow, stats))
+        Serial.write(frame, gConsoleStream.encodeRxStats(frame, tNow, stats));
+    }
+
 /****************************************************************************\
 |
 |   The commands -- called automatically from the framework after receiving
@@ -521,3 +556,64 @@ cCommandStream::CommandStatus cmdDebugMask(
                        : cCommandStream::CommandStatus::kInvalidParameter
                        ;
         }
+
+/* process "stream" */
+// argv[0] is the matched command name.
+// argv[1] if present is "on" (send the readings on the console as
+//      binary records, for extras/pms7003-stream.cpp) or "off" (print
+//      them).
+cCommandStream::CommandStatus cmdStream(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+        cConsoleStream::Frame_t frame;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc > 2)
+            {
+            fResult = false;
+            pThis->printf("too many args\n");
+            }
+        else if (argc > 1)
+            {
+            if (std::strcmp(argv[1], "on") == 0)
+                {
+                std::uint32_t bootCount = 0;
+
+                if (! gConsoleStream.isRunning())
+                    {
+                    gCatena.getBootCount(bootCount);
+                    Serial.write(frame, gConsoleStream.encodeStart(frame, millis(), bootCount, gPms7003.getRxStats()));
+                    }
+                }
+            else if (std::strcmp(argv[1], "off") == 0)
+                {
+                // the counts since the last record, so the deltas add up.
+                if (gConsoleStream.isRunning())
+                    {
+                    streamRxStats(true);
+                    gConsoleStream.stop();
+                    }
+                }
+            else
+                {
+                fResult = false;
+                pThis->printf("usage: stream [on | off]\n");
+                }
+            }
+
+        if (fResult)
+            pThis->printf("stream: %s, %u records\n",
+                gConsoleStream.isRunning() ? "on" : "off",
+                unsigned(gConsoleStream.getRecords())
+                );
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
@@ -20,6 +20,7 @@ Author:
 #endif
 
 extern SPIClass gSPI2;
+extern McciCatena::Catena_Mx25v8035f gFlash;
 extern bool gfFlash;
 
 /****************************************************************************\
@@ -40,6 +41,18 @@ void cMeasurementLoop::begin()
         this->m_Pms7003.setCallback(measurementAvailable, this);
 
         this->m_UplinkTimer.begin(this->m_txCycleSec * 1000);
+
+        // pick up the intervals left in the flash log last time.
+        if (gfFlash)
+            {
+            gFlash.powerUp();
+            this->m_log.begin(gFlash);
+            gFlash.powerDown();
+            gCatena.SafePrintf("flash log: next seq %u, %u unsent\n",
+                unsigned(this->m_log.getNextSeq()),
+                unsigned(this->m_log.getUnsentCount())
+                );
+            }
         }
 
     if (! this->m_running)
@@ -76,7 +89,7 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
     State newState = State::stNoChange;
     auto const pHal = this->getHal();
 
-    if (fEntry && pHal->isEnabled(this->m_Pms7003.DebugFlags::kTrace))
+    if (fEntry && pHal->isTraceEnabled<McciCatenaPMS7003::cPMS7003::DebugFlags::kTrace>())
         {
         this->getHal()->printf("cMeasurementLoop::fsmDispatch: enter %s\n",
                 this->getStateName(currentState)
@@ -93,12 +106,16 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
         if (fEntry)
             {
             this->m_Pms7003.requestOff();
+            this->m_pmsSleepDepth = McciCatenaPMS7003::cKeepWarmPolicy::Depth::Off;
+            this->setContinuous(false);
+            this->m_fHousekeeping = false;
             }
         if (this->m_rqActive)
             {
             this->m_rqActive = this->m_rqInactive = false;
             this->m_active = true;
             this->m_UplinkTimer.retrigger();
+            this->m_report.reset();
             newState = State::stWakePms;
             }
         break;
@@ -106,7 +123,18 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
     case State::stSleeping:
         if (fEntry)
             {
-            this->m_Pms7003.requestOff();
+            // the sensor is still running if it was left on for
+            // continuous mode; otherwise stSleepPms has seen to it.
+            if (this->m_fContinuous)
+                this->sleepPms();
+            // a countdown cut short by the last cycle starts again.
+            if (this->m_sleepCountdown != 0)
+                {
+                this->m_sleepCountdown = 0;
+                this->m_fPrintedSleeping = false;
+                }
+            this->setContinuous(false);
+            this->m_fHousekeeping = false;
             gLed.Set(McciCatena::LedPattern::Sleeping);
             }
 
@@ -125,15 +153,22 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
     case State::stWakePms:
         if (fEntry)
             {
+            // read the battery before the sensor loads it, and the rest
+            // of the uplink's housekeeping while it warms up, so the
+            // uplink can go as soon as the window is reduced.
+            this->readVbat();
+            this->m_tPmsWake = millis();
             this->m_Pms7003.eventWake();
             this->setTimer(2 * 60 * 1000);
             this->resetMeasurement();
+            this->readHousekeeping();
             }
         if (this->timedOut())
             newState = State::stSleepPms;
         else if (this->measurementAwake())
             {
             this->clearTimer();
+            this->m_keepWarm.putRecovery(this->m_pmsSleepDepth, millis() - this->m_tPmsWake);
             newState = State::stMeasurePms;
             }
         break;
@@ -141,7 +176,7 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
     case State::stMeasurePms:
         if (fEntry)
             {
-            this->setTimer(this->kNumMeasurements * 2 * 1000);
+            this->setTimer(this->m_nMeasurements * 2 * 1000);
             }
         if (this->timedOut())
             {
@@ -156,31 +191,152 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
         break;
 
     case State::stSleepPms:
-        if (fEntry)
-            {
-            this->m_Pms7003.requestOff();
-            this->setTimer(10);
-            }
-        if (this->timedOut())
-            newState = State::stTransmit;
+        // the sensor powers down (or goes to sleep) by itself; the
+        // uplink needn't wait.
+        this->sleepPms();
+        newState = State::stTransmit;
         break;
 
     case State::stTransmit:
         if (fEntry)
             {
             TxBuffer_t b;
-            this->fillTxBuffer(b);
-            this->startTransmission(b);
+            std::uint16_t results[McciCatenaPMS7003::kReduceChannels] = {};
+
+            if (this->m_fContinuous)
+                this->m_measurement_valid = this->m_sliding.getCount() != 0;
+
+            bool const fValid = this->m_measurement_valid && this->postProcess(results);
+            bool const fReport = this->reportDue(results, fValid);
+            std::uint32_t tFirst, tLast;
+
+            // the interval is as of its last reading; with none, as of
+            // now.
+            if (fValid && this->getWindowTimes(tFirst, tLast))
+                gCatena.SafePrintf("Window:  %u.%03u s, ended %u ms ago\n",
+                    unsigned((tLast - tFirst) / 1000), unsigned((tLast - tFirst) % 1000),
+                    unsigned(millis() - tLast)
+                    );
+            else
+                tLast = millis();
+
+            this->updateNowCast(results, fValid, tLast);
+
+            this->m_nTxIntervals = 0;
+            if (fReport && (this->batching() || this->m_log.isRunning()))
+                this->saveInterval(results, fValid, tLast);
+
+            // intervals held for a batch go out in time even if this
+            // one isn't reported.
+            bool const fSend = this->batching() ? this->m_batch.getCount() != 0 && this->batchDue()
+                                                : fReport;
+
+            if (fSend)
+                {
+                this->fillTxBuffer(b, results, fValid);
+                this->startTransmission(b);
+                }
+            else
+                {
+                // hold the interval for a later uplink (or skip it), but
+                // keep track of USB power, as fillTxBuffer() would.
+                if (! this->m_fHousekeeping)
+                    this->setVbus(gCatena.ReadVbus());
+                this->m_txcomplete = true;
+                this->m_txerr = false;
+                }
             }
         if (this->txComplete())
             {
-            newState = State::stSleeping;
+            bool const fSent = this->m_nTxIntervals != 0 && ! this->m_txerr;
+
+            // the intervals sent are gone from RAM, whether or not the
+            // uplink got through; the flash log keeps the ones that
+            // didn't.
+            this->m_batch.drop(this->m_nTxIntervals);
+            this->m_seqBatch += this->m_nTxIntervals;
+            if (fSent)
+                this->markTxSent();
+
+            // without a log, intervals that didn't get through are
+            // gone: make sure the next one is reported.
+            if (this->m_nTxIntervals != 0 && this->m_txerr && ! this->m_log.isRunning())
+                this->m_report.reset();
+            this->m_nTxIntervals = 0;
+
+            // Vbus has been read this cycle: stay on (or go to)
+            // continuous mode if we're on USB power. But first, if the
+            // link is back, send what the log has been keeping.
+            if (fSent && this->drainPending())
+                newState = State::stDrain;
+            else
+                newState = this->continuousAllowed() ? State::stContinuous
+                                                     : State::stSleeping;
 
             // calculate the new sleep interval.
             this->updateTxCycleTime();
             }
         break;
 
+    case State::stDrain:
+        if (fEntry)
+            {
+            this->m_nDrainUplinks = 0;
+            if (! this->startDrain())
+                {
+                this->m_txcomplete = true;
+                this->m_txerr = true;
+                }
+            }
+        if (this->txComplete())
+            {
+            bool const fSent = this->m_nTxIntervals != 0 && ! this->m_txerr;
+
+            if (fSent)
+                this->markTxSent();
+            this->m_nTxIntervals = 0;
+
+            // stop at the first failure, or after a few; the rest wait
+            // for the next cycle.
+            if (! (fSent &&
+                   ++this->m_nDrainUplinks < kMaxDrainUplinks &&
+                   this->startDrain()))
+                newState = this->continuousAllowed() ? State::stContinuous
+                                                     : State::stSleeping;
+            }
+        break;
+
+    case State::stContinuous:
+        if (fEntry)
+            {
+            // start the sensor and a new window the first time in, or
+            // if the window length has been changed.
+            const bool fStart = ! this->m_fContinuous;
+
+            if (fStart ||
+                this->m_sliding.getLength() != this->m_nMeasurementsRequested)
+                {
+                this->setContinuous(true);
+                this->m_sliding.reset(this->m_nMeasurementsRequested);
+                this->m_nMeasurements = this->m_nMeasurementsRequested;
+                }
+            if (fStart)
+                this->m_Pms7003.eventWake();
+            // the housekeeping is read at each uplink.
+            this->m_fHousekeeping = false;
+            gLed.Set(McciCatena::LedPattern::Measuring);
+            }
+
+        if (this->m_rqInactive)
+            {
+            this->m_rqActive = this->m_rqInactive = false;
+            this->m_active = false;
+            newState = State::stInactive;
+            }
+        else if (this->m_UplinkTimer.isready())
+            newState = State::stTransmit;
+        break;
+
     case State::stFinal:
         break;
 
@@ -200,7 +356,8 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
 void cMeasurementLoop::measurementAvailable(
     void *pUserData,
     const McciCatenaPMS7003::cPMS7003::Measurements<std::uint16_t> *pData,
-    bool fWarmedUp
+    bool fWarmedUp,
+    std::uint32_t tFrameMs
     )
     {
     cMeasurementLoop * const pThis = (cMeasurementLoop *)pUserData;
@@ -210,7 +367,7 @@ void cMeasurementLoop::measurementAvailable(
 //        pData->cf1.m1p0, pData->cf1.m2p5, pData->cf1.m10
 //        );
 
-    pThis->processMeasurement(pData, fWarmedUp);
+    pThis->processMeasurement(pData, fWarmedUp, tFrameMs);
     }
 
 /****************************************************************************\
@@ -221,20 +378,31 @@ void cMeasurementLoop::measurementAvailable(
 
 void cMeasurementLoop::processMeasurement(
     const McciCatenaPMS7003::cPMS7003::Measurements<std::uint16_t> *pData,
-    bool fWarmedUp
+    bool fWarmedUp,
+    std::uint32_t tFrameMs
     )
     {
-    gCatena.SafePrintf(
-        "ATM pm 1.0=%-5u 2.5=%-5u 10=%-5u ",
-        pData->atm.m1p0, pData->atm.m2p5, pData->atm.m10
-        );
+    if (this->m_consoleStream.isRunning())
+        {
+        McciCatenaPMS7003::cConsoleStream::Frame_t frame;
 
-    gCatena.SafePrintf(
-        "Dust .3=%-5u .5=%-5u 1.0=%-5u 2.5=%-5u 5=%-5u 10=%-5u%s\n",
-        pData->dust.m0p3, pData->dust.m0p5, pData->dust.m1p0,
-          pData->dust.m2p5, pData->dust.m5, pData->dust.m10,
-        fWarmedUp ? "" : " (warmup)"
-        );
+        this->streamRxStats(false);
+        Serial.write(frame, this->m_consoleStream.encodeMeasurement(frame, tFrameMs, *pData, fWarmedUp));
+        }
+    else
+        {
+        gCatena.SafePrintf(
+            "ATM pm 1.0=%-5u 2.5=%-5u 10=%-5u ",
+            pData->atm.m1p0, pData->atm.m2p5, pData->atm.m10
+            );
+
+        gCatena.SafePrintf(
+            "Dust .3=%-5u .5=%-5u 1.0=%-5u 2.5=%-5u 5=%-5u 10=%-5u%s\n",
+            pData->dust.m0p3, pData->dust.m0p5, pData->dust.m1p0,
+              pData->dust.m2p5, pData->dust.m5, pData->dust.m10,
+            fWarmedUp ? "" : " (warmup)"
+            );
+        }
 
     bool fEvent = false;
     if (! this->m_measurement_received)
@@ -243,7 +411,12 @@ void cMeasurementLoop::processMeasurement(
         this->m_measurement_received = true;
         }
 
-    if (fWarmedUp)
+    if (fWarmedUp && this->m_fContinuous)
+        {
+        // continuous mode: the uplink timer drives the FSM.
+        this->m_sliding.put(*pData, tFrameMs);
+        }
+    else if (fWarmedUp)
         {
 
         if (this->m_iMeasurement == 0)
@@ -253,20 +426,15 @@ void cMeasurementLoop::processMeasurement(
             }
         const unsigned i = this->m_iMeasurement;
 
-        if (i < kNumMeasurements)
+        if (i < this->m_nMeasurements)
             {
-            this->m_Pm.m1p0[i] = pData->atm.m1p0;
-            this->m_Pm.m2p5[i] = pData->atm.m2p5;
-            this->m_Pm.m10[i] = pData->atm.m10;
-            this->m_Dust.m0p3[i] = pData->dust.m0p3;
-            this->m_Dust.m0p5[i] = pData->dust.m0p5;
-            this->m_Dust.m1p0[i] = pData->dust.m1p0;
-            this->m_Dust.m2p5[i] = pData->dust.m2p5;
-            this->m_Dust.m5[i] = pData->dust.m5;
-            this->m_Dust.m10[i] = pData->dust.m10;
+            this->m_window.put(i, *pData);
+            if (i == 0)
+                this->m_tWindowFirst = tFrameMs;
+            this->m_tWindowLast = tFrameMs;
 
             this->m_iMeasurement = i + 1;
-            if (i + 1 == kNumMeasurements)
+            if (i + 1 == this->m_nMeasurements)
                 fEvent = true;
             }
         }
@@ -277,54 +445,118 @@ void cMeasurementLoop::processMeasurement(
 
 /****************************************************************************\
 |
-|   Prepare a buffer to be transmitted.
+|   Stream the readings on the console
 |
 \****************************************************************************/
 
-void cMeasurementLoop::fillTxBuffer(cMeasurementLoop::TxBuffer_t& b)
+void cMeasurementLoop::setConsoleStream(bool fEnable)
     {
-    auto const savedLed = gLed.Set(McciCatena::LedPattern::Measuring);
+    McciCatenaPMS7003::cConsoleStream::Frame_t frame;
 
-    b.begin();
-    Flags flag;
+    if (fEnable == this->m_consoleStream.isRunning())
+        return;
 
-    flag = Flags(0);
+    if (fEnable)
+        {
+        std::uint32_t bootCount = 0;
+
+        gCatena.getBootCount(bootCount);
+        Serial.write(frame, this->m_consoleStream.encodeStart(frame, millis(), bootCount, this->m_Pms7003.getRxStats()));
+        }
+    else
+        {
+        // the counts since the last record, so the deltas add up.
+        this->streamRxStats(true);
+        this->m_consoleStream.stop();
+        }
+    }
 
-    // insert format byte
-    b.put(kMessageFormat);
+// send the change in the receive statistics, if it's due (or forced).
+void cMeasurementLoop::streamRxStats(bool fForce)
+    {
+    McciCatenaPMS7003::cConsoleStream::Frame_t frame;
+    std::uint32_t const tNow = millis();
+    auto const stats = this->m_Pms7003.getRxStats();
 
-    // insert a byte that will become flags later.
-    std::uint8_t * const pFlag = b.getp();
-    b.put(std::uint8_t(flag));
+    if (fForce || this->m_consoleStream.isRxStatsDue(tNow, stats))
+        Serial.write(frame, this->m_consoleStream.encodeRxStats(frame, tNow, stats));
+    }
+
+/****************************************************************************\
+|
+|   The times of the window
+|
+\****************************************************************************/
+
+// the times of the first and last readings of the window being
+// reduced; false if it's empty.
+bool cMeasurementLoop::getWindowTimes(std::uint32_t &tFirst, std::uint32_t &tLast) const
+    {
+    if (this->m_fContinuous)
+        {
+        if (this->m_sliding.getCount() == 0)
+            return false;
+        tFirst = this->m_sliding.getFirstTime();
+        tLast = this->m_sliding.getLastTime();
+        }
+    else
+        {
+        if (this->m_iMeasurement == 0)
+            return false;
+        tFirst = this->m_tWindowFirst;
+        tLast = this->m_tWindowLast;
+        }
+    return true;
+    }
+
+/****************************************************************************\
+|
+|   Read the values every uplink carries.
+|
+\****************************************************************************/
+
+// the battery, before the PM sensor loads it; this starts the
+// housekeeping for the next uplink.
+void cMeasurementLoop::readVbat()
+    {
+    using Msg = McciCatenaPMS7003::cPort1Message;
 
     // send Vbat
     float Vbat = gCatena.ReadVbat();
     gCatena.SafePrintf("Vbat:    %d mV\n", (int) (Vbat * 1000.0f));
-    b.putV(Vbat);
-    flag |= Flags::Vbat;
+    this->m_txHousekeeping.reset(kMessageFormat);
+    this->m_txHousekeeping.set<Msg::kVbat>(Vbat);
+    this->m_fHousekeeping = false;
+    }
+
+// the rest: Vbus, the boot count and the BME280. These take a while (the
+// BME280 most of all), so the FSM reads them while the PM sensor warms
+// up, not after the window is reduced.
+void cMeasurementLoop::readHousekeeping()
+    {
+    using Msg = McciCatenaPMS7003::cPort1Message;
+    Msg &msg = this->m_txHousekeeping;
 
     // send Vdd if we can measure it.
 
-    // vBus is sent as 5000 * v
+    // vBus is sent as 4096 * v
     float Vbus = gCatena.ReadVbus();
     gCatena.SafePrintf("Vbus:    %d mV\n", (int) (Vbus * 1000.0f));
     this->setVbus(Vbus);
-    b.putV(Vbus);
-    flag |= Flags::Vbus;
+    msg.set<Msg::kVbus>(Vbus);
 
     // send boot count
     uint32_t bootCount;
     if (gCatena.getBootCount(bootCount))
         {
-        b.putBootCountLsb(bootCount);
-        flag |= Flags::Boot;
+        msg.setCode(Msg::kBoot, std::uint8_t(bootCount));
         }
 
     if (this->m_fBme280)
         {
         Adafruit_BME280::Measurements m = this->m_BME280.readTemperaturePressureHumidity();
         // temperature is 2 bytes from -0x80.00 to +0x7F.FF degrees C
-        // pressure is 2 bytes, hPa * 10.
+        // pressure is 2 bytes, hPa * 25.
         // humidity is two bytes, where 0 == 0/65535 and 0xFFFFF == 65535/65535 = 100%.
         gCatena.SafePrintf(
                 "BME280:  T: %d P: %d RH: %d\n",
@@ -332,103 +564,321 @@ void cMeasurementLoop::fillTxBuffer(cMeasurementLoop::TxBuffer_t& b)
                 (int) m.Pressure,
                 (int) m.Humidity
                 );
-        b.putT(m.Temperature);
-        b.putP(m.Pressure);
-        // no method for 2-byte RH, directly encode it.
-        b.put2uf((m.Humidity / 100.0f) * 65535.0f);
+        msg.set<Msg::kTempC>(m.Temperature);
+        msg.set<Msg::kP>(m.Pressure / 100.0f);
+        msg.set<Msg::kRh>(m.Humidity);
+        }
+
+    this->m_fHousekeeping = true;
+    }
+
+/****************************************************************************\
+|
+|   Prepare a buffer to be transmitted.
+|
+\****************************************************************************/
+
+// results are the current window's, as reduced by postProcess(); they
+// go out unless they aren't valid, or the uplink is a batch.
+void cMeasurementLoop::fillTxBuffer(
+    cMeasurementLoop::TxBuffer_t& b,
+    const std::uint16_t (&results)[McciCatenaPMS7003::kReduceChannels],
+    bool fValid
+    )
+    {
+    if (this->batching())
+        this->fillTxBuffer(b, &this->m_batch, this->m_seqBatch, nullptr);
+    else
+        {
+        this->fillTxBuffer(b, nullptr, this->m_seqLast, fValid ? results : nullptr);
+        this->m_nTxIntervals = 1;
+        }
+    }
+
+// pBatch is the batch to send, or nullptr to send the current window,
+// whose results are at pResults (nullptr if they aren't valid); seq is
+// the log sequence number of the first interval.
+void cMeasurementLoop::fillTxBuffer(
+    cMeasurementLoop::TxBuffer_t& b,
+    const cMeasurementLoop::UplinkBatch_t *pBatch,
+    std::uint32_t seq,
+    const std::uint16_t *pResults
+    )
+    {
+    using Msg = McciCatenaPMS7003::cPort1Message;
+    auto const savedLed = gLed.Set(McciCatena::LedPattern::Measuring);
+
+    // the housekeeping values, unless they were read while the sensor
+    // warmed up (they aren't in continuous mode).
+    if (! this->m_fHousekeeping)
+        {
+        this->readVbat();
+        this->readHousekeeping();
+        }
 
-        flag |= Flags::TPH;
+    // the values go in msg, which lays them out from the schema in
+    // Catena-PMS7003-Port1.h; the batch follows.
+    Msg msg { this->m_txHousekeeping };
+    Flags flag;
+
+    msg.setFormat(pBatch != nullptr ? kBatchMessageFormat : kMessageFormat);
+    flag = Flags(0);
+    this->m_seqTx = seq;
+
+    if (pBatch == nullptr && pResults != nullptr)
+        {
+        // already uflt16, in uplink order: atm pm 1.0, 2.5, 10,
+        // then the dust counts from 0.3 to 10.
+        for (std::size_t i = 0; i < McciCatenaPMS7003::kReduceChannels; ++i)
+            msg.setCode(Msg::kPm1p0 + i, pResults[i]);
+
+        // the AQI, exactly as the decoders compute it.
+        using Aqi = McciCatenaPMS7003::cAqi;
+        std::uint16_t const uf2p5 = pResults[McciCatenaPMS7003::cReportByException::kPm2p5Channel];
+        std::uint16_t const uf10 = pResults[McciCatenaPMS7003::cReportByException::kPm10Channel];
+        std::uint32_t const aqi = Aqi::getAqi(uf2p5, uf10);
+
+        gCatena.SafePrintf("AQI:     %u (%s)\n",
+            unsigned(aqi), Aqi::getCategoryName(Aqi::getCategory(uf2p5, uf10))
+            );
+        if (this->m_fAqiField)
+            msg.setCode(Msg::kAqi, std::uint16_t(aqi < 0xFFFF ? aqi : 0xFFFF));
         }
 
-    // sort and process
-    if (this->m_measurement_valid)
+    std::uint8_t buf[Msg::kMaxSize];
+    std::size_t const nMsg = msg.encode(buf);
+
+    b.begin();
+    b.put(buf[0]);
+
+    // the bitmap; the batch fields are added below.
+    std::uint8_t * const pFlag = b.getp();
+    for (std::size_t i = 1; i < nMsg; ++i)
+        b.put(buf[i]);
+
+    if (pBatch != nullptr)
         {
-        McciCatenaPMS7003::cPMS7003::Measurements<float> results;
-        if (this->postProcess(results))
+        // the held intervals, oldest first, as many as fit in the rest
+        // of the buffer; the others wait for the next uplink. With a
+        // flash log, the sequence number follows.
+        bool const fSeq = this->m_log.isRunning();
+        std::uint8_t batch[kTxBufferSize];
+        std::size_t const nBatch = pBatch->encode(
+                                        batch, kTxBufferSize - b.getn() - (fSeq ? 4 : 0),
+                                        millis(), this->m_nTxIntervals
+                                        );
+
+        if (nBatch != 0)
             {
-            flag |= Flags::PM | Flags::Dust;
-            
-            b.put2uf(this->particle2uf(results.atm.m1p0));
-            b.put2uf(this->particle2uf(results.atm.m2p5));
-            b.put2uf(this->particle2uf(results.atm.m10));
-            b.put2uf(this->particle2uf(results.dust.m0p3));
-            b.put2uf(this->particle2uf(results.dust.m0p5));
-            b.put2uf(this->particle2uf(results.dust.m1p0));
-            b.put2uf(this->particle2uf(results.dust.m2p5));
-            b.put2uf(this->particle2uf(results.dust.m5));
-            b.put2uf(this->particle2uf(results.dust.m10));
+            gCatena.SafePrintf("Batch:   %u intervals, %u bytes\n",
+                unsigned(this->m_nTxIntervals), unsigned(nBatch)
+                );
+            for (std::size_t i = 0; i < nBatch; ++i)
+                b.put(batch[i]);
+            flag |= Flags::Batch;
+
+            if (fSeq)
+                {
+                b.put(std::uint8_t(seq >> 24));
+                b.put(std::uint8_t(seq >> 16));
+                b.put(std::uint8_t(seq >> 8));
+                b.put(std::uint8_t(seq));
+                flag |= Flags::Seq;
+                }
             }
         }
 
-    *pFlag = std::uint8_t(flag);
+    *pFlag |= std::uint8_t(flag);
 
     gLed.Set(savedLed);
     }
 
 /****************************************************************************\
 |
-|   Reduce a single data set
+|   Decide whether to report an interval
 |
 \****************************************************************************/
 
-extern "C" {
-  static int compare16(const void *pLeft, const void *pRight);
-}
-
-static int compare16(const void *pLeft, const void *pRight)
+bool cMeasurementLoop::reportDue(
+    const std::uint16_t (&results)[McciCatenaPMS7003::kReduceChannels],
+    bool fValid
+    )
     {
-    auto p = (const std::uint16_t *)pLeft;
-    auto q = (const std::uint16_t *)pRight;
+    using Reason = McciCatenaPMS7003::cReportByException::Reason;
 
-    return (int)*p - (int)*q;
+    if (! this->m_fReportByException)
+        return true;
+
+    std::uint32_t const tNow = millis();
+    Reason const reason = this->m_report.check(results, fValid, tNow, this->m_txCycleSec * 1000);
+
+    gCatena.SafePrintf("Report:  %s\n",
+        reason == Reason::None ? "no change, skipped" : this->m_report.getReasonName(reason)
+        );
+
+    if (reason == Reason::None)
+        return false;
+
+    this->m_report.setReported(results, fValid, tNow);
+    return true;
     }
 
-void cMeasurementLoop::processOneMeasurement(
-    float &r,
-    std::uint16_t *pv
+/****************************************************************************\
+|
+|   Hold an interval for a batched uplink
+|
+\****************************************************************************/
+
+void cMeasurementLoop::saveInterval(
+    const std::uint16_t (&results)[McciCatenaPMS7003::kReduceChannels],
+    bool fValid,
+    std::uint32_t tInterval
     )
     {
-    // set pointers to q1 and q3 cells by counting in symmetrically from the ends of the vector.
-    // For example if kNumMeasurements is 10, then we call the q1 value pv[2], and the
-    // q3 value is pv[7]; values [0],[1] are below q1, and [8],[9] are above q3.
-    const std::uint16_t * const pq1 = pv + kNumMeasurements / 4;
-    const std::uint16_t * const pq3 = pv + kNumMeasurements - (kNumMeasurements / 4) - 1;
+    if (this->m_log.isRunning())
+        {
+        std::uint32_t bootCount = 0;
+
+        gCatena.getBootCount(bootCount);
+        gFlash.powerUp();
+        if (! this->m_log.append(tInterval, std::uint8_t(bootCount), results, fValid, this->m_seqLast))
+            gCatena.SafePrintf("flash log: can't write seq %u\n", unsigned(this->m_seqLast));
+        gFlash.powerDown();
+        }
+
+    if (this->batching())
+        {
+        // the log numbers intervals consecutively, so the batch needs
+        // only the first.
+        if (this->m_batch.getCount() == 0)
+            this->m_seqBatch = this->m_seqLast;
+        this->m_batch.put(tInterval, results, fValid);
+        }
+    }
+
+bool cMeasurementLoop::batchDue() const
+    {
+    // send when the batch is full, or when waiting another cycle would
+    // hold the oldest interval too long.
+    return this->m_batch.getCount() >= this->m_nBatchIntervals ||
+           this->m_batch.getAgeMs(millis()) / 1000 + this->m_txCycleSec > this->m_batchLatencySec;
+    }
+
+/****************************************************************************\
+|
+|   Send the intervals left in the flash log
+|
+\****************************************************************************/
+
+bool cMeasurementLoop::drainPending()
+    {
+    std::uint32_t seq;
+
+    if (! this->m_log.isRunning())
+        return false;
+
+    gFlash.powerUp();
+    bool const fResult = this->m_log.findUnsent(this->drainLimit(), seq);
+    gFlash.powerDown();
+
+    return fResult;
+    }
+
+// send the oldest unsent intervals in the log that follow each other,
+// as a batch. Returns false if there are none.
+bool cMeasurementLoop::startDrain()
+    {
+    using Record = FlashLog_t::Record;
+
+    std::uint32_t const seqLimit = this->drainLimit();
+    std::uint32_t const tNow = millis();
+    std::uint32_t bootCount = 0;
+    std::uint32_t seq;
+    UplinkBatch_t batch;
+
+    if (! this->m_log.isRunning())
+        return false;
+
+    gCatena.getBootCount(bootCount);
+    gFlash.powerUp();
+    if (this->m_log.findUnsent(seqLimit, seq))
+        {
+        for (std::uint32_t i = 0; i < kMaxBatchIntervals && seq + i != seqLimit; ++i)
+            {
+            Record r;
+
+            if (! this->m_log.read(seq + i, r) || r.fSent)
+                break;
 
-    // sort pv in place.
-    qsort(pv, kNumMeasurements, sizeof(pv[0]), compare16);
+            // millis() means nothing from an earlier boot: send those
+            // as old as the format goes, and let the sequence number
+            // place them.
+            bool const fThisBoot = r.boot == std::uint8_t(bootCount) &&
+                                   std::int32_t(tNow - r.tMs) >= 0;
 
-    // calculate IQR = q3 - q1
-    std::int32_t iqr = *pq3 - *pq1;
+            batch.put(fThisBoot ? r.tMs : tNow - 0xFFFFu * 1000u, r.uf, r.fValid);
+            }
+        }
+    gFlash.powerDown();
+
+    if (batch.getCount() == 0)
+        return false;
+
+    TxBuffer_t b;
 
-    // calculate 1.5 IRQ. It's positive, so >> is well defined.
-    std::int32_t iqr15 = (3 * iqr) >> 1;
+    gCatena.SafePrintf("flash log: sending from seq %u, %u unsent\n",
+        unsigned(seq), unsigned(this->m_log.getUnsentCount())
+        );
+    this->fillTxBuffer(b, &batch, seq, nullptr);
+    this->startTransmission(b);
+    return true;
+    }
 
-    // calcluate the low and high limits.
-    std::int32_t lowlim = pq1[0] - iqr15;
-    std::int32_t highlim = pq3[0] + iqr15;
+// mark the intervals in the uplink just sent as sent in the log.
+void cMeasurementLoop::markTxSent()
+    {
+    if (! this->m_log.isRunning())
+        return;
 
-    // define left and right pointers for summation.
-    const std::uint16_t *p1;
-    const std::uint16_t *p2;
+    gFlash.powerUp();
+    for (std::size_t i = 0; i < this->m_nTxIntervals; ++i)
+        this->m_log.markSent(this->m_seqTx + i);
+    gFlash.powerDown();
+    }
 
-    // scan from left to find first value to accumulate.
-    for (p1 = pv; p1 < pq1 && *p1 < lowlim; ++p1)
-        ;
+/****************************************************************************\
+|
+|   The NowCast
+|
+\****************************************************************************/
 
-    // scan from right to find last value to accumulate.
-    for (p2 = pv + kNumMeasurements - 1; pq3 < p2 && *p2 > highlim; --p2)
-        ;
+// every interval, reported or not, goes into the hourly averages; one
+// with no particle data just moves the hours on.
+void cMeasurementLoop::updateNowCast(
+    const std::uint16_t (&results)[McciCatenaPMS7003::kReduceChannels],
+    bool fValid,
+    std::uint32_t tInterval
+    )
+    {
+    using NowCast = McciCatenaPMS7003::cNowCast;
+    using Report = McciCatenaPMS7003::cReportByException;
 
-    // sum the values.
-    std::uint32_t sum = 0;
-    for (auto p = p1; p <= p2; ++p)
-        sum += *p;
+    std::uint32_t const nHours = fValid
+        ? this->m_nowCast.put(results[Report::kPm2p5Channel], results[Report::kPm10Channel], tInterval)
+        : this->m_nowCast.advance(tInterval);
+    std::uint32_t c2p5, c10, aqi;
 
-    // divide by n * 65536.0
-    float const div = (p2 - p1 + 1) * 65535.0f;
+    if (nHours == 0)
+        return;
 
-    // store into r.
-    r = sum / div;
+    if (this->m_nowCast.getConcentration(NowCast::kPm2p5, c2p5) &&
+        this->m_nowCast.getConcentration(NowCast::kPm10, c10) &&
+        this->m_nowCast.getAqi(aqi))
+        gCatena.SafePrintf("NowCast: PM2.5 %u.%u PM10 %u ug/m3, AQI %u\n",
+            unsigned(c2p5 / 10), unsigned(c2p5 % 10), unsigned(c10 / 10), unsigned(aqi)
+            );
+    else
+        gCatena.SafePrintf("NowCast: not enough data\n");
     }
 
 /****************************************************************************\
@@ -438,23 +888,39 @@ void cMeasurementLoop::processOneMeasurement(
 \****************************************************************************/
 
 bool cMeasurementLoop::postProcess(
-    McciCatenaPMS7003::cPMS7003::Measurements<float> &results
+    std::uint16_t (&results)[McciCatenaPMS7003::kReduceChannels]
     )
     {
-    std::uint16_t m[kNumMeasurements];
+    // all nine channels at once, straight to uflt16 with no floating
+    // point; see Catena-PMS7003-Reduce.h. In continuous mode, the
+    // sliding window is already sorted; see Catena-PMS7003-Sliding.h.
+    if (this->m_fContinuous)
+        this->m_sliding.reduceUflt16(results);
+    else
+        this->m_window.reduceUflt16(results);
+
+    return true;
+    }
+
+/****************************************************************************\
+|
+|   Switching windows
+|
+\****************************************************************************/
 
-    processOneMeasurement(results.atm.m1p0, this->m_Pm.m1p0);
-    processOneMeasurement(results.atm.m2p5, this->m_Pm.m2p5);
-    processOneMeasurement(results.atm.m10,  this->m_Pm.m10);
+// switch between the window and the sliding window of continuous mode,
+// which share storage. The one switched to starts empty.
+void cMeasurementLoop::setContinuous(bool fContinuous)
+    {
+    if (fContinuous == this->m_fContinuous)
+        return;
 
-    processOneMeasurement(results.dust.m0p3, this->m_Dust.m0p3);
-    processOneMeasurement(results.dust.m0p5, this->m_Dust.m0p5);
-    processOneMeasurement(results.dust.m1p0, this->m_Dust.m1p0);
-    processOneMeasurement(results.dust.m2p5, this->m_Dust.m2p5);
-    processOneMeasurement(results.dust.m5,   this->m_Dust.m5);
-    processOneMeasurement(results.dust.m10,  this->m_Dust.m10);
+    if (fContinuous)
+        new (&this->m_sliding) SlidingWindow_t;
+    else
+        new (&this->m_window) Window_t;
 
-    return true;
+    this->m_fContinuous = fContinuous;
     }
 
 /****************************************************************************\
@@ -521,6 +987,10 @@ void cMeasurementLoop::poll()
     // no need to evaluate unless something happens.
     fEvent = false;
 
+    // the receive statistics go out even while no readings do.
+    if (this->m_consoleStream.isRunning())
+        this->streamRxStats(false);
+
     // if we're not active, and no request, nothing to do.
     if (! this->m_active)
         {
@@ -586,6 +1056,37 @@ void cMeasurementLoop::updateTxCycleTime()
 |
 \****************************************************************************/
 
+// put the PM sensor to sleep until the next cycle, as deeply as the
+// keep-warm policy finds worth it. If the window wasn't finished, the
+// sensor may not be running normally, so it's powered off, which
+// resets it.
+void cMeasurementLoop::sleepPms()
+    {
+    using Policy = McciCatenaPMS7003::cKeepWarmPolicy;
+
+    std::uint32_t const idleMs = this->m_UplinkTimer.getRemaining();
+    Policy::Depth const depth = this->m_measurement_valid ? this->m_keepWarm.choose(idleMs)
+                                                          : Policy::Depth::Off;
+
+    switch (depth)
+        {
+    case Policy::Depth::HwSleep:
+        this->m_Pms7003.requestHwSleep();
+        break;
+    case Policy::Depth::SwSleep:
+        this->m_Pms7003.requestSleep();
+        break;
+    default:
+        this->m_Pms7003.requestOff();
+        break;
+        }
+
+    this->m_pmsSleepDepth = depth;
+    gCatena.SafePrintf("PMS7003: %s, next cycle in %u s\n",
+        Policy::getDepthName(depth), unsigned(idleMs / 1000)
+        );
+    }
+
 void cMeasurementLoop::sleep()
     {
     const bool fDeepSleep = checkDeepSleep();
@@ -593,6 +1094,9 @@ void cMeasurementLoop::sleep()
     if (! this->m_fPrintedSleeping)
             this->doSleepAlert(fDeepSleep);
 
+    if (this->pollSleepCountdown(fDeepSleep))
+            return;
+
     if (fDeepSleep)
             this->doDeepSleep();
     }
@@ -642,7 +1146,14 @@ void cMeasurementLoop::doSleepAlert(bool fDeepSleep)
         {
         bool const fDeepSleepTest = gCatena.GetOperatingFlags() &
                         static_cast<uint32_t>(gCatena.OPERATING_FLAGS::fDeepSleepTest);
-        const uint32_t deepSleepDelay = fDeepSleepTest ? 10 : 30;
+        const uint32_t deepSleepDelay = fDeepSleepTest ? kDeepSleepTestCountdownSec
+                                                       : kUnattendedCountdownSec;
+
+        if (deepSleepDelay == 0)
+            {
+            gCatena.SafePrintf("using deep sleep\n");
+            return;
+            }
 
         gCatena.SafePrintf("using deep sleep in %u secs"
 #ifdef USBCON
@@ -652,32 +1163,57 @@ void cMeasurementLoop::doSleepAlert(bool fDeepSleep)
                             deepSleepDelay
                             );
 
-        // sleep and print
+        // count down on the timer; pollSleepCountdown() sleeps the
+        // CPU between ticks.
         gLed.Set(McciCatena::LedPattern::TwoShort);
-
-        for (auto n = deepSleepDelay; n > 0; --n)
-            {
-            uint32_t tNow = millis();
-
-            while (uint32_t(millis() - tNow) < 1000)
-                {
-                gCatena.poll();
-                yield();
-                }
-            gCatena.SafePrintf(".");
-            }
-        gCatena.SafePrintf("\nStarting deep sleep.\n");
-        uint32_t tNow = millis();
-        while (uint32_t(millis() - tNow) < 100)
-            {
-            gCatena.poll();
-            yield();
-            }
+        this->m_sleepCountdown = deepSleepDelay;
+        this->setTimer(1000);
         }
     else
         gCatena.SafePrintf("using light sleep\n");
     }
 
+// called each time stSleeping is evaluated. Returns true while the
+// countdown to deep sleep is running, printing a dot each second, and
+// between the dots puts the CPU in sleep mode until the next interrupt:
+// the SysTick brings it back within a millisecond, and console input
+// (USB or UART) at once, so the loop still sees the console. If
+// deep sleep is no longer wanted (for example, the console connected,
+// or the operating flags changed), the countdown stops, and the sketch
+// says how it will sleep instead.
+bool cMeasurementLoop::pollSleepCountdown(bool fDeepSleep)
+    {
+    if (this->m_sleepCountdown == 0)
+        return false;
+
+    if (! fDeepSleep)
+        {
+        this->clearTimer();
+        this->m_sleepCountdown = 0;
+        this->m_fPrintedSleeping = false;
+        gCatena.SafePrintf("\ndeep sleep cancelled\n");
+        gLed.Set(McciCatena::LedPattern::Sleeping);
+        return true;
+        }
+
+    if (! this->timedOut())
+        {
+        __WFI();
+        return true;
+        }
+
+    gCatena.SafePrintf(".");
+    if (--this->m_sleepCountdown != 0)
+        {
+        this->setTimer(1000);
+        return true;
+        }
+
+    gCatena.SafePrintf("\nStarting deep sleep.\n");
+    Serial.flush();
+    return false;
+    }
+
 void cMeasurementLoop::doDeepSleep()
     {
     // bool const fDeepSleepTest = gCatena.GetOperatingFlags() &
@@ -703,7 +1239,10 @@ void cMeasurementLoop::doDeepSleep()
 
 void cMeasurementLoop::deepSleepPrepare(void)
     {
-    this->m_Pms7003.end();
+    // a sensor kept warm stays as it is: its 5V supply and SET pin hold
+    // while the MCU sleeps.
+    if (this->m_pmsSleepDepth == McciCatenaPMS7003::cKeepWarmPolicy::Depth::Off)
+        this->m_Pms7003.end();
     Serial.end();
     Wire.end();
     SPI.end();
@@ -718,5 +1257,6 @@ void cMeasurementLoop::deepSleepRecovery(void)
     SPI.begin();
     if (gfFlash)
             gSPI2.begin();
-    this->m_Pms7003.begin();
+    if (this->m_pmsSleepDepth == McciCatenaPMS7003::cKeepWarmPolicy::Depth::Off)
+        this->m_Pms7003.begin();
     }
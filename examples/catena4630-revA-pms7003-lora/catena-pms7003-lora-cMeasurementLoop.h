@@ -32,15 +32,35 @@ Author:
 #include <Adafruit_BME280.h>
 #include <Catena-PMS7003.h>
 #include <Catena-PMS7003Hal-4630.h>
+#include <Catena-PMS7003-Aqi.h>
+#include <Catena-PMS7003-Batch.h>
+#include <Catena-PMS7003-ConsoleStream.h>
+#include <Catena-PMS7003-FlashLog.h>
+#include <Catena-PMS7003-KeepWarm.h>
+#include <Catena-PMS7003-NowCast.h>
+#include <Catena-PMS7003-Port1.h>
+#include <Catena-PMS7003-Reduce.h>
+#include <Catena-PMS7003-Report.h>
+#include <Catena-PMS7003-Sliding.h>
+#include <Catena-PMS7003-Streaming.h>
 #include <mcciadk_baselib.h>
 #include <stdlib.h>
 
 #include <cstdint>
+#include <new>
+#include <type_traits>
 
 #ifndef ARDUINO_MCCI_CATENA_4630
 # error "This sketch targets the MCCI Catena 4630"
 #endif
 
+// the countdown before the first deep sleep of an unattended node, in
+// seconds. Define as 0 on the command line to skip it, for nodes that
+// no one watches.
+#ifndef CATENA_PMS7003_LORA_UNATTENDED_COUNTDOWN_SEC
+# define CATENA_PMS7003_LORA_UNATTENDED_COUNTDOWN_SEC 30
+#endif
+
 extern McciCatena::Catena gCatena;
 extern McciCatena::Catena::LoRaWAN gLoRaWAN;
 extern McciCatena::StatusLed gLed;
@@ -53,6 +73,9 @@ extern McciCatena::StatusLed gLed;
 
 class cMeasurementLoop : public McciCatena::cPollableObject
     {
+    // host-side harnesses (see extras/host) get at the internals this way.
+    friend class cMeasurementLoopHostAccess;
+
 public:
     // constructor
     cMeasurementLoop(
@@ -61,9 +84,24 @@ public:
             )
         : m_Pms7003(pms7003)
         , m_BME280(bme280)
-        , m_txCycleSec_Permanent(6 * 60)    // default uplink interval
+        , m_nMeasurements(kDefaultMeasurements)
+        , m_nMeasurementsRequested(kDefaultMeasurements)
+        , m_window()
+        , m_tWindowFirst(0)
+        , m_tWindowLast(0)
+        , m_nBatchIntervals(1)
+        , m_batchLatencySec(kDefaultBatchLatencySec)
+        , m_pmsSleepDepth(McciCatenaPMS7003::cKeepWarmPolicy::Depth::Off)
+        , m_tPmsWake(0)
+        , m_seqLast(0)
+        , m_seqBatch(0)
+        , m_seqTx(0)
+        , m_nTxIntervals(0)
+        , m_nDrainUplinks(0)
         , m_txCycleSec(30)                  // initial uplink interval
         , m_txCycleCount(10)                // initial count of fast uplinks
+        , m_txCycleSec_Permanent(6 * 60)    // default uplink interval
+        , m_sleepCountdown(0)
         {};
 
     // neither copyable nor movable
@@ -82,6 +120,8 @@ public:
         stMeasurePms,   // make the PM measurements
         stSleepPms,     // sleep the PM sensor
         stTransmit,     // transmit data
+        stDrain,        // transmit intervals left in the flash log
+        stContinuous,   // on USB power: PM sensor left running
 
         stFinal,        // this name must be present, it's the terminal state.
         };
@@ -98,26 +138,32 @@ public:
         case State::stMeasurePms: return "stMeasurePms";
         case State::stSleepPms: return "stSleepPms";
         case State::stTransmit: return "stTransmit";
+        case State::stDrain: return "stDrain";
+        case State::stContinuous: return "stContinuous";
         case State::stFinal: return "stFinal";
         default: return "<<unknown>>";
             }
         }
 
     static constexpr uint8_t kUplinkPort = 1;
+    static constexpr uint8_t kWindowDownlinkPort = 2;
     static constexpr uint8_t kMessageFormat = 0x20;
+    // the same, with field 5 carrying a batch of intervals; see
+    // Catena-PMS7003-Batch.h.
+    static constexpr uint8_t kBatchMessageFormat = 0x22;
 
+    // the bitmap bits of the batched format's own fields; the others
+    // come from the schema in Catena-PMS7003-Port1.h.
     enum class Flags : uint8_t
             {
-            Vbat = 1 << 0,
-            Vcc = 1 << 1,
-            Vbus = 1 << 2,  // Vbus input
-            Boot = 1 << 3,
-            TPH = 1 << 4,    // temperature, pressure, humidity
-            PM = 1 << 5,    // Particulate matter
-            Dust = 1 << 6,  // Dust
+            Batch = 1 << 5, // in kBatchMessageFormat: the intervals
+            Seq = 1 << 6,   // in kBatchMessageFormat: first interval's log sequence number
             };
 
-    static constexpr size_t kTxBufferSize = 36;
+    // a single interval takes 29 bytes at most; a batch (and its
+    // sequence number) is cut to fit here. 115 bytes fits EU868 DR3 and
+    // US915 DR2 and up.
+    static constexpr size_t kTxBufferSize = 115;
     using TxBuffer_t = McciCatena::AbstractTxBuffer_t<kTxBufferSize>;
 
     // initialize measurement FSM.
@@ -156,8 +202,172 @@ public:
     // request that the measurement loop be active/inactive
     void requestActive(bool fEnable);
 
+    // the number of PM readings in each measurement window, by default
+    // and at most. The window's storage is sized for the maximum.
+    static constexpr unsigned kDefaultMeasurements = 10;
+    static constexpr unsigned kMaxMeasurements = 60;
+
+    // set the number of readings in each window, from 1 to
+    // kMaxMeasurements; takes effect at the next window. Returns false
+    // (and changes nothing) if nMeasurements is out of range.
+    bool setMeasurementWindow(unsigned nMeasurements)
+        {
+        if (nMeasurements < 1 || nMeasurements > kMaxMeasurements)
+            return false;
+
+        this->m_nMeasurementsRequested = nMeasurements;
+        return true;
+        }
+    // the requested number of readings in each window.
+    unsigned getMeasurementWindow() const
+        {
+        return this->m_nMeasurementsRequested;
+        }
+
+    // the most intervals one uplink can carry, and how long the oldest
+    // waits at most, by default.
+    static constexpr unsigned kMaxBatchIntervals = 8;
+    static constexpr std::uint32_t kDefaultBatchLatencySec = 60 * 60;
+
+    // send the results of nIntervals measurement intervals in each
+    // uplink, or fewer if waiting for the next interval would hold the
+    // oldest longer than maxLatencySec. One interval (the default)
+    // sends kMessageFormat, as before; more send kBatchMessageFormat.
+    // Returns false (and changes nothing) if nIntervals is out of range.
+    bool setBatch(unsigned nIntervals, std::uint32_t maxLatencySec)
+        {
+        if (nIntervals < 1 || nIntervals > kMaxBatchIntervals)
+            return false;
+
+        this->m_nBatchIntervals = nIntervals;
+        this->m_batchLatencySec = maxLatencySec;
+        return true;
+        }
+    unsigned getBatchIntervals() const
+        {
+        return this->m_nBatchIntervals;
+        }
+    std::uint32_t getBatchLatency() const
+        {
+        return this->m_batchLatencySec;
+        }
+
+    // report by exception: send (or batch) an interval only if it
+    // differs enough from the last one reported, or the heartbeat
+    // interval is up; see Catena-PMS7003-Report.h. Off by default. The
+    // policy's settings can be changed whether or not it's on.
+    void setReportByException(bool fEnable)
+        {
+        this->m_fReportByException = fEnable;
+        this->m_report.reset();
+        }
+    bool getReportByException() const
+        {
+        return this->m_fReportByException;
+        }
+    McciCatenaPMS7003::cReportByException &getReportPolicy()
+        {
+        return this->m_report;
+        }
+
+    // how deeply the PM sensor sleeps between cycles: by default, as
+    // deeply as pays for itself, given the time to the next cycle and
+    // the measured recovery times; see Catena-PMS7003-KeepWarm.h.
+    McciCatenaPMS7003::cKeepWarmPolicy &getKeepWarm()
+        {
+        return this->m_keepWarm;
+        }
+
+    // send the AQI (field 7; see Catena-PMS7003-Aqi.h) in single-interval
+    // uplinks, along with the concentrations. Off by default.
+    void setAqiField(bool fEnable)
+        {
+        this->m_fAqiField = fEnable;
+        }
+    bool getAqiField() const
+        {
+        return this->m_fAqiField;
+        }
+
+    // the EPA NowCast of the intervals measured; see
+    // Catena-PMS7003-NowCast.h.
+    const McciCatenaPMS7003::cNowCast &getNowCast() const
+        {
+        return this->m_nowCast;
+        }
+
+    // send each reading, and the PM sensor's receive statistics, on the
+    // console as binary records, instead of printing the readings; see
+    // Catena-PMS7003-ConsoleStream.h. Off by default.
+    void setConsoleStream(bool fEnable);
+    const McciCatenaPMS7003::cConsoleStream &getConsoleStream() const
+        {
+        return this->m_consoleStream;
+        }
+
 private:
-    static constexpr unsigned kNumMeasurements = 10;
+    // the estimator for each channel; see Catena-PMS7003-ReducePolicy.h.
+    // Only the IQR mean can be computed by streaming.
+    using ReductionPolicy_t = McciCatenaPMS7003::cIqrMeanPolicy;
+
+    // set true to leave the PM sensor running while the node is on USB
+    // power, and uplink the reduction of its most recent readings
+    // (m_nMeasurements of them), rather than waking it for a fresh
+    // window before each uplink.
+    static constexpr bool kfContinuousOnUsb = true;
+
+    // the window of recent readings, for continuous mode; a token one
+    // if there's no continuous mode.
+    using SlidingWindow_t = McciCatenaPMS7003::cSlidingWindow<
+                                kfContinuousOnUsb ? kMaxMeasurements : 1,
+                                ReductionPolicy_t
+                                >;
+
+    // true to reduce each channel as the readings arrive, in a fixed
+    // amount of RAM, rather than keeping the readings and sorting them.
+    // It's slower, so it's chosen only when it saves RAM: when the
+    // window is longer than about 56 readings, and the sliding window,
+    // which shares its storage, is smaller (that is, continuous mode is
+    // compiled out). The results are the same up to
+    // cStreamingIqrMean<>::kMaxExact (63) readings, and close beyond
+    // that; see Catena-PMS7003-Streaming.h.
+    static constexpr bool kfStreamingReduction =
+        std::is_same<ReductionPolicy_t, McciCatenaPMS7003::cIqrMeanPolicy>::value &&
+        sizeof(McciCatenaPMS7003::cStreamingIqrWindow<>) <
+            sizeof(McciCatenaPMS7003::cReductionWindow<kMaxMeasurements, ReductionPolicy_t>) &&
+        sizeof(SlidingWindow_t) <
+            sizeof(McciCatenaPMS7003::cReductionWindow<kMaxMeasurements, ReductionPolicy_t>);
+
+    // the countdown before the first deep sleep, in seconds: with
+    // fDeepSleepTest set, and otherwise, when the node is unattended.
+    // 0 skips it.
+    static constexpr std::uint32_t kDeepSleepTestCountdownSec = 10;
+    static constexpr std::uint32_t kUnattendedCountdownSec = CATENA_PMS7003_LORA_UNATTENDED_COUNTDOWN_SEC;
+
+    // the measurement window.
+    using Window_t = std::conditional_t<
+                        kfStreamingReduction,
+                        McciCatenaPMS7003::cStreamingIqrWindow<>,
+                        McciCatenaPMS7003::cReductionWindow<kMaxMeasurements, ReductionPolicy_t>
+                        >;
+
+    // the intervals waiting to be sent.
+    using UplinkBatch_t = McciCatenaPMS7003::cUplinkBatch<kMaxBatchIntervals>;
+
+    // the log of intervals in the SPI flash, if there is one: the top
+    // 256 KiB of the 1 MiB part, 8192 records, or 34 days at the default
+    // uplink interval. Intervals that don't get sent stay there, and are
+    // sent after the next uplink that gets through, in up to
+    // kMaxDrainUplinks extra uplinks each time. See
+    // Catena-PMS7003-FlashLog.h.
+    static constexpr std::uint32_t kFlashLogBase = 0xC0000;
+    static constexpr std::uint32_t kFlashLogSectors = 64;
+    static constexpr unsigned kMaxDrainUplinks = 4;
+    using FlashLog_t = McciCatenaPMS7003::cFlashLog<
+                            McciCatena::Catena_Mx25v8035f,
+                            kFlashLogBase,
+                            kFlashLogSectors
+                            >;
 
     // evaluate the control FSM.
     State fsmDispatch(State currentState, bool fEntry);
@@ -183,9 +393,11 @@ private:
         }
 
     // sleep handling
+    void sleepPms();
     void sleep();
     bool checkDeepSleep();
     void doSleepAlert(bool fDeepSleep);
+    bool pollSleepCountdown(bool fDeepSleep);
     void doDeepSleep();
     void deepSleepPrepare();
     void deepSleepRecovery();
@@ -194,8 +406,15 @@ private:
     void resetMeasurement()
         {
         this->m_iMeasurement = 0;
+        this->m_nMeasurements = this->m_nMeasurementsRequested;
         this->m_measurement_received = false;
         this->m_measurement_valid = false;
+        this->m_window.reset();
+        }
+    void setContinuous(bool fContinuous);
+    bool continuousAllowed() const
+        {
+        return kfContinuousOnUsb && this->m_fUsbPower;
         }
     bool measurementAwake()
         {
@@ -203,36 +422,71 @@ private:
         }
     bool measurementComplete()
         {
-        return this->m_iMeasurement >= kNumMeasurements;
+        return this->m_iMeasurement >= this->m_nMeasurements;
         }
     static void measurementAvailable(
         void *pUserData,
         const McciCatenaPMS7003::cPMS7003::Measurements<std::uint16_t> *pData,
-        bool fWarmedUp
+        bool fWarmedUp,
+        std::uint32_t tFrameMs
         );
     void processMeasurement(
         const McciCatenaPMS7003::cPMS7003::Measurements<std::uint16_t> *pData,
-        bool fWarmedUp
-        );
-    void processOneMeasurement(
-        float &r,
-        std::uint16_t *pv
+        bool fWarmedUp,
+        std::uint32_t tFrameMs
         );
+    bool getWindowTimes(std::uint32_t &tFirst, std::uint32_t &tLast) const;
+    void streamRxStats(bool fForce);
     bool postProcess(
-        McciCatenaPMS7003::cPMS7003::Measurements<float> &results
+        std::uint16_t (&results)[McciCatenaPMS7003::kReduceChannels]
+        );
+    void readVbat();
+    void readHousekeeping();
+    void fillTxBuffer(
+        TxBuffer_t &b,
+        const std::uint16_t (&results)[McciCatenaPMS7003::kReduceChannels],
+        bool fValid
         );
-    void fillTxBuffer(TxBuffer_t &b);
+    void fillTxBuffer(
+        TxBuffer_t &b,
+        const UplinkBatch_t *pBatch,
+        std::uint32_t seq,
+        const std::uint16_t *pResults
+        );
+    bool batching() const
+        {
+        // also while intervals are left from a larger batch setting.
+        return this->m_nBatchIntervals > 1 || this->m_batch.getCount() != 0;
+        }
+    bool reportDue(
+        const std::uint16_t (&results)[McciCatenaPMS7003::kReduceChannels],
+        bool fValid
+        );
+    void saveInterval(
+        const std::uint16_t (&results)[McciCatenaPMS7003::kReduceChannels],
+        bool fValid,
+        std::uint32_t tInterval
+        );
+    void updateNowCast(
+        const std::uint16_t (&results)[McciCatenaPMS7003::kReduceChannels],
+        bool fValid,
+        std::uint32_t tInterval
+        );
+    bool batchDue() const;
+    std::uint32_t drainLimit() const
+        {
+        // the intervals held for a batch are sent in their own time.
+        return this->m_batch.getCount() != 0 ? this->m_seqBatch : this->m_log.getNextSeq();
+        }
+    bool drainPending();
+    bool startDrain();
+    void markTxSent();
     void startTransmission(TxBuffer_t &b);
     void sendBufferDone(bool fSuccess);
     bool txComplete()
         {
         return this->m_txcomplete;
         }
-    static std::uint16_t particle2uf(float v)
-        {
-        return McciCatena::TxBuffer_t::f2uflt16(v);
-        }
-
     void updateTxCycleTime();
 
     // instance data
@@ -278,13 +532,76 @@ private:
     bool                m_txerr : 1;
     // set true when we've printed how we plan to sleep
     bool                m_fPrintedSleeping : 1;
-
-    // index of next measurement in array.
+    // set true while the PM sensor is left running (stContinuous).
+    bool                m_fContinuous : 1;
+    // set true to report by exception.
+    bool                m_fReportByException : 1;
+    // set true to send the AQI field.
+    bool                m_fAqiField : 1;
+    // set true when m_txHousekeeping has been read for this cycle.
+    bool                m_fHousekeeping : 1;
+
+    // index of next measurement in window.
     unsigned            m_iMeasurement;
-    // the collection of arrays of PM measurements
-    McciCatenaPMS7003::cPMS7003::PmBins<std::uint16_t[kNumMeasurements]> m_Pm;
-    // the collection of arrays of dust measurements
-    McciCatenaPMS7003::cPMS7003::DustBins<std::uint16_t[kNumMeasurements]> m_Dust;
+    // number of measurements in the current window.
+    unsigned            m_nMeasurements;
+    // number of measurements requested for the next window.
+    unsigned            m_nMeasurementsRequested;
+    // the measurements: the window, or in continuous mode, the most
+    // recent measurements. Only one is in use at a time, so they share
+    // storage; setContinuous() switches between them.
+    union
+        {
+        Window_t        m_window;
+        SlidingWindow_t m_sliding;
+        };
+    // the times of the first and last measurements of the window, by
+    // millis() at their first byte.
+    std::uint32_t       m_tWindowFirst;
+    std::uint32_t       m_tWindowLast;
+
+    // the intervals not yet sent.
+    UplinkBatch_t       m_batch;
+    // the number of intervals per uplink, and the longest wait.
+    unsigned            m_nBatchIntervals;
+    std::uint32_t       m_batchLatencySec;
+
+    // the report-by-exception policy, and the last interval reported.
+    McciCatenaPMS7003::cReportByException
+                        m_report;
+
+    // the values every uplink carries (Vbat, Vbus, boot count and the
+    // BME280), read while the PM sensor warms up.
+    McciCatenaPMS7003::cPort1Message
+                        m_txHousekeeping;
+
+    // the keep-warm policy; how the PM sensor was last put to sleep,
+    // and when it was last woken.
+    McciCatenaPMS7003::cKeepWarmPolicy
+                        m_keepWarm;
+    McciCatenaPMS7003::cKeepWarmPolicy::Depth
+                        m_pmsSleepDepth;
+    std::uint32_t       m_tPmsWake;
+
+    // the readings, in binary on the console, if on.
+    McciCatenaPMS7003::cConsoleStream
+                        m_consoleStream;
+
+    // the hourly averages, and the NowCast.
+    McciCatenaPMS7003::cNowCast
+                        m_nowCast;
+
+    // the flash log, and the sequence numbers of the latest interval
+    // and of the oldest one in m_batch.
+    FlashLog_t          m_log;
+    std::uint32_t       m_seqLast;
+    std::uint32_t       m_seqBatch;
+    // the intervals in the pending uplink: the first one's sequence
+    // number, and how many.
+    std::uint32_t       m_seqTx;
+    std::size_t         m_nTxIntervals;
+    // the number of uplinks sent from the flash log this time round.
+    unsigned            m_nDrainUplinks;
 
     // uplink time control
     McciCatena::cTimer  m_UplinkTimer;
@@ -295,6 +612,9 @@ private:
     // for simple internal timer.
     std::uint32_t           m_timer_start;
     std::uint32_t           m_timer_delay;
+
+    // seconds left in the countdown to deep sleep; 0 if none.
+    std::uint32_t           m_sleepCountdown;
     };
 
 static constexpr cMeasurementLoop::Flags operator| (const cMeasurementLoop::Flags lhs, const cMeasurementLoop::Flags rhs)
@@ -302,7 +622,7 @@ static constexpr cMeasurementLoop::Flags operator| (const cMeasurementLoop::Flag
         return cMeasurementLoop::Flags(uint8_t(lhs) | uint8_t(rhs));
         };
 
-static cMeasurementLoop::Flags operator|= (cMeasurementLoop::Flags &lhs, const cMeasurementLoop::Flags &rhs)
+inline cMeasurementLoop::Flags operator|= (cMeasurementLoop::Flags &lhs, const cMeasurementLoop::Flags &rhs)
         {
         lhs = lhs | rhs;
         return lhs;
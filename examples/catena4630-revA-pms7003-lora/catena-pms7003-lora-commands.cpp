@@ -35,6 +35,7 @@ using namespace McciCatenaPMS7003;
 
 extern cPMS7003 gPms7003;
 extern cPMS7003Hal_4630 gPmsHal;
+extern cTraceRing gTraceRing;
 extern cMeasurementLoop gMeasurementLoop;
 
 /****************************************************************************\
@@ -132,3 +133,484 @@ cCommandStream::CommandStatus cmdStats(
         return cCommandStream::CommandStatus::kSuccess;
         }
 
+/* process "window" */
+// argv[0] is the matched command name.
+// argv[1] if present is the new number of readings per window
+cCommandStream::CommandStatus cmdWindow(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc < 2)
+            pThis->printf("window: %u readings\n", gMeasurementLoop.getMeasurementWindow());
+        else if (argc > 2)
+            {
+            fResult = false;
+            pThis->printf("too many args\n");
+            }
+        else
+            {
+            std::uint32_t nWindow;
+            bool fOverflow;
+            size_t const nArg = std::strlen(argv[1]);
+
+            if (nArg != McciAdkLib_BufferToUint32(
+                                argv[1], nArg,
+                                0,
+                                &nWindow, &fOverflow
+                                ) || fOverflow ||
+                ! gMeasurementLoop.setMeasurementWindow(nWindow))
+                {
+                pThis->printf("invalid window: %s (1 to %u)\n", argv[1], cMeasurementLoop::kMaxMeasurements);
+                fResult = false;
+                }
+            else
+                {
+                pThis->printf("window is now %u readings\n", gMeasurementLoop.getMeasurementWindow());
+                }
+            }
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "batch" */
+// argv[0] is the matched command name.
+// argv[1] if present is the new number of intervals per uplink
+// argv[2] if present is the new longest wait, in seconds
+cCommandStream::CommandStatus cmdBatch(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc < 2)
+            pThis->printf("batch: %u intervals, at most %u sec\n",
+                gMeasurementLoop.getBatchIntervals(),
+                unsigned(gMeasurementLoop.getBatchLatency())
+                );
+        else if (argc > 3)
+            {
+            fResult = false;
+            pThis->printf("too many args\n");
+            }
+        else
+            {
+            std::uint32_t nIntervals;
+            std::uint32_t latency = gMeasurementLoop.getBatchLatency();
+            bool fOverflow;
+            size_t nArg = std::strlen(argv[1]);
+
+            if (nArg != McciAdkLib_BufferToUint32(
+                                argv[1], nArg,
+                                0,
+                                &nIntervals, &fOverflow
+                                ) || fOverflow)
+                fResult = false;
+
+            if (fResult && argc > 2)
+                {
+                nArg = std::strlen(argv[2]);
+                if (nArg != McciAdkLib_BufferToUint32(
+                                    argv[2], nArg,
+                                    0,
+                                    &latency, &fOverflow
+                                    ) || fOverflow)
+                    fResult = false;
+                }
+
+            if (! fResult || ! gMeasurementLoop.setBatch(nIntervals, latency))
+                {
+                pThis->printf("invalid batch (1 to %u intervals)\n", cMeasurementLoop::kMaxBatchIntervals);
+                fResult = false;
+                }
+            else
+                {
+                pThis->printf("batch is now %u intervals, at most %u sec\n",
+                    gMeasurementLoop.getBatchIntervals(),
+                    unsigned(gMeasurementLoop.getBatchLatency())
+                    );
+                }
+            }
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "aqi" */
+// argv[0] is the matched command name.
+// argv[1] if present is "on" or "off"
+cCommandStream::CommandStatus cmdAqi(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc > 2)
+            {
+            fResult = false;
+            pThis->printf("too many args\n");
+            }
+        else if (argc > 1)
+            {
+            if (std::strcmp(argv[1], "on") == 0)
+                gMeasurementLoop.setAqiField(true);
+            else if (std::strcmp(argv[1], "off") == 0)
+                gMeasurementLoop.setAqiField(false);
+            else
+                {
+                fResult = false;
+                pThis->printf("usage: aqi [on | off]\n");
+                }
+            }
+
+        if (fResult)
+            pThis->printf("aqi field: %s\n", gMeasurementLoop.getAqiField() ? "on" : "off");
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "nowcast" -- args are ignored */
+// argv[0] is the matched command name.
+cCommandStream::CommandStatus cmdNowCast(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        auto const &nowCast = gMeasurementLoop.getNowCast();
+        std::uint32_t c2p5, c10, aqi;
+
+        pThis->printf("%s\n", argv[0]);
+
+        // the hourly averages, newest first, in µg/m^3.
+        for (std::size_t age = 0; age < cNowCast::kHours; ++age)
+            {
+            std::uint32_t avg2p5, avg10;
+
+            if (nowCast.getHourlyAverage(cNowCast::kPm2p5, age, avg2p5) &&
+                nowCast.getHourlyAverage(cNowCast::kPm10, age, avg10))
+                pThis->printf("-%2u h: PM2.5 %u PM10 %u\n",
+                    unsigned(age + 1),
+                    unsigned(avg2p5 >> cNowCast::kFracBits),
+                    unsigned(avg10 >> cNowCast::kFracBits)
+                    );
+            }
+
+        if (nowCast.getConcentration(cNowCast::kPm2p5, c2p5) &&
+            nowCast.getConcentration(cNowCast::kPm10, c10) &&
+            nowCast.getAqi(aqi))
+            pThis->printf("NowCast: PM2.5 %u.%u PM10 %u ug/m3, AQI %u\n",
+                unsigned(c2p5 / 10), unsigned(c2p5 % 10), unsigned(c10 / 10), unsigned(aqi)
+                );
+        else
+            pThis->printf("NowCast: not enough data\n");
+
+        return cCommandStream::CommandStatus::kSuccess;
+        }
+
+/* process "rbe" */
+// argv[0] is the matched command name.
+// argv[1] if present is "on" or "off"
+// argv[2] if present is the new heartbeat, in seconds
+// argv[3] if present is the new relative threshold, in percent
+// argv[4..12] if present are the new thresholds for the channels, in
+//      uplink order: pm 1.0, 2.5 and 10, then the dust counts.
+cCommandStream::CommandStatus cmdReport(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+        auto &report = gMeasurementLoop.getReportPolicy();
+
+        auto getArg = [](const char *pArg, std::uint32_t &v) -> bool
+            {
+            bool fOverflow;
+            size_t const nArg = std::strlen(pArg);
+
+            return nArg == McciAdkLib_BufferToUint32(
+                                pArg, nArg,
+                                0,
+                                &v, &fOverflow
+                                ) && ! fOverflow;
+            };
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc > 4 + int(kReduceChannels))
+            {
+            fResult = false;
+            pThis->printf("too many args\n");
+            }
+        else if (argc > 2 && std::strcmp(argv[1], "on") != 0)
+            {
+            fResult = false;
+            pThis->printf("settings need \"on\"\n");
+            }
+        else if (argc > 1)
+            {
+            std::uint32_t heartbeat = report.getHeartbeat();
+            std::uint32_t percent = report.getPercent();
+            std::uint32_t threshold[kReduceChannels];
+
+            for (std::size_t c = 0; c < kReduceChannels; ++c)
+                threshold[c] = report.getThreshold(c);
+
+            if (std::strcmp(argv[1], "on") != 0 && std::strcmp(argv[1], "off") != 0)
+                fResult = false;
+            if (fResult && argc > 2)
+                fResult = getArg(argv[2], heartbeat);
+            if (fResult && argc > 3)
+                fResult = getArg(argv[3], percent) && percent <= 255;
+            for (int i = 4; fResult && i < argc; ++i)
+                fResult = getArg(argv[i], threshold[i - 4]) && threshold[i - 4] <= 0xFFFF;
+
+            if (! fResult)
+                pThis->printf("usage: rbe [off | on [heartbeat-sec [percent [thresholds...]]]]\n");
+            else
+                {
+                report.setHeartbeat(heartbeat);
+                report.setPercent(percent);
+                for (std::size_t c = 0; c < kReduceChannels; ++c)
+                    report.setThreshold(c, std::uint16_t(threshold[c]));
+                gMeasurementLoop.setReportByException(argv[1][1] == 'n');
+                }
+            }
+
+        if (fResult)
+            {
+            pThis->printf("rbe: %s, heartbeat %u sec, %u%% and",
+                gMeasurementLoop.getReportByException() ? "on" : "off",
+                unsigned(report.getHeartbeat()),
+                report.getPercent()
+                );
+            for (std::size_t c = 0; c < kReduceChannels; ++c)
+                pThis->printf(" %u", unsigned(report.getThreshold(c)));
+            pThis->printf("\n");
+            }
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "keepwarm" */
+// argv[0] is the matched command name.
+// argv[1] if present is "auto", or the one depth to use between cycles:
+//      "off", "hwsleep" or "swsleep".
+cCommandStream::CommandStatus cmdKeepWarm(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+        auto &keepWarm = gMeasurementLoop.getKeepWarm();
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc > 2)
+            {
+            fResult = false;
+            pThis->printf("too many args\n");
+            }
+        else if (argc > 1)
+            {
+            fResult = std::strcmp(argv[1], "auto") == 0;
+            if (fResult)
+                keepWarm.setAllowed(cKeepWarmPolicy::kAllDepths);
+
+            for (std::size_t d = 0; d < cKeepWarmPolicy::kDepths && ! fResult; ++d)
+                {
+                fResult = std::strcmp(argv[1], cKeepWarmPolicy::getDepthName(cKeepWarmPolicy::Depth(d))) == 0;
+                if (fResult)
+                    keepWarm.setAllowed(std::uint8_t(1u << d));
+                }
+
+            if (! fResult)
+                pThis->printf("usage: keepwarm [auto | off | hwsleep | swsleep]\n");
+            }
+
+        if (fResult)
+            {
+            // otherwise, one depth is allowed: bit 0, 1 or 2, so
+            // allowed / 2 is its index.
+            std::uint8_t const allowed = keepWarm.getAllowed();
+
+            pThis->printf("keepwarm: %s\n",
+                allowed == cKeepWarmPolicy::kAllDepths ? "auto"
+                    : cKeepWarmPolicy::getDepthName(cKeepWarmPolicy::Depth(allowed / 2))
+                );
+
+            // for each depth: the recovery time, and how often it's been
+            // chosen; for the sleeps, the longest wait it pays for.
+            for (std::size_t d = 0; d < cKeepWarmPolicy::kDepths; ++d)
+                {
+                auto const depth = cKeepWarmPolicy::Depth(d);
+
+                pThis->printf("%-8s recovery %u ms%s, chosen %u",
+                    cKeepWarmPolicy::getDepthName(depth),
+                    unsigned(keepWarm.getRecoveryMs(depth)),
+                    keepWarm.isMeasured(depth) ? "" : " (default)",
+                    unsigned(keepWarm.getChosenCount(depth))
+                    );
+                if (depth != cKeepWarmPolicy::Depth::Off)
+                    pThis->printf(", up to %u s", unsigned(keepWarm.getBreakEvenMs(depth) / 1000));
+                pThis->printf("\n");
+                }
+            }
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "trace" */
+// argv[0] is the matched command name.
+// argv[1] if present is "on" (keep the library's traces in the ring),
+//      "off" (print them), or "dump" (print the ring's records in hex,
+//      one per line, for extras/pms7003-trace.cpp, and empty it).
+cCommandStream::CommandStatus cmdTrace(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc > 2)
+            {
+            fResult = false;
+            pThis->printf("too many args\n");
+            }
+        else if (argc > 1)
+            {
+            if (std::strcmp(argv[1], "on") == 0)
+                gPmsHal.setTraceRing(&gTraceRing);
+            else if (std::strcmp(argv[1], "off") == 0)
+                gPmsHal.setTraceRing(nullptr);
+            else if (std::strcmp(argv[1], "dump") == 0)
+                {
+                std::uint8_t rec[kMaxTraceRecord];
+                char line[2 + 2 * sizeof(rec) + 1];
+                std::uint32_t nRecords = 0;
+                std::uint32_t const nLost = gTraceRing.getLost();
+
+                while (gTraceRing.read(rec, sizeof(rec)) != 0)
+                    {
+                    std::size_t const n = kTraceHeaderSize + rec[1];
+
+                    line[0] = 'T';
+                    line[1] = ':';
+                    for (std::size_t i = 0; i < n; ++i)
+                        {
+                        line[2 + 2 * i] = "0123456789abcdef"[rec[i] >> 4];
+                        line[3 + 2 * i] = "0123456789abcdef"[rec[i] & 0xF];
+                        }
+                    line[2 + 2 * n] = '\0';
+                    pThis->printf("%s\n", line);
+                    ++nRecords;
+                    }
+
+                gTraceRing.clear();
+                pThis->printf("dumped %u records, %u lost\n", unsigned(nRecords), unsigned(nLost));
+                }
+            else
+                {
+                fResult = false;
+                pThis->printf("usage: trace [on | off | dump]\n");
+                }
+            }
+
+        if (fResult)
+            {
+            pThis->printf("trace: %s, %u records, %u of %u bytes, %u lost\n",
+                gPmsHal.getTraceRing() != nullptr ? "on" : "off",
+                unsigned(gTraceRing.getRecords()),
+                unsigned(gTraceRing.getBytes()),
+                unsigned(gTraceRing.getCapacity()),
+                unsigned(gTraceRing.getLost())
+                );
+            }
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "stream" */
+// argv[0] is the matched command name.
+// argv[1] if present is "on" (send the readings on the console as
+//      binary records, for extras/pms7003-stream.cpp) or "off" (print
+//      them).
+cCommandStream::CommandStatus cmdStream(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc > 2)
+            {
+            fResult = false;
+            pThis->printf("too many args\n");
+            }
+        else if (argc > 1)
+            {
+            if (std::strcmp(argv[1], "on") == 0)
+                gMeasurementLoop.setConsoleStream(true);
+            else if (std::strcmp(argv[1], "off") == 0)
+                gMeasurementLoop.setConsoleStream(false);
+            else
+                {
+                fResult = false;
+                pThis->printf("usage: stream [on | off]\n");
+                }
+            }
+
+        if (fResult)
+            {
+            auto const &stream = gMeasurementLoop.getConsoleStream();
+
+            pThis->printf("stream: %s, %u records\n",
+                stream.isRunning() ? "on" : "off",
+                unsigned(stream.getRecords())
+                );
+            }
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
@@ -72,6 +72,11 @@ cPMS7003Hal_4630 gPmsHal
      cPMS7003::DebugFlags::kTrace)
     };
 
+// the trace ring: with "trace on", the library's traces are kept here
+// in binary, rather than printed.
+static std::uint8_t sTraceBuffer[1024];
+cTraceRing gTraceRing { sTraceBuffer, sizeof(sTraceBuffer) };
+
 // the PMS7003 instance
 cPMS7003 gPms7003 { Serial2, gPmsHal };
 
@@ -82,6 +87,14 @@ cMeasurementLoop gMeasurementLoop { gPms7003, gBme280 };
 cCommandStream::CommandFn cmdDebugMask;
 cCommandStream::CommandFn cmdRunStop;
 cCommandStream::CommandFn cmdStats;
+cCommandStream::CommandFn cmdWindow;
+cCommandStream::CommandFn cmdBatch;
+cCommandStream::CommandFn cmdReport;
+cCommandStream::CommandFn cmdAqi;
+cCommandStream::CommandFn cmdNowCast;
+cCommandStream::CommandFn cmdKeepWarm;
+cCommandStream::CommandFn cmdTrace;
+cCommandStream::CommandFn cmdStream;
 
 // the individual commmands are put in this table
 static const cCommandStream::cEntry sMyExtraCommmands[] =
@@ -90,6 +103,14 @@ static const cCommandStream::cEntry sMyExtraCommmands[] =
         { "run", cmdRunStop },
         { "stats", cmdStats },
         { "stop", cmdRunStop },
+        { "window", cmdWindow },
+        { "batch", cmdBatch },
+        { "rbe", cmdReport },
+        { "aqi", cmdAqi },
+        { "nowcast", cmdNowCast },
+        { "keepwarm", cmdKeepWarm },
+        { "trace", cmdTrace },
+        { "stream", cmdStream },
         // other commands go here....
         };
 
@@ -102,6 +123,37 @@ sMyExtraCommands_top(
         nullptr                     /* this is no "first word" for all the commands in this table */
         );
 
+/****************************************************************************\
+|
+|   Downlinks
+|
+\****************************************************************************/
+
+// called by the LoRaWAN stack for every downlink. A one-byte message on
+// cMeasurementLoop::kWindowDownlinkPort sets the number of readings per
+// measurement window, as the "window" command does.
+static void receiveMessage(
+    void *pContext,
+    uint8_t port,
+    const uint8_t *pMessage,
+    size_t nMessage
+    )
+    {
+    if (port == 0)
+        return;
+
+    if (port != cMeasurementLoop::kWindowDownlinkPort || nMessage != 1)
+        {
+        gCatena.SafePrintf("invalid downlink: port %u length %u\n", port, unsigned(nMessage));
+        return;
+        }
+
+    if (gMeasurementLoop.setMeasurementWindow(pMessage[0]))
+        gCatena.SafePrintf("downlink: window is now %u readings\n", gMeasurementLoop.getMeasurementWindow());
+    else
+        gCatena.SafePrintf("downlink: invalid window %u (1 to %u)\n", pMessage[0], cMeasurementLoop::kMaxMeasurements);
+    }
+
 /****************************************************************************\
 |
 |   Setup
@@ -193,6 +245,7 @@ void setup_radio()
     {
     gLoRaWAN.begin(&gCatena);
     gCatena.registerObject(&gLoRaWAN);
+    gLoRaWAN.SetReceiveBufferBufferCb(receiveMessage);
     LMIC_setClockError(5 * MAX_CLOCK_ERROR / 100);
     }
 
@@ -3,7 +3,7 @@
 Name:   catena-message-port1-format-20-decoder-ttn.js
 
 Function:
-    Decode port 0x01 format 0x20 and 0x21 messages for TTN console.
+    Decode port 0x01 format 0x20 to 0x23 messages for TTN console.
 
 Copyright and License:
     See accompanying LICENSE file at https://github.com/mcci-catena/MCCI-Catena-PMS7003/
@@ -190,7 +190,10 @@ function DecodeU16(Parse) {
 }
 
 function DecodeUflt16(Parse) {
-    var rawUflt16 = DecodeU16(Parse);
+    return Uflt16Value(DecodeU16(Parse));
+}
+
+function Uflt16Value(rawUflt16) {
     var exp1 = rawUflt16 >> 12;
     var mant1 = (rawUflt16 & 0xFFF) / 4096.0;
     var f_unscaled = mant1 * Math.pow(2, exp1 - 15);
@@ -232,6 +235,100 @@ function DecodeV(Parse) {
     return DecodeI16(Parse) / 4096.0;
 }
 
+// a LEB128 unsigned number: 7 bits per byte, least significant first.
+function DecodeVarint(Parse) {
+    var v = 0;
+    var scale = 1;
+    var b;
+
+    do {
+        b = Parse.bytes[Parse.i++];
+        v += (b & 0x7F) * scale;
+        scale *= 128;
+    } while (b & 0x80);
+
+    return v;
+}
+
+// set the PM fields of result, given the concentrations.
+function SetPm(result, pm1_0, pm2_5, pm10) {
+    result.pm = {};
+    result.pm["1.0"] = pm1_0;
+    result.pm["2.5"] = pm2_5;
+    result.pm["10"] = pm10;
+
+    result.aqi_partial = {};
+    var aqi = CalculatePmAqi(pm1_0, null);
+    result.aqi_partial["1.0"] = aqi.AQI;
+
+    aqi = CalculatePmAqi(pm2_5, pm10);
+    result.aqi_partial["2.5"] = aqi.AQI_2_5;
+    result.aqi_partial["10"] = aqi.AQI_10;
+    result.aqi = aqi.AQI;
+}
+
+// field 5 of formats 0x22 and 0x23: a batch of intervals, oldest first.
+// Each gets its age in seconds at the uplink and, if it has particle
+// data, pm, aqi and dust as in formats 0x20 and 0x21. The newest
+// interval with data is also copied to the top level.
+function DecodeBatch(Parse, decoded) {
+    var nIntervals = Parse.bytes[Parse.i++];
+    var validMap = Parse.bytes[Parse.i++];
+    var deltaMap = Parse.bytes[Parse.i++];
+    var age = DecodeU16(Parse);
+    var codes = null;
+    var latest = null;
+
+    decoded.intervals = [];
+    for (var iInterval = 0; iInterval < nIntervals; ++iInterval) {
+        var interval = {};
+        var c;
+
+        if (iInterval > 0)
+            age -= DecodeVarint(Parse);
+        interval.age = age;
+
+        if (validMap & (1 << iInterval)) {
+            if (! (deltaMap & (1 << iInterval))) {
+                codes = [];
+                for (c = 0; c < 9; ++c)
+                    codes.push(DecodeU16(Parse));
+            } else {
+                // zigzag differences from the previous interval with
+                // data, modulo 2^16.
+                for (c = 0; c < 9; ++c) {
+                    var z = DecodeVarint(Parse);
+                    var d = (z % 2) ? -(z + 1) / 2 : z / 2;
+                    codes[c] = (codes[c] + d) & 0xFFFF;
+                }
+            }
+
+            var v = [];
+            for (c = 0; c < 9; ++c)
+                v.push(Uflt16Value(codes[c]) * 65536.0);
+
+            SetPm(interval, v[0], v[1], v[2]);
+            interval.dust = {};
+            interval.dust["0.3"] = v[3];
+            interval.dust["0.5"] = v[4];
+            interval.dust["1.0"] = v[5];
+            interval.dust["2.5"] = v[6];
+            interval.dust["5"] = v[7];
+            interval.dust["10"] = v[8];
+            latest = interval;
+        }
+
+        decoded.intervals.push(interval);
+    }
+
+    if (latest !== null) {
+        decoded.pm = latest.pm;
+        decoded.aqi_partial = latest.aqi_partial;
+        decoded.aqi = latest.aqi;
+        decoded.dust = latest.dust;
+    }
+}
+
 function Decoder(bytes, port) {
     // Decode an uplink message from a buffer
     // (array) of bytes to an object of fields.
@@ -241,9 +338,14 @@ function Decoder(bytes, port) {
         return null;
 
     var uFormat = bytes[0];
-    if (! (uFormat === 0x20 || uFormat === 0x21))
+    if (! (uFormat >= 0x20 && uFormat <= 0x23))
         return null;
 
+    // 0x22 and 0x23 are 0x20 and 0x21 with a batch of intervals in
+    // field 5; 0x20 and 0x22 have pressure.
+    var fBatch = (uFormat & 0x02) !== 0;
+    var fPressure = (uFormat & 0x01) === 0;
+
     // an object to help us parse.
     var Parse = {};
     Parse.bytes = bytes;
@@ -273,7 +375,7 @@ function Decoder(bytes, port) {
     if (flags & 0x10) {
         // we have temp, pressure, RH
         decoded.tempC = DecodeI16(Parse) / 256;
-        if (uFormat === 0x20)
+        if (fPressure)
             decoded.p = DecodeU16(Parse) * 4 / 100.0;
         decoded.rh = DecodeU16(Parse) * 100 / 65535.0;
         decoded.tDewC = dewpoint(decoded.tempC, decoded.rh);
@@ -282,20 +384,29 @@ function Decoder(bytes, port) {
             decoded.tHeatIndexF = tHeat;
     }
 
+    if (fBatch) {
+        if (flags & 0x20)
+            DecodeBatch(Parse, decoded);
+
+        // the flash log's sequence number for the first interval; the
+        // rest follow on.
+        if (flags & 0x40) {
+            decoded.seq = DecodeU16(Parse) * 65536 + DecodeU16(Parse);
+            if (decoded.intervals) {
+                for (var iSeq = 0; iSeq < decoded.intervals.length; ++iSeq)
+                    decoded.intervals[iSeq].seq = (decoded.seq + iSeq) % 4294967296;
+            }
+        }
+
+        return decoded;
+    }
+
     if (flags & 0x20) {
-        decoded.pm = {};
-        decoded.pm["1.0"] = DecodePM(Parse);
-        decoded.pm["2.5"] = DecodePM(Parse);
-        decoded.pm["10"] = DecodePM(Parse);
-
-        decoded.aqi_partial = {};
-        var aqi = CalculatePmAqi(decoded.pm["1.0"], null);
-        decoded.aqi_partial["1.0"] = aqi.AQI;
-
-        aqi = CalculatePmAqi(decoded.pm["2.5"], decoded.pm["10"]);
-        decoded.aqi_partial["2.5"] = aqi.AQI_2_5;
-        decoded.aqi_partial["10"] = aqi.AQI_10;
-        decoded.aqi = aqi.AQI;
+        var pm1_0 = DecodePM(Parse);
+        var pm2_5 = DecodePM(Parse);
+        var pm10 = DecodePM(Parse);
+
+        SetPm(decoded, pm1_0, pm2_5, pm10);
     }
 
     if (flags & 0x40) {
@@ -308,6 +419,11 @@ function Decoder(bytes, port) {
         decoded.dust["10"] = DecodeDust(Parse);
     }
 
+    // the AQI the node computed, from 0 to 65535.
+    if (flags & 0x80) {
+        decoded.aqi = DecodeU16(Parse);
+    }
+
     return decoded;
 }
 
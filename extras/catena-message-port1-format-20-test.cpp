@@ -1,229 +1,23 @@
+#include <Catena-PMS7003-Port1.h>
+
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <sstream>
 #include <string>
-#include <vector>
-
-std::string key;
-std::string value;
-
-template <typename T>
-struct val
-    {
-    bool fValid;
-    T v;
-    };
 
-struct env
-    {
-    float t;
-    float p;
-    float rh;
-    };
-
-struct pm
-    {
-    float m1_0;
-    float m2_5;
-    float m10;
-    };
+using McciCatenaPMS7003::cPort1Message;
 
-struct dust
-    {
-    float m0_3, m0_5, m1_0, m2_5, m5, m10;
-    };
+std::string key;
 
+// the message, and the values as they were input, for the log.
 struct Measurements
     {
-    val<float> Vbat;
-    val<float> Vsys;
-    val<float> Vbus;
-    val<std::uint8_t> Boot;
-    val<env> Env;
-    val<pm> Pm;
-    val<dust> Dust;
-    };
-
-uint16_t
-LMIC_f2uflt16(
-        float f
-        )
-        {
-        if (f < 0.0)
-                return 0;
-        else if (f >= 1.0)
-                return 0xFFFF;
-        else
-                {
-                int iExp;
-                float normalValue;
-
-                normalValue = std::frexp(f, &iExp);
-
-                // f is supposed to be in [0..1), so useful exp
-                // is [0..-15]
-                iExp += 15;
-                if (iExp < 0)
-                        // underflow.
-                        iExp = 0;
-
-                // bits 15..12 are the exponent
-                // bits 11..0 are the fraction
-                // we conmpute the fraction and then decide if we need to round.
-                uint16_t outputFraction = std::ldexp(normalValue, 12) + 0.5;
-                if (outputFraction >= (1 << 12u))
-                        {
-                        // reduce output fraction
-                        outputFraction = 1 << 11;
-                        // increase exponent
-                        ++iExp;
-                        }
-
-                // check for overflow and return max instead.
-                if (iExp > 15)
-                        return 0xFFFF;
-
-                return (uint16_t)((iExp << 12u) | outputFraction);
-                }
-        }
-
-std::uint16_t encode16s(float v)
-    {
-    float nv = std::floor(v + 0.5f);
-
-    if (nv > 32767.0f)
-        return 0x7FFFu;
-    else if (nv < -32768.0f)
-        return 0x8000u;
-    else
-        {
-        return (std::uint16_t) std::int16_t(nv);
-        }
-    }
-
-std::uint16_t encode16u(float v)
-    {
-    float nv = std::floor(v + 0.5f);
-    if (nv > 65535.0f)
-        return 0xFFFFu;
-    else if (nv < 0.0f)
-        return 0;
-    else
-        {
-        return std::uint16_t(nv);
-        }
-    }
-
-std::uint16_t encodeV(float v)
-    {
-    return encode16s(v * 4096.0f);
-    }
-
-std::uint16_t encodeT(float v)
-    {
-    return encode16s(v * 256.0f);
-    }
-
-std::uint16_t encodeP(float v)
-    {
-    return encode16u(v * 25.0f);
-    }
-
-std::uint16_t encodeRH(float v)
-    {
-    return encode16u(v * 65535.0f / 100.0f);
-    }
-
-std::uint16_t encodePM(float v)
-    {
-    return encode16u(LMIC_f2uflt16(v / 65536.0f));
-    }
-
-std::uint16_t encodeDust(float v)
-    {
-    return encode16u(LMIC_f2uflt16(v / 65536.0f));
-    }
-
-class Buffer : public std::vector<std::uint8_t>
-    {
-public:
-    Buffer() : std::vector<std::uint8_t>() {};
-
-    void push_back_be(std::uint16_t v)
-        {
-        this->push_back(std::uint8_t(v >> 8));
-        this->push_back(std::uint8_t(v & 0xFF));
-        }
+    cPort1Message msg;
+    float in[cPort1Message::kSlots];
     };
 
-void encodeMeasurement(Buffer &buf, Measurements &m)
-    {
-    std::uint8_t flags = 0;
-
-    // sent the type byte
-    buf.clear();
-    buf.push_back(0x20);
-    buf.push_back(0u); // flag byte.
-
-    // put the fields
-    if (m.Vbat.fValid)
-        {
-        flags |= 1 << 0;
-        buf.push_back_be(encodeV(m.Vbat.v));
-        }
-
-    if (m.Vsys.fValid)
-        {
-        flags |= 1 << 1;
-        buf.push_back_be(encodeV(m.Vsys.v));
-        }
-
-    if (m.Vbus.fValid)
-        {
-        flags |= 1 << 2;
-        buf.push_back_be(encodeV(m.Vbus.v));
-        }
-
-    if (m.Boot.fValid)
-        {
-        flags |= 1 << 3;
-        buf.push_back(m.Boot.v);
-        }
-    
-    if (m.Env.fValid)
-        {
-        flags |= 1 << 4;
-
-        buf.push_back_be(encodeT(m.Env.v.t));
-        buf.push_back_be(encodeP(m.Env.v.p));
-        buf.push_back_be(encodeRH(m.Env.v.rh));
-        }
-
-    if (m.Pm.fValid)
-        {
-        flags |= 1 << 5;
-
-        buf.push_back_be(encodePM(m.Pm.v.m1_0));
-        buf.push_back_be(encodePM(m.Pm.v.m2_5));
-        buf.push_back_be(encodePM(m.Pm.v.m10));
-        }
-
-    if (m.Dust.fValid)
-        {
-        flags |= 1 << 6;
-
-        buf.push_back_be(encodeDust(m.Dust.v.m0_3));
-        buf.push_back_be(encodeDust(m.Dust.v.m0_5));
-        buf.push_back_be(encodeDust(m.Dust.v.m1_0));
-        buf.push_back_be(encodeDust(m.Dust.v.m2_5));
-        buf.push_back_be(encodeDust(m.Dust.v.m5));
-        buf.push_back_be(encodeDust(m.Dust.v.m10));
-        }
-
-    // update the flags
-    buf.data()[1] = flags;
-    }
-
 void logMeasurement(Measurements &m)
     {
     class Padder {
@@ -245,80 +39,190 @@ void logMeasurement(Measurements &m)
         bool m_first;
     } pad;
 
-    // put the fields
-    if (m.Vbat.fValid)
+    // put the fields, in bitmap order.
+    std::cout << std::dec;
+    for (std::size_t f = 0; f < cPort1Message::kFields; ++f)
         {
-        std::cout << pad.get() << "Vbat " << m.Vbat.v;
-        }
+        if (! (m.msg.getFlags() & (1u << f)))
+            continue;
 
-    if (m.Vsys.fValid)
-        {
-        std::cout << pad.get() << "Vsys " << m.Vsys.v;
+        std::cout << pad.get() << cPort1Message::kFieldKeys[f];
+        for (std::size_t s = 0; s < cPort1Message::kSlots; ++s)
+            if (cPort1Message::kSchema[s].field == f)
+                std::cout << " " << m.in[s];
         }
 
-    if (m.Vbus.fValid)
-        {
-        std::cout << pad.get() << "Vbus " << m.Vbus.v;
-        }
+    // make the syntax cut/pastable.
+    std::cout << pad.get() << ".\n";
+    }
 
-    if (m.Boot.fValid)
-        {
-        std::cout << pad.get() << "Boot " << unsigned(m.Boot.v);
-        }
-    
-    if (m.Env.fValid)
+// true if got is as near to in as value v's wire type allows.
+bool nearEnough(const McciCatenaPMS7003::Port1Value &v, double in, double got)
+    {
+    using McciCatenaPMS7003::Port1Codec;
+
+    double const step = double(v.mul) / double(v.div);
+    double lo, hi;
+
+    switch (v.codec)
         {
-        std::cout << pad.get() << "Env " << m.Env.v.t << " "
-                                         << m.Env.v.p << " "
-                                         << m.Env.v.rh;
+    case Port1Codec::Uflt16:
+        // 12 bits of fraction, and nothing from 1 up.
+        if (in >= step)
+            return got == step * (4095.0 / 4096.0);
+        return std::fabs(got - in) <= std::fmax(std::fabs(in) / 4096.0, step / 134217728.0);
+    case Port1Codec::Int16:     lo = -32768; hi = 32767; break;
+    case Port1Codec::Uint16:    lo = 0; hi = 65535; break;
+    default:                    lo = 0; hi = 255; break;
         }
 
-    if (m.Pm.fValid)
+    // allow for the input having been a float.
+    in = std::fmin(std::fmax(in, lo * step), hi * step);
+    return std::fabs(got - in) <= step / 2 + std::fabs(in) * 1e-6;
+    }
+
+// decode what was encoded, and check that each value came back as
+// closely as its wire type allows, and encodes to the same code again.
+bool checkMeasurement(Measurements &m, const std::uint8_t *pBuf, std::size_t nBuf)
+    {
+    cPort1Message d;
+    bool fResult = true;
+
+    if (d.decode(pBuf, nBuf) != nBuf || d.getFlags() != m.msg.getFlags())
         {
-        std::cout << pad.get() << "Pm " << m.Pm.v.m1_0 << " "
-                                        << m.Pm.v.m2_5 << " "
-                                        << m.Pm.v.m10;
+        std::cerr << "doesn't decode\n";
+        return false;
         }
 
-    if (m.Dust.fValid)
+    for (std::size_t s = 0; s < cPort1Message::kSlots; ++s)
         {
-        std::cout << pad.get() << "Dust " << m.Dust.v.m0_3 << " "
-                                          << m.Dust.v.m0_5 << " "
-                                          << m.Dust.v.m1_0 << " "
-                                          << m.Dust.v.m2_5 << " "
-                                          << m.Dust.v.m5   << " "
-                                          << m.Dust.v.m10;
+        auto const &v = cPort1Message::kSchema[s];
+        cPort1Message r { d.getFormat() };
+        double const got = d.getValue(s);
+
+        if (! d.isPresent(s))
+            continue;
+
+        r.set(s, float(got));
+        if (r.getCode(s) != d.getCode(s) || ! nearEnough(v, m.in[s], got))
+            {
+            std::cerr << (v.pGroup ? v.pGroup : "") << (v.pGroup ? "." : "") << v.pName
+                      << ": " << m.in[s] << " came back as " << got << "\n";
+            fResult = false;
+            }
         }
 
-    // make the syntax cut/pastable.
-    std::cout << pad.get() << ".\n";
+    return fResult;
     }
 
-void putTestVector(Measurements &m)
+bool putTestVector(Measurements &m)
     {
-    Buffer buf {};
-    logMeasurement(m);
-    encodeMeasurement(buf, m);
+    std::uint8_t buf[cPort1Message::kMaxSize];
+    std::size_t const n = m.msg.encode(buf);
     bool fFirst;
 
+    logMeasurement(m);
+
     fFirst = true;
-    for (auto v : buf)
+    for (std::size_t i = 0; i < n; ++i)
         {
         if (! fFirst)
             std::cout << " ";
         fFirst = false;
         std::cout.width(2);
         std::cout.fill('0');
-        std::cout << std::hex << unsigned(v);
+        std::cout << std::hex << unsigned(buf[i]);
         }
-    std::cout << "\n";
+    std::cout << std::dec << "\n";
+
+    return checkMeasurement(m, buf, n);
+    }
+
+// check the input file for the test vectors against the schema: every
+// key names a field, with as many values as the field has, and every
+// field is tested.
+bool checkVectorFile()
+    {
+    std::string line;
+    unsigned nLine = 0;
+    std::uint32_t seen = 0;
+    bool fResult = true;
+
+    while (std::getline(std::cin, line))
+        {
+        std::istringstream words { line };
+        std::string word;
+        std::size_t f = cPort1Message::kFields;
+        std::size_t nWant = 0;
+        std::size_t nGot = 0;
+
+        ++nLine;
+
+        // close off the field before each key, and at the end.
+        auto endField = [&]
+            {
+            if (f < cPort1Message::kFields && nGot != nWant)
+                {
+                std::cerr << "line " << nLine << ": " << cPort1Message::kFieldKeys[f]
+                          << " has " << nGot << " values, not " << nWant << "\n";
+                fResult = false;
+                }
+            f = cPort1Message::kFields;
+            };
+
+        while (words >> word)
+            {
+            std::size_t k;
+
+            for (k = 0; k < cPort1Message::kFields; ++k)
+                if (word == cPort1Message::kFieldKeys[k])
+                    break;
+
+            if (k < cPort1Message::kFields)
+                {
+                endField();
+                f = k;
+                nWant = 0;
+                nGot = 0;
+                for (auto const &v : cPort1Message::kSchema)
+                    if (v.field == f)
+                        ++nWant;
+                seen |= 1u << f;
+                }
+            else if (word == ".")
+                endField();
+            else if (f < cPort1Message::kFields)
+                ++nGot;
+            else
+                {
+                std::cerr << "line " << nLine << ": unknown key: " << word << "\n";
+                fResult = false;
+                }
+            }
+        endField();
+        }
+
+    for (std::size_t f = 0; f < cPort1Message::kFields; ++f)
+        {
+        if (! (seen & (1u << f)))
+            {
+            std::cerr << "no vector for " << cPort1Message::kFieldKeys[f] << "\n";
+            fResult = false;
+            }
+        }
+
+    return fResult;
     }
 
 int main(int argc, char **argv)
     {
-    Measurements m {0};
-    Measurements m0 {0};
+    Measurements m {};
+    Measurements const m0 {};
     bool fAny;
+    bool fOk = true;
+
+    if (argc > 1 && std::strcmp(argv[1], "--vec") == 0)
+        return checkVectorFile() ? 0 : 1;
 
     std::cout << "Input a line with name/values pairs\n";
 
@@ -326,55 +230,35 @@ int main(int argc, char **argv)
     while (std::cin.good())
         {
         bool fUpdate = true;
+        std::size_t f;
+
         key.clear();
 
         std::cin >> key;
 
-        if (key == "Vbat")
-            {
-            std::cin >> m.Vbat.v;
-            m.Vbat.fValid = true;
-            }
-        else if (key == "Vsys")
-            {
-            std::cin >> m.Vsys.v;
-            m.Vsys.fValid = true;
-            }
-        else if (key == "Vbus")
-            {
-            std::cin >> m.Vbus.v;
-            m.Vbus.fValid = true;
-            }
-        else if (key == "Boot")
-            {
-            std::uint32_t nonce;
-            std::cin >> nonce;
-            m.Boot.v = (std::uint8_t) nonce;
-            m.Boot.fValid = true;
-            }
-        else if (key == "Env")
-            {
-            std::cin >> m.Env.v.t >> m.Env.v.p >> m.Env.v.rh;
-            m.Env.fValid = true;
-            }
-        else if (key == "Pm")
-            {
-            std::cin >> m.Pm.v.m1_0 >> m.Pm.v.m2_5 >> m.Pm.v.m10;
-            m.Pm.fValid = true;
-            }
-        else if (key == "Dust")
+        for (f = 0; f < cPort1Message::kFields; ++f)
+            if (key == cPort1Message::kFieldKeys[f])
+                break;
+
+        if (f < cPort1Message::kFields)
             {
-            std::cin >> m.Dust.v.m0_3 
-                    >> m.Dust.v.m0_5
-                    >> m.Dust.v.m1_0
-                    >> m.Dust.v.m2_5
-                    >> m.Dust.v.m5
-                    >> m.Dust.v.m10;
-            m.Dust.fValid = true;
+            // read the field's values, in order.
+            for (std::size_t s = 0; s < cPort1Message::kSlots; ++s)
+                {
+                if (cPort1Message::kSchema[s].field != f)
+                    continue;
+
+                std::cin >> m.in[s];
+
+                // the boot counter is sent modulo 256.
+                if (s == cPort1Message::kBoot)
+                    m.in[s] = float(std::uint32_t(m.in[s]) & 0xFF);
+                m.msg.set(s, m.in[s]);
+                }
             }
         else if (key == ".")
             {
-            putTestVector(m);
+            fOk &= putTestVector(m);
             m = m0;
             fAny = false;
             fUpdate = false;
@@ -390,7 +274,7 @@ int main(int argc, char **argv)
 
         fAny |= fUpdate;
         }
-    
+
     if (!std::cin.eof() && std::cin.fail())
         {
         std::string nextword;
@@ -402,7 +286,7 @@ int main(int argc, char **argv)
         }
 
     if (fAny)
-        putTestVector(m);
+        fOk &= putTestVector(m);
 
-    return 0;
+    return fOk ? 0 : 1;
     }
@@ -0,0 +1,288 @@
+/*
+
+Module: Arduino.h
+
+Function:
+    Host stand-in for the Arduino core, used to build the library and
+    the lora sketch on a PC.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Only the parts of the core that the library and sketches actually
+    use are provided. Time is virtual: millis() and micros() return
+    McciCatenaHost::gClock, which only moves when a harness (or a
+    delay(), yield() or __WFI()) advances it.
+
+*/
+
+#ifndef _Arduino_h_
+# define _Arduino_h_
+
+#pragma once
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/****************************************************************************\
+|
+|   The virtual clock
+|
+\****************************************************************************/
+
+namespace McciCatenaHost {
+
+class cClock
+    {
+public:
+    std::uint64_t getMicros() const
+        {
+        return this->m_us;
+        }
+
+    void advanceMicros(std::uint64_t us)
+        {
+        // observers see the state of the world as of the start of the
+        // interval.
+        if (this->m_pObserverFn != nullptr)
+            this->m_pObserverFn(this->m_pObserverCtx, us);
+        this->m_us += us;
+        }
+
+    void advanceMillis(std::uint64_t ms)
+        {
+        this->advanceMicros(ms * 1000);
+        }
+
+    // register a function to be called each time the clock advances.
+    typedef void ObserverFn_t(void *pCtx, std::uint64_t us);
+    void setObserver(ObserverFn_t *pFn, void *pCtx)
+        {
+        this->m_pObserverFn = pFn;
+        this->m_pObserverCtx = pCtx;
+        }
+
+    // the amount of time that a yield() represents; harnesses that
+    // spin in the sketch's busy loops depend on this being non-zero.
+    std::uint32_t   m_yieldMicros = 1000;
+
+private:
+    std::uint64_t   m_us = 0;
+    ObserverFn_t *  m_pObserverFn = nullptr;
+    void *          m_pObserverCtx = nullptr;
+    };
+
+inline cClock gClock;
+
+} // namespace McciCatenaHost
+
+inline std::uint32_t millis()
+    {
+    return std::uint32_t(McciCatenaHost::gClock.getMicros() / 1000);
+    }
+
+inline std::uint32_t micros()
+    {
+    return std::uint32_t(McciCatenaHost::gClock.getMicros());
+    }
+
+inline void delay(std::uint32_t ms)
+    {
+    McciCatenaHost::gClock.advanceMillis(ms);
+    }
+
+inline void yield()
+    {
+    McciCatenaHost::gClock.advanceMicros(McciCatenaHost::gClock.m_yieldMicros);
+    }
+
+// the CMSIS wait for interrupt: on the host, the next SysTick.
+inline void __WFI()
+    {
+    McciCatenaHost::gClock.advanceMicros(1000 - McciCatenaHost::gClock.getMicros() % 1000);
+    }
+
+/****************************************************************************\
+|
+|   GPIOs
+|
+\****************************************************************************/
+
+enum : int
+    {
+    INPUT = 0,
+    OUTPUT = 1,
+    };
+
+enum : int
+    {
+    D10 = 10,
+    D11 = 11,
+    D12 = 12,
+    };
+
+namespace McciCatenaHost {
+
+struct cPins
+    {
+    static constexpr int kNumPins = 32;
+    bool    value[kNumPins];
+    int     mode[kNumPins];
+    };
+
+inline cPins gPins;
+
+} // namespace McciCatenaHost
+
+inline void digitalWrite(int pin, bool value)
+    {
+    if (unsigned(pin) < McciCatenaHost::cPins::kNumPins)
+        McciCatenaHost::gPins.value[pin] = value;
+    }
+
+inline void pinMode(int pin, int mode)
+    {
+    if (unsigned(pin) < McciCatenaHost::cPins::kNumPins)
+        McciCatenaHost::gPins.mode[pin] = mode;
+    }
+
+/****************************************************************************\
+|
+|   Serial ports
+|
+\****************************************************************************/
+
+// the UARTs: bytes "received" are queued by the harness with hostRx(),
+// bytes written by the code under test can be collected with hostTx().
+class HardwareSerial
+    {
+public:
+    static constexpr std::size_t kRxBufferSize = 64;
+    static constexpr std::size_t kTxBufferSize = 64;
+
+    void begin(std::uint32_t baud)
+        {
+        this->m_baud = baud;
+        this->m_fOpen = true;
+        this->m_nRx = this->m_iRx = 0;
+        }
+    void end()
+        {
+        this->m_fOpen = false;
+        }
+    int available() const
+        {
+        return int(this->m_nRx);
+        }
+    int read()
+        {
+        if (this->m_nRx == 0)
+            return -1;
+
+        int const c = this->m_rx[this->m_iRx];
+        this->m_iRx = (this->m_iRx + 1) % kRxBufferSize;
+        --this->m_nRx;
+        return c;
+        }
+    int availableForWrite() const
+        {
+        return int(kTxBufferSize);
+        }
+    std::size_t write(const std::uint8_t *pBuffer, std::size_t nBuffer)
+        {
+        if (this->m_pTxFn != nullptr)
+            this->m_pTxFn(this->m_pTxCtx, pBuffer, nBuffer);
+        return nBuffer;
+        }
+
+    // harness side: queue a received byte; returns false (and drops
+    // the byte) on overrun, as the real driver would.
+    bool hostRx(std::uint8_t c)
+        {
+        if (! this->m_fOpen)
+            return false;
+        if (this->m_nRx == kRxBufferSize)
+            {
+            ++this->m_nOverrun;
+            return false;
+            }
+        this->m_rx[(this->m_iRx + this->m_nRx) % kRxBufferSize] = c;
+        ++this->m_nRx;
+        return true;
+        }
+
+    // harness side: observe transmitted bytes.
+    typedef void HostTxFn_t(void *pCtx, const std::uint8_t *pBuffer, std::size_t nBuffer);
+    void hostTx(HostTxFn_t *pFn, void *pCtx)
+        {
+        this->m_pTxFn = pFn;
+        this->m_pTxCtx = pCtx;
+        }
+
+    bool isOpen() const
+        {
+        return this->m_fOpen;
+        }
+    std::uint32_t getOverruns() const
+        {
+        return this->m_nOverrun;
+        }
+
+private:
+    std::uint8_t    m_rx[kRxBufferSize];
+    std::size_t     m_iRx = 0;
+    std::size_t     m_nRx = 0;
+    std::uint32_t   m_baud = 0;
+    std::uint32_t   m_nOverrun = 0;
+    bool            m_fOpen = false;
+    HostTxFn_t *    m_pTxFn = nullptr;
+    void *          m_pTxCtx = nullptr;
+    };
+
+// the USB console. Bytes written go to stdout, or to the harness's
+// function if it has set one.
+class USBSerial
+    {
+public:
+    void begin() {}
+    void begin(std::uint32_t) {}
+    void end() {}
+    void flush() {}
+    bool dtr() const { return false; }
+    explicit operator bool() const { return true; }
+
+    std::size_t write(const std::uint8_t *pBuffer, std::size_t nBuffer)
+        {
+        if (this->m_pTxFn != nullptr)
+            this->m_pTxFn(this->m_pTxCtx, pBuffer, nBuffer);
+        else
+            std::fwrite(pBuffer, 1, nBuffer, stdout);
+        return nBuffer;
+        }
+
+    // harness side: observe written bytes.
+    typedef HardwareSerial::HostTxFn_t HostTxFn_t;
+    void hostTx(HostTxFn_t *pFn, void *pCtx)
+        {
+        this->m_pTxFn = pFn;
+        this->m_pTxCtx = pCtx;
+        }
+
+private:
+    HostTxFn_t *    m_pTxFn = nullptr;
+    void *          m_pTxCtx = nullptr;
+    };
+
+inline USBSerial Serial;
+inline HardwareSerial Serial1;
+inline HardwareSerial Serial2;
+
+#endif // _Arduino_h_
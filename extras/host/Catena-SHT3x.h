@@ -0,0 +1,61 @@
+/*
+
+Module: Catena-SHT3x.h
+
+Function:
+    Host stand-in for the MCCI SHT3x library.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+*/
+
+#ifndef _Catena_SHT3x_h_
+# define _Catena_SHT3x_h_
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <cstdint>
+
+namespace McciCatenaSht3x {
+
+class cSHT3x
+    {
+public:
+    struct Measurements
+        {
+        float   Temperature;
+        float   Humidity;
+        };
+
+    cSHT3x(TwoWire & /* wire */)
+        {}
+
+    bool begin()
+        {
+        return true;
+        }
+
+    // like the real one, this waits for the measurement.
+    bool getTemperatureHumidity(Measurements &m)
+        {
+        if (this->m_readMs != 0)
+            delay(this->m_readMs);
+        m = this->m_value;
+        return true;
+        }
+
+    // harness-visible state
+    Measurements    m_value { 21.5f, 45.0f };
+    std::uint32_t   m_readMs = 0;
+    };
+
+} // namespace McciCatenaSht3x
+
+#endif // _Catena_SHT3x_h_
@@ -0,0 +1,245 @@
+/*
+
+Module: Catena.h
+
+Function:
+    Host stand-in for the Catena platform object (McciCatena::Catena).
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The host Catena is a Catena 4630. The values that the sketch reads
+    from the hardware (Vbat, Vbus, boot count, operating flags) are
+    plain public members that a harness can set. Console output goes
+    to stdout unless fQuiet is set, in which case it is still formatted
+    (so that the cost of formatting stays in the measurement) and then
+    discarded. A harness that wants to check the output can set
+    pfnConsole, which is then called with each piece of it instead.
+
+*/
+
+#ifndef _Catena_h_
+# define _Catena_h_
+
+#pragma once
+
+#include <Arduino.h>
+#include <Catena_PollableInterface.h>
+#include <cstdint>
+
+namespace McciCatena {
+
+class Catena4630
+    {
+public:
+    enum class OPERATING_FLAGS : std::uint32_t
+        {
+        fUnattended = 1 << 0,
+        fManufacturingTest = 1 << 1,
+        fConfirmedUplink = 1 << 16,
+        fDisableDeepSleep = 1 << 17,
+        fQuickLightSleep = 1 << 18,
+        fDeepSleepTest = 1 << 19,
+        };
+
+    static constexpr int PIN_STATUS_LED = 13;
+    static constexpr int PIN_SPI2_MOSI = 14;
+    static constexpr int PIN_SPI2_MISO = 15;
+    static constexpr int PIN_SPI2_SCK = 16;
+    static constexpr int PIN_SPI2_FLASH_SS = 17;
+
+    class LoRaWAN;
+
+    bool begin()
+        {
+        return true;
+        }
+
+    void registerObject(cPollableObject *pObject)
+        {
+        this->m_PollingEngine.registerObject(pObject);
+        }
+
+    void poll()
+        {
+        this->m_PollingEngine.poll();
+        }
+
+    void SafePrintf(const char *pFmt, ...)
+        __attribute__((__format__(__printf__, 2, 3)))
+        {
+        char buf[128];
+        std::va_list ap;
+
+        va_start(ap, pFmt);
+        std::vsnprintf(buf, sizeof(buf), pFmt, ap);
+        va_end(ap);
+
+        if (this->pfnConsole != nullptr)
+            this->pfnConsole(buf);
+        else if (! this->fQuiet)
+            std::fputs(buf, stdout);
+        }
+
+    std::uint32_t GetOperatingFlags() const
+        {
+        return this->OperatingFlags;
+        }
+
+    std::uint32_t GetSystemClockRate() const
+        {
+        return 32 * 1000 * 1000;
+        }
+
+    float ReadVbat() const
+        {
+        return this->Vbat;
+        }
+
+    float ReadVbus() const
+        {
+        return this->Vbus;
+        }
+
+    bool getBootCount(std::uint32_t &bootCount) const
+        {
+        bootCount = this->BootCount;
+        return true;
+        }
+
+    // deep sleep: on the host, time simply passes.
+    void Sleep(std::uint32_t howLongInSeconds)
+        {
+        ++this->nSleeps;
+        this->SleepSeconds += howLongInSeconds;
+        this->fDeepSleep = true;
+        McciCatenaHost::gClock.advanceMillis(std::uint64_t(howLongInSeconds) * 1000);
+        this->fDeepSleep = false;
+        }
+
+    // harness-visible state
+    std::uint32_t   OperatingFlags = 0;
+    float           Vbat = 3.9f;
+    float           Vbus = 0.0f;
+    std::uint32_t   BootCount = 42;
+    bool            fQuiet = false;
+    void            (*pfnConsole)(const char *) = nullptr;
+    std::uint32_t   nSleeps = 0;
+    std::uint64_t   SleepSeconds = 0;
+    // true while in Sleep().
+    bool            fDeepSleep = false;
+
+private:
+    cPollingEngine  m_PollingEngine;
+    };
+
+// the network side: SendBuffer() completes after a fixed airtime has
+// passed on the virtual clock, from the poll() routine.
+class Catena4630::LoRaWAN : public cPollableObject
+    {
+public:
+    typedef void SendBufferCbFn(void *pClientData, bool fSuccess);
+
+    // the largest LoRaWAN application payload.
+    static constexpr std::size_t kMaxMessage = 242;
+
+    bool begin(Catena4630 *pCatena)
+        {
+        this->m_pCatena = pCatena;
+        return true;
+        }
+
+    bool IsProvisioned() const
+        {
+        return this->fProvisioned;
+        }
+
+    const char *GetNetworkName() const
+        {
+        return "host";
+        }
+
+    const char *GetRegionString(char *pBuf, std::size_t nBuf) const
+        {
+        std::snprintf(pBuf, nBuf, "%s", "US915");
+        return pBuf;
+        }
+
+    bool SendBuffer(
+        const std::uint8_t *pBuffer,
+        std::size_t nBuffer,
+        SendBufferCbFn *pDoneFn,
+        void *pDoneCtx,
+        bool fConfirmed,
+        std::uint8_t port
+        )
+        {
+        if (this->m_pDoneFn != nullptr || ! this->fLaunchOk)
+            return false;
+
+        if (nBuffer > sizeof(this->LastMessage))
+            nBuffer = sizeof(this->LastMessage);
+        std::memcpy(this->LastMessage, pBuffer, nBuffer);
+        this->nLastMessage = nBuffer;
+        this->LastPort = port;
+        this->fLastConfirmed = fConfirmed;
+        ++this->nSends;
+        this->nBytesSent += nBuffer;
+
+        this->m_pDoneFn = pDoneFn;
+        this->m_pDoneCtx = pDoneCtx;
+        this->m_tStart = McciCatenaHost::gClock.getMicros();
+        return true;
+        }
+
+    bool isTxActive() const
+        {
+        return this->m_pDoneFn != nullptr;
+        }
+
+    // how long the current SendBuffer() has been running.
+    std::uint64_t getTxElapsedMicros() const
+        {
+        return McciCatenaHost::gClock.getMicros() - this->m_tStart;
+        }
+
+    virtual void poll() override
+        {
+        if (this->m_pDoneFn == nullptr)
+            return;
+        if (McciCatenaHost::gClock.getMicros() - this->m_tStart < std::uint64_t(this->AirtimeMs) * 1000)
+            return;
+
+        auto const pDoneFn = this->m_pDoneFn;
+        this->m_pDoneFn = nullptr;
+        pDoneFn(this->m_pDoneCtx, this->fTxOk);
+        }
+
+    // harness-visible state
+    bool            fProvisioned = true;
+    bool            fLaunchOk = true;
+    bool            fTxOk = true;
+    std::uint32_t   AirtimeMs = 100;
+    std::uint32_t   nSends = 0;
+    std::uint64_t   nBytesSent = 0;
+    std::uint8_t    LastMessage[kMaxMessage];
+    std::size_t     nLastMessage = 0;
+    std::uint8_t    LastPort = 0;
+    bool            fLastConfirmed = false;
+
+private:
+    Catena4630 *    m_pCatena = nullptr;
+    SendBufferCbFn *m_pDoneFn = nullptr;
+    void *          m_pDoneCtx = nullptr;
+    std::uint64_t   m_tStart = 0;
+    };
+
+typedef Catena4630 Catena;
+
+} // namespace McciCatena
+
+#endif // _Catena_h_
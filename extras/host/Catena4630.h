@@ -0,0 +1,23 @@
+/*
+
+Module: Catena4630.h
+
+Function:
+    Host stand-in for the Catena 4630 platform header.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+*/
+
+#ifndef _Catena4630_h_
+# define _Catena4630_h_
+
+#pragma once
+
+#include <Catena.h>
+
+#endif // _Catena4630_h_
@@ -0,0 +1,103 @@
+/*
+
+Module: Catena_FSM.h
+
+Function:
+    Host stand-in for McciCatena::cFSM.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Same contract as the platform: the dispatch function is called
+    with fEntry true on the first call in each state, and is called
+    repeatedly until it returns stNoChange. Re-entrant calls to eval()
+    are deferred until the outer evaluation finishes.
+
+*/
+
+#ifndef _Catena_FSM_h_
+# define _Catena_FSM_h_
+
+#pragma once
+
+namespace McciCatena {
+
+template <typename TParent, typename TState>
+class cFSM
+    {
+public:
+    typedef TState (TParent::*Dispatch)(TState currentState, bool fEntry);
+
+    void init(TParent &parent, Dispatch dispatch)
+        {
+        this->m_pParent = &parent;
+        this->m_dispatch = dispatch;
+        this->m_state = TState::stInitial;
+        this->m_fEntry = true;
+        this->m_fRunning = true;
+        this->m_fBusy = false;
+        this->eval();
+        }
+
+    void eval()
+        {
+        if (! this->m_fRunning)
+            return;
+        if (this->m_fBusy)
+            {
+            this->m_fPending = true;
+            return;
+            }
+
+        this->m_fBusy = true;
+        do  {
+            this->m_fPending = false;
+            for (;;)
+                {
+                TState const newState = (this->m_pParent->*this->m_dispatch)(this->m_state, this->m_fEntry);
+
+                this->m_fEntry = false;
+                if (newState == TState::stNoChange)
+                    break;
+
+                this->m_state = newState;
+                this->m_fEntry = true;
+                if (newState == TState::stFinal)
+                    {
+                    (this->m_pParent->*this->m_dispatch)(newState, true);
+                    this->m_fRunning = false;
+                    this->m_fPending = false;
+                    break;
+                    }
+                }
+            } while (this->m_fPending);
+        this->m_fBusy = false;
+        }
+
+    TState getState() const
+        {
+        return this->m_state;
+        }
+
+    bool isRunning() const
+        {
+        return this->m_fRunning;
+        }
+
+private:
+    TParent *   m_pParent = nullptr;
+    Dispatch    m_dispatch = nullptr;
+    TState      m_state = TState::stInitial;
+    bool        m_fEntry = false;
+    bool        m_fRunning = false;
+    bool        m_fBusy = false;
+    bool        m_fPending = false;
+    };
+
+} // namespace McciCatena
+
+#endif // _Catena_FSM_h_
@@ -0,0 +1,80 @@
+/*
+
+Module: Catena_Led.h
+
+Function:
+    Host stand-in for McciCatena::StatusLed.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+*/
+
+#ifndef _Catena_Led_h_
+# define _Catena_Led_h_
+
+#pragma once
+
+#include <Catena_PollableInterface.h>
+#include <cstdint>
+
+namespace McciCatena {
+
+enum class LedPattern : std::uint8_t
+    {
+    NoChange = 0,
+    Off,
+    On,
+    Measuring,
+    Joining,
+    Joined,
+    Sending,
+    Sleeping,
+    Settling,
+    WarmingUp,
+    TwoShort,
+    FastFlash,
+    FiftyFiftySlow,
+    };
+
+class StatusLed : public cPollableObject
+    {
+public:
+    StatusLed(int pin)
+        : m_pin(pin)
+        {}
+
+    bool begin()
+        {
+        return true;
+        }
+
+    LedPattern Set(LedPattern newPattern)
+        {
+        LedPattern const oldPattern = this->m_pattern;
+
+        if (newPattern != LedPattern::NoChange)
+            this->m_pattern = newPattern;
+        return oldPattern;
+        }
+
+    LedPattern Get() const
+        {
+        return this->m_pattern;
+        }
+
+    virtual void poll() override
+        {
+        }
+
+private:
+    int         m_pin;
+    LedPattern  m_pattern = LedPattern::Off;
+    };
+
+} // namespace McciCatena
+
+#endif // _Catena_Led_h_
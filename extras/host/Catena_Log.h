@@ -0,0 +1,21 @@
+/*
+
+Module: Catena_Log.h
+
+Function:
+    Host stand-in for the platform logging header (nothing is needed).
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+*/
+
+#ifndef _Catena_Log_h_
+# define _Catena_Log_h_
+
+#pragma once
+
+#endif // _Catena_Log_h_
@@ -0,0 +1,121 @@
+/*
+
+Module: Catena_Mx25v8035f.h
+
+Function:
+    Host stand-in for the SPI flash driver.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The flash is an array in memory, erased to 0xFF. Like NOR flash,
+    program() can only clear bits; eraseSector() sets a 4 KiB sector
+    back to 0xFF, and counts the erase. begin() fails unless the tool
+    sets fPresent, so that tools that don't care about the flash see
+    the board without it.
+
+*/
+
+#ifndef _Catena_Mx25v8035f_h_
+# define _Catena_Mx25v8035f_h_
+
+#pragma once
+
+#include <SPI.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace McciCatena {
+
+class Catena_Mx25v8035f
+    {
+public:
+    static constexpr std::uint32_t kSize = 1024 * 1024;
+    static constexpr std::uint32_t kSectorSize = 4 * 1024;
+
+    bool begin(SPIClass * /* pSpi */, int /* chipSelectPin */)
+        {
+        if (this->fPresent && this->m_data.empty())
+            {
+            this->m_data.assign(kSize, 0xFF);
+            this->m_erases.assign(kSize / kSectorSize, 0);
+            }
+        this->m_fPoweredDown = false;
+        return this->fPresent;
+        }
+    void end() {}
+    void powerDown()
+        {
+        this->m_fPoweredDown = true;
+        }
+    void powerUp()
+        {
+        this->m_fPoweredDown = false;
+        }
+
+    bool eraseSector(std::uint32_t address)
+        {
+        if (! this->check(address, 1))
+            return false;
+
+        address -= address % kSectorSize;
+        std::memset(&this->m_data[address], 0xFF, kSectorSize);
+        ++this->m_erases[address / kSectorSize];
+        return true;
+        }
+
+    void read(std::uint32_t address, std::uint8_t *pBuffer, std::size_t nBuffer)
+        {
+        if (this->check(address, nBuffer))
+            std::memcpy(pBuffer, &this->m_data[address], nBuffer);
+        else
+            std::memset(pBuffer, 0xFF, nBuffer);
+        }
+
+    void program(std::uint32_t address, const std::uint8_t *pBuffer, std::size_t nBuffer)
+        {
+        if (! this->check(address, nBuffer))
+            return;
+
+        for (std::size_t i = 0; i < nBuffer; ++i)
+            this->m_data[address + i] &= pBuffer[i];
+        ++this->nPrograms;
+        }
+
+    // harness-visible state
+    bool            fPresent = false;
+    std::uint32_t   nPrograms = 0;
+    std::uint32_t   nAccessErrors = 0;
+
+    std::uint32_t getErases(std::uint32_t address) const
+        {
+        return address < kSize && ! this->m_erases.empty() ? this->m_erases[address / kSectorSize] : 0;
+        }
+
+private:
+    // the device must be present, awake, and the access in range.
+    bool check(std::uint32_t address, std::size_t n)
+        {
+        if (this->m_data.empty() || this->m_fPoweredDown || address > kSize || n > kSize - address)
+            {
+            ++this->nAccessErrors;
+            return false;
+            }
+        return true;
+        }
+
+    std::vector<std::uint8_t>   m_data;
+    std::vector<std::uint32_t>  m_erases;
+    bool                        m_fPoweredDown = false;
+    };
+
+} // namespace McciCatena
+
+#endif // _Catena_Mx25v8035f_h_
@@ -0,0 +1,56 @@
+/*
+
+Module: Catena_PollableInterface.h
+
+Function:
+    Host stand-in for McciCatena::cPollableObject.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+*/
+
+#ifndef _Catena_PollableInterface_h_
+# define _Catena_PollableInterface_h_
+
+#pragma once
+
+namespace McciCatena {
+
+class cPollableObject
+    {
+public:
+    virtual void poll(void) = 0;
+    };
+
+class cPollingEngine
+    {
+public:
+    static constexpr unsigned kMaxObjects = 16;
+
+    void registerObject(cPollableObject *pObject)
+        {
+        for (unsigned i = 0; i < this->m_nObjects; ++i)
+            if (this->m_pObjects[i] == pObject)
+                return;
+        if (this->m_nObjects < kMaxObjects)
+            this->m_pObjects[this->m_nObjects++] = pObject;
+        }
+
+    void poll(void)
+        {
+        for (unsigned i = 0; i < this->m_nObjects; ++i)
+            this->m_pObjects[i]->poll();
+        }
+
+private:
+    cPollableObject *   m_pObjects[kMaxObjects];
+    unsigned            m_nObjects = 0;
+    };
+
+} // namespace McciCatena
+
+#endif // _Catena_PollableInterface_h_
@@ -0,0 +1,97 @@
+/*
+
+Module: Catena_Timer.h
+
+Function:
+    Host stand-in for McciCatena::cTimer.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The platform timer counts ticks from its poll() routine; this one
+    computes them from the virtual clock when asked, which gives the
+    same answers without needing to be registered.
+
+*/
+
+#ifndef _Catena_Timer_h_
+# define _Catena_Timer_h_
+
+#pragma once
+
+#include <Arduino.h>
+#include <cstdint>
+
+namespace McciCatena {
+
+class cTimer
+    {
+public:
+    bool begin(std::uint32_t nMillis)
+        {
+        this->m_interval = nMillis;
+        this->retrigger();
+        return true;
+        }
+
+    void end()
+        {
+        }
+
+    std::uint32_t getInterval() const
+        {
+        return this->m_interval;
+        }
+
+    void setInterval(std::uint32_t uInterval)
+        {
+        this->m_interval = uInterval;
+        }
+
+    std::uint32_t peekTicks() const
+        {
+        if (this->m_interval == 0)
+            return 0;
+        return (millis() - this->m_time) / this->m_interval;
+        }
+
+    std::uint32_t readTicks()
+        {
+        auto const nTicks = this->peekTicks();
+
+        this->m_time += nTicks * this->m_interval;
+        return nTicks;
+        }
+
+    bool isready()
+        {
+        return this->readTicks() != 0;
+        }
+
+    void retrigger()
+        {
+        this->m_time = millis();
+        }
+
+    std::uint32_t getRemaining() const
+        {
+        std::uint32_t const delta = millis() - this->m_time;
+
+        if (delta >= this->m_interval)
+            return 0;
+        else
+            return this->m_interval - delta;
+        }
+
+private:
+    std::uint32_t   m_time = 0;
+    std::uint32_t   m_interval = 0;
+    };
+
+} // namespace McciCatena
+
+#endif // _Catena_Timer_h_
@@ -0,0 +1,157 @@
+/*
+
+Module: Catena_TxBuffer.h
+
+Function:
+    Host stand-in for McciCatena::AbstractTxBuffer_t.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The encoders follow the platform (and LMIC) implementations, so
+    that uplinks built on the host are byte-for-byte what the sensor
+    would send.
+
+*/
+
+#ifndef _Catena_TxBuffer_h_
+# define _Catena_TxBuffer_h_
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatena {
+
+template <std::size_t N = 32>
+class AbstractTxBuffer_t
+    {
+public:
+    void begin()
+        {
+        this->p = this->buf;
+        }
+    void put(std::uint8_t c)
+        {
+        if (this->p < this->buf + N)
+            *this->p++ = c;
+        }
+    void put1u(std::int32_t v)
+        {
+        if (v > 0xFF)
+            v = 0xFF;
+        else if (v < 0)
+            v = 0;
+        this->put(std::uint8_t(v));
+        }
+    void put2(std::uint32_t v)
+        {
+        if (v > 0xFFFF)
+            v = 0xFFFF;
+        this->put(std::uint8_t(v >> 8));
+        this->put(std::uint8_t(v));
+        }
+    void put2(std::int32_t v)
+        {
+        if (v < -0x8000)
+            v = -0x8000;
+        else if (v > 0x7FFF)
+            v = 0x7FFF;
+        this->put(std::uint8_t(v >> 8));
+        this->put(std::uint8_t(v));
+        }
+    void put2sf(std::int32_t v)
+        {
+        this->put2(v);
+        }
+    void put2uf(std::uint32_t v)
+        {
+        this->put2(v);
+        }
+    void putV(float V)
+        {
+        this->put2sf(std::int32_t(V * 4096.0f + 0.5f));
+        }
+    void putT(float T)
+        {
+        this->put2sf(std::int32_t(T * 256.0f + 0.5f));
+        }
+    void putP(float P)
+        {
+        this->put2uf(std::uint32_t(P / 4.0f + 0.5f));
+        }
+    void putBootCountLsb(std::uint32_t bootCount)
+        {
+        this->put(std::uint8_t(bootCount));
+        }
+    std::uint8_t *getp(void)
+        {
+        return this->p;
+        }
+    std::size_t getn(void)
+        {
+        return this->p - this->buf;
+        }
+    std::uint8_t *getbase(void)
+        {
+        return this->buf;
+        }
+
+    // the LMIC encoder for uflt16: 4-bit exponent, 12-bit mantissa,
+    // representing a number in [0, 1).
+    static std::uint16_t f2uflt16(float f)
+        {
+        if (f < 0.0)
+            return 0;
+        else if (f >= 1.0)
+            return 0xFFFF;
+        else
+            {
+            int iExp;
+            float normalValue;
+
+            normalValue = std::frexp(f, &iExp);
+
+            // f is supposed to be in [0..1), so useful exp
+            // is [0..-15]
+            iExp += 15;
+            if (iExp < 0)
+                // underflow.
+                iExp = 0;
+
+            // bits 15..12 are the exponent
+            // bits 11..0 are the fraction
+            // we conmpute the fraction and then decide if we need to round.
+            std::uint16_t outputFraction = std::ldexp(normalValue, 12) + 0.5;
+            if (outputFraction >= (1 << 12u))
+                {
+                // reduce output fraction
+                outputFraction = 1 << 11;
+                // increase exponent
+                ++iExp;
+                }
+
+            // check for overflow and return max instead.
+            if (iExp > 15)
+                return 0xFFFF;
+
+            return std::uint16_t((iExp << 12u) | outputFraction);
+            }
+        }
+
+private:
+    std::uint8_t    buf[N];
+    std::uint8_t *  p = buf;
+    };
+
+typedef AbstractTxBuffer_t<> TxBuffer_t;
+
+} // namespace McciCatena
+
+#endif // _Catena_TxBuffer_h_
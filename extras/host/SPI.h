@@ -0,0 +1,32 @@
+/*
+
+Module: SPI.h
+
+Function:
+    Host stand-in for the Arduino SPI driver.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+*/
+
+#ifndef _SPI_h_
+# define _SPI_h_
+
+#pragma once
+
+class SPIClass
+    {
+public:
+    SPIClass() {}
+    SPIClass(int /* mosi */, int /* miso */, int /* sck */) {}
+    void begin() {}
+    void end() {}
+    };
+
+inline SPIClass SPI;
+
+#endif // _SPI_h_
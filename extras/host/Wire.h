@@ -0,0 +1,30 @@
+/*
+
+Module: Wire.h
+
+Function:
+    Host stand-in for the Arduino I2C driver.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+*/
+
+#ifndef _Wire_h_
+# define _Wire_h_
+
+#pragma once
+
+class TwoWire
+    {
+public:
+    void begin() {}
+    void end() {}
+    };
+
+inline TwoWire Wire;
+
+#endif // _Wire_h_
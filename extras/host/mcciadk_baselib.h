@@ -0,0 +1,21 @@
+/*
+
+Module: mcciadk_baselib.h
+
+Function:
+    Host stand-in for the MCCI ADK base library (nothing is needed).
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+*/
+
+#ifndef _mcciadk_baselib_h_
+# define _mcciadk_baselib_h_
+
+#pragma once
+
+#endif // _mcciadk_baselib_h_
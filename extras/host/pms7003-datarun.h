@@ -0,0 +1,73 @@
+/*
+
+Module: pms7003-datarun.h
+
+Function:
+    Read the measurements from a console log such as
+    assets/data-run-1.txt.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The test sketch prints one line per frame:
+
+        CF1 pm 1.0=4 2.5=7 10=7 ATM pm 1.0=4 2.5=7 10=7 Dust .3=996 ...
+
+    Other lines are ignored.
+
+*/
+
+#ifndef _pms7003_datarun_h_
+# define _pms7003_datarun_h_
+
+#pragma once
+
+#include <pms7003-host.h>
+
+#include <cstdio>
+#include <vector>
+
+namespace McciCatenaHost {
+
+// append the measurements in the log at pPath to v. Returns false if
+// the file can't be opened.
+inline bool readDataRun(const char *pPath, std::vector<Measurements16> &v)
+    {
+    std::FILE * const fp = std::fopen(pPath, "r");
+
+    if (fp == nullptr)
+        return false;
+
+    char line[256];
+
+    while (std::fgets(line, sizeof(line), fp) != nullptr)
+        {
+        unsigned c[12];
+
+        if (std::sscanf(line,
+                " CF1 pm 1.0=%u 2.5=%u 10=%u ATM pm 1.0=%u 2.5=%u 10=%u"
+                " Dust .3=%u .5=%u 1.0=%u 2.5=%u 5=%u 10=%u",
+                &c[0], &c[1], &c[2], &c[3], &c[4], &c[5],
+                &c[6], &c[7], &c[8], &c[9], &c[10], &c[11]) != 12)
+            continue;
+
+        Measurements16 m;
+
+        m.cf1.m1p0 = c[0];  m.cf1.m2p5 = c[1];  m.cf1.m10 = c[2];
+        m.atm.m1p0 = c[3];  m.atm.m2p5 = c[4];  m.atm.m10 = c[5];
+        m.dust.m0p3 = c[6]; m.dust.m0p5 = c[7]; m.dust.m1p0 = c[8];
+        m.dust.m2p5 = c[9]; m.dust.m5 = c[10];  m.dust.m10 = c[11];
+        v.push_back(m);
+        }
+
+    std::fclose(fp);
+    return true;
+    }
+
+} // namespace McciCatenaHost
+
+#endif // _pms7003_datarun_h_
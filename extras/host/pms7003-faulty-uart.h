@@ -0,0 +1,163 @@
+/*
+
+Module: pms7003-faulty-uart.h
+
+Function:
+    A serial line that carries a clean PMS7003 frame stream into a host
+    HardwareSerial, injecting configurable faults on the way.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+*/
+
+#ifndef _pms7003_faulty_uart_h_
+# define _pms7003_faulty_uart_h_
+
+#pragma once
+
+#include <pms7003-host.h>
+
+namespace McciCatenaHost {
+
+class cFaultyUart
+    {
+public:
+    // the fault model. All rates are probabilities; zero disables.
+    struct Faults
+        {
+        double      dropRate = 0;       // per byte: byte is lost
+        double      bitErrorRate = 0;   // per bit: bit is inverted
+        double      burstRate = 0;      // per byte: a noise burst starts
+        unsigned    burstMin = 2;       // burst length, in bytes
+        unsigned    burstMax = 16;
+        double      truncateRate = 0;   // per frame: frame is cut short
+        double      spuriousRate = 0;   // per byte: a stray 0x42 is inserted first
+        };
+
+    struct Stats
+        {
+        std::uint32_t   nFrames;
+        std::uint32_t   nDamagedFrames;
+        std::uint32_t   nBytesIn;
+        std::uint32_t   nBytesOut;
+        std::uint32_t   nDropped;
+        std::uint32_t   nBitsFlipped;
+        std::uint32_t   nBursts;
+        std::uint32_t   nTruncated;
+        std::uint32_t   nSpurious;
+        };
+
+    // 9600 baud, 8N1: ten bit times per byte.
+    static constexpr std::uint32_t kByteMicros = 10 * 1000 * 1000 / 9600;
+
+    cFaultyUart(HardwareSerial &port, std::uint32_t seed, const Faults &faults)
+        : m_port(port)
+        , m_random(seed)
+        , m_faults(faults)
+        , m_stats {}
+        {}
+
+    // send one frame down the line, calling poll() after each byte
+    // time, as the sketch's loop would. Returns true if any fault
+    // touched the frame. A stray byte inserted ahead of the first
+    // byte doesn't count as damage: a parser that resynchronizes well
+    // still gets the frame.
+    template <typename TPoll>
+    bool sendFrame(const std::uint8_t *pFrame, std::size_t nFrame, TPoll poll)
+        {
+        bool fDamaged = false;
+
+        ++this->m_stats.nFrames;
+        if (this->m_random.chance(this->m_faults.truncateRate))
+            {
+            ++this->m_stats.nTruncated;
+            nFrame = 1 + this->m_random.uniform(nFrame - 1);
+            fDamaged = true;
+            }
+
+        for (std::size_t i = 0; i < nFrame; ++i)
+            {
+            std::uint8_t c = pFrame[i];
+
+            ++this->m_stats.nBytesIn;
+            if (this->m_random.chance(this->m_faults.spuriousRate))
+                {
+                ++this->m_stats.nSpurious;
+                this->deliver(0x42, poll);
+                if (i != 0)
+                    fDamaged = true;
+                }
+
+            if (this->m_nBurst == 0 && this->m_random.chance(this->m_faults.burstRate))
+                {
+                ++this->m_stats.nBursts;
+                this->m_nBurst = this->m_faults.burstMin +
+                    this->m_random.uniform(this->m_faults.burstMax - this->m_faults.burstMin + 1);
+                }
+
+            if (this->m_nBurst != 0)
+                {
+                --this->m_nBurst;
+                c = std::uint8_t(this->m_random.next());
+                fDamaged = true;
+                }
+
+            if (this->m_faults.bitErrorRate != 0)
+                {
+                for (unsigned iBit = 0; iBit < 8; ++iBit)
+                    {
+                    if (this->m_random.chance(this->m_faults.bitErrorRate))
+                        {
+                        ++this->m_stats.nBitsFlipped;
+                        c ^= std::uint8_t(1u << iBit);
+                        fDamaged = true;
+                        }
+                    }
+                }
+
+            if (this->m_random.chance(this->m_faults.dropRate))
+                {
+                ++this->m_stats.nDropped;
+                fDamaged = true;
+                McciCatenaHost::gClock.advanceMicros(kByteMicros);
+                poll();
+                continue;
+                }
+
+            this->deliver(c, poll);
+            }
+
+        if (fDamaged)
+            ++this->m_stats.nDamagedFrames;
+        return fDamaged;
+        }
+
+    const Stats &getStats() const
+        {
+        return this->m_stats;
+        }
+
+private:
+    template <typename TPoll>
+    void deliver(std::uint8_t c, TPoll poll)
+        {
+        ++this->m_stats.nBytesOut;
+        this->m_port.hostRx(c);
+        McciCatenaHost::gClock.advanceMicros(kByteMicros);
+        poll();
+        }
+
+    HardwareSerial &    m_port;
+    cRandom             m_random;
+    Faults              m_faults;
+    Stats               m_stats;
+    unsigned            m_nBurst = 0;
+    };
+
+} // namespace McciCatenaHost
+
+#endif // _pms7003_faulty_uart_h_
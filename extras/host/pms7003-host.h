@@ -0,0 +1,239 @@
+/*
+
+Module: pms7003-host.h
+
+Function:
+    Helpers shared by the host-side tools: a seeded random number
+    generator, synthetic measurements, and PMS7003 wire frames.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+*/
+
+#ifndef _pms7003_host_h_
+# define _pms7003_host_h_
+
+#pragma once
+
+#include <Catena-PMS7003.h>
+#include <Catena-PMS7003-Reduce.h>
+#include <cstdint>
+#include <cstdlib>
+
+namespace McciCatenaPMS7003 {
+
+/****************************************************************************\
+|
+|   Access to the internals of cPMS7003
+|
+\****************************************************************************/
+
+class cPMS7003HostAccess
+    {
+public:
+    static constexpr std::size_t kFrameSize = sizeof(cPMS7003::WireData);
+
+    static std::uint16_t computeChecksum(const std::uint8_t *pData, size_t nData)
+        {
+        return cPMS7003::computeChecksum(pData, nData);
+        }
+
+    static cPMS7003::State getState(const cPMS7003 &pms)
+        {
+        return pms.m_fsm.getState();
+        }
+    };
+
+} // namespace McciCatenaPMS7003
+
+namespace McciCatenaHost {
+
+/****************************************************************************\
+|
+|   A small, fully-specified PRNG (xorshift32), so that every platform
+|   produces the same sequence for the same seed.
+|
+\****************************************************************************/
+
+class cRandom
+    {
+public:
+    cRandom(std::uint32_t seed)
+        : m_state(seed != 0 ? seed : 0x2545F491u)
+        {}
+
+    std::uint32_t next()
+        {
+        std::uint32_t x = this->m_state;
+
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        this->m_state = x;
+        return x;
+        }
+
+    // uniform in [0, n)
+    std::uint32_t uniform(std::uint32_t n)
+        {
+        return std::uint32_t((std::uint64_t(this->next()) * n) >> 32);
+        }
+
+    // true with probability p
+    bool chance(double p)
+        {
+        return this->next() < p * 4294967296.0;
+        }
+
+private:
+    std::uint32_t   m_state;
+    };
+
+/****************************************************************************\
+|
+|   Synthetic measurements and frames
+|
+\****************************************************************************/
+
+using Measurements16 = McciCatenaPMS7003::cPMS7003::Measurements<std::uint16_t>;
+
+// make a plausible measurement: values scattered around a base level,
+// with an occasional outlier of the sort the IQR filter is meant to
+// remove.
+inline void makeMeasurement(cRandom &r, std::uint16_t pmBase, Measurements16 &m)
+    {
+    auto jitter = [&r](std::uint32_t base) -> std::uint16_t
+        {
+        std::uint32_t v = base + r.uniform(base / 4 + 2);
+
+        if (r.chance(0.05))
+            v *= 3;
+        return std::uint16_t(v > 0xFFFF ? 0xFFFF : v);
+        };
+
+    m.atm.m1p0 = jitter(pmBase * 2 / 3);
+    m.atm.m2p5 = jitter(pmBase);
+    m.atm.m10  = jitter(pmBase + pmBase / 8);
+    m.cf1 = m.atm;
+    m.dust.m0p3 = jitter(pmBase * 150u);
+    m.dust.m0p5 = jitter(pmBase * 40u);
+    m.dust.m1p0 = jitter(pmBase * 5u);
+    m.dust.m2p5 = jitter(pmBase / 2);
+    m.dust.m5   = jitter(pmBase / 8);
+    m.dust.m10  = jitter(pmBase / 16);
+    }
+
+static constexpr std::size_t kFrameSize = McciCatenaPMS7003::cPMS7003HostAccess::kFrameSize;
+
+// encode m as the 32-byte frame the PMS7003 sends in active mode.
+inline void makeFrame(const Measurements16 &m, std::uint8_t (&frame)[kFrameSize])
+    {
+    std::uint8_t *p = frame;
+    auto put2 = [&p](std::uint16_t v)
+        {
+        *p++ = std::uint8_t(v >> 8);
+        *p++ = std::uint8_t(v);
+        };
+
+    *p++ = 0x42;
+    *p++ = 0x4D;
+    put2(kFrameSize - 4);
+    put2(m.cf1.m1p0);   put2(m.cf1.m2p5);   put2(m.cf1.m10);
+    put2(m.atm.m1p0);   put2(m.atm.m2p5);   put2(m.atm.m10);
+    put2(m.dust.m0p3);  put2(m.dust.m0p5);  put2(m.dust.m1p0);
+    put2(m.dust.m2p5);  put2(m.dust.m5);    put2(m.dust.m10);
+    put2(0);    // reserved.
+    put2(McciCatenaPMS7003::cPMS7003HostAccess::computeChecksum(frame, kFrameSize - 2));
+    }
+
+// bring the PMS7003 FSM up to the point where it's receiving data on
+// port. Warmup frames are still flagged as such, but are accepted.
+inline void startPms7003(McciCatenaPMS7003::cPMS7003 &pms, HardwareSerial &port)
+    {
+    pms.begin();
+    pms.eventWake();
+    for (int i = 0; i < 100 && ! port.isOpen(); ++i)
+        {
+        delay(100);
+        pms.poll();
+        }
+    delay(100);
+    pms.poll();
+    }
+
+/****************************************************************************\
+|
+|   The reference reduction
+|
+\****************************************************************************/
+
+// the comparison the original reduction gave qsort().
+inline int referenceCompare16(const void *pLeft, const void *pRight)
+    {
+    auto p = (const std::uint16_t *)pLeft;
+    auto q = (const std::uint16_t *)pRight;
+
+    return (int)*p - (int)*q;
+    }
+
+// the lora sketch's original reduction of one channel: sort with
+// qsort(), find the quartiles, and average what's inside the fences,
+// scanning in from each end. Sorts v in place.
+template <std::size_t N>
+inline float referenceIqrMean(std::uint16_t (&v)[N])
+    {
+    std::uint16_t * const pv = v;
+    const std::uint16_t * const pq1 = pv + N / 4;
+    const std::uint16_t * const pq3 = pv + N - (N / 4) - 1;
+
+    std::qsort(pv, N, sizeof(pv[0]), referenceCompare16);
+
+    std::int32_t const iqr15 = (3 * (*pq3 - *pq1)) >> 1;
+    std::int32_t const lowlim = pq1[0] - iqr15;
+    std::int32_t const highlim = pq3[0] + iqr15;
+    const std::uint16_t *p1;
+    const std::uint16_t *p2;
+
+    for (p1 = pv; p1 < pq1 && *p1 < lowlim; ++p1)
+        ;
+    for (p2 = pv + N - 1; pq3 < p2 && *p2 > highlim; --p2)
+        ;
+
+    std::uint32_t sum = 0;
+    for (auto p = p1; p <= p2; ++p)
+        sum += *p;
+
+    float const div = (p2 - p1 + 1) * 65535.0f;
+    return sum / div;
+    }
+
+// the same, for every channel of a window, one channel at a time.
+template <std::size_t N>
+inline void referenceReduce(const Measurements16 *pWindow, McciCatenaPMS7003::cPMS7003::Measurements<float> &r)
+    {
+    using namespace McciCatenaPMS7003;
+    std::uint16_t v[kReduceChannels][N];
+    float result[kReduceChannels];
+
+    for (std::size_t i = 0; i < N; ++i)
+        {
+        std::uint16_t row[kReduceChannels];
+
+        getReduceChannels(pWindow[i], row);
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            v[c][i] = row[c];
+        }
+
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        result[c] = referenceIqrMean(v[c]);
+
+    setReduceChannels(r, result);
+    }
+
+} // namespace McciCatenaHost
+
+#endif // _pms7003_host_h_
@@ -0,0 +1,69 @@
+/*
+
+Module: pms7003-lora-globals.h
+
+Function:
+    The globals that the lora sketch's .ino file would provide, for the
+    host tools that link the sketch.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    This defines objects, not just declarations: include it exactly
+    once per program, in the tool's main source file. The HAL starts
+    with no debug flags; a tool that wants some sets them with
+    gPmsHal.setDebugFlags().
+
+    fail() and gnFailed are the usual check-and-count for the tests.
+
+*/
+
+#ifndef _pms7003_lora_globals_h_
+# define _pms7003_lora_globals_h_
+
+#pragma once
+
+#include <pms7003-lora-host.h>
+#include <Catena-PMS7003Hal-4630.h>
+
+#include <cstdio>
+
+/****************************************************************************\
+|
+|   The globals that the sketch expects
+|
+\****************************************************************************/
+
+McciCatena::Catena gCatena;
+McciCatena::Catena::LoRaWAN gLoRaWAN;
+McciCatena::StatusLed gLed (McciCatena::Catena::PIN_STATUS_LED);
+SPIClass gSPI2;
+McciCatena::Catena_Mx25v8035f gFlash;
+bool gfFlash;
+
+McciCatenaSht3x::cSHT3x gTempRh { Wire };
+McciCatenaPMS7003::cPMS7003Hal_4630 gPmsHal { gCatena, 0 };
+McciCatenaPMS7003::cPMS7003 gPms7003 { Serial2, gPmsHal };
+cMeasurementLoop gMeasurementLoop { gPms7003, gTempRh };
+
+/****************************************************************************\
+|
+|   Counting failures
+|
+\****************************************************************************/
+
+unsigned gnFailed;
+
+// report a failed check (the first 20 of them), and count it.
+void fail(const char *pWhat, unsigned long n)
+    {
+    if (gnFailed < 20)
+        std::printf("%s (%lu)\n", pWhat, n);
+    ++gnFailed;
+    }
+
+#endif // _pms7003_lora_globals_h_
@@ -0,0 +1,105 @@
+/*
+
+Module: pms7003-lora-host.h
+
+Function:
+    Host-side access to the lora sketch's cMeasurementLoop.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Tools that include this must also define the globals that the
+    sketch's .ino file would normally provide (gCatena, gLoRaWAN, gLed,
+    gSPI2, gFlash and gfFlash), usually by including
+    pms7003-lora-globals.h instead, and must put the sketch directory
+    on the include path.
+
+*/
+
+#ifndef _pms7003_lora_host_h_
+# define _pms7003_lora_host_h_
+
+#pragma once
+
+#include "catena-pms7003-lora-cMeasurementLoop.h"
+#include <pms7003-host.h>
+
+class cMeasurementLoopHostAccess
+    {
+public:
+    using TxBuffer_t = cMeasurementLoop::TxBuffer_t;
+    using State = cMeasurementLoop::State;
+
+    static constexpr unsigned kDefaultMeasurements = cMeasurementLoop::kDefaultMeasurements;
+
+    static bool postProcess(cMeasurementLoop &loop, std::uint16_t (&r)[McciCatenaPMS7003::kReduceChannels])
+        {
+        return loop.postProcess(r);
+        }
+
+    // reduce the window and fill the buffer, as stTransmit does.
+    static void fillTxBuffer(cMeasurementLoop &loop, TxBuffer_t &b)
+        {
+        std::uint16_t results[McciCatenaPMS7003::kReduceChannels] = {};
+        bool const fValid = loop.m_measurement_valid && loop.postProcess(results);
+
+        loop.fillTxBuffer(b, results, fValid);
+        }
+
+    // load a complete window of samples (as many as the loop's window
+    // length), as if they had arrived from the PMS7003.
+    static void loadWindow(
+        cMeasurementLoop &loop,
+        const McciCatenaHost::Measurements16 *pData
+        )
+        {
+        loop.setContinuous(false);
+        loop.resetMeasurement();
+        for (unsigned i = 0; i < loop.m_nMeasurements; ++i, ++pData)
+            loop.m_window.put(i, *pData);
+        loop.m_iMeasurement = loop.m_nMeasurements;
+        loop.m_measurement_valid = true;
+        }
+
+    // route cPMS7003 measurements to the loop, as begin() does.
+    static void setCallback(cMeasurementLoop &loop)
+        {
+        loop.m_Pms7003.setCallback(cMeasurementLoop::measurementAvailable, &loop);
+        }
+
+    // pass a measurement to the loop, as cPMS7003 does; for a harness
+    // that watches the measurements on their way.
+    static void measurementAvailable(
+        void *pUserData,
+        const McciCatenaHost::Measurements16 *pData,
+        bool fWarmedUp,
+        std::uint32_t tFrameMs
+        )
+        {
+        cMeasurementLoop::measurementAvailable(pUserData, pData, fWarmedUp, tFrameMs);
+        }
+
+    static State getState(const cMeasurementLoop &loop)
+        {
+        return loop.m_fsm.getState();
+        }
+
+    using FlashLog_t = cMeasurementLoop::FlashLog_t;
+
+    static const FlashLog_t &getLog(const cMeasurementLoop &loop)
+        {
+        return loop.m_log;
+        }
+
+    // the number of intervals held for a batched uplink.
+    static std::size_t getBatchCount(const cMeasurementLoop &loop)
+        {
+        return loop.m_batch.getCount();
+        }
+    };
+
+#endif // _pms7003_lora_host_h_
@@ -0,0 +1,191 @@
+/*
+
+Module: pms7003-sim.h
+
+Function:
+    A simulated PMS7003, driven by the HAL's power, reset and mode
+    outputs and by the commands the library sends.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The timings default to what we see on real sensors: data starts a
+    few seconds after power-up or wake-up, and then arrives about once
+    a second in active mode.
+
+*/
+
+#ifndef _pms7003_sim_h_
+# define _pms7003_sim_h_
+
+#pragma once
+
+#include <pms7003-host.h>
+#include <Catena-PMS7003Hal.h>
+
+namespace McciCatenaHost {
+
+class cPms7003Sim
+    {
+public:
+    enum class State : std::uint8_t
+        {
+        Off,        // no power, or held in reset
+        Starting,   // fan spinning up; no data yet
+        Active,     // sending a frame every m_frameMs
+        Passive,    // sending a frame on request
+        SwSleep,    // sleeping by command
+        HwSleep,    // sleeping by SET pin
+        };
+
+    cPms7003Sim(HardwareSerial &port, McciCatenaPMS7003::cPMS7003Hal &hal, std::uint32_t seed)
+        : m_port(port)
+        , m_hal(hal)
+        , m_random(seed)
+        {
+        port.hostTx(txCallback, this);
+        }
+
+    // timing (in ms)
+    std::uint32_t   m_powerOnMs = 6000;     // power-on to first frame
+    std::uint32_t   m_wakeMs = 3000;        // wake-up to first frame
+    std::uint32_t   m_frameMs = 1000;       // frame interval, active mode
+
+    // base level for the synthetic data.
+    std::uint16_t   m_pmBase = 20;
+
+    State getState() const
+        {
+        return this->m_state;
+        }
+
+    std::uint32_t getFramesSent() const
+        {
+        return this->m_nFrames;
+        }
+
+    void poll()
+        {
+        std::uint32_t const now = millis();
+        bool const fPowered = this->m_hal.get5v() &&
+                              this->m_hal.getReset() != McciCatenaPMS7003::cPMS7003Hal::PinState::Zero;
+        bool const fSetLow = this->m_hal.getMode() == McciCatenaPMS7003::cPMS7003Hal::PinState::Zero;
+
+        if (! fPowered)
+            {
+            this->m_state = State::Off;
+            return;
+            }
+
+        switch (this->m_state)
+            {
+        case State::Off:
+            this->start(now, this->m_powerOnMs);
+            break;
+
+        case State::HwSleep:
+            if (! fSetLow)
+                this->start(now, this->m_wakeMs);
+            break;
+
+        case State::SwSleep:
+            break;
+
+        default:
+            if (fSetLow)
+                this->m_state = State::HwSleep;
+            else if (this->m_fPendingRead || std::int32_t(now - this->m_tNext) >= 0)
+                {
+                if (this->m_state == State::Starting)
+                    this->m_state = this->m_fPassive ? State::Passive : State::Active;
+
+                if (this->m_state == State::Active || this->m_fPendingRead)
+                    this->sendFrame();
+
+                this->m_fPendingRead = false;
+                this->m_tNext = now + this->m_frameMs;
+                }
+            break;
+            }
+        }
+
+private:
+    void start(std::uint32_t now, std::uint32_t delayMs)
+        {
+        this->m_state = State::Starting;
+        this->m_tNext = now + delayMs;
+        this->m_fPendingRead = false;
+        }
+
+    void sendFrame()
+        {
+        Measurements16 m;
+        std::uint8_t frame[kFrameSize];
+
+        makeMeasurement(this->m_random, this->m_pmBase, m);
+        makeFrame(m, frame);
+        for (auto c : frame)
+            this->m_port.hostRx(c);
+        ++this->m_nFrames;
+        }
+
+    // commands are 42 4D cmd dataH dataL csH csL; we trust the
+    // library to send them whole.
+    static void txCallback(void *pCtx, const std::uint8_t *pBuffer, std::size_t nBuffer)
+        {
+        auto const pThis = static_cast<cPms7003Sim *>(pCtx);
+
+        if (nBuffer != 7 || pBuffer[0] != 0x42 || pBuffer[1] != 0x4D)
+            return;
+
+        pThis->command(pBuffer[2], pBuffer[4]);
+        }
+
+    void command(std::uint8_t cmd, std::uint8_t data)
+        {
+        std::uint32_t const now = millis();
+
+        switch (cmd)
+            {
+        case 0xE1:  // change mode
+            this->m_fPassive = (data == 0);
+            if (this->m_state == State::Active && this->m_fPassive)
+                this->m_state = State::Passive;
+            else if (this->m_state == State::Passive && ! this->m_fPassive)
+                this->m_state = State::Active;
+            break;
+
+        case 0xE2:  // read in passive mode
+            if (this->m_state == State::Passive)
+                this->m_fPendingRead = true;
+            break;
+
+        case 0xE4:  // sleep / wake
+            if (data == 0 && this->m_state != State::Off)
+                this->m_state = State::SwSleep;
+            else if (data != 0 && this->m_state == State::SwSleep)
+                this->start(now, this->m_wakeMs);
+            break;
+
+        default:
+            break;
+            }
+        }
+
+    HardwareSerial &                    m_port;
+    McciCatenaPMS7003::cPMS7003Hal &    m_hal;
+    cRandom                             m_random;
+    State           m_state = State::Off;
+    std::uint32_t   m_tNext = 0;
+    std::uint32_t   m_nFrames = 0;
+    bool            m_fPassive = false;
+    bool            m_fPendingRead = false;
+    };
+
+} // namespace McciCatenaHost
+
+#endif // _pms7003_sim_h_
@@ -0,0 +1,960 @@
+/*
+
+Module: pms7003-uplink-decoder.h
+
+Function:
+    cUplinkDecoder: decode port 1 uplinks (formats 0x20 to 0x23) on a
+    PC, to the same values and JSON as the JavaScript decoders.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Fields 0 to 4, and fields 5 to 7 of formats 0x20 and 0x21, are
+    read with cPort1Message (src/Catena-PMS7003-Port1.h), the table the
+    sketches encode with. Field 5 of the batched formats is read as
+    extras/catena-message-port1-format-20.md describes it.
+
+    The derived values (dew point, heat index and AQI) are computed
+    with the same double operations, in the same order (and the same
+    logarithm), as
+    extras/catena-message-port1-format-20-decoder-node-red.js, and
+    putJson() writes what JSON.stringify() writes for the object that
+    decoder returns: the same keys in the same order (JavaScript puts
+    keys such as "5" and "10" first), and numbers in the shortest form
+    that reads back exactly, as JavaScript's Number.toString() does.
+    So the output can be compared byte for byte. Don't build with
+    -ffast-math, and don't let the compiler fuse multiplies and adds
+    (-ffp-contract=off, where the target has FMA).
+
+    Nothing is allocated: a decoder holds one uplink, and the writers
+    take a buffer of kMaxJson or kMaxCsv bytes.
+
+*/
+
+#ifndef _pms7003_uplink_decoder_h_
+# define _pms7003_uplink_decoder_h_
+
+#pragma once
+
+#include <Catena-PMS7003-Port1.h>
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+namespace McciCatenaHost {
+
+using McciCatenaPMS7003::cPort1Message;
+
+// the particle channels: pm 1.0, 2.5 and 10, then the six dust counts.
+constexpr std::size_t kUplinkChannels = cPort1Message::kDust10 + 1 - cPort1Message::kPm1p0;
+
+// an interval of a batched uplink.
+struct UplinkInterval
+    {
+    std::uint32_t   age;        // seconds before the uplink
+    std::uint32_t   seq;        // the flash log sequence number, if any
+    bool            fValid;     // true if it has particle data
+    std::uint16_t   uf[kUplinkChannels];
+    };
+
+class cUplinkDecoder
+    {
+public:
+    static constexpr std::size_t kMaxIntervals = 8;
+
+    // room for the longest output of putJson() and putCsv().
+    static constexpr std::size_t kMaxJson = 16 * 1024;
+    static constexpr std::size_t kMaxCsv = 8 * 1024;
+
+    // decode an uplink of nBuf bytes; false if it isn't one of ours,
+    // or is cut short. Bytes after the message are ignored, as the
+    // JavaScript decoders ignore them.
+    bool decode(const std::uint8_t *pBuf, std::size_t nBuf);
+
+    const cPort1Message &getMessage() const
+        {
+        return this->m_msg;
+        }
+    // true for formats 0x22 and 0x23.
+    bool isBatch() const
+        {
+        return (this->m_msg.getFormat() & 0x02) != 0;
+        }
+    // the intervals of a batched uplink; none if field 5 is absent.
+    std::size_t getIntervalCount() const
+        {
+        return this->m_nIntervals;
+        }
+    const UplinkInterval &getInterval(std::size_t i) const
+        {
+        return this->m_intervals[i];
+        }
+    // the sequence number of the first interval, if field 6 is present.
+    bool getSeq(std::uint32_t &seq) const
+        {
+        seq = this->m_seq;
+        return this->m_fSeq;
+        }
+    // the number of bytes the uplink used, not counting any after it.
+    std::size_t getSize() const
+        {
+        return this->m_nBytes;
+        }
+
+    // the values the decoders compute from the measurements.
+    static double getDewpoint(double t, double rh);
+    static bool getHeatIndex(double t, double rh, double &tHeat);
+    static double getAqi2p5(double pm2p5)
+        {
+        return interpolate(pm2p5, kAqi2p5);
+        }
+    static double getAqi10(double pm10)
+        {
+        return interpolate(pm10, kAqi10);
+        }
+    // the value of a particle channel's code, in µg/m^3 or per 0.1 L.
+    static double getParticleValue(std::uint16_t uf)
+        {
+        return double(McciCatenaPMS7003::uflt16Decode(uf)) * 65536.0;
+        }
+
+    // write the uplink as JSON.stringify() would write the decoded
+    // object, without a newline. Returns the end of the text.
+    char *putJson(char *p) const;
+
+    // write the uplink as CSV, with record as the first column: one row
+    // per interval of a batch, else one row. Returns the end.
+    char *putCsv(char *p, std::uint64_t record) const;
+    static char *putCsvHeader(char *p);
+
+    // write v as JavaScript's Number.toString() does; non-finite
+    // values as null, as JSON.stringify() does.
+    static char *putNumber(char *p, double v);
+
+private:
+    using Aqi_t = double[7][2];
+
+    // from extras/calculate-aqi.js.
+    static constexpr Aqi_t kAqi2p5 =
+        {
+        { 0, 0 }, { 12.1, 51 }, { 35.5, 101 }, { 55.5, 151 },
+        { 150.5, 201 }, { 250.5, 301 }, { 350.5, 401 }
+        };
+    static constexpr Aqi_t kAqi10 =
+        {
+        { 0, 0 }, { 55, 51 }, { 155, 101 }, { 255, 151 },
+        { 355, 201 }, { 425, 301 }, { 505, 401 }
+        };
+
+    static double interpolate(double v, const Aqi_t &t);
+    static double jsLog(double x);
+    static bool getExactDigits(double v, char (&digits)[24], int &k, int &n);
+    static char *putString(char *p, const char *s)
+        {
+        std::size_t const n = std::strlen(s);
+
+        std::memcpy(p, s, n);
+        return p + n;
+        }
+    static char *putUint(char *p, std::uint64_t v)
+        {
+        return std::to_chars(p, p + 20, v).ptr;
+        }
+    static char *putParticlesJson(char *p, const double (&v)[kUplinkChannels], bool fPm, bool fDust, const double *pAqi);
+    char *putCsvRow(char *p, std::uint64_t record, const UplinkInterval *pInterval, const double *pV) const;
+    std::size_t decodeBatch(const std::uint8_t *pBuf, std::size_t nBuf);
+
+    cPort1Message   m_msg;
+    std::uint32_t   m_seq;
+    bool            m_fSeq;
+    std::size_t     m_nBytes;
+    std::uint8_t    m_nIntervals;
+    UplinkInterval  m_intervals[kMaxIntervals];
+    };
+
+/****************************************************************************\
+|
+|   Decoding
+|
+\****************************************************************************/
+
+inline bool cUplinkDecoder::decode(const std::uint8_t *pBuf, std::size_t nBuf)
+    {
+    std::size_t const n = this->m_msg.decode(pBuf, nBuf);
+
+    this->m_nIntervals = 0;
+    this->m_fSeq = false;
+    this->m_nBytes = n;
+    if (n == 0)
+        return false;
+
+    if (! this->isBatch())
+        return true;
+
+    std::uint8_t const flags = this->m_msg.getFlags();
+    std::size_t i = n;
+
+    if (flags & 0x20)
+        {
+        std::size_t const nBatch = this->decodeBatch(pBuf + i, nBuf - i);
+
+        if (nBatch == 0)
+            return false;
+        i += nBatch;
+        }
+
+    if (flags & 0x40)
+        {
+        if (nBuf - i < 4)
+            return false;
+
+        this->m_seq = (std::uint32_t(pBuf[i]) << 24) | (std::uint32_t(pBuf[i + 1]) << 16) |
+                      (std::uint32_t(pBuf[i + 2]) << 8) | pBuf[i + 3];
+        this->m_fSeq = true;
+        for (std::size_t iInterval = 0; iInterval < this->m_nIntervals; ++iInterval)
+            this->m_intervals[iInterval].seq = this->m_seq + std::uint32_t(iInterval);
+        i += 4;
+        }
+
+    this->m_nBytes = i;
+    return true;
+    }
+
+// field 5 of formats 0x22 and 0x23; returns the number of bytes used, or
+// 0 if the field is malformed.
+inline std::size_t cUplinkDecoder::decodeBatch(const std::uint8_t *pBuf, std::size_t nBuf)
+    {
+    std::size_t i = 0;
+
+    auto getVarint = [&](std::uint32_t &v) -> bool
+        {
+        v = 0;
+        for (unsigned shift = 0; i < nBuf && shift < 32; shift += 7)
+            {
+            std::uint8_t const b = pBuf[i++];
+
+            v |= std::uint32_t(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+            }
+        return false;
+        };
+
+    if (nBuf < 5 || pBuf[0] > kMaxIntervals)
+        return 0;
+
+    std::size_t const nIntervals = pBuf[0];
+    std::uint8_t const validMap = pBuf[1];
+    std::uint8_t const deltaMap = pBuf[2];
+    std::uint32_t age = (std::uint32_t(pBuf[3]) << 8) | pBuf[4];
+    const std::uint16_t *pPrev = nullptr;
+
+    i = 5;
+    for (std::size_t iInterval = 0; iInterval < nIntervals; ++iInterval)
+        {
+        UplinkInterval &d = this->m_intervals[iInterval];
+
+        if (iInterval > 0)
+            {
+            std::uint32_t delta;
+
+            if (! getVarint(delta) || delta > age)
+                return 0;
+            age -= delta;
+            }
+        d.age = age;
+        d.seq = 0;
+        d.fValid = (validMap >> iInterval) & 1;
+
+        if (! d.fValid)
+            continue;
+
+        bool const fDelta = (deltaMap >> iInterval) & 1;
+
+        if (fDelta && pPrev == nullptr)
+            return 0;
+
+        for (std::size_t c = 0; c < kUplinkChannels; ++c)
+            {
+            if (! fDelta)
+                {
+                if (nBuf - i < 2)
+                    return 0;
+                d.uf[c] = std::uint16_t((pBuf[i] << 8) | pBuf[i + 1]);
+                i += 2;
+                }
+            else
+                {
+                std::uint32_t z;
+
+                if (! getVarint(z))
+                    return 0;
+
+                // zigzag, modulo 2^16.
+                std::uint32_t const delta = (z & 1) ? ~(z >> 1) : (z >> 1);
+
+                d.uf[c] = std::uint16_t(pPrev[c] + delta);
+                }
+            }
+        pPrev = d.uf;
+        }
+
+    this->m_nIntervals = std::uint8_t(nIntervals);
+    return i;
+    }
+
+/****************************************************************************\
+|
+|   The derived values
+|
+\****************************************************************************/
+
+// Math.log(), as JavaScript engines compute it: the C library's log()
+// can differ in the last bit. This is __ieee754_log() from fdlibm, which
+// V8 and SpiderMonkey use, for positive finite x:
+//
+// Copyright (C) 1993 by Sun Microsystems, Inc. All rights reserved.
+//
+// Developed at SunPro, a Sun Microsystems, Inc. business.
+// Permission to use, copy, modify, and distribute this
+// software is freely granted, provided that this notice
+// is preserved.
+inline double cUplinkDecoder::jsLog(double x)
+    {
+    static constexpr double ln2_hi = 6.93147180369123816490e-01;
+    static constexpr double ln2_lo = 1.90821492927058770002e-10;
+    static constexpr double two54 = 1.80143985094819840000e+16;
+    static constexpr double Lg1 = 6.666666666666735130e-01;
+    static constexpr double Lg2 = 3.999999999940941908e-01;
+    static constexpr double Lg3 = 2.857142874366239149e-01;
+    static constexpr double Lg4 = 2.222219843214978396e-01;
+    static constexpr double Lg5 = 1.818357216161805012e-01;
+    static constexpr double Lg6 = 1.531383769920937332e-01;
+    static constexpr double Lg7 = 1.479819860511658591e-01;
+
+    std::uint64_t bits;
+    std::int32_t hx;
+    int k = 0;
+
+    if (! (x > 0) || ! std::isfinite(x))
+        return std::log(x);
+
+    std::memcpy(&bits, &x, sizeof(bits));
+    hx = std::int32_t(bits >> 32);
+    if (hx < 0x00100000)
+        {
+        // subnormal: scale up.
+        k -= 54;
+        x *= two54;
+        std::memcpy(&bits, &x, sizeof(bits));
+        hx = std::int32_t(bits >> 32);
+        }
+
+    k += (hx >> 20) - 1023;
+    hx &= 0x000fffff;
+
+    std::int32_t i = (hx + 0x95f64) & 0x100000;
+
+    // normalize x or x/2.
+    bits = (bits & 0xFFFFFFFFu) | (std::uint64_t(std::uint32_t(hx | (i ^ 0x3ff00000))) << 32);
+    std::memcpy(&x, &bits, sizeof(x));
+    k += (i >> 20);
+
+    double const f = x - 1.0;
+    double const dk = double(k);
+
+    if ((0x000fffff & (2 + hx)) < 3)
+        {
+        // |f| < 2^-20
+        if (f == 0)
+            return k == 0 ? 0 : dk * ln2_hi + dk * ln2_lo;
+
+        double const R = f * f * (0.5 - 0.33333333333333333 * f);
+
+        return k == 0 ? f - R : dk * ln2_hi - ((R - dk * ln2_lo) - f);
+        }
+
+    double const s = f / (2.0 + f);
+    double const z = s * s;
+    double const w = z * z;
+    double const t1 = w * (Lg2 + w * (Lg4 + w * Lg6));
+    double const t2 = z * (Lg1 + w * (Lg3 + w * (Lg5 + w * Lg7)));
+    double const R = t2 + t1;
+
+    i = (hx - 0x6147a) | (0x6b851 - hx);
+    if (i > 0)
+        {
+        double const hfsq = 0.5 * f * f;
+
+        return k == 0 ? f - (hfsq - s * (hfsq + R))
+                      : dk * ln2_hi - ((hfsq - (s * (hfsq + R) + dk * ln2_lo)) - f);
+        }
+    else
+        {
+        return k == 0 ? f - s * (f - R)
+                      : dk * ln2_hi - ((s * (f - R) - dk * ln2_lo) - f);
+        }
+    }
+
+// dewpoint() in the decoders.
+inline double cUplinkDecoder::getDewpoint(double t, double rh)
+    {
+    double const c1 = 243.04;
+    double const c2 = 17.625;
+    double h = rh / 100;
+
+    if (h <= 0.01)
+        h = 0.01;
+    else if (h > 1.0)
+        h = 1.0;
+
+    double const lnh = jsLog(h);
+    double const tpc1 = t + c1;
+    double const txc2 = t * c2;
+    double const txc2_tpc1 = txc2 / tpc1;
+
+    return c1 * (lnh + txc2_tpc1) / (c2 - lnh - txc2_tpc1);
+    }
+
+// CalculateHeatIndex() in the decoders, with t in Fahrenheit; false
+// where it returns null.
+inline bool cUplinkDecoder::getHeatIndex(double t, double rh, double &tHeat)
+    {
+    double const tRounded = std::floor(t + 0.5);
+
+    if (tRounded < 76 || tRounded > 126)
+        return false;
+    if (rh < 0 || rh > 100)
+        return false;
+
+    double const tHeatEasy = 0.5 * (t + 61.0 + ((t - 68.0) * 1.2) + (rh * 0.094));
+
+    if ((tHeatEasy + t) < 160.0)
+        {
+        tHeat = tHeatEasy;
+        return true;
+        }
+
+    double const t2 = t * t;
+    double const rh2 = rh * rh;
+    double tResult =
+        -42.379 +
+        (2.04901523 * t) +
+        (10.14333127 * rh) +
+        (-0.22475541 * t * rh) +
+        (-0.00683783 * t2) +
+        (-0.05481717 * rh2) +
+        (0.00122874 * t2 * rh) +
+        (0.00085282 * t * rh2) +
+        (-0.00000199 * t2 * rh2);
+    double tAdjust;
+
+    if (rh < 13.0 && 80.0 <= t && t <= 112.0)
+        tAdjust = -((13.0 - rh) / 4.0) * std::sqrt((17.0 - std::fabs(t - 95.0)) / 17.0);
+    else if (rh > 85.0 && 80.0 <= t && t <= 87.0)
+        tAdjust = ((rh - 85.0) / 10.0) * ((87.0 - t) / 5.0);
+    else
+        tAdjust = 0;
+
+    tResult += tAdjust;
+
+    if (tResult >= 183.5)
+        return false;
+
+    tHeat = tResult;
+    return true;
+    }
+
+// interpolate() in CalculatePmAqi().
+inline double cUplinkDecoder::interpolate(double v, const Aqi_t &t)
+    {
+    std::size_t i;
+
+    for (i = 7 - 2; i > 0; --i)
+        if (t[i][0] <= v)
+            break;
+
+    double const baseX = t[i][0];
+    double const baseY = t[i][1];
+    double const dx = (t[i + 1][0] - baseX);
+    double const f = (v - baseX);
+    double const dy = (t[i + 1][1] - baseY);
+
+    return std::floor(baseY + f * dy / dx + 0.5);
+    }
+
+/****************************************************************************\
+|
+|   Output
+|
+\****************************************************************************/
+
+// Most values in an uplink are an integer over a power of two, with few
+// digits. For those, the exact decimal is quicker to find than the
+// shortest; and if it has 15 digits or fewer it is the shortest, as no
+// two decimals of 15 digits are the same double. False for the others.
+inline bool cUplinkDecoder::getExactDigits(double v, char (&digits)[24], int &k, int &n)
+    {
+    static constexpr std::size_t kMaxPow5 = 27;
+    static constexpr auto kPow5 = []
+        {
+        struct { std::uint64_t v[kMaxPow5 + 1]; } t {};
+
+        t.v[0] = 1;
+        for (std::size_t i = 1; i <= kMaxPow5; ++i)
+            t.v[i] = t.v[i - 1] * 5;
+        return t;
+        }();
+
+    std::uint64_t bits;
+
+    std::memcpy(&bits, &v, sizeof(bits));
+
+    int const biased = int(bits >> 52) & 0x7FF;
+
+    if (biased == 0)
+        return false;
+
+    // v = m * 2^e2, with m odd.
+    std::uint64_t m = (bits & ((std::uint64_t(1) << 52) - 1)) | (std::uint64_t(1) << 52);
+    int e2 = biased - 1075;
+
+    while ((m & 0xFF) == 0)
+        {
+        m >>= 8;
+        e2 += 8;
+        }
+    while ((m & 1) == 0)
+        {
+        m >>= 1;
+        ++e2;
+        }
+
+    // v = x * 10^-j
+    std::uint64_t x;
+    int j;
+
+    if (e2 >= 0)
+        {
+        if (e2 > 10)
+            return false;
+        x = m << e2;
+        j = 0;
+        }
+    else
+        {
+        j = -e2;
+        if (std::size_t(j) > kMaxPow5 || m > ~std::uint64_t(0) / kPow5.v[j])
+            return false;
+        x = m * kPow5.v[j];
+        }
+
+    int len = int(std::to_chars(digits, digits + sizeof(digits), x).ptr - digits);
+
+    n = len - j;
+    while (len > 1 && digits[len - 1] == '0')
+        --len;
+    k = len;
+    return k <= 15;
+    }
+
+inline char *cUplinkDecoder::putNumber(char *p, double v)
+    {
+    if (! std::isfinite(v))
+        return putString(p, "null");
+    if (v == 0)
+        {
+        *p++ = '0';
+        return p;
+        }
+    if (v < 0)
+        {
+        *p++ = '-';
+        v = -v;
+        }
+
+    // the shortest digits that read back as v: v = 0.digits * 10^n,
+    // with k digits.
+    char digits[24];
+    int k;
+    int n;
+
+    if (! getExactDigits(v, digits, k, n))
+        {
+        char sci[32];
+        char const * const pEnd = std::to_chars(sci, sci + sizeof(sci), v, std::chars_format::scientific).ptr;
+        char const *q;
+
+        k = 0;
+        for (q = sci; q < pEnd && *q != 'e'; ++q)
+            if (*q != '.')
+                digits[k++] = *q;
+
+        // the exponent, after the 'e': a sign, then two or more digits.
+        n = 0;
+        for (char const *r = q + 2; r < pEnd; ++r)
+            n = 10 * n + (*r - '0');
+        if (q[1] == '-')
+            n = -n;
+        ++n;
+        }
+
+    int const e = n - 1;
+
+    if (k <= n && n <= 21)
+        {
+        std::memcpy(p, digits, k);
+        p += k;
+        for (int i = k; i < n; ++i)
+            *p++ = '0';
+        }
+    else if (0 < n && n <= 21)
+        {
+        std::memcpy(p, digits, n);
+        p += n;
+        *p++ = '.';
+        std::memcpy(p, digits + n, k - n);
+        p += k - n;
+        }
+    else if (-6 < n && n <= 0)
+        {
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = n; i < 0; ++i)
+            *p++ = '0';
+        std::memcpy(p, digits, k);
+        p += k;
+        }
+    else
+        {
+        *p++ = digits[0];
+        if (k > 1)
+            {
+            *p++ = '.';
+            std::memcpy(p, digits + 1, k - 1);
+            p += k - 1;
+            }
+        *p++ = 'e';
+        *p++ = e < 0 ? '-' : '+';
+        p = putUint(p, std::uint64_t(e < 0 ? -e : e));
+        }
+
+    return p;
+    }
+
+// "pm", "aqi_partial", "aqi" and "dust", as SetPm() and the decoders
+// set them, with a comma after each. If pAqi isn't null, it's field 7,
+// which the decoders store in "aqi" after the dust: over the value
+// SetPm() computed, in its place, or else as a new key at the end.
+inline char *cUplinkDecoder::putParticlesJson(char *p, const double (&v)[kUplinkChannels], bool fPm, bool fDust, const double *pAqi)
+    {
+    if (fPm)
+        {
+        double const aqi1p0 = getAqi2p5(v[0]);
+        double const aqi2p5 = getAqi2p5(v[1]);
+        double const aqi10 = getAqi10(v[2]);
+
+        p = putString(p, "\"pm\":{\"10\":");
+        p = putNumber(p, v[2]);
+        p = putString(p, ",\"1.0\":");
+        p = putNumber(p, v[0]);
+        p = putString(p, ",\"2.5\":");
+        p = putNumber(p, v[1]);
+        p = putString(p, "},\"aqi_partial\":{\"10\":");
+        p = putNumber(p, aqi10);
+        p = putString(p, ",\"1.0\":");
+        p = putNumber(p, aqi1p0);
+        p = putString(p, ",\"2.5\":");
+        p = putNumber(p, aqi2p5);
+        p = putString(p, "},\"aqi\":");
+        p = putNumber(p, pAqi ? *pAqi : aqi2p5 > aqi10 ? aqi2p5 : aqi10);
+        *p++ = ',';
+        }
+
+    if (fDust)
+        {
+        p = putString(p, "\"dust\":{\"5\":");
+        p = putNumber(p, v[7]);
+        p = putString(p, ",\"10\":");
+        p = putNumber(p, v[8]);
+        p = putString(p, ",\"0.3\":");
+        p = putNumber(p, v[3]);
+        p = putString(p, ",\"0.5\":");
+        p = putNumber(p, v[4]);
+        p = putString(p, ",\"1.0\":");
+        p = putNumber(p, v[5]);
+        p = putString(p, ",\"2.5\":");
+        p = putNumber(p, v[6]);
+        p = putString(p, "},");
+        }
+
+    if (pAqi != nullptr && ! fPm)
+        {
+        p = putString(p, "\"aqi\":");
+        p = putNumber(p, *pAqi);
+        *p++ = ',';
+        }
+
+    return p;
+    }
+
+inline char *cUplinkDecoder::putJson(char *p) const
+    {
+    using Msg = cPort1Message;
+    Msg const &m = this->m_msg;
+    char * const pStart = p;
+
+    *p++ = '{';
+
+    static constexpr struct { Msg::Slot s; const char *pKey; } kSimple[] =
+        {
+        { Msg::kVbat, "\"vBat\":" },
+        { Msg::kVsys, "\"vSys\":" },
+        { Msg::kVbus, "\"vBus\":" },
+        { Msg::kBoot, "\"boot\":" },
+        { Msg::kTempC, "\"tempC\":" },
+        { Msg::kP, "\"p\":" },
+        { Msg::kRh, "\"rh\":" },
+        };
+
+    for (auto const &f : kSimple)
+        {
+        if (m.isPresent(f.s))
+            {
+            p = putString(p, f.pKey);
+            p = putNumber(p, m.getValue(f.s));
+            *p++ = ',';
+            }
+        }
+
+    if (m.isPresent(Msg::kTempC))
+        {
+        double const t = m.getValue(Msg::kTempC);
+        double const rh = m.getValue(Msg::kRh);
+        double tHeat;
+
+        p = putString(p, "\"tDewC\":");
+        p = putNumber(p, getDewpoint(t, rh));
+        *p++ = ',';
+        if (getHeatIndex(t * 1.8 + 32, rh, tHeat))
+            {
+            p = putString(p, "\"tHeatIndexF\":");
+            p = putNumber(p, tHeat);
+            *p++ = ',';
+            }
+        }
+
+    double v[kUplinkChannels];
+
+    if (! this->isBatch())
+        {
+        for (std::size_t c = 0; c < kUplinkChannels; ++c)
+            v[c] = m.getValue(Msg::kPm1p0 + c);
+
+        double const aqi = m.getValue(Msg::kAqi);
+
+        p = putParticlesJson(
+                p, v, m.isPresent(Msg::kPm1p0), m.isPresent(Msg::kDust0p3),
+                m.isPresent(Msg::kAqi) ? &aqi : nullptr
+                );
+        }
+    else
+        {
+        const UplinkInterval *pLatest = nullptr;
+
+        if (m.getFlags() & 0x20)
+            {
+            p = putString(p, "\"intervals\":[");
+            for (std::size_t i = 0; i < this->m_nIntervals; ++i)
+                {
+                UplinkInterval const &d = this->m_intervals[i];
+
+                if (i != 0)
+                    *p++ = ',';
+                p = putString(p, "{\"age\":");
+                p = putUint(p, d.age);
+                *p++ = ',';
+                if (d.fValid)
+                    {
+                    for (std::size_t c = 0; c < kUplinkChannels; ++c)
+                        v[c] = getParticleValue(d.uf[c]);
+                    p = putParticlesJson(p, v, true, true, nullptr);
+                    pLatest = &d;
+                    }
+                if (this->m_fSeq)
+                    {
+                    p = putString(p, "\"seq\":");
+                    p = putUint(p, d.seq);
+                    *p++ = ',';
+                    }
+                p[-1] = '}';
+                }
+            p = putString(p, "],");
+            }
+
+        if (pLatest != nullptr)
+            {
+            for (std::size_t c = 0; c < kUplinkChannels; ++c)
+                v[c] = getParticleValue(pLatest->uf[c]);
+            p = putParticlesJson(p, v, true, true, nullptr);
+            }
+
+        if (this->m_fSeq)
+            {
+            p = putString(p, "\"seq\":");
+            p = putUint(p, this->m_seq);
+            *p++ = ',';
+            }
+        }
+
+    // replace the last comma, if any.
+    if (p - pStart > 1)
+        --p;
+    *p++ = '}';
+    return p;
+    }
+
+inline char *cUplinkDecoder::putCsvHeader(char *p)
+    {
+    return putString(p,
+        "record,format,vBat,vSys,vBus,boot,tempC,p,rh,tDewC,tHeatIndexF,"
+        "seq,age,pm1.0,pm2.5,pm10,aqi1.0,aqi2.5,aqi10,aqi,"
+        "dust0.3,dust0.5,dust1.0,dust2.5,dust5,dust10\n"
+        );
+    }
+
+// a row: the uplink's own values, then the interval's (if pInterval
+// isn't null), then the particle values at pV (if it isn't null). The
+// aqi column is field 7 if it's present, as in the JSON.
+inline char *cUplinkDecoder::putCsvRow(
+    char *p,
+    std::uint64_t record,
+    const UplinkInterval *pInterval,
+    const double *pV
+    ) const
+    {
+    using Msg = cPort1Message;
+    Msg const &m = this->m_msg;
+
+    p = putUint(p, record);
+    p = putString(p, ",0x");
+    *p++ = "0123456789abcdef"[m.getFormat() >> 4];
+    *p++ = "0123456789abcdef"[m.getFormat() & 0xF];
+
+    for (Msg::Slot s : { Msg::kVbat, Msg::kVsys, Msg::kVbus, Msg::kBoot, Msg::kTempC, Msg::kP, Msg::kRh })
+        {
+        *p++ = ',';
+        if (m.isPresent(s))
+            p = putNumber(p, m.getValue(s));
+        }
+
+    double tDew = NAN;
+    double tHeat = NAN;
+
+    if (m.isPresent(Msg::kTempC))
+        {
+        double const t = m.getValue(Msg::kTempC);
+        double const rh = m.getValue(Msg::kRh);
+
+        tDew = getDewpoint(t, rh);
+        if (! getHeatIndex(t * 1.8 + 32, rh, tHeat))
+            tHeat = NAN;
+        }
+
+    *p++ = ',';
+    if (! std::isnan(tDew))
+        p = putNumber(p, tDew);
+    *p++ = ',';
+    if (! std::isnan(tHeat))
+        p = putNumber(p, tHeat);
+
+    *p++ = ',';
+    if (pInterval != nullptr && this->m_fSeq)
+        p = putUint(p, pInterval->seq);
+    *p++ = ',';
+    if (pInterval != nullptr)
+        p = putUint(p, pInterval->age);
+
+    double aqi = NAN;
+
+    if (pV != nullptr && ! std::isnan(pV[0]))
+        {
+        double const aqi2p5 = getAqi2p5(pV[1]);
+        double const aqi10 = getAqi10(pV[2]);
+
+        for (std::size_t c = 0; c < 3; ++c)
+            {
+            *p++ = ',';
+            p = putNumber(p, pV[c]);
+            }
+        *p++ = ',';
+        p = putNumber(p, getAqi2p5(pV[0]));
+        *p++ = ',';
+        p = putNumber(p, aqi2p5);
+        *p++ = ',';
+        p = putNumber(p, aqi10);
+        aqi = aqi2p5 > aqi10 ? aqi2p5 : aqi10;
+        }
+    else
+        p = putString(p, ",,,,,,");
+
+    if (m.isPresent(Msg::kAqi))
+        aqi = m.getValue(Msg::kAqi);
+    *p++ = ',';
+    if (! std::isnan(aqi))
+        p = putNumber(p, aqi);
+
+    for (std::size_t c = 3; c < kUplinkChannels; ++c)
+        {
+        *p++ = ',';
+        if (pV != nullptr && ! std::isnan(pV[c]))
+            p = putNumber(p, pV[c]);
+        }
+
+    *p++ = '\n';
+    return p;
+    }
+
+inline char *cUplinkDecoder::putCsv(char *p, std::uint64_t record) const
+    {
+    using Msg = cPort1Message;
+    Msg const &m = this->m_msg;
+    double v[kUplinkChannels];
+
+    if (! this->isBatch())
+        {
+        for (std::size_t c = 0; c < kUplinkChannels; ++c)
+            {
+            bool const fPresent = m.isPresent(Msg::kPm1p0 + c);
+
+            v[c] = fPresent ? m.getValue(Msg::kPm1p0 + c) : NAN;
+            }
+        return this->putCsvRow(p, record, nullptr, v);
+        }
+
+    if (this->m_nIntervals == 0)
+        return this->putCsvRow(p, record, nullptr, nullptr);
+
+    for (std::size_t i = 0; i < this->m_nIntervals; ++i)
+        {
+        UplinkInterval const &d = this->m_intervals[i];
+
+        for (std::size_t c = 0; c < kUplinkChannels; ++c)
+            v[c] = getParticleValue(d.uf[c]);
+        p = this->putCsvRow(p, record, &d, d.fValid ? v : nullptr);
+        }
+
+    return p;
+    }
+
+} // namespace McciCatenaHost
+
+#endif // _pms7003_uplink_decoder_h_
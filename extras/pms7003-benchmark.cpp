@@ -0,0 +1,435 @@
+/*
+
+Module: pms7003-benchmark.cpp
+
+Function:
+    Host-side microbenchmarks for the hot paths of the library and the
+    lora sketch.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    This builds the real library and the real cMeasurementLoop against
+    the stand-ins in extras/host. From the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src -I examples/catena4630-revB-pms7003-lora \
+            extras/pms7003-benchmark.cpp src/lib/cPMS7003.cpp \
+            examples/catena4630-revB-pms7003-lora/catena-pms7003-lora-cMeasurementLoop.cpp \
+            -o pms7003-benchmark
+
+    Usage:
+        pms7003-benchmark [--seed=N] [--min-ms=N] [--filter=text] [--csv]
+
+    Output is one JSON object per line (or CSV with --csv), giving
+    ns/op and heap allocations/op for each kernel. Inputs are generated
+    from a fixed seed, so runs are comparable across builds and hosts;
+    only the timings should differ.
+
+*/
+
+#include <pms7003-lora-globals.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace McciCatena;
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaSht3x;
+using namespace McciCatenaHost;
+
+/****************************************************************************\
+|
+|   Allocation counting
+|
+\****************************************************************************/
+
+static std::size_t gnAllocs;
+static std::size_t gnAllocBytes;
+
+void *operator new(std::size_t n)
+    {
+    ++gnAllocs;
+    gnAllocBytes += n;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+    }
+
+void operator delete(void *p) noexcept
+    {
+    std::free(p);
+    }
+
+void operator delete(void *p, std::size_t) noexcept
+    {
+    std::free(p);
+    }
+
+/****************************************************************************\
+|
+|   The benchmark driver
+|
+\****************************************************************************/
+
+struct Options
+    {
+    std::uint32_t   seed = 1;
+    std::uint32_t   minMs = 250;
+    const char *    filter = nullptr;
+    bool            fCsv = false;
+    };
+
+static Options gOptions;
+
+// defeat dead-code elimination of results.
+static volatile std::uint32_t gSink;
+
+// run `op` over batches of `nBatch` inputs until at least gOptions.minMs
+// of timed work has been done. `setup` (re)creates the inputs for a batch
+// and is not timed.
+template <typename TSetup, typename TOp>
+static void runBenchmark(const char *pName, std::size_t nBatch, TSetup setup, TOp op)
+    {
+    using clock = std::chrono::steady_clock;
+
+    if (gOptions.filter != nullptr && std::strstr(pName, gOptions.filter) == nullptr)
+        return;
+
+    std::uint64_t nOps = 0;
+    std::uint64_t nanos = 0;
+    std::size_t nAllocs = 0;
+    std::size_t nAllocBytes = 0;
+
+    // one untimed pass to warm caches and branch predictors.
+    setup();
+    for (std::size_t i = 0; i < nBatch; ++i)
+        op(i);
+
+    while (nanos < std::uint64_t(gOptions.minMs) * 1000 * 1000)
+        {
+        setup();
+
+        std::size_t const allocs0 = gnAllocs;
+        std::size_t const bytes0 = gnAllocBytes;
+        auto const t0 = clock::now();
+
+        for (std::size_t i = 0; i < nBatch; ++i)
+            op(i);
+
+        auto const t1 = clock::now();
+        nAllocs += gnAllocs - allocs0;
+        nAllocBytes += gnAllocBytes - bytes0;
+        nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        nOps += nBatch;
+        }
+
+    double const nsPerOp = double(nanos) / double(nOps);
+    double const allocsPerOp = double(nAllocs) / double(nOps);
+    double const bytesPerOp = double(nAllocBytes) / double(nOps);
+
+    if (gOptions.fCsv)
+        std::printf("%s,%u,%u,%llu,%.2f,%.3f,%.1f\n",
+            pName, gOptions.seed, cMeasurementLoopHostAccess::kDefaultMeasurements,
+            (unsigned long long) nOps, nsPerOp, allocsPerOp, bytesPerOp
+            );
+    else
+        std::printf(
+            "{\"benchmark\":\"%s\",\"seed\":%u,\"window\":%u,\"ops\":%llu,"
+            "\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f}\n",
+            pName, gOptions.seed, cMeasurementLoopHostAccess::kDefaultMeasurements,
+            (unsigned long long) nOps, nsPerOp, allocsPerOp, bytesPerOp
+            );
+    std::fflush(stdout);
+    }
+
+/****************************************************************************\
+|
+|   The kernels
+|
+\****************************************************************************/
+
+static constexpr unsigned kNumMeasurements = cMeasurementLoopHostAccess::kDefaultMeasurements;
+
+static void benchChecksum()
+    {
+    static constexpr std::size_t kBatch = 256;
+    static std::uint8_t frames[kBatch][kFrameSize];
+    cRandom r { gOptions.seed };
+
+    for (auto &frame : frames)
+        {
+        Measurements16 m;
+        makeMeasurement(r, 20, m);
+        makeFrame(m, frame);
+        }
+
+    runBenchmark("computeChecksum", kBatch,
+        [] {},
+        [](std::size_t i)
+            {
+            gSink += cPMS7003HostAccess::computeChecksum(frames[i], kFrameSize - 2);
+            }
+        );
+    }
+
+static void countMeasurement(
+    void * /* pUserData */,
+    const cPMS7003::Measurements<std::uint16_t> *pData,
+    bool fWarmedUp
+    )
+    {
+    gSink += pData->atm.m2p5 + fWarmedUp;
+    }
+
+static void benchPoll()
+    {
+    static constexpr std::size_t kBatch = 256;
+    static std::uint8_t frames[kBatch][kFrameSize];
+    cRandom r { gOptions.seed };
+
+    for (auto &frame : frames)
+        {
+        Measurements16 m;
+        makeMeasurement(r, 20, m);
+        makeFrame(m, frame);
+        }
+
+    auto feedFrame = [](std::size_t i)
+        {
+        for (auto c : frames[i])
+            Serial2.hostRx(c);
+        gPms7003.poll();
+        };
+
+    // the measurement loop starts out inactive, so it won't touch the
+    // PMS7003; but it does register its callback.
+    gMeasurementLoop.begin();
+    startPms7003(gPms7003, Serial2);
+
+    auto const nGood0 = gPms7003.getRxStats().GoodMsg;
+
+    // the parser, with a callback that does nothing interesting.
+    gPms7003.setCallback(countMeasurement, nullptr);
+    runBenchmark("poll.frame", kBatch, [] {}, feedFrame);
+
+    // the parser, delivering to the sketch (which formats each frame
+    // for the console).
+    cMeasurementLoopHostAccess::setCallback(gMeasurementLoop);
+    runBenchmark("poll.frame.measurementLoop", kBatch, [] {}, feedFrame);
+
+    auto const stats = gPms7003.getRxStats();
+    // (if --filter skipped both, nothing was fed.)
+    if ((stats.GoodMsg == nGood0 && stats.CharIn != 0) || stats.CharDrops != 0 || stats.BadChecksum != 0)
+        std::fprintf(stderr, "poll.frame: frames were not accepted (good %u drops %u bad checksum %u)\n",
+            stats.GoodMsg - nGood0, stats.CharDrops, stats.BadChecksum
+            );
+    }
+
+// bytes out of frame, with kRxDiscard on: "poll.discard.print" formats
+// each one for the console, as the library did before it had a trace
+// ring; "poll.discard.ring" keeps each as a binary record. (The console
+// output itself is discarded, so the printing path is cheaper here than
+// on the node.) Runs after benchPoll(), which starts the PMS7003.
+static void benchTrace()
+    {
+    static constexpr std::size_t kBatch = 256;
+    static constexpr std::size_t kBytes = 32;
+    static std::uint8_t noise[kBatch][kBytes];
+    static std::uint8_t sTraceBuffer[1024];
+    static cTraceRing ring { sTraceBuffer, sizeof(sTraceBuffer) };
+    cRandom r { gOptions.seed };
+
+    // nothing that could start a frame.
+    for (auto &chunk : noise)
+        for (auto &c : chunk)
+            do  {
+                c = std::uint8_t(r.next());
+                } while (c == 0x42);
+
+    auto feedNoise = [](std::size_t i)
+        {
+        for (auto c : noise[i])
+            Serial2.hostRx(c);
+        gPms7003.poll();
+        };
+
+    auto const mask = gPmsHal.getDebugFlags();
+
+    gPmsHal.setDebugFlags(mask | cPMS7003::DebugFlags::kRxDiscard);
+    runBenchmark("poll.discard.print", kBatch, [] {}, feedNoise);
+    gPmsHal.setTraceRing(&ring);
+    runBenchmark("poll.discard.ring", kBatch, [] {}, feedNoise);
+    gPmsHal.setTraceRing(nullptr);
+    gPmsHal.setDebugFlags(mask);
+    }
+
+// reduce a whole window: load it (as the frames would as they arrive)
+// and then reduce and encode it. "reduce.perChannel" is the sketch's
+// original code, one channel at a time with qsort() and in float;
+// "postProcess" is what the sketch does now.
+static void benchReduce()
+    {
+    static constexpr std::size_t kBatch = 64;
+    static Measurements16 windows[kBatch][kNumMeasurements];
+    cRandom r { gOptions.seed };
+
+    for (auto &window : windows)
+        for (auto &m : window)
+            makeMeasurement(r, 20, m);
+
+    runBenchmark("reduce.perChannel", kBatch,
+        [] {},
+        [](std::size_t i)
+            {
+            cPMS7003::Measurements<float> result;
+
+            referenceReduce<kNumMeasurements>(windows[i], result);
+            gSink += TxBuffer_t::f2uflt16(result.atm.m1p0);
+            gSink += TxBuffer_t::f2uflt16(result.atm.m2p5);
+            gSink += TxBuffer_t::f2uflt16(result.atm.m10);
+            gSink += TxBuffer_t::f2uflt16(result.dust.m0p3);
+            gSink += TxBuffer_t::f2uflt16(result.dust.m0p5);
+            gSink += TxBuffer_t::f2uflt16(result.dust.m1p0);
+            gSink += TxBuffer_t::f2uflt16(result.dust.m2p5);
+            gSink += TxBuffer_t::f2uflt16(result.dust.m5);
+            gSink += TxBuffer_t::f2uflt16(result.dust.m10);
+            }
+        );
+
+    runBenchmark("postProcess", kBatch,
+        [] {},
+        [](std::size_t i)
+            {
+            std::uint16_t result[kReduceChannels];
+
+            cMeasurementLoopHostAccess::loadWindow(gMeasurementLoop, windows[i]);
+            cMeasurementLoopHostAccess::postProcess(gMeasurementLoop, result);
+            gSink += result[3];
+            }
+        );
+    }
+
+// encoding a reduced channel: "f2uflt16" is the float path the sketch
+// used to take, and "uflt16FromRatio" is the integer path it takes now.
+static void benchUflt16()
+    {
+    static constexpr std::size_t kBatch = 1024;
+    static std::uint32_t sums[kBatch];
+    static std::uint16_t counts[kBatch];
+    cRandom r { gOptions.seed };
+
+    // means spread over the 16-bit range on a log scale, from windows
+    // with a few readings rejected.
+    for (std::size_t i = 0; i < kBatch; ++i)
+        {
+        std::uint32_t const nBits = r.uniform(17);
+        std::uint32_t const mean = nBits == 0 ? 0 : (r.next() >> (32 - nBits));
+
+        counts[i] = std::uint16_t(kNumMeasurements - r.uniform(kNumMeasurements / 4 + 1));
+        sums[i] = mean * counts[i] + r.uniform(counts[i]);
+        if (sums[i] > counts[i] * 65535u)
+            sums[i] = counts[i] * 65535u;
+        }
+
+    runBenchmark("f2uflt16", kBatch,
+        [] {},
+        [](std::size_t i)
+            {
+            gSink += TxBuffer_t::f2uflt16(scaleReduceResult(sums[i], counts[i]));
+            }
+        );
+
+    runBenchmark("uflt16FromRatio", kBatch,
+        [] {},
+        [](std::size_t i)
+            {
+            gSink += encodeReduceResult(sums[i], counts[i]);
+            }
+        );
+    }
+
+static void benchFillTxBuffer()
+    {
+    static constexpr std::size_t kBatch = 64;
+    static Measurements16 windows[kBatch][kNumMeasurements];
+    cRandom r { gOptions.seed };
+
+    for (auto &window : windows)
+        for (auto &m : window)
+            makeMeasurement(r, 20, m);
+
+    // each op reloads the window (90 stores), as postProcess() sorts
+    // the arrays in place. That is small next to the reduction.
+    runBenchmark("fillTxBuffer", kBatch,
+        [] {},
+        [](std::size_t i)
+            {
+            cMeasurementLoopHostAccess::TxBuffer_t b;
+
+            cMeasurementLoopHostAccess::loadWindow(gMeasurementLoop, windows[i]);
+            cMeasurementLoopHostAccess::fillTxBuffer(gMeasurementLoop, b);
+            gSink += b.getn() + b.getbase()[b.getn() - 1];
+            }
+        );
+    }
+
+/****************************************************************************\
+|
+|   Main
+|
+\****************************************************************************/
+
+static bool parseArgs(int argc, char **argv)
+    {
+    for (int i = 1; i < argc; ++i)
+        {
+        const char * const pArg = argv[i];
+
+        if (std::strncmp(pArg, "--seed=", 7) == 0)
+            gOptions.seed = std::uint32_t(std::strtoul(pArg + 7, nullptr, 0));
+        else if (std::strncmp(pArg, "--min-ms=", 9) == 0)
+            gOptions.minMs = std::uint32_t(std::strtoul(pArg + 9, nullptr, 0));
+        else if (std::strncmp(pArg, "--filter=", 9) == 0)
+            gOptions.filter = pArg + 9;
+        else if (std::strcmp(pArg, "--csv") == 0)
+            gOptions.fCsv = true;
+        else
+            {
+            std::fprintf(stderr, "unknown argument: %s\n", pArg);
+            std::fprintf(stderr, "usage: %s [--seed=N] [--min-ms=N] [--filter=text] [--csv]\n", argv[0]);
+            return false;
+            }
+        }
+    return true;
+    }
+
+int main(int argc, char **argv)
+    {
+    if (! parseArgs(argc, argv))
+        return 1;
+
+    gCatena.fQuiet = true;
+    gPmsHal.setDebugFlags(cPMS7003::DebugFlags::kError);
+    gTempRh.begin();
+    gMeasurementLoop.setTempRh(true);
+
+    if (gOptions.fCsv)
+        std::printf("benchmark,seed,window,ops,ns_per_op,allocs_per_op,bytes_per_op\n");
+
+    benchChecksum();
+    benchPoll();
+    benchTrace();
+    benchReduce();
+    benchUflt16();
+    benchFillTxBuffer();
+
+    return 0;
+    }
@@ -0,0 +1,403 @@
+/*
+
+Module: pms7003-decode.cpp
+
+Function:
+    Decode a stream of port 1 uplinks (formats 0x20 to 0x23) to JSON
+    or CSV, on all cores.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -pthread -I extras/host -I src \
+            extras/pms7003-decode.cpp -o pms7003-decode
+
+    Usage:
+        pms7003-decode [--csv] [--binary] [--threads=N] [file]
+
+    The uplinks come from file, or from stdin. By default, each line is
+    an uplink in hex; spaces between the bytes are allowed, and blank
+    lines are skipped. With --binary, each uplink is a length byte
+    followed by that many bytes.
+
+    Each uplink is decoded with cUplinkDecoder (pms7003-uplink-decoder.h)
+    and written to stdout: as one line of JSON, exactly as
+    JSON.stringify() writes what the Node-RED decoder returns (null if
+    the uplink isn't one of ours, or is cut short); or, with --csv, as
+    one row per interval, under a header. The first CSV column is the
+    record number: the line number, or with --binary, the uplink's
+    position from 1. A summary goes to stderr as a JSON line.
+
+    The input is read in chunks of 16 MiB. Each chunk is cut into one
+    shard per thread at record boundaries, the shards are decoded in
+    parallel into buffers that are kept from chunk to chunk, and the
+    buffers are written in order; so nothing is allocated per record,
+    and the output is the same for any number of threads.
+
+    pms7003-decode.js runs the Node-RED decoder on the same input, so
+    the two can be compared:
+
+        diff <(node extras/pms7003-decode.js < uplinks.txt) \
+             <(pms7003-decode uplinks.txt)
+
+*/
+
+#include <pms7003-uplink-decoder.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace McciCatenaHost;
+
+struct Options
+    {
+    bool            fCsv = false;
+    bool            fBinary = false;
+    unsigned        nThreads = 0;
+    const char *    pPath = nullptr;
+    };
+
+static Options gOptions;
+
+static constexpr std::size_t kChunkSize = 16 * 1024 * 1024;
+
+// a thread's part of a chunk, and what it made of it.
+struct Shard
+    {
+    const char *        pBegin;
+    const char *        pEnd;
+    std::uint64_t       firstRecord;    // of the shard, from 1
+    std::vector<char>   out;            // kept from chunk to chunk
+    std::size_t         nOut;
+    std::uint64_t       nRecords;
+    std::uint64_t       nErrors;
+    };
+
+/****************************************************************************\
+|
+|   Decoding a shard
+|
+\****************************************************************************/
+
+// hex digit values, or 0xFF.
+struct HexTable
+    {
+    std::uint8_t v[256];
+
+    constexpr HexTable() : v()
+        {
+        for (unsigned i = 0; i < 256; ++i)
+            v[i] = 0xFF;
+        for (unsigned i = 0; i < 10; ++i)
+            v['0' + i] = std::uint8_t(i);
+        for (unsigned i = 0; i < 6; ++i)
+            {
+            v['a' + i] = std::uint8_t(10 + i);
+            v['A' + i] = std::uint8_t(10 + i);
+            }
+        }
+    };
+
+static constexpr HexTable kHex;
+
+// the bytes of a line of hex; false if it has anything else, or an odd
+// digit, or more than nBuf bytes.
+static bool parseHex(const char *p, const char *pEnd, std::uint8_t *pBuf, std::size_t nBuf, std::size_t &n)
+    {
+    n = 0;
+    while (p < pEnd)
+        {
+        if (*p == ' ' || *p == '\t' || *p == '\r')
+            {
+            ++p;
+            continue;
+            }
+        if (pEnd - p < 2 || n == nBuf)
+            return false;
+
+        std::uint8_t const hi = kHex.v[std::uint8_t(p[0])];
+        std::uint8_t const lo = kHex.v[std::uint8_t(p[1])];
+
+        if ((hi | lo) & 0xF0)
+            return false;
+        pBuf[n++] = std::uint8_t((hi << 4) | lo);
+        p += 2;
+        }
+    return true;
+    }
+
+static bool isBlank(const char *p, const char *pEnd)
+    {
+    for (; p < pEnd; ++p)
+        if (! (*p == ' ' || *p == '\t' || *p == '\r'))
+            return false;
+    return true;
+    }
+
+// decode one record, and write it to the shard's buffer.
+static void putRecord(Shard &s, cUplinkDecoder &d, std::uint64_t record, const std::uint8_t *pBuf, std::size_t nBuf, bool fOk)
+    {
+    std::size_t const nMax = gOptions.fCsv ? cUplinkDecoder::kMaxCsv : cUplinkDecoder::kMaxJson;
+
+    if (s.out.size() - s.nOut < nMax)
+        s.out.resize(std::max(2 * s.out.size(), s.nOut + nMax));
+
+    char * const pStart = s.out.data() + s.nOut;
+    char *p = pStart;
+
+    ++s.nRecords;
+    fOk = fOk && d.decode(pBuf, nBuf);
+    if (! fOk)
+        ++s.nErrors;
+
+    if (gOptions.fCsv)
+        {
+        if (fOk)
+            p = d.putCsv(p, record);
+        }
+    else
+        {
+        if (fOk)
+            p = d.putJson(p);
+        else
+            {
+            std::memcpy(p, "null", 4);
+            p += 4;
+            }
+        *p++ = '\n';
+        }
+
+    s.nOut += p - pStart;
+    }
+
+static void decodeShard(Shard &s)
+    {
+    cUplinkDecoder d;
+    std::uint8_t buf[256];
+    std::uint64_t record = s.firstRecord;
+    const char *p = s.pBegin;
+
+    s.nOut = 0;
+    s.nRecords = 0;
+    s.nErrors = 0;
+
+    while (p < s.pEnd)
+        {
+        if (gOptions.fBinary)
+            {
+            std::size_t const n = std::uint8_t(*p);
+            bool const fOk = std::size_t(s.pEnd - p - 1) >= n;
+
+            putRecord(s, d, record, reinterpret_cast<const std::uint8_t *>(p + 1), fOk ? n : 0, fOk);
+            p += fOk ? 1 + n : s.pEnd - p;
+            }
+        else
+            {
+            const char *pEol = static_cast<const char *>(std::memchr(p, '\n', s.pEnd - p));
+
+            if (pEol == nullptr)
+                pEol = s.pEnd;
+            if (! isBlank(p, pEol))
+                {
+                std::size_t n;
+                bool const fOk = parseHex(p, pEol, buf, sizeof(buf), n);
+
+                putRecord(s, d, record, buf, n, fOk);
+                }
+            p = pEol + (pEol < s.pEnd);
+            }
+        ++record;
+        }
+    }
+
+/****************************************************************************\
+|
+|   Chunks
+|
+\****************************************************************************/
+
+// the end of the last whole record in [p, pEnd); pEnd at end of file.
+static const char *lastRecordEnd(const char *p, const char *pEnd, bool fEof)
+    {
+    if (fEof)
+        return pEnd;
+
+    if (gOptions.fBinary)
+        {
+        while (p < pEnd && std::size_t(pEnd - p - 1) >= std::size_t(std::uint8_t(*p)))
+            p += 1 + std::uint8_t(*p);
+        return p;
+        }
+
+    for (const char *q = pEnd; q > p; --q)
+        if (q[-1] == '\n')
+            return q;
+
+    // a line longer than a chunk: take it all.
+    return pEnd;
+    }
+
+// cut [p, pEnd) into shards at record boundaries, and number them.
+static void cutShards(std::vector<Shard> &shards, const char *p, const char *pEnd, std::uint64_t &record)
+    {
+    std::size_t const nShards = shards.size();
+    std::size_t const nEach = (pEnd - p) / nShards + 1;
+
+    for (std::size_t i = 0; i < nShards; ++i)
+        {
+        Shard &s = shards[i];
+        const char *q = p;
+
+        s.pBegin = p;
+        s.firstRecord = record;
+
+        // move q to the end of the record at or after p + nEach,
+        // counting records.
+        if (gOptions.fBinary)
+            {
+            while (q < pEnd && q - p < std::ptrdiff_t(nEach))
+                {
+                q = std::min(pEnd, q + 1 + std::uint8_t(*q));
+                ++record;
+                }
+            }
+        else
+            {
+            const char * const pTarget = std::min(pEnd, p + nEach);
+
+            while (q < pTarget)
+                {
+                const char *pEol = static_cast<const char *>(std::memchr(q, '\n', pEnd - q));
+
+                q = pEol == nullptr ? pEnd : pEol + 1;
+                ++record;
+                }
+            }
+
+        s.pEnd = q;
+        p = q;
+        }
+    }
+
+/****************************************************************************\
+|
+|   Main
+|
+\****************************************************************************/
+
+static bool parseArgs(int argc, char **argv)
+    {
+    for (int i = 1; i < argc; ++i)
+        {
+        const char * const pArg = argv[i];
+
+        if (std::strcmp(pArg, "--csv") == 0)
+            gOptions.fCsv = true;
+        else if (std::strcmp(pArg, "--binary") == 0)
+            gOptions.fBinary = true;
+        else if (std::strncmp(pArg, "--threads=", 10) == 0)
+            gOptions.nThreads = unsigned(std::strtoul(pArg + 10, nullptr, 0));
+        else if (pArg[0] != '-' && gOptions.pPath == nullptr)
+            gOptions.pPath = pArg;
+        else
+            {
+            std::fprintf(stderr, "unknown argument: %s\n", pArg);
+            std::fprintf(stderr, "usage: %s [--csv] [--binary] [--threads=N] [file]\n", argv[0]);
+            return false;
+            }
+        }
+
+    if (gOptions.nThreads == 0)
+        gOptions.nThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    return true;
+    }
+
+int main(int argc, char **argv)
+    {
+    if (! parseArgs(argc, argv))
+        return 1;
+
+    std::FILE * const fp = gOptions.pPath ? std::fopen(gOptions.pPath, "rb") : stdin;
+
+    if (fp == nullptr)
+        {
+        std::fprintf(stderr, "can't open %s\n", gOptions.pPath);
+        return 1;
+        }
+
+    auto const tStart = std::chrono::steady_clock::now();
+    std::vector<char> chunk(kChunkSize);
+    std::vector<Shard> shards(gOptions.nThreads);
+    std::vector<std::thread> threads;
+    std::size_t nHeld = 0;
+    std::uint64_t record = 1;
+    std::uint64_t nRecords = 0;
+    std::uint64_t nErrors = 0;
+    std::uint64_t nBytes = 0;
+    bool fEof = false;
+
+    if (gOptions.fCsv)
+        {
+        char header[256];
+
+        std::fwrite(header, 1, cUplinkDecoder::putCsvHeader(header) - header, stdout);
+        }
+
+    while (! fEof)
+        {
+        std::size_t const nRead = std::fread(chunk.data() + nHeld, 1, chunk.size() - nHeld, fp);
+        const char * const pBegin = chunk.data();
+        const char * const pData = pBegin + nHeld + nRead;
+
+        nBytes += nRead;
+        fEof = nRead < chunk.size() - nHeld;
+
+        const char * const pEnd = lastRecordEnd(pBegin, pData, fEof);
+
+        cutShards(shards, pBegin, pEnd, record);
+
+        threads.clear();
+        for (std::size_t i = 1; i < shards.size(); ++i)
+            threads.emplace_back(decodeShard, std::ref(shards[i]));
+        decodeShard(shards[0]);
+        for (auto &t : threads)
+            t.join();
+
+        for (auto const &s : shards)
+            {
+            std::fwrite(s.out.data(), 1, s.nOut, stdout);
+            nRecords += s.nRecords;
+            nErrors += s.nErrors;
+            }
+
+        // keep the partial record for the next chunk.
+        nHeld = pData - pEnd;
+        std::memmove(chunk.data(), pEnd, nHeld);
+        }
+
+    if (fp != stdin)
+        std::fclose(fp);
+    std::fflush(stdout);
+
+    double const sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+    std::fprintf(stderr,
+        "{\"records\":%llu,\"errors\":%llu,\"bytes\":%llu,\"threads\":%u,\"seconds\":%.3f,\"records_per_sec\":%.0f}\n",
+        (unsigned long long) nRecords, (unsigned long long) nErrors, (unsigned long long) nBytes,
+        gOptions.nThreads, sec, sec > 0 ? nRecords / sec : 0.0
+        );
+
+    return 0;
+    }
@@ -0,0 +1,53 @@
+/*
+
+Name:   pms7003-decode.js
+
+Function:
+    Decode port 1 uplinks, one per line in hex, with the Node-RED
+    decoder; write one line of JSON for each.
+
+Copyright and License:
+    See accompanying LICENSE file at https://github.com/mcci-catena/MCCI-Catena-PMS7003/
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Usage:
+    node pms7003-decode.js < uplinks.txt
+
+    This is the reference for pms7003-decode.cpp, which takes the same
+    input and should write the same output, byte for byte. Blank lines
+    are skipped; spaces between bytes are allowed. The decoder doesn't
+    check lengths, so only compare uplinks that aren't cut short.
+
+*/
+
+var fs = require("fs");
+var path = require("path");
+
+// load Decoder() from the Node-RED script, without the function body.
+var src = fs.readFileSync(
+    path.join(__dirname, "catena-message-port1-format-20-decoder-node-red.js"),
+    "utf8"
+    );
+src = src.slice(0, src.indexOf("var bytes;"));
+var Decoder = new Function(src + "\nreturn Decoder;")();
+
+var lines = fs.readFileSync(0, "utf8").split("\n");
+var out = [];
+
+for (var i = 0; i < lines.length; ++i) {
+    var hex = lines[i].replace(/[ \t\r]/g, "");
+
+    if (hex === "")
+        continue;
+
+    var bytes = [];
+    for (var j = 0; j < hex.length; j += 2)
+        bytes.push(parseInt(hex.substr(j, 2), 16));
+
+    out.push(JSON.stringify(Decoder(bytes, 1)));
+}
+
+if (out.length > 0)
+    process.stdout.write(out.join("\n") + "\n");
@@ -0,0 +1,506 @@
+/*
+
+Module: pms7003-energy-model.cpp
+
+Function:
+    Estimate battery use of the lora sketch, by running it against a
+    simulated PMS7003 and integrating a current model over the time
+    spent in each state.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src -I examples/catena4630-revB-pms7003-lora \
+            extras/pms7003-energy-model.cpp src/lib/cPMS7003.cpp \
+            examples/catena4630-revB-pms7003-lora/catena-pms7003-lora-cMeasurementLoop.cpp \
+            -o pms7003-energy-model
+
+    Usage:
+        pms7003-energy-model [--tx-cycle=SEC] [--days=N] [--window=N]
+                             [--batch=N] [--batch-latency=SEC]
+                             [--keep-warm=auto|off|hwsleep|swsleep]
+                             [--usb] [--attended] [--param=value ...]
+
+    The real cPMS7003 and cMeasurementLoop run under the virtual clock.
+    Every time the clock moves, the interval is charged to the current
+    states:
+
+    - the PMS7003, from the cPMS7003 FSM state: fan on, HW sleep, SW
+      sleep, or 5V off. The 5V current is referred to the battery
+      through the boost converter.
+    - the radio: TX for the first tx_ms of an uplink, then RX for the
+      remainder of the airtime.
+    - the MCU: deep sleep inside Catena::Sleep(); light sleep while the
+      loop is idle (stSleeping, stInactive, stContinuous); otherwise
+      running. The SHT3x read takes sht3x_ms of virtual time, as the
+      real one blocks for the measurement.
+
+    All currents are in mA and all can be overridden; run with --help
+    for the list and the defaults. --window sets the number of readings
+    per measurement window, as the sketch's "window" command does (the
+    default is kDefaultMeasurements); it's reported in the output. With
+    --usb, Vbus reads as 5 V, so the loop runs in continuous mode after
+    its first uplink. --batch and --batch-latency set the number of
+    intervals per uplink and the longest wait, as the sketch's "batch"
+    command does.
+
+    The sketch's keep-warm policy (Catena-PMS7003-KeepWarm.h) is given
+    the currents of this model, so it chooses as it would on a board
+    that matched them. --keep-warm limits it, as the sketch's
+    "keepwarm" command does; the default is auto. The report gives
+    how many times each depth was chosen, and the recovery times the
+    sketch measured.
+
+    The report also gives the payload bytes and the time on air per
+    day, the latter from each uplink's length (plus 13 bytes of LoRaWAN
+    framing) at spreading factor lora_sf, 125 kHz, coding rate 4/5. The
+    radio's current is still charged for tx_ms per uplink.
+
+*/
+
+#include <pms7003-lora-globals.h>
+#include <pms7003-sim.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaSht3x;
+using namespace McciCatenaHost;
+
+/****************************************************************************\
+|
+|   The model
+|
+\****************************************************************************/
+
+struct Parameter
+    {
+    const char *    pName;
+    double          value;
+    const char *    pHelp;
+    };
+
+// defaults are typical datasheet values for the Catena 4630 parts.
+static Parameter gParameters[] =
+    {
+    { "vbat",           3.9,    "battery voltage (V)" },
+    { "boost_eff",      0.85,   "5V boost converter efficiency" },
+    { "pms_fan_ma",     100.0,  "PMS7003 active current at 5V" },
+    { "pms_hwsleep_ma", 0.2,    "PMS7003 HW sleep current at 5V" },
+    { "pms_swsleep_ma", 0.2,    "PMS7003 SW sleep current at 5V" },
+    { "pms_off_ma",     0.0,    "5V supply off (leakage at battery)" },
+    { "mcu_run_ma",     6.0,    "MCU running" },
+    { "mcu_light_ma",   1.5,    "MCU light sleep (idle between polls)" },
+    { "mcu_deep_ma",    0.03,   "MCU and board in deep sleep" },
+    { "lora_tx_ma",     44.0,   "radio transmitting" },
+    { "lora_rx_ma",     12.0,   "radio receiving (RX windows)" },
+    { "tx_ms",          100.0,  "time on air per uplink" },
+    { "lora_sf",        10.0,   "spreading factor, for the airtime report" },
+    { "rx_ms",          2000.0, "RX windows per uplink" },
+    { "pms_poweron_ms", 6000.0, "PMS7003 power-on to first frame" },
+    { "pms_wake_ms",    3000.0, "PMS7003 wake-up to first frame" },
+    { "pms_frame_ms",   1000.0, "PMS7003 frame interval" },
+    { "sht3x_ms",       15.0,   "SHT3x measurement, with the MCU waiting" },
+    { "battery_mah",    2000.0, "battery capacity, for the lifetime estimate" },
+    };
+
+static double param(const char *pName)
+    {
+    for (auto const &p : gParameters)
+        if (std::strcmp(p.pName, pName) == 0)
+            return p.value;
+
+    std::fprintf(stderr, "internal error: no parameter %s\n", pName);
+    std::exit(2);
+    }
+
+enum Rail : unsigned
+    {
+    kPmsFan, kPmsHwSleep, kPmsSwSleep, kPmsOff,
+    kMcuRun, kMcuLight, kMcuDeep,
+    kLoraTx, kLoraRx, kLoraIdle,
+    kNumRails
+    };
+
+static const char * const kRailNames[kNumRails] =
+    {
+    "pms_fan", "pms_hwsleep", "pms_swsleep", "pms_off",
+    "mcu_run", "mcu_light", "mcu_deep",
+    "lora_tx", "lora_rx", "lora_idle",
+    };
+
+// the keep-warm model: the same currents, at the battery, in µA.
+static cKeepWarmPolicy::Model keepWarmModel()
+    {
+    double const k5v = 5.0 / (param("vbat") * param("boost_eff"));
+    cKeepWarmPolicy::Model model;
+
+    model.idleUa[unsigned(cKeepWarmPolicy::Depth::Off)] = std::uint32_t(param("pms_off_ma") * 1000 + 0.5);
+    model.idleUa[unsigned(cKeepWarmPolicy::Depth::HwSleep)] = std::uint32_t(param("pms_hwsleep_ma") * k5v * 1000 + 0.5);
+    model.idleUa[unsigned(cKeepWarmPolicy::Depth::SwSleep)] = std::uint32_t(param("pms_swsleep_ma") * k5v * 1000 + 0.5);
+    model.recoverUa = std::uint32_t((param("pms_fan_ma") * k5v + param("mcu_run_ma")) * 1000 + 0.5);
+    return model;
+    }
+
+// LoRa time on air for an application payload of nBytes: 13 bytes of
+// LoRaWAN framing, an 8-symbol preamble, explicit header and CRC, coding
+// rate 4/5 at 125 kHz; low data rate optimization at SF11 and SF12.
+static double airtimeMs(std::size_t nBytes, unsigned sf)
+    {
+    double const tSymbolMs = double(1u << sf) / 125.0;
+    int const de = sf >= 11 ? 1 : 0;
+    double const nBits = 8.0 * (nBytes + 13) - 4.0 * sf + 28 + 16;
+    double nSymbols = std::ceil(nBits / (4.0 * (sf - 2 * de))) * 5;
+
+    if (nSymbols < 0)
+        nSymbols = 0;
+
+    return (8 + 4.25 + 8 + nSymbols) * tSymbolMs;
+    }
+
+static constexpr unsigned kNumPmsStates = unsigned(cPMS7003::State::stFinal) + 1;
+static constexpr unsigned kNumLoopStates = unsigned(cMeasurementLoop::State::stFinal) + 1;
+
+class cEnergyMeter
+    {
+public:
+    void begin()
+        {
+        // convert the PMS7003's 5V currents to battery current.
+        double const k5v = 5.0 / (param("vbat") * param("boost_eff"));
+
+        this->m_mA[kPmsFan] = param("pms_fan_ma") * k5v;
+        this->m_mA[kPmsHwSleep] = param("pms_hwsleep_ma") * k5v;
+        this->m_mA[kPmsSwSleep] = param("pms_swsleep_ma") * k5v;
+        this->m_mA[kPmsOff] = param("pms_off_ma");
+        this->m_mA[kMcuRun] = param("mcu_run_ma");
+        this->m_mA[kMcuLight] = param("mcu_light_ma");
+        this->m_mA[kMcuDeep] = param("mcu_deep_ma");
+        this->m_mA[kLoraTx] = param("lora_tx_ma");
+        this->m_mA[kLoraRx] = param("lora_rx_ma");
+        this->m_mA[kLoraIdle] = 0;
+        this->m_txMicros = std::uint64_t(param("tx_ms") * 1000);
+        this->m_sf = unsigned(param("lora_sf"));
+
+        gClock.setObserver(advance, this);
+        }
+
+    void end()
+        {
+        gClock.setObserver(nullptr, nullptr);
+        }
+
+    void report(double days, double txCycleSec, bool fAttended, std::uint32_t nFrames) const;
+
+private:
+    static void advance(void *pCtx, std::uint64_t us)
+        {
+        static_cast<cEnergyMeter *>(pCtx)->charge(us);
+        }
+
+    void charge(std::uint64_t us)
+        {
+        auto const pmsState = cPMS7003HostAccess::getState(gPms7003);
+        auto const loopState = cMeasurementLoopHostAccess::getState(gMeasurementLoop);
+        Rail pms, mcu, lora;
+
+        if (! gPmsHal.get5v())
+            pms = kPmsOff;
+        else if (pmsState == cPMS7003::State::stHwSleep)
+            pms = kPmsHwSleep;
+        else if (pmsState == cPMS7003::State::stSwSleep)
+            pms = kPmsSwSleep;
+        else
+            pms = kPmsFan;
+
+        if (gCatena.fDeepSleep)
+            mcu = kMcuDeep;
+        else if (loopState == cMeasurementLoop::State::stSleeping ||
+                 loopState == cMeasurementLoop::State::stInactive ||
+                 loopState == cMeasurementLoop::State::stContinuous)
+            mcu = kMcuLight;
+        else
+            mcu = kMcuRun;
+
+        if (! gLoRaWAN.isTxActive())
+            lora = kLoraIdle;
+        else if (gLoRaWAN.getTxElapsedMicros() < this->m_txMicros)
+            lora = kLoraTx;
+        else
+            lora = kLoraRx;
+
+        // a new uplink: add its time on air.
+        if (gLoRaWAN.nSends != this->m_nSends)
+            {
+            this->m_nSends = gLoRaWAN.nSends;
+            this->m_airtimeMs += airtimeMs(gLoRaWAN.nLastMessage, this->m_sf);
+            }
+
+        this->m_us[pms] += us;
+        this->m_us[mcu] += us;
+        this->m_us[lora] += us;
+        this->m_pmsStateUs[unsigned(pmsState)] += us;
+        this->m_loopStateUs[unsigned(loopState)] += us;
+        }
+
+    double          m_mA[kNumRails];
+    std::uint64_t   m_us[kNumRails] {};
+    std::uint64_t   m_pmsStateUs[kNumPmsStates] {};
+    std::uint64_t   m_loopStateUs[kNumLoopStates] {};
+    std::uint64_t   m_txMicros;
+    unsigned        m_sf;
+    std::uint32_t   m_nSends = 0;
+    double          m_airtimeMs = 0;
+    };
+
+void cEnergyMeter::report(double days, double txCycleSec, bool fAttended, std::uint32_t nFrames) const
+    {
+    double total = 0;
+
+    std::printf("{\n  \"tx_cycle_sec\": %g,\n  \"window\": %u,\n  \"batch\": %u,\n  \"days\": %g,\n  \"attended\": %s,\n",
+        txCycleSec, gMeasurementLoop.getMeasurementWindow(),
+        gMeasurementLoop.getBatchIntervals(), days,
+        fAttended ? "true" : "false"
+        );
+    std::printf("  \"uplinks_per_day\": %.1f,\n  \"pms_frames_per_day\": %.1f,\n",
+        gLoRaWAN.nSends / days, nFrames / days
+        );
+    std::printf("  \"uplink_bytes_per_day\": %.1f,\n  \"airtime_sec_per_day\": %.2f,\n",
+        gLoRaWAN.nBytesSent / days, this->m_airtimeMs / 1000.0 / days
+        );
+
+    std::printf("  \"rails\": {\n");
+    for (unsigned i = 0; i < kNumRails; ++i)
+        {
+        double const secPerDay = this->m_us[i] / 1e6 / days;
+        double const mAhPerDay = this->m_mA[i] * secPerDay / 3600.0;
+
+        total += mAhPerDay;
+        std::printf("    \"%s\": { \"ma\": %.4g, \"sec_per_day\": %.1f, \"mah_per_day\": %.4f }%s\n",
+            kRailNames[i], this->m_mA[i], secPerDay, mAhPerDay,
+            i + 1 < kNumRails ? "," : ""
+            );
+        }
+    std::printf("  },\n");
+
+    std::printf("  \"pms_state_sec_per_day\": {");
+    for (unsigned i = 0, n = 0; i < kNumPmsStates; ++i)
+        if (this->m_pmsStateUs[i] != 0)
+            std::printf("%s \"%s\": %.1f", n++ ? "," : "",
+                cPMS7003::getStateName(cPMS7003::State(i)), this->m_pmsStateUs[i] / 1e6 / days
+                );
+    std::printf(" },\n");
+
+    auto const &keepWarm = gMeasurementLoop.getKeepWarm();
+
+    std::printf("  \"pms_sleep_depths\": {");
+    for (unsigned i = 0; i < cKeepWarmPolicy::kDepths; ++i)
+        {
+        auto const d = cKeepWarmPolicy::Depth(i);
+
+        std::printf("%s \"%s\": { \"chosen\": %u, \"recovery_ms\": %u }", i ? "," : "",
+            cKeepWarmPolicy::getDepthName(d), unsigned(keepWarm.getChosenCount(d)),
+            unsigned(keepWarm.getRecoveryMs(d))
+            );
+        }
+    std::printf(" },\n");
+
+    std::printf("  \"loop_state_sec_per_day\": {");
+    for (unsigned i = 0, n = 0; i < kNumLoopStates; ++i)
+        if (this->m_loopStateUs[i] != 0)
+            std::printf("%s \"%s\": %.1f", n++ ? "," : "",
+                cMeasurementLoop::getStateName(cMeasurementLoop::State(i)), this->m_loopStateUs[i] / 1e6 / days
+                );
+    std::printf(" },\n");
+
+    std::printf("  \"mah_per_day\": %.3f,\n  \"battery_days\": %.1f\n}\n",
+        total, param("battery_mah") / total
+        );
+    }
+
+/****************************************************************************\
+|
+|   Main
+|
+\****************************************************************************/
+
+struct Options
+    {
+    std::uint32_t   txCycleSec = 6 * 60;
+    double          days = 1;
+    unsigned        nWindow = cMeasurementLoop::kDefaultMeasurements;
+    unsigned        nBatch = 1;
+    std::uint32_t   batchLatencySec = cMeasurementLoop::kDefaultBatchLatencySec;
+    std::uint8_t    keepWarm = cKeepWarmPolicy::kAllDepths;
+    bool            fUsb = false;
+    bool            fAttended = false;
+    };
+
+static Options gOptions;
+
+static void usage(const char *pName)
+    {
+    std::fprintf(stderr, "usage: %s [--tx-cycle=SEC] [--days=N] [--window=N] [--batch=N] [--batch-latency=SEC] [--keep-warm=auto|off|hwsleep|swsleep] [--usb] [--attended] [--param=value ...]\n", pName);
+    std::fprintf(stderr, "parameters:\n");
+    for (auto const &p : gParameters)
+        std::fprintf(stderr, "  --%-16s %-8g %s\n", p.pName, p.value, p.pHelp);
+    }
+
+static bool parseArgs(int argc, char **argv)
+    {
+    for (int i = 1; i < argc; ++i)
+        {
+        const char * const pArg = argv[i];
+        bool fFound = false;
+
+        if (std::strncmp(pArg, "--tx-cycle=", 11) == 0)
+            {
+            gOptions.txCycleSec = std::uint32_t(std::strtoul(pArg + 11, nullptr, 0));
+            continue;
+            }
+        else if (std::strncmp(pArg, "--days=", 7) == 0)
+            {
+            gOptions.days = std::strtod(pArg + 7, nullptr);
+            continue;
+            }
+        else if (std::strncmp(pArg, "--window=", 9) == 0)
+            {
+            gOptions.nWindow = unsigned(std::strtoul(pArg + 9, nullptr, 0));
+            continue;
+            }
+        else if (std::strncmp(pArg, "--batch=", 8) == 0)
+            {
+            gOptions.nBatch = unsigned(std::strtoul(pArg + 8, nullptr, 0));
+            continue;
+            }
+        else if (std::strncmp(pArg, "--batch-latency=", 16) == 0)
+            {
+            gOptions.batchLatencySec = std::uint32_t(std::strtoul(pArg + 16, nullptr, 0));
+            continue;
+            }
+        else if (std::strncmp(pArg, "--keep-warm=", 12) == 0)
+            {
+            const char * const pMode = pArg + 12;
+
+            fFound = std::strcmp(pMode, "auto") == 0;
+            if (fFound)
+                gOptions.keepWarm = cKeepWarmPolicy::kAllDepths;
+            for (unsigned d = 0; d < cKeepWarmPolicy::kDepths && ! fFound; ++d)
+                {
+                fFound = std::strcmp(pMode, cKeepWarmPolicy::getDepthName(cKeepWarmPolicy::Depth(d))) == 0;
+                if (fFound)
+                    gOptions.keepWarm = std::uint8_t(1u << d);
+                }
+            if (fFound)
+                continue;
+            }
+        else if (std::strcmp(pArg, "--usb") == 0)
+            {
+            gOptions.fUsb = true;
+            continue;
+            }
+        else if (std::strcmp(pArg, "--attended") == 0)
+            {
+            gOptions.fAttended = true;
+            continue;
+            }
+
+        for (auto &p : gParameters)
+            {
+            std::size_t const nName = std::strlen(p.pName);
+
+            if (std::strncmp(pArg, "--", 2) == 0 &&
+                std::strncmp(pArg + 2, p.pName, nName) == 0 &&
+                pArg[2 + nName] == '=')
+                {
+                p.value = std::strtod(pArg + 3 + nName, nullptr);
+                fFound = true;
+                break;
+                }
+            }
+
+        if (! fFound)
+            {
+            if (std::strcmp(pArg, "--help") != 0)
+                std::fprintf(stderr, "unknown argument: %s\n", pArg);
+            usage(argv[0]);
+            return false;
+            }
+        }
+
+    if (gOptions.txCycleSec == 0 || gOptions.days <= 0)
+        {
+        std::fprintf(stderr, "tx cycle and days must be positive\n");
+        return false;
+        }
+    return true;
+    }
+
+int main(int argc, char **argv)
+    {
+    if (! parseArgs(argc, argv))
+        return 1;
+
+    cPms7003Sim sim { Serial2, gPmsHal, 1 };
+    cEnergyMeter meter;
+
+    sim.m_powerOnMs = std::uint32_t(param("pms_poweron_ms"));
+    sim.m_wakeMs = std::uint32_t(param("pms_wake_ms"));
+    sim.m_frameMs = std::uint32_t(param("pms_frame_ms"));
+    gTempRh.m_readMs = std::uint32_t(param("sht3x_ms"));
+
+    gCatena.fQuiet = true;
+    if (! gOptions.fAttended)
+        gCatena.OperatingFlags |= std::uint32_t(Catena::OPERATING_FLAGS::fUnattended);
+    gLoRaWAN.AirtimeMs = std::uint32_t(param("tx_ms") + param("rx_ms"));
+    if (gOptions.fUsb)
+        gCatena.Vbus = 5.0f;
+
+    // the setup() sequence from the sketch, with a fixed tx cycle.
+    gLoRaWAN.begin(&gCatena);
+    gCatena.registerObject(&gLoRaWAN);
+    gMeasurementLoop.setTempRh(gTempRh.begin());
+    gPms7003.begin();
+    gMeasurementLoop.begin();
+    gMeasurementLoop.setTxCycleTime(gOptions.txCycleSec, 0);
+    if (! gMeasurementLoop.setMeasurementWindow(gOptions.nWindow))
+        {
+        std::fprintf(stderr, "window must be 1 to %u\n", cMeasurementLoop::kMaxMeasurements);
+        return 1;
+        }
+    if (! gMeasurementLoop.setBatch(gOptions.nBatch, gOptions.batchLatencySec))
+        {
+        std::fprintf(stderr, "batch must be 1 to %u\n", cMeasurementLoop::kMaxBatchIntervals);
+        return 1;
+        }
+
+    gMeasurementLoop.getKeepWarm().setModel(keepWarmModel());
+    gMeasurementLoop.getKeepWarm().setAllowed(gOptions.keepWarm);
+
+    meter.begin();
+    gMeasurementLoop.requestActive(true);
+
+    std::uint64_t const tEnd = gClock.getMicros() + std::uint64_t(gOptions.days * 86400.0 * 1e6);
+
+    while (gClock.getMicros() < tEnd)
+        {
+        gCatena.poll();
+        sim.poll();
+        yield();
+        }
+
+    meter.end();
+    meter.report(gOptions.days, gOptions.txCycleSec, gOptions.fAttended, sim.getFramesSent());
+    return 0;
+    }
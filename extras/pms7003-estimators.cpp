@@ -0,0 +1,348 @@
+/*
+
+Module: pms7003-estimators.cpp
+
+Function:
+    Compare the cost and robustness of the reduction policies in
+    Catena-PMS7003-ReducePolicy.h on recorded data.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/pms7003-estimators.cpp -o pms7003-estimators
+
+    Usage:
+        pms7003-estimators [--data=path] [--window=N] [--seed=N]
+                           [--min-ms=N] [--csv]
+
+    The frames come from a console log (default assets/data-run-1.txt);
+    the window is 10, 20, 30 or 60 frames. For each policy, the report
+    gives:
+
+        ns_per_window   time to put() and reduce() one window
+        jitter          mean relative change in the result from one
+                        window to the next, sliding by one frame: how
+                        noisy the estimate is on clean data
+        shift_1         mean relative change in the result when one
+                        frame of each window is replaced by a spike
+                        (every channel times ten)
+        shift_2         the same, with two spike frames
+        shift_q         the same, with N/4 spike frames
+
+    Relative changes are taken against the clean result (or one count,
+    if that's bigger), and averaged over the nine channels and every
+    window. The spike positions come from a fixed seed.
+
+    Also, the lockstep IQR mean is checked against cIqrMeanPolicy
+    applied one channel at a time; the program exits non-zero if they
+    differ.
+
+*/
+
+#include <pms7003-datarun.h>
+#include <Catena-PMS7003-Reduce.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+struct Options
+    {
+    std::uint32_t   seed = 1;
+    std::uint32_t   minMs = 250;
+    bool            fCsv = false;
+    };
+
+static Options gOptions;
+
+// defeat dead-code elimination of results.
+static volatile float gSink;
+
+/****************************************************************************\
+|
+|   Running one policy
+|
+\****************************************************************************/
+
+typedef float Result[kReduceChannels];
+
+template <std::size_t N, typename TPolicy>
+static void reduceWindow(const Measurements16 *pWindow, Result &result)
+    {
+    static cReductionBlock<N, TPolicy> block;
+    std::uint32_t sum[cReductionBlock<N, TPolicy>::kLanes];
+    std::uint16_t n[cReductionBlock<N, TPolicy>::kLanes];
+
+    block.reset();
+    for (std::size_t i = 0; i < N; ++i)
+        block.put(i, pWindow[i]);
+    block.reduce(sum, n);
+
+    // in counts, not scaled for uflt16.
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        result[c] = n[c] == 0 ? 0.0f : float(sum[c]) / float(n[c]);
+    }
+
+static double relativeChange(const Result &clean, const Result &other)
+    {
+    double total = 0;
+
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        {
+        double const base = clean[c] > 1.0f ? clean[c] : 1.0;
+
+        total += std::fabs(double(other[c]) - clean[c]) / base;
+        }
+
+    return total / kReduceChannels;
+    }
+
+static void makeSpike(Measurements16 &m)
+    {
+    std::uint16_t v[kReduceChannels];
+
+    getReduceChannels(m, v);
+    for (auto &x : v)
+        x = std::uint16_t(x * 10u + 10u > 0xFFFF ? 0xFFFF : x * 10u + 10u);
+
+    m.atm.m1p0 = v[0];  m.atm.m2p5 = v[1];  m.atm.m10 = v[2];
+    m.dust.m0p3 = v[3]; m.dust.m0p5 = v[4]; m.dust.m1p0 = v[5];
+    m.dust.m2p5 = v[6]; m.dust.m5 = v[7];   m.dust.m10 = v[8];
+    }
+
+// mean relative shift when nSpikes frames of each window are spikes.
+template <std::size_t N, typename TPolicy>
+static double spikeShift(const std::vector<Measurements16> &run, std::size_t nSpikes)
+    {
+    cRandom r { gOptions.seed };
+    double total = 0;
+    std::size_t nWindows = 0;
+
+    for (std::size_t iBase = 0; iBase + N <= run.size(); ++iBase, ++nWindows)
+        {
+        Measurements16 window[N];
+        Result clean, spiked;
+
+        std::memcpy(window, &run[iBase], sizeof(window));
+        reduceWindow<N, TPolicy>(window, clean);
+
+        // distinct positions: a partial Fisher-Yates shuffle.
+        std::size_t pos[N];
+        for (std::size_t i = 0; i < N; ++i)
+            pos[i] = i;
+        for (std::size_t i = 0; i < nSpikes; ++i)
+            {
+            std::size_t const j = i + r.uniform(std::uint32_t(N - i));
+            std::size_t const t = pos[i];
+
+            pos[i] = pos[j];
+            pos[j] = t;
+            makeSpike(window[pos[i]]);
+            }
+
+        reduceWindow<N, TPolicy>(window, spiked);
+        total += relativeChange(clean, spiked);
+        }
+
+    return nWindows == 0 ? 0.0 : total / nWindows;
+    }
+
+template <std::size_t N, typename TPolicy>
+static void runPolicy(const char *pName, const std::vector<Measurements16> &run)
+    {
+    using clock = std::chrono::steady_clock;
+    std::size_t const nWindows = run.size() / N;
+
+    // cost: every disjoint window, repeated for at least minMs.
+    std::uint64_t nOps = 0;
+    std::uint64_t nanos = 0;
+
+    while (nanos < std::uint64_t(gOptions.minMs) * 1000 * 1000)
+        {
+        auto const t0 = clock::now();
+
+        for (std::size_t iWindow = 0; iWindow < nWindows; ++iWindow)
+            {
+            Result result;
+
+            reduceWindow<N, TPolicy>(&run[iWindow * N], result);
+            gSink = gSink + result[0];
+            }
+
+        auto const t1 = clock::now();
+        nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        nOps += nWindows;
+        }
+
+    // noise: sliding by one frame.
+    double jitter = 0;
+    std::size_t nJitter = 0;
+    Result prev;
+
+    for (std::size_t iBase = 0; iBase + N <= run.size(); ++iBase)
+        {
+        Result result;
+
+        reduceWindow<N, TPolicy>(&run[iBase], result);
+        if (iBase != 0)
+            {
+            jitter += relativeChange(prev, result);
+            ++nJitter;
+            }
+        std::memcpy(prev, result, sizeof(prev));
+        }
+    jitter = nJitter == 0 ? 0.0 : jitter / nJitter;
+
+    double const shift1 = spikeShift<N, TPolicy>(run, 1);
+    double const shift2 = spikeShift<N, TPolicy>(run, 2);
+    double const shiftQ = spikeShift<N, TPolicy>(run, N / 4);
+    double const nsPerWindow = nOps == 0 ? 0.0 : double(nanos) / double(nOps);
+
+    if (gOptions.fCsv)
+        std::printf("%s,%zu,%.1f,%.4f,%.4f,%.4f,%.4f\n",
+            pName, N, nsPerWindow, jitter, shift1, shift2, shiftQ
+            );
+    else
+        std::printf(
+            "{\"policy\":\"%s\",\"window\":%zu,\"ns_per_window\":%.1f,"
+            "\"jitter\":%.4f,\"shift_1\":%.4f,\"shift_2\":%.4f,\"shift_q\":%.4f}\n",
+            pName, N, nsPerWindow, jitter, shift1, shift2, shiftQ
+            );
+    std::fflush(stdout);
+    }
+
+/****************************************************************************\
+|
+|   The lockstep check
+|
+\****************************************************************************/
+
+// returns the number of windows where the lockstep IQR mean differs from
+// cIqrMeanPolicy applied to each channel.
+template <std::size_t N>
+static unsigned checkLockstep(const std::vector<Measurements16> &run)
+    {
+    static cReductionBlock<N> block;
+    unsigned nMismatch = 0;
+
+    for (std::size_t iBase = 0; iBase + N <= run.size(); ++iBase)
+        {
+        std::uint32_t sum[cReductionBlock<N>::kLanes];
+        std::uint16_t n[cReductionBlock<N>::kLanes];
+        std::uint16_t columns[kReduceChannels][N];
+
+        for (std::size_t i = 0; i < N; ++i)
+            {
+            std::uint16_t v[kReduceChannels];
+
+            getReduceChannels(run[iBase + i], v);
+            block.put(i, run[iBase + i]);
+            for (std::size_t c = 0; c < kReduceChannels; ++c)
+                columns[c][i] = v[c];
+            }
+        block.reduce(sum, n);
+
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            {
+            std::uint32_t expectSum;
+            std::uint16_t expectN;
+
+            sortWindow<N>(columns[c]);
+            cIqrMeanPolicy::reduceSorted(columns[c], N, expectSum, expectN);
+            if (sum[c] != expectSum || n[c] != expectN)
+                {
+                std::printf("window %zu channel %zu: lockstep IQR mean doesn't match\n", iBase, c);
+                ++nMismatch;
+                }
+            }
+        }
+
+    return nMismatch;
+    }
+
+/****************************************************************************\
+|
+|   The policies
+|
+\****************************************************************************/
+
+template <std::size_t N>
+static unsigned runAll(const std::vector<Measurements16> &run)
+    {
+    runPolicy<N, cIqrMeanPolicy>("iqr-mean", run);
+    runPolicy<N, cMedianPolicy>("median", run);
+    runPolicy<N, cTrimmedMeanPolicy<10>>("trimmed-10", run);
+    runPolicy<N, cTrimmedMeanPolicy<25>>("trimmed-25", run);
+    runPolicy<N, cWinsorizedMeanPolicy<10>>("winsorized-10", run);
+    runPolicy<N, cHampelPolicy<30>>("hampel-3", run);
+
+    return checkLockstep<N>(run);
+    }
+
+int main(int argc, char **argv)
+    {
+    const char *pData = "assets/data-run-1.txt";
+    std::size_t nWindow = 10;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--data=", 7) == 0)
+            pData = argv[i] + 7;
+        else if (std::strncmp(argv[i], "--window=", 9) == 0)
+            nWindow = std::strtoul(argv[i] + 9, nullptr, 0);
+        else if (std::strncmp(argv[i], "--seed=", 7) == 0)
+            gOptions.seed = std::strtoul(argv[i] + 7, nullptr, 0);
+        else if (std::strncmp(argv[i], "--min-ms=", 9) == 0)
+            gOptions.minMs = std::strtoul(argv[i] + 9, nullptr, 0);
+        else if (std::strcmp(argv[i], "--csv") == 0)
+            gOptions.fCsv = true;
+        else
+            {
+            std::fprintf(stderr,
+                "usage: %s [--data=path] [--window=N] [--seed=N] [--min-ms=N] [--csv]\n",
+                argv[0]
+                );
+            return 1;
+            }
+        }
+
+    std::vector<Measurements16> run;
+
+    if (! readDataRun(pData, run) || run.size() < nWindow)
+        {
+        std::fprintf(stderr, "%s: can't read enough data\n", pData);
+        return 1;
+        }
+
+    if (gOptions.fCsv)
+        std::printf("policy,window,ns_per_window,jitter,shift_1,shift_2,shift_q\n");
+
+    unsigned nMismatch;
+
+    switch (nWindow)
+        {
+    case 10:    nMismatch = runAll<10>(run); break;
+    case 20:    nMismatch = runAll<20>(run); break;
+    case 30:    nMismatch = runAll<30>(run); break;
+    case 60:    nMismatch = runAll<60>(run); break;
+    default:
+        std::fprintf(stderr, "window must be 10, 20, 30 or 60\n");
+        return 1;
+        }
+
+    return nMismatch == 0 ? 0 : 1;
+    }
@@ -0,0 +1,286 @@
+/*
+
+Module: pms7003-noise-yield.cpp
+
+Function:
+    Measure how many good frames cPMS7003::poll() recovers from a noisy
+    serial line, as a function of the injected error rate.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/pms7003-noise-yield.cpp src/lib/cPMS7003.cpp \
+            -o pms7003-noise-yield
+
+    Usage:
+        pms7003-noise-yield [--seed=N] [--frames=N] [--fault=name] [--csv]
+
+    For each kind of fault (see cFaultyUart in extras/host) and a sweep
+    of rates, a stream of frames is sent through the faulty line into
+    the real parser. The report gives, per row:
+
+        damaged     frames touched by at least one fault
+        good        frames delivered that exactly match a frame sent
+        corrupt     frames delivered that don't (checksum escapes)
+        yield       good / sent
+        ideal       (sent - damaged) / sent: what a parser that never
+                    lost sync would deliver
+        efficiency  good / (sent - damaged): how much of the ideal the
+                    parser's resynchronization actually achieves
+
+*/
+
+#include <pms7003-faulty-uart.h>
+#include <Catena-PMS7003Hal-4630.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+/****************************************************************************\
+|
+|   Variables
+|
+\****************************************************************************/
+
+Catena gCatena;
+cPMS7003Hal_4630 gPmsHal { gCatena, 0 };
+cPMS7003 gPms7003 { Serial2, gPmsHal };
+
+struct Options
+    {
+    std::uint32_t   seed = 1;
+    std::uint32_t   nFrames = 5000;
+    const char *    fault = nullptr;
+    bool            fCsv = false;
+    };
+
+static Options gOptions;
+
+/****************************************************************************\
+|
+|   Checking what the parser delivers
+|
+\****************************************************************************/
+
+// the last few frames sent; the parser can only deliver one of these.
+class cSentFrames
+    {
+public:
+    static constexpr unsigned kDepth = 4;
+
+    void reset()
+        {
+        this->m_n = 0;
+        this->nGood = this->nCorrupt = 0;
+        }
+
+    void add(const Measurements16 &m)
+        {
+        this->m_sent[this->m_n % kDepth] = m;
+        this->m_fDelivered[this->m_n % kDepth] = false;
+        ++this->m_n;
+        }
+
+    void check(const Measurements16 &m)
+        {
+        for (unsigned i = 0; i < kDepth && i < this->m_n; ++i)
+            {
+            if (! this->m_fDelivered[i] &&
+                std::memcmp(&m, &this->m_sent[i], sizeof(m)) == 0)
+                {
+                this->m_fDelivered[i] = true;
+                ++this->nGood;
+                return;
+                }
+            }
+        ++this->nCorrupt;
+        }
+
+    std::uint32_t   nGood;
+    std::uint32_t   nCorrupt;
+
+private:
+    Measurements16  m_sent[kDepth];
+    bool            m_fDelivered[kDepth];
+    std::uint32_t   m_n;
+    };
+
+static cSentFrames gSent;
+
+static void checkMeasurement(
+    void * /* pUserData */,
+    const cPMS7003::Measurements<std::uint16_t> *pData,
+    bool /* fWarmedUp */
+    )
+    {
+    gSent.check(*pData);
+    }
+
+/****************************************************************************\
+|
+|   Running one configuration
+|
+\****************************************************************************/
+
+static void printHeader()
+    {
+    if (gOptions.fCsv)
+        std::printf("fault,rate,frames,damaged,good,corrupt,yield,ideal,efficiency,char_drops,msg_drops,bad_checksum\n");
+    }
+
+static void runOne(const char *pName, double rate, const cFaultyUart::Faults &faults)
+    {
+    cRandom r { gOptions.seed };
+    cFaultyUart line { Serial2, gOptions.seed ^ 0x5A5A5A5Au, faults };
+    cFaultyUart clean { Serial2, 0, cFaultyUart::Faults {} };
+    std::uint8_t frame[kFrameSize];
+    Measurements16 m;
+    auto poll = [] { gPms7003.poll(); };
+
+    // resynchronize after the previous run with a couple of clean frames.
+    gSent.reset();
+    for (int i = 0; i < 2; ++i)
+        {
+        makeMeasurement(r, 20, m);
+        makeFrame(m, frame);
+        clean.sendFrame(frame, sizeof(frame), poll);
+        }
+
+    auto const stats0 = gPms7003.getRxStats();
+    gSent.reset();
+
+    for (std::uint32_t i = 0; i < gOptions.nFrames; ++i)
+        {
+        makeMeasurement(r, 20, m);
+        // make every frame distinct, so a delivery can't match by luck.
+        m.cf1.m1p0 = std::uint16_t(i);
+        makeFrame(m, frame);
+        gSent.add(m);
+        line.sendFrame(frame, sizeof(frame), poll);
+        }
+
+    auto const stats = gPms7003.getRxStats();
+    auto const &lineStats = line.getStats();
+    double const nFrames = lineStats.nFrames;
+    double const nUndamaged = nFrames - lineStats.nDamagedFrames;
+    double const yield = gSent.nGood / nFrames;
+    double const ideal = nUndamaged / nFrames;
+    double const efficiency = nUndamaged == 0 ? 0 : gSent.nGood / nUndamaged;
+
+    if (gOptions.fCsv)
+        std::printf("%s,%g,%u,%u,%u,%u,%.4f,%.4f,%.4f,%u,%u,%u\n",
+            pName, rate, lineStats.nFrames, lineStats.nDamagedFrames,
+            gSent.nGood, gSent.nCorrupt, yield, ideal, efficiency,
+            stats.CharDrops - stats0.CharDrops,
+            stats.MsgDrops - stats0.MsgDrops,
+            stats.BadChecksum - stats0.BadChecksum
+            );
+    else
+        std::printf(
+            "{\"fault\":\"%s\",\"rate\":%g,\"frames\":%u,\"damaged\":%u,"
+            "\"good\":%u,\"corrupt\":%u,\"yield\":%.4f,\"ideal\":%.4f,\"efficiency\":%.4f,"
+            "\"char_drops\":%u,\"msg_drops\":%u,\"bad_checksum\":%u}\n",
+            pName, rate, lineStats.nFrames, lineStats.nDamagedFrames,
+            gSent.nGood, gSent.nCorrupt, yield, ideal, efficiency,
+            stats.CharDrops - stats0.CharDrops,
+            stats.MsgDrops - stats0.MsgDrops,
+            stats.BadChecksum - stats0.BadChecksum
+            );
+    }
+
+// sweep one kind of fault over a set of rates; `set` installs a rate
+// into the fault model.
+template <typename TSet>
+static void sweep(const char *pName, const double (&rates)[6], TSet set)
+    {
+    if (gOptions.fault != nullptr && std::strcmp(gOptions.fault, pName) != 0)
+        return;
+
+    for (auto rate : rates)
+        {
+        cFaultyUart::Faults faults;
+
+        set(faults, rate);
+        runOne(pName, rate, faults);
+        }
+    }
+
+/****************************************************************************\
+|
+|   Main
+|
+\****************************************************************************/
+
+static bool parseArgs(int argc, char **argv)
+    {
+    for (int i = 1; i < argc; ++i)
+        {
+        const char * const pArg = argv[i];
+
+        if (std::strncmp(pArg, "--seed=", 7) == 0)
+            gOptions.seed = std::uint32_t(std::strtoul(pArg + 7, nullptr, 0));
+        else if (std::strncmp(pArg, "--frames=", 9) == 0)
+            gOptions.nFrames = std::uint32_t(std::strtoul(pArg + 9, nullptr, 0));
+        else if (std::strncmp(pArg, "--fault=", 8) == 0)
+            gOptions.fault = pArg + 8;
+        else if (std::strcmp(pArg, "--csv") == 0)
+            gOptions.fCsv = true;
+        else
+            {
+            std::fprintf(stderr, "unknown argument: %s\n", pArg);
+            std::fprintf(stderr, "usage: %s [--seed=N] [--frames=N] [--fault=drop|bitflip|burst|truncate|spurious42|mixed] [--csv]\n", argv[0]);
+            return false;
+            }
+        }
+    return true;
+    }
+
+int main(int argc, char **argv)
+    {
+    if (! parseArgs(argc, argv))
+        return 1;
+
+    startPms7003(gPms7003, Serial2);
+    gPms7003.setCallback(checkMeasurement, nullptr);
+
+    static const double byteRates[6] = { 0, 1e-4, 1e-3, 3e-3, 1e-2, 3e-2 };
+    static const double bitRates[6] = { 0, 1e-5, 1e-4, 3e-4, 1e-3, 3e-3 };
+    static const double frameRates[6] = { 0, 0.01, 0.03, 0.1, 0.2, 0.5 };
+
+    printHeader();
+    sweep("drop", byteRates,
+        [](cFaultyUart::Faults &f, double rate) { f.dropRate = rate; });
+    sweep("bitflip", bitRates,
+        [](cFaultyUart::Faults &f, double rate) { f.bitErrorRate = rate; });
+    sweep("burst", byteRates,
+        [](cFaultyUart::Faults &f, double rate) { f.burstRate = rate; });
+    sweep("truncate", frameRates,
+        [](cFaultyUart::Faults &f, double rate) { f.truncateRate = rate; });
+    sweep("spurious42", byteRates,
+        [](cFaultyUart::Faults &f, double rate) { f.spuriousRate = rate; });
+    // a long cable: a bit of everything, scaled together.
+    sweep("mixed", byteRates,
+        [](cFaultyUart::Faults &f, double rate)
+            {
+            f.dropRate = rate / 4;
+            f.bitErrorRate = rate / 32;
+            f.burstRate = rate / 8;
+            f.truncateRate = rate;
+            f.spuriousRate = rate / 4;
+            });
+
+    return 0;
+    }
@@ -0,0 +1,269 @@
+/*
+
+Module: pms7003-nowcast.cpp
+
+Function:
+    Compute the hourly averages and the EPA NowCast from a log of port 1
+    uplinks, as the lora sketch computes them on the node.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -I extras/host -I src \
+            extras/pms7003-nowcast.cpp -o pms7003-nowcast
+
+    Usage:
+        pms7003-nowcast [--min-samples=N] [file]
+
+    The uplinks come from file, or from stdin, one per line: the time
+    the uplink was received, in Unix seconds, then the uplink in hex
+    (spaces between the bytes are allowed). Blank lines are skipped.
+
+    Each uplink is decoded with cUplinkDecoder. A single-interval
+    uplink with particle data is an interval that ended when it was
+    received; each interval of a batched uplink ended its age before.
+    The intervals are sorted by time, and fed to cNowCast
+    (Catena-PMS7003-NowCast.h) by the hour of the clock, with
+    --min-samples (default 1) as the fewest intervals an hour needs.
+
+    The output is CSV, one row per hour that has data or a NowCast:
+    the start of the hour (Unix seconds), the number of intervals in
+    it, the PM2.5 and PM10 averages in µg/m^3, then the NowCast of each
+    (truncated, as the EPA reports them) and the NowCast AQI, as of
+    the end of the hour. Empty columns have no data. A summary goes to
+    stderr as a JSON line.
+
+*/
+
+#include <Catena-PMS7003-NowCast.h>
+#include <pms7003-uplink-decoder.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+namespace {
+
+// an interval: when it ended, and its PM2.5 and PM10 codes.
+struct Sample
+    {
+    std::uint64_t   t;
+    std::uint16_t   uf2p5;
+    std::uint16_t   uf10;
+    };
+
+constexpr std::uint64_t kHourSec = cNowCast::kHourMs / 1000;
+
+// the value of a hex digit, or -1.
+int hexValue(char c)
+    {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+    }
+
+// parse a line: a time, then the uplink; false if it's malformed.
+bool parseLine(const char *p, std::uint64_t &t, std::uint8_t *pBuf, std::size_t nBuf, std::size_t &n)
+    {
+    char *pEnd;
+
+    t = std::strtoull(p, &pEnd, 10);
+    if (pEnd == p)
+        return false;
+
+    n = 0;
+    for (p = pEnd; *p != '\0' && *p != '\n'; )
+        {
+        if (*p == ' ' || *p == '\t' || *p == '\r')
+            {
+            ++p;
+            continue;
+            }
+
+        int const hi = hexValue(p[0]);
+        int const lo = hi < 0 ? -1 : hexValue(p[1]);
+
+        if (lo < 0 || n == nBuf)
+            return false;
+        pBuf[n++] = std::uint8_t((hi << 4) | lo);
+        p += 2;
+        }
+    return n != 0;
+    }
+
+// the intervals of an uplink received at t.
+void addSamples(const cUplinkDecoder &d, std::uint64_t t, std::vector<Sample> &samples)
+    {
+    if (! d.isBatch())
+        {
+        auto const &msg = d.getMessage();
+
+        if (msg.isPresent(cPort1Message::kPm2p5) && msg.isPresent(cPort1Message::kPm10))
+            samples.push_back(Sample { t, msg.getCode(cPort1Message::kPm2p5), msg.getCode(cPort1Message::kPm10) });
+        return;
+        }
+
+    for (std::size_t i = 0; i < d.getIntervalCount(); ++i)
+        {
+        auto const &interval = d.getInterval(i);
+
+        if (interval.fValid && interval.age <= t)
+            samples.push_back(Sample {
+                t - interval.age,
+                interval.uf[cPort1Message::kPm2p5 - cPort1Message::kPm1p0],
+                interval.uf[cPort1Message::kPm10 - cPort1Message::kPm1p0]
+                });
+        }
+    }
+
+// write the row for the hour that started at tHour and just closed.
+void putRow(const cNowCast &nc, std::uint64_t tHour, unsigned nSamples)
+    {
+    std::uint32_t avg2p5, avg10, c2p5, c10, aqi;
+    bool const fAvg = nc.getHourlyAverage(cNowCast::kPm2p5, 0, avg2p5) &&
+                      nc.getHourlyAverage(cNowCast::kPm10, 0, avg10);
+    bool const fNowCast = nc.getConcentration(cNowCast::kPm2p5, c2p5) &&
+                          nc.getConcentration(cNowCast::kPm10, c10) &&
+                          nc.getAqi(aqi);
+
+    if (! fAvg && ! fNowCast)
+        return;
+
+    std::printf("%llu,%u,", (unsigned long long) tHour, nSamples);
+    if (fAvg)
+        std::printf("%.3f,%.3f,",
+            std::ldexp(double(avg2p5), -int(cNowCast::kFracBits)),
+            std::ldexp(double(avg10), -int(cNowCast::kFracBits))
+            );
+    else
+        std::printf(",,");
+    if (fNowCast)
+        std::printf("%u.%u,%u,%u\n", unsigned(c2p5 / 10), unsigned(c2p5 % 10), unsigned(c10 / 10), unsigned(aqi));
+    else
+        std::printf(",,\n");
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+    {
+    unsigned minSamples = 1;
+    const char *pPath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--min-samples=", 14) == 0)
+            minSamples = unsigned(std::strtoul(argv[i] + 14, nullptr, 0));
+        else if (argv[i][0] != '-' && pPath == nullptr)
+            pPath = argv[i];
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--min-samples=N] [file]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    std::FILE * const fp = pPath ? std::fopen(pPath, "r") : stdin;
+
+    if (fp == nullptr)
+        {
+        std::fprintf(stderr, "can't open %s\n", pPath);
+        return 1;
+        }
+
+    // read and decode the uplinks.
+    cUplinkDecoder d;
+    std::vector<Sample> samples;
+    std::uint64_t nUplinks = 0;
+    std::uint64_t nErrors = 0;
+    char line[1024];
+
+    while (std::fgets(line, sizeof(line), fp) != nullptr)
+        {
+        std::uint8_t buf[256];
+        std::size_t n;
+        std::uint64_t t;
+        const char *p = line;
+
+        while (*p == ' ' || *p == '\t' || *p == '\r')
+            ++p;
+        if (*p == '\n' || *p == '\0')
+            continue;
+
+        ++nUplinks;
+        if (parseLine(p, t, buf, sizeof(buf), n) && d.decode(buf, n))
+            addSamples(d, t, samples);
+        else
+            ++nErrors;
+        }
+
+    if (fp != stdin)
+        std::fclose(fp);
+
+    std::stable_sort(samples.begin(), samples.end(),
+        [](const Sample &a, const Sample &b) { return a.t < b.t; }
+        );
+
+    // feed the hours, one at a time, by the clock. cNowCast counts
+    // milliseconds in 32 bits, so times are kept relative to the first
+    // hour, and each call moves at most an hour on.
+    std::printf("hour,intervals,pm2p5_avg,pm10_avg,nowcast_pm2p5,nowcast_pm10,nowcast_aqi\n");
+
+    cNowCast nc;
+    std::uint64_t nHours = 0;
+
+    nc.setMinSamples(std::uint16_t(minSamples));
+    if (! samples.empty())
+        {
+        std::uint64_t const t0 = samples.front().t / kHourSec * kHourSec;
+        std::uint64_t tHour = t0;
+        unsigned nInHour = 0;
+        auto const toMs = [t0](std::uint64_t t) { return std::uint32_t((t - t0) * 1000); };
+
+        nc.start(toMs(t0));
+        for (std::size_t i = 0; i <= samples.size(); ++i)
+            {
+            // close the hours before this interval (or, at the end, the
+            // last one).
+            while (i == samples.size() ? tHour <= samples.back().t
+                                       : samples[i].t >= tHour + kHourSec)
+                {
+                nc.advance(toMs(tHour + kHourSec));
+                putRow(nc, tHour, nInHour);
+                tHour += kHourSec;
+                nInHour = 0;
+                ++nHours;
+                }
+
+            if (i < samples.size())
+                {
+                nc.put(samples[i].uf2p5, samples[i].uf10, toMs(samples[i].t));
+                ++nInHour;
+                }
+            }
+        }
+
+    std::fflush(stdout);
+    std::fprintf(stderr,
+        "{\"uplinks\":%llu,\"errors\":%llu,\"intervals\":%llu,\"hours\":%llu}\n",
+        (unsigned long long) nUplinks, (unsigned long long) nErrors,
+        (unsigned long long) samples.size(), (unsigned long long) nHours
+        );
+    return 0;
+    }
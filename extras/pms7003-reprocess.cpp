@@ -0,0 +1,236 @@
+/*
+
+Module: pms7003-reprocess.cpp
+
+Function:
+    Reduce a recorded (or synthetic) run of PMS7003 frames, window by
+    window, as the lora sketch would.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/pms7003-reprocess.cpp -o pms7003-reprocess
+
+    Usage:
+        pms7003-reprocess [--data=path] [--synthetic=N] [--window=N]
+                          [--runtime] [--check] [--quiet] [--csv]
+
+    The frames come from a console log (default assets/data-run-1.txt),
+    or, with --synthetic=N, from N generated frames. The window is 10,
+    20, 30 or 60 frames. Each window is reduced with cReductionBlock,
+    and the nine results (scaled, as uplinked) are printed one window
+    per line, as JSON or CSV. A final line gives the throughput.
+
+    With --runtime, the windows are reduced with cReductionWindow<60>
+    instead, as the sketch does when its window length is set at run
+    time; the results must be the same.
+
+    With --check, each window is also reduced with the original
+    per-channel code, and the program exits non-zero if any result
+    differs in any bit. Add -DCATENA_PMS7003_REDUCE_SIMD=0 to the build
+    to check the portable code.
+
+*/
+
+#include <pms7003-datarun.h>
+#include <Catena-PMS7003-Reduce.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+typedef cPMS7003::Measurements<float> MeasurementsF;
+
+struct Options
+    {
+    bool    fRuntime = false;
+    bool    fCheck = false;
+    bool    fQuiet = false;
+    bool    fCsv = false;
+    };
+
+static void printResult(const Options &opt, std::size_t iWindow, const MeasurementsF &r)
+    {
+    float v[kReduceChannels];
+
+    v[0] = r.atm.m1p0;  v[1] = r.atm.m2p5;  v[2] = r.atm.m10;
+    v[3] = r.dust.m0p3; v[4] = r.dust.m0p5; v[5] = r.dust.m1p0;
+    v[6] = r.dust.m2p5; v[7] = r.dust.m5;   v[8] = r.dust.m10;
+
+    if (opt.fCsv)
+        {
+        std::printf("%zu", iWindow);
+        for (auto x : v)
+            std::printf(",%.9g", x);
+        std::printf("\n");
+        }
+    else
+        {
+        std::printf("{\"window\":%zu,\"result\":[", iWindow);
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            std::printf("%s%.9g", c == 0 ? "" : ",", v[c]);
+        std::printf("]}\n");
+        }
+    }
+
+// the longest window --runtime handles.
+static constexpr std::size_t kMaxRuntimeWindow = 60;
+
+// reduce every whole window of nWindow frames with block.
+template <typename TBlock>
+static void reduceAll(
+    TBlock &block,
+    std::size_t nWindow,
+    const std::vector<Measurements16> &run,
+    std::vector<MeasurementsF> &results
+    )
+    {
+    for (std::size_t iWindow = 0; iWindow < results.size(); ++iWindow)
+        {
+        block.reset();
+        for (std::size_t i = 0; i < nWindow; ++i)
+            block.put(i, run[iWindow * nWindow + i]);
+        block.reduce(results[iWindow]);
+        }
+    }
+
+// returns the number of windows that didn't match the reference.
+template <std::size_t N>
+static unsigned reprocess(const Options &opt, const std::vector<Measurements16> &run)
+    {
+    static_assert(N <= kMaxRuntimeWindow, "window too long for --runtime");
+
+    static cReductionBlock<N> block;
+    static cReductionWindow<kMaxRuntimeWindow> window;
+    std::size_t const nWindows = run.size() / N;
+    std::vector<MeasurementsF> results(nWindows);
+    unsigned nMismatch = 0;
+
+    auto const t0 = std::chrono::steady_clock::now();
+    if (opt.fRuntime)
+        reduceAll(window, N, run, results);
+    else
+        reduceAll(block, N, run, results);
+    auto const t1 = std::chrono::steady_clock::now();
+
+    for (std::size_t iWindow = 0; iWindow < nWindows; ++iWindow)
+        {
+        if (opt.fCheck)
+            {
+            MeasurementsF expect {};
+
+            referenceReduce<N>(&run[iWindow * N], expect);
+            // cf1 isn't reduced.
+            expect.cf1 = results[iWindow].cf1;
+            if (std::memcmp(&expect, &results[iWindow], sizeof(expect)) != 0)
+                {
+                std::printf("window %zu doesn't match the reference\n", iWindow);
+                ++nMismatch;
+                }
+            }
+
+        if (! opt.fQuiet)
+            printResult(opt, iWindow, results[iWindow]);
+        }
+
+    double const seconds = std::chrono::duration<double>(t1 - t0).count();
+
+    std::printf(
+        opt.fCsv
+            ? "# window=%zu windows=%zu windows_per_s=%.0f simd=%d runtime=%d\n"
+            : "{\"window\":%zu,\"windows\":%zu,\"windows_per_s\":%.0f,\"simd\":%d,\"runtime\":%d}\n",
+        N, nWindows,
+        seconds > 0 ? nWindows / seconds : 0.0,
+        CATENA_PMS7003_REDUCE_SIMD,
+        int(opt.fRuntime)
+        );
+
+    return nMismatch;
+    }
+
+int main(int argc, char **argv)
+    {
+    Options opt;
+    const char *pData = "assets/data-run-1.txt";
+    std::size_t nSynthetic = 0;
+    std::size_t nWindow = 10;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--data=", 7) == 0)
+            pData = argv[i] + 7;
+        else if (std::strncmp(argv[i], "--synthetic=", 12) == 0)
+            nSynthetic = std::strtoul(argv[i] + 12, nullptr, 0);
+        else if (std::strncmp(argv[i], "--window=", 9) == 0)
+            nWindow = std::strtoul(argv[i] + 9, nullptr, 0);
+        else if (std::strcmp(argv[i], "--runtime") == 0)
+            opt.fRuntime = true;
+        else if (std::strcmp(argv[i], "--check") == 0)
+            opt.fCheck = true;
+        else if (std::strcmp(argv[i], "--quiet") == 0)
+            opt.fQuiet = true;
+        else if (std::strcmp(argv[i], "--csv") == 0)
+            opt.fCsv = true;
+        else
+            {
+            std::fprintf(stderr,
+                "usage: %s [--data=path] [--synthetic=N] [--window=N] [--runtime] [--check] [--quiet] [--csv]\n",
+                argv[0]
+                );
+            return 1;
+            }
+        }
+
+    std::vector<Measurements16> run;
+
+    if (nSynthetic != 0)
+        {
+        cRandom r { 1 };
+
+        // a mix of levels, switching every 100 frames.
+        static const std::uint16_t kLevels[] = { 5, 20, 100, 400 };
+
+        run.resize(nSynthetic);
+        for (std::size_t i = 0; i < nSynthetic; ++i)
+            makeMeasurement(r, kLevels[(i / 100) % 4], run[i]);
+        }
+    else if (! readDataRun(pData, run))
+        {
+        std::fprintf(stderr, "%s: can't read\n", pData);
+        return 1;
+        }
+
+    if (opt.fCsv && ! opt.fQuiet)
+        std::printf("window,atm1p0,atm2p5,atm10,dust0p3,dust0p5,dust1p0,dust2p5,dust5,dust10\n");
+
+    unsigned nMismatch;
+
+    switch (nWindow)
+        {
+    case 10:    nMismatch = reprocess<10>(opt, run); break;
+    case 20:    nMismatch = reprocess<20>(opt, run); break;
+    case 30:    nMismatch = reprocess<30>(opt, run); break;
+    case 60:    nMismatch = reprocess<60>(opt, run); break;
+    default:
+        std::fprintf(stderr, "window must be 10, 20, 30 or 60\n");
+        return 1;
+        }
+
+    if (opt.fCheck)
+        std::printf("%s\n", nMismatch == 0 ? "passed" : "FAILED");
+
+    return nMismatch == 0 ? 0 : 1;
+    }
@@ -0,0 +1,474 @@
+/*
+
+Module: pms7003-stream.cpp
+
+Function:
+    Read the binary console stream of the demo and lora sketches
+    ("stream on"), and write its records as a columnar file.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/pms7003-stream.cpp -o pms7003-stream
+
+    Usage:
+        pms7003-stream [--out=file] [--csv] [--text] [capture]
+        pms7003-stream --info=file
+
+    The input is a raw capture of the console, from file or stdin: the
+    records (see Catena-PMS7003-ConsoleStream.h), with whatever text
+    the node printed between them. Records are split out at their zero
+    bytes, and checked by their CRC; anything else is text.
+
+    With --out, the records are written to file as three tables:
+
+        readings    run, t_ms, warm, and the 12 values, named as in
+                    cPMS7003::Measurements (cf1_m1p0 ... dust_m10)
+        rxstats     run, t_ms, and the change in each RxStats counter
+        runs        run, t_ms, boot, version: one row per kStart
+
+    run numbers the kStart records, from 0; rows before the first are
+    run 0 too. t_ms is the node's millis(), widened to 64 bits so it
+    doesn't wrap within a run.
+
+    The file is little-endian throughout:
+
+        "PMS7COL1"                          8 bytes
+        the number of tables                4 bytes
+        then, for each table:
+            name                            16 bytes, NUL-padded
+            the number of rows              8 bytes
+            the number of columns           4 bytes
+            reserved                        4 bytes
+            then, for each column:
+                name                        16 bytes, NUL-padded
+                type                        1 byte: 'u' (unsigned)
+                size of a value             1 byte: 1, 2, 4 or 8
+                reserved                    6 bytes
+                offset of the values        8 bytes, from the start
+                                            of the file
+
+    Each column's values are contiguous, 8-byte aligned, so a column
+    can be mapped or read (numpy.fromfile(), with offset and count)
+    without touching the others. --info prints the directory of such a
+    file as JSON.
+
+    With --csv, the readings go to stdout as CSV; with --text, the text
+    does, as the node printed it. A summary goes to stderr as a JSON
+    line: the records of each kind, those lost (by sequence number),
+    and the bytes of text.
+
+*/
+
+#include <Catena-PMS7003-ConsoleStream.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace McciCatenaPMS7003;
+
+namespace {
+
+static constexpr char kMagic[8] = { 'P', 'M', 'S', '7', 'C', 'O', 'L', '1' };
+static constexpr std::size_t kNameSize = 16;
+
+/****************************************************************************\
+|
+|   The tables
+|
+\****************************************************************************/
+
+class cColumn
+    {
+public:
+    cColumn(const char *pName, std::uint8_t size)
+        : m_name(pName)
+        , m_size(size)
+        {}
+
+    void put(std::uint64_t v)
+        {
+        for (std::uint8_t i = 0; i < this->m_size; ++i, v >>= 8)
+            this->m_data.push_back(std::uint8_t(v));
+        }
+
+    const std::string &getName() const { return this->m_name; }
+    std::uint8_t getSize() const { return this->m_size; }
+    const std::vector<std::uint8_t> &getData() const { return this->m_data; }
+
+private:
+    std::string                 m_name;
+    std::uint8_t                m_size;
+    std::vector<std::uint8_t>   m_data;
+    };
+
+class cTable
+    {
+public:
+    explicit cTable(const char *pName)
+        : m_name(pName)
+        {}
+
+    cTable &add(const char *pName, std::uint8_t size)
+        {
+        this->m_columns.emplace_back(pName, size);
+        return *this;
+        }
+
+    // add a row: one value per column, in order.
+    void put(std::initializer_list<std::uint64_t> values)
+        {
+        std::size_t i = 0;
+
+        for (auto v : values)
+            this->m_columns[i++].put(v);
+        ++this->m_nRows;
+        }
+
+    const std::string &getName() const { return this->m_name; }
+    std::uint64_t getRows() const { return this->m_nRows; }
+    const std::vector<cColumn> &getColumns() const { return this->m_columns; }
+
+private:
+    std::string             m_name;
+    std::vector<cColumn>    m_columns;
+    std::uint64_t           m_nRows = 0;
+    };
+
+void putLe(std::vector<std::uint8_t> &buf, std::uint64_t v, std::size_t n)
+    {
+    for (std::size_t i = 0; i < n; ++i, v >>= 8)
+        buf.push_back(std::uint8_t(v));
+    }
+
+void putName(std::vector<std::uint8_t> &buf, const std::string &name)
+    {
+    for (std::size_t i = 0; i < kNameSize; ++i)
+        buf.push_back(i < name.size() ? std::uint8_t(name[i]) : 0);
+    }
+
+bool writeTables(const char *pPath, const std::vector<const cTable *> &tables)
+    {
+    std::vector<std::uint8_t> dir;
+    std::size_t nDir = sizeof(kMagic) + 4;
+
+    for (auto pTable : tables)
+        nDir += kNameSize + 16 + pTable->getColumns().size() * (kNameSize + 16);
+
+    // the directory, with the offsets of the columns that follow it.
+    std::uint64_t offset = (nDir + 7) & ~std::uint64_t(7);
+
+    dir.insert(dir.end(), kMagic, kMagic + sizeof(kMagic));
+    putLe(dir, tables.size(), 4);
+    for (auto pTable : tables)
+        {
+        putName(dir, pTable->getName());
+        putLe(dir, pTable->getRows(), 8);
+        putLe(dir, pTable->getColumns().size(), 4);
+        putLe(dir, 0, 4);
+        for (auto const &col : pTable->getColumns())
+            {
+            putName(dir, col.getName());
+            dir.push_back('u');
+            dir.push_back(col.getSize());
+            putLe(dir, 0, 6);
+            putLe(dir, offset, 8);
+            offset += (col.getData().size() + 7) & ~std::size_t(7);
+            }
+        }
+
+    std::FILE * const fp = std::fopen(pPath, "wb");
+
+    if (fp == nullptr)
+        return false;
+
+    static const std::uint8_t kPad[8] = {};
+    bool fOk = std::fwrite(dir.data(), 1, dir.size(), fp) == dir.size() &&
+               std::fwrite(kPad, 1, (8 - dir.size() % 8) % 8, fp) == (8 - dir.size() % 8) % 8;
+
+    for (auto pTable : tables)
+        {
+        for (auto const &col : pTable->getColumns())
+            {
+            auto const &data = col.getData();
+            std::size_t const nPad = (8 - data.size() % 8) % 8;
+
+            fOk = fOk &&
+                  std::fwrite(data.data(), 1, data.size(), fp) == data.size() &&
+                  std::fwrite(kPad, 1, nPad, fp) == nPad;
+            }
+        }
+
+    return std::fclose(fp) == 0 && fOk;
+    }
+
+/****************************************************************************\
+|
+|   --info
+|
+\****************************************************************************/
+
+std::uint64_t getLe(const std::uint8_t *p, std::size_t n)
+    {
+    std::uint64_t v = 0;
+
+    for (std::size_t i = n; i > 0; --i)
+        v = (v << 8) | p[i - 1];
+    return v;
+    }
+
+std::string getName(const std::uint8_t *p)
+    {
+    std::size_t n = 0;
+
+    while (n < kNameSize && p[n] != 0)
+        ++n;
+    return std::string(reinterpret_cast<const char *>(p), n);
+    }
+
+int printInfo(const char *pPath)
+    {
+    std::FILE * const fp = std::fopen(pPath, "rb");
+    std::uint8_t buf[kNameSize + 16];
+
+    if (fp == nullptr)
+        {
+        std::fprintf(stderr, "can't open %s\n", pPath);
+        return 1;
+        }
+
+    if (std::fread(buf, 1, sizeof(kMagic) + 4, fp) != sizeof(kMagic) + 4 ||
+        std::memcmp(buf, kMagic, sizeof(kMagic)) != 0)
+        {
+        std::fprintf(stderr, "%s: not a columnar file\n", pPath);
+        std::fclose(fp);
+        return 1;
+        }
+
+    std::uint32_t const nTables = std::uint32_t(getLe(buf + sizeof(kMagic), 4));
+
+    std::printf("{\"tables\":[");
+    for (std::uint32_t iTable = 0; iTable < nTables; ++iTable)
+        {
+        if (std::fread(buf, 1, kNameSize + 16, fp) != kNameSize + 16)
+            break;
+
+        std::uint32_t const nColumns = std::uint32_t(getLe(buf + kNameSize + 8, 4));
+
+        std::printf("%s{\"name\":\"%s\",\"rows\":%llu,\"columns\":[",
+            iTable == 0 ? "" : ",",
+            getName(buf).c_str(),
+            (unsigned long long) getLe(buf + kNameSize, 8)
+            );
+        for (std::uint32_t iCol = 0; iCol < nColumns; ++iCol)
+            {
+            if (std::fread(buf, 1, kNameSize + 16, fp) != kNameSize + 16)
+                break;
+            std::printf("%s{\"name\":\"%s\",\"type\":\"%c%u\",\"offset\":%llu}",
+                iCol == 0 ? "" : ",",
+                getName(buf).c_str(),
+                buf[kNameSize], 8u * buf[kNameSize + 1],
+                (unsigned long long) getLe(buf + kNameSize + 8, 8)
+                );
+            }
+        std::printf("]}");
+        }
+    std::printf("]}\n");
+
+    std::fclose(fp);
+    return 0;
+    }
+
+} // namespace
+
+/****************************************************************************\
+|
+|   Main
+|
+\****************************************************************************/
+
+int main(int argc, char **argv)
+    {
+    const char *pOut = nullptr;
+    const char *pPath = nullptr;
+    bool fCsv = false;
+    bool fText = false;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--out=", 6) == 0)
+            pOut = argv[i] + 6;
+        else if (std::strncmp(argv[i], "--info=", 7) == 0)
+            return printInfo(argv[i] + 7);
+        else if (std::strcmp(argv[i], "--csv") == 0)
+            fCsv = true;
+        else if (std::strcmp(argv[i], "--text") == 0)
+            fText = true;
+        else if (argv[i][0] != '-' && pPath == nullptr)
+            pPath = argv[i];
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--out=file] [--csv] [--text] [capture]\n", argv[0]);
+            std::fprintf(stderr, "       %s --info=file\n", argv[0]);
+            return 1;
+            }
+        }
+
+    if (fCsv && fText)
+        {
+        std::fprintf(stderr, "--csv and --text both write to stdout\n");
+        return 1;
+        }
+
+    std::FILE * const fp = pPath ? std::fopen(pPath, "rb") : stdin;
+
+    if (fp == nullptr)
+        {
+        std::fprintf(stderr, "can't open %s\n", pPath);
+        return 1;
+        }
+
+    cTable readings { "readings" };
+    cTable rxstats { "rxstats" };
+    cTable runs { "runs" };
+
+    readings.add("run", 4).add("t_ms", 8).add("warm", 1);
+    for (auto pName : { "cf1_m1p0", "cf1_m2p5", "cf1_m10",
+                        "atm_m1p0", "atm_m2p5", "atm_m10",
+                        "dust_m0p3", "dust_m0p5", "dust_m1p0", "dust_m2p5", "dust_m5", "dust_m10" })
+        readings.add(pName, 2);
+    rxstats.add("run", 4).add("t_ms", 8);
+    for (auto pName : { "char_in", "char_drops", "msg_drops", "bad_checksum", "good_msg" })
+        rxstats.add(pName, 4);
+    runs.add("run", 4).add("t_ms", 8).add("boot", 4).add("version", 1);
+
+    if (fCsv)
+        std::printf("run,t_ms,warm,cf1_m1p0,cf1_m2p5,cf1_m10,atm_m1p0,atm_m2p5,atm_m10,"
+                    "dust_m0p3,dust_m0p5,dust_m1p0,dust_m2p5,dust_m5,dust_m10\n");
+
+    cConsoleStreamReader reader;
+    std::uint32_t nStarts = 0;
+    std::uint32_t nReadings = 0;
+    std::uint32_t nRxStats = 0;
+    std::uint32_t run = 0;
+    std::uint32_t tLast = 0;
+    std::uint64_t tLast64 = 0;
+    std::uint8_t buf[4096];
+    std::size_t n;
+    std::string piece;
+
+    // millis() widened within a run: each record is taken to be within
+    // 24 days of the one before, either way.
+    auto widen = [&](std::uint32_t t)
+        {
+        tLast64 += std::int64_t(std::int32_t(t - tLast));
+        tLast = t;
+        return tLast64;
+        };
+
+    while ((n = std::fread(buf, 1, sizeof(buf), fp)) != 0)
+        {
+        for (std::size_t i = 0; i < n; ++i)
+            {
+            std::uint8_t const c = buf[i];
+            std::uint32_t const nTextPieces = reader.getTextPieces();
+
+            // the reader keeps only the start of long text, so the text
+            // is kept here in full.
+            if (fText && c != 0)
+                piece.push_back(char(c));
+
+            if (! reader.put(c))
+                {
+                if (fText && reader.getTextPieces() != nTextPieces)
+                    std::fwrite(piece.data(), 1, piece.size(), stdout);
+                if (c == 0)
+                    piece.clear();
+                continue;
+                }
+
+            piece.clear();
+
+            auto const &r = reader.getResult();
+
+            switch (r.type)
+                {
+            case cConsoleStream::Record::kStart:
+                if (nStarts != 0)
+                    ++run;
+                ++nStarts;
+                tLast = r.tMs;
+                tLast64 = r.tMs;
+                runs.put({ run, tLast64, r.bootCount, r.version });
+                break;
+
+            case cConsoleStream::Record::kMeasurement:
+                {
+                auto const &m = r.m;
+                std::uint64_t const t = widen(r.tMs);
+
+                readings.put({
+                    run, t, r.fWarmedUp,
+                    m.cf1.m1p0, m.cf1.m2p5, m.cf1.m10,
+                    m.atm.m1p0, m.atm.m2p5, m.atm.m10,
+                    m.dust.m0p3, m.dust.m0p5, m.dust.m1p0, m.dust.m2p5, m.dust.m5, m.dust.m10,
+                    });
+                if (fCsv)
+                    std::printf("%u,%llu,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+                        unsigned(run), (unsigned long long) t, unsigned(r.fWarmedUp),
+                        m.cf1.m1p0, m.cf1.m2p5, m.cf1.m10,
+                        m.atm.m1p0, m.atm.m2p5, m.atm.m10,
+                        m.dust.m0p3, m.dust.m0p5, m.dust.m1p0, m.dust.m2p5, m.dust.m5, m.dust.m10
+                        );
+                ++nReadings;
+                }
+                break;
+
+            case cConsoleStream::Record::kRxStats:
+                {
+                auto const &s = r.rxStats;
+
+                rxstats.put({
+                    run, widen(r.tMs),
+                    s.CharIn, s.CharDrops, s.MsgDrops, s.BadChecksum, s.GoodMsg
+                    });
+                ++nRxStats;
+                }
+                break;
+
+            default:
+                break;
+                }
+            }
+        }
+
+    if (fp != stdin)
+        std::fclose(fp);
+    if (fText)
+        std::fwrite(piece.data(), 1, piece.size(), stdout);
+    std::fflush(stdout);
+
+    if (pOut != nullptr && ! writeTables(pOut, { &readings, &rxstats, &runs }))
+        {
+        std::fprintf(stderr, "can't write %s\n", pOut);
+        return 1;
+        }
+
+    std::fprintf(stderr,
+        "{\"starts\":%u,\"readings\":%u,\"rxstats\":%u,\"lost\":%u,\"text_bytes\":%llu}\n",
+        unsigned(nStarts), unsigned(nReadings), unsigned(nRxStats),
+        unsigned(reader.getLost()), (unsigned long long) reader.getTextBytes()
+        );
+    return 0;
+    }
@@ -0,0 +1,158 @@
+/*
+
+Module: pms7003-trace.cpp
+
+Function:
+    Format the binary trace records dumped by the lora sketch's
+    "trace dump" command.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/pms7003-trace.cpp src/lib/cPMS7003.cpp \
+            -o pms7003-trace
+
+    Usage:
+        pms7003-trace [--raw] [file]
+
+    The input is a console log, from file or stdin. Each record of the
+    dump is a line "T:" followed by the record in hex; other lines are
+    skipped, so the whole log can be given. Each record is formatted
+    with formatTrace() from the table in Catena-PMS7003-Trace.h, so the
+    text is what the node would have printed.
+
+    By default, each record is a line: the time, in seconds by the
+    node's millis(), then its text without the newline. With --raw,
+    the text is written just as the node would have written it, with
+    no times: a dump taken with "debugmask 0x20" gives the discarded
+    bytes run together, as on the console.
+
+    A summary goes to stderr as a JSON line.
+
+*/
+
+#include <Catena-PMS7003.h>
+#include <Catena-PMS7003-Trace.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace McciCatenaPMS7003;
+
+namespace {
+
+// the value of a hex digit, or -1.
+int hexValue(char c)
+    {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+    }
+
+// parse the hex after "T:"; false if it's malformed.
+bool parseRecord(const char *p, std::uint8_t *pBuf, std::size_t nBuf, std::size_t &n)
+    {
+    n = 0;
+    for (; *p != '\0' && *p != '\n' && *p != '\r'; p += 2)
+        {
+        int const hi = hexValue(p[0]);
+        int const lo = hi < 0 ? -1 : hexValue(p[1]);
+
+        if (lo < 0 || n == nBuf)
+            return false;
+        pBuf[n++] = std::uint8_t((hi << 4) | lo);
+        }
+
+    return n >= kTraceHeaderSize && n == kTraceHeaderSize + pBuf[1];
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+    {
+    bool fRaw = false;
+    const char *pPath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strcmp(argv[i], "--raw") == 0)
+            fRaw = true;
+        else if (argv[i][0] != '-' && pPath == nullptr)
+            pPath = argv[i];
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--raw] [file]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    std::FILE * const fp = pPath ? std::fopen(pPath, "r") : stdin;
+
+    if (fp == nullptr)
+        {
+        std::fprintf(stderr, "can't open %s\n", pPath);
+        return 1;
+        }
+
+    std::uint64_t nRecords = 0;
+    std::uint64_t nErrors = 0;
+    std::uint64_t nUnknown = 0;
+    char line[1024];
+
+    while (std::fgets(line, sizeof(line), fp) != nullptr)
+        {
+        const char *p = std::strstr(line, "T:");
+
+        if (p == nullptr)
+            continue;
+
+        std::uint8_t rec[kMaxTraceRecord];
+        std::size_t n;
+
+        if (! parseRecord(p + 2, rec, sizeof(rec), n))
+            {
+            ++nErrors;
+            continue;
+            }
+
+        char text[256];
+        std::size_t nText = formatTrace(text, sizeof(text), TraceId(rec[0]), rec + kTraceHeaderSize, rec[1]);
+        std::uint32_t const t = rec[2] | (rec[3] << 8) | (rec[4] << 16) | (std::uint32_t(rec[5]) << 24);
+
+        ++nRecords;
+        if (rec[0] >= std::uint8_t(TraceId::kMax))
+            ++nUnknown;
+
+        if (fRaw)
+            std::fputs(text, stdout);
+        else
+            {
+            while (nText > 0 && text[nText - 1] == '\n')
+                text[--nText] = '\0';
+            std::printf("%10u.%03u %s\n", unsigned(t / 1000), unsigned(t % 1000), text);
+            }
+        }
+
+    if (fp != stdin)
+        std::fclose(fp);
+
+    std::fflush(stdout);
+    std::fprintf(stderr,
+        "{\"records\":%llu,\"errors\":%llu,\"unknown\":%llu}\n",
+        (unsigned long long) nRecords, (unsigned long long) nErrors, (unsigned long long) nUnknown
+        );
+    return 0;
+    }
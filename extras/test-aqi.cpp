@@ -0,0 +1,150 @@
+/*
+
+Module: test-aqi.cpp
+
+Function:
+    Check that cAqi computes, in integers, the AQI the decoders compute
+    in doubles.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -I extras/host -I src \
+            extras/test-aqi.cpp -o test-aqi
+
+    Usage:
+        test-aqi [--samples=N]
+
+    First, cAqi's breakpoint tables must be those of
+    extras/calculate-aqi.js (as cUplinkDecoder has them). Then, for
+    every one of the 65536 uflt16 codes, the PM2.5 and PM10 AQI must be
+    what CalculatePmAqi() gives for the value the decoders compute
+    from the code, which cUplinkDecoder does with the same double
+    operations; and the category must be the segment the script
+    interpolates in. Last, --samples (default 10 million) random pairs
+    of codes are checked for the combined AQI and category.
+
+    Exits non-zero on any mismatch.
+
+*/
+
+#include <Catena-PMS7003-Aqi.h>
+#include <pms7003-host.h>
+#include <pms7003-uplink-decoder.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+static unsigned gnFailed;
+
+static void fail(const char *pWhat, unsigned a, unsigned b, double expect, double actual)
+    {
+    if (gnFailed < 20)
+        std::printf("%s(%#06x, %#06x): expected %.17g, got %.17g\n", pWhat, a, b, expect, actual);
+    ++gnFailed;
+    }
+
+// the segment of t that CalculatePmAqi() interpolates v in.
+static unsigned jsSegment(double v, const cAqi::Table_t &t)
+    {
+    unsigned i;
+
+    for (i = cAqi::kBreakpoints - 2; i > 0; --i)
+        if (t[i].c10 / 10.0 <= v)
+            break;
+
+    return i;
+    }
+
+int main(int argc, char **argv)
+    {
+    unsigned long nSamples = 10000000;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--samples=", 10) == 0)
+            nSamples = std::strtoul(argv[i] + 10, nullptr, 0);
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--samples=N]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    // the tables: the decoder interpolates each breakpoint to its AQI.
+    for (std::size_t i = 0; i < cAqi::kBreakpoints; ++i)
+        {
+        double const x2p5 = cAqi::kPm2p5[i].c10 / 10.0;
+        double const x10 = cAqi::kPm10[i].c10 / 10.0;
+
+        if (cUplinkDecoder::getAqi2p5(x2p5) != cAqi::kPm2p5[i].aqi)
+            fail("kPm2p5", unsigned(i), 0, cUplinkDecoder::getAqi2p5(x2p5), cAqi::kPm2p5[i].aqi);
+        if (cUplinkDecoder::getAqi10(x10) != cAqi::kPm10[i].aqi)
+            fail("kPm10", unsigned(i), 0, cUplinkDecoder::getAqi10(x10), cAqi::kPm10[i].aqi);
+        }
+
+    // every code.
+    std::uint32_t aqiMax = 0;
+
+    for (std::uint32_t uf = 0; uf < 0x10000; ++uf)
+        {
+        double const v = cUplinkDecoder::getParticleValue(std::uint16_t(uf));
+        double const aqi2p5 = cUplinkDecoder::getAqi2p5(v);
+        double const aqi10 = cUplinkDecoder::getAqi10(v);
+        std::uint32_t const a2p5 = cAqi::getPm2p5Aqi(std::uint16_t(uf));
+        std::uint32_t const a10 = cAqi::getPm10Aqi(std::uint16_t(uf));
+
+        if (a2p5 != aqi2p5)
+            fail("getPm2p5Aqi", uf, 0, aqi2p5, a2p5);
+        if (a10 != aqi10)
+            fail("getPm10Aqi", uf, 0, aqi10, a10);
+        if (cAqi::getPm2p5Category(std::uint16_t(uf)) != jsSegment(v, cAqi::kPm2p5))
+            fail("getPm2p5Category", uf, 0, jsSegment(v, cAqi::kPm2p5), cAqi::getPm2p5Category(std::uint16_t(uf)));
+        if (cAqi::getPm10Category(std::uint16_t(uf)) != jsSegment(v, cAqi::kPm10))
+            fail("getPm10Category", uf, 0, jsSegment(v, cAqi::kPm10), cAqi::getPm10Category(std::uint16_t(uf)));
+
+        if (a2p5 > aqiMax)
+            aqiMax = a2p5;
+        }
+
+    std::printf("{\"check\":\"codes\",\"codes\":65536,\"max_aqi\":%u}\n", unsigned(aqiMax));
+
+    // random pairs, with magnitudes spread over the exponents.
+    cRandom r { 1 };
+
+    for (unsigned long i = 0; i < nSamples; ++i)
+        {
+        std::uint16_t const uf2p5 = std::uint16_t(r.next() >> (16 + r.uniform(16)));
+        std::uint16_t const uf10 = std::uint16_t(r.next() >> (16 + r.uniform(16)));
+        double const aqi2p5 = cUplinkDecoder::getAqi2p5(cUplinkDecoder::getParticleValue(uf2p5));
+        double const aqi10 = cUplinkDecoder::getAqi10(cUplinkDecoder::getParticleValue(uf10));
+        unsigned const c2p5 = cAqi::getPm2p5Category(uf2p5);
+        unsigned const c10 = cAqi::getPm10Category(uf10);
+
+        if (cAqi::getAqi(uf2p5, uf10) != (aqi2p5 > aqi10 ? aqi2p5 : aqi10))
+            fail("getAqi", uf2p5, uf10, aqi2p5 > aqi10 ? aqi2p5 : aqi10, cAqi::getAqi(uf2p5, uf10));
+        if (cAqi::getCategory(uf2p5, uf10) != (c2p5 > c10 ? c2p5 : c10))
+            fail("getCategory", uf2p5, uf10, c2p5 > c10 ? c2p5 : c10, cAqi::getCategory(uf2p5, uf10));
+        }
+
+    std::printf("{\"check\":\"pairs\",\"samples\":%lu}\n", nSamples);
+
+    if (gnFailed != 0)
+        {
+        std::printf("%u failures\n", gnFailed);
+        return 1;
+        }
+
+    std::printf("passed\n");
+    return 0;
+    }
@@ -0,0 +1,483 @@
+/*
+
+Module: test-console-stream.cpp
+
+Function:
+    Check cConsoleStream and cConsoleStreamReader, and the lora
+    sketch's binary console stream.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src -I examples/catena4630-revB-pms7003-lora \
+            extras/test-console-stream.cpp src/lib/cPMS7003.cpp \
+            examples/catena4630-revB-pms7003-lora/catena-pms7003-lora-cMeasurementLoop.cpp \
+            -o test-console-stream
+
+    Usage:
+        test-console-stream [--seed=N] [--capture=file]
+
+    First, COBS: random buffers, with long runs of zeros and of other
+    bytes, must encode to no more than getCobsEncodedSize() bytes, none
+    of them zero, and decode to themselves.
+
+    Then the records: random records, with console text between them,
+    and some of them damaged, go through the reader byte by byte. It
+    must give back exactly the undamaged records, count the damaged ones
+    as lost, and take everything else for text; of a piece of text too
+    long to be a record, getText() must still give the start.
+
+    Last, the RevB sketch runs in continuous mode against the simulated
+    PMS7003 for an hour, with the stream on, its console text and its
+    records in one byte stream, as the host would see them. Every
+    reading must come back from the stream, in order, with its time;
+    the RxStats deltas must add up to the library's counters; and no
+    reading may be printed as text. With --capture, the console is
+    written to file, for pms7003-stream.
+
+    Exits non-zero on any mismatch.
+
+*/
+
+#include <pms7003-lora-globals.h>
+#include <pms7003-sim.h>
+#include <Catena-PMS7003-ConsoleStream.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace McciCatena;
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaSht3x;
+using namespace McciCatenaHost;
+
+using Record = cConsoleStream::Record;
+
+/****************************************************************************\
+|
+|   COBS
+|
+\****************************************************************************/
+
+static void testCobs(std::uint32_t seed)
+    {
+    cRandom r { seed };
+    static std::uint8_t buf[1200];
+    static std::uint8_t enc[getCobsEncodedSize(sizeof(buf))];
+    static std::uint8_t dec[sizeof(buf)];
+    unsigned long nChecked = 0;
+
+    for (unsigned long iter = 0; iter < 50000; ++iter)
+        {
+        std::size_t const n = r.uniform(4) == 0 ? r.uniform(sizeof(buf) + 1) : r.uniform(600);
+        unsigned const zeroPct = r.uniform(4) == 0 ? 0 : r.uniform(101);
+
+        // runs of zeros, and of other bytes, some past 254.
+        for (std::size_t i = 0; i < n; )
+            {
+            bool const fZero = r.uniform(100) < zeroPct;
+            std::size_t const nRun = r.uniform(2) ? 1 + r.uniform(4) : 1 + r.uniform(300);
+
+            for (std::size_t j = 0; j < nRun && i < n; ++j, ++i)
+                buf[i] = fZero ? 0 : std::uint8_t(1 + r.uniform(255));
+            }
+
+        std::size_t const nEnc = encodeCobs(buf, n, enc);
+        std::size_t nDec;
+
+        if (nEnc > getCobsEncodedSize(n))
+            fail("encoded too long", iter);
+        if (std::memchr(enc, 0, nEnc) != nullptr)
+            fail("zero in encoding", iter);
+        if (! decodeCobs(enc, nEnc, dec, sizeof(dec), nDec) || nDec != n || std::memcmp(buf, dec, n) != 0)
+            fail("decode", iter);
+        // nor may it fit in less than it decodes to.
+        if (n != 0 && decodeCobs(enc, nEnc, dec, n - 1, nDec))
+            fail("decode overflow", iter);
+        ++nChecked;
+        }
+
+    std::printf("{\"check\":\"cobs\",\"cases\":%lu}\n", nChecked);
+    }
+
+/****************************************************************************\
+|
+|   The records
+|
+\****************************************************************************/
+
+static bool isSameRxStats(const cPMS7003::RxStats &a, const cPMS7003::RxStats &b)
+    {
+    return a.CharIn == b.CharIn && a.CharDrops == b.CharDrops &&
+           a.MsgDrops == b.MsgDrops && a.BadChecksum == b.BadChecksum &&
+           a.GoodMsg == b.GoodMsg;
+    }
+
+static void testRecords(std::uint32_t seed)
+    {
+    cRandom r { seed };
+    cConsoleStream stream;
+    cConsoleStreamReader reader;
+    cPMS7003::RxStats stats {};
+    unsigned long nSent = 0;
+    unsigned long nDamaged = 0;
+    unsigned long nReceived = 0;
+
+    struct Sent
+        {
+        cConsoleStreamReader::Result    result;
+        bool                            fDamaged;
+        };
+    std::vector<Sent> sent;
+    std::vector<std::uint8_t> wire;
+
+    for (unsigned long i = 0; i < 100000; ++i)
+        {
+        cConsoleStream::Frame_t frame;
+        Sent s {};
+        std::size_t n;
+        std::uint32_t const t = r.next();
+        auto &e = s.result;
+
+        e.tMs = t;
+        e.seq = std::uint8_t(stream.getRecords());
+        if (i == 0 || r.uniform(500) == 0)
+            {
+            e.type = Record::kStart;
+            e.version = cConsoleStream::kVersion;
+            e.bootCount = r.next();
+            e.seq = 0;
+            n = stream.encodeStart(frame, t, e.bootCount, stats);
+            }
+        else if (r.uniform(5) == 0)
+            {
+            cPMS7003::RxStats next = stats;
+
+            next.CharIn += r.uniform(100000);
+            next.CharDrops += r.uniform(3) == 0 ? r.uniform(100) : 0;
+            next.MsgDrops += r.uniform(3) == 0 ? r.uniform(10) : 0;
+            next.BadChecksum += r.uniform(3) == 0 ? r.uniform(10) : 0;
+            next.GoodMsg += r.uniform(3000);
+            e.type = Record::kRxStats;
+            e.rxStats.CharIn = next.CharIn - stats.CharIn;
+            e.rxStats.CharDrops = next.CharDrops - stats.CharDrops;
+            e.rxStats.MsgDrops = next.MsgDrops - stats.MsgDrops;
+            e.rxStats.BadChecksum = next.BadChecksum - stats.BadChecksum;
+            e.rxStats.GoodMsg = next.GoodMsg - stats.GoodMsg;
+            n = stream.encodeRxStats(frame, t, next);
+            stats = next;
+            }
+        else
+            {
+            e.type = Record::kMeasurement;
+            e.fWarmedUp = r.uniform(2) != 0;
+            makeMeasurement(r, std::uint16_t(r.uniform(2) ? r.uniform(256) : r.uniform(65536)), e.m);
+            if (r.uniform(8) == 0)
+                std::memset(&e.m, 0, sizeof(e.m));
+            n = stream.encodeMeasurement(frame, t, e.m, e.fWarmedUp);
+            }
+
+        if (n > sizeof(frame) || frame[0] != 0 || frame[n - 1] != 0 ||
+            std::memchr(frame + 1, 0, n - 2) != nullptr)
+            fail("frame", i);
+
+        // damage a byte inside the frame: change it to another nonzero
+        // byte, or drop it. A damaged kStart would leave the reader
+        // counting the records that follow it against the old
+        // sequence, so those are left alone.
+        if (e.type != Record::kStart && r.uniform(50) == 0)
+            {
+            std::size_t const j = 1 + r.uniform(n - 2);
+
+            s.fDamaged = true;
+            if (r.uniform(2))
+                frame[j] = std::uint8_t(frame[j] == 0xFF ? 1 : frame[j] + 1);
+            else
+                {
+                std::memmove(frame + j, frame + j + 1, n - j - 1);
+                --n;
+                }
+            ++nDamaged;
+            }
+
+        wire.insert(wire.end(), frame, frame + n);
+        sent.push_back(s);
+        ++nSent;
+
+        // some console text.
+        if (r.uniform(3) == 0)
+            {
+            static const char kText[] = "Report:  no change, skipped\nNowCast: PM2.5 12.3 PM10 20 ug/m3, AQI 51\n";
+            std::size_t const nText = 1 + r.uniform(sizeof(kText) - 1);
+
+            wire.insert(wire.end(), kText, kText + nText);
+            }
+        }
+
+    std::size_t iSent = 0;
+    std::uint32_t lost = 0;
+
+    for (auto c : wire)
+        {
+        if (! reader.put(c))
+            continue;
+
+        auto const &got = reader.getResult();
+
+        // skip the damaged ones, which the reader must not return, and
+        // counts lost unless a kStart follows them.
+        std::uint32_t nSkipped = 0;
+
+        while (iSent < sent.size() && sent[iSent].fDamaged)
+            {
+            ++nSkipped;
+            ++iSent;
+            }
+        if (iSent == sent.size())
+            {
+            fail("extra record", nReceived);
+            break;
+            }
+
+        auto const &e = sent[iSent++].result;
+
+        if (e.type != Record::kStart)
+            lost += nSkipped;
+        bool fSame = got.type == e.type && got.seq == e.seq && got.tMs == e.tMs;
+
+        if (fSame && e.type == Record::kStart)
+            fSame = got.version == e.version && got.bootCount == e.bootCount;
+        else if (fSame && e.type == Record::kMeasurement)
+            fSame = got.fWarmedUp == e.fWarmedUp && std::memcmp(&got.m, &e.m, sizeof(e.m)) == 0;
+        else if (fSame && e.type == Record::kRxStats)
+            fSame = isSameRxStats(got.rxStats, e.rxStats);
+
+        if (! fSame)
+            fail("record differs", nReceived);
+        ++nReceived;
+        }
+
+    if (nReceived + nDamaged != nSent)
+        fail("records missing", nSent - nReceived - nDamaged);
+    if (reader.getLost() != lost)
+        fail("lost count", reader.getLost());
+
+    // text too long to be a record: its start must still be kept.
+    std::uint8_t longText[cConsoleStreamReader::kMaxPiece + 40];
+
+    for (std::size_t i = 0; i < sizeof(longText); ++i)
+        longText[i] = std::uint8_t(' ' + i % 95);
+    reader.put(0);
+    for (auto c : longText)
+        reader.put(c);
+    reader.put(0);
+
+    std::size_t nKept;
+    const std::uint8_t * const pKept = reader.getText(nKept);
+
+    if (nKept != cConsoleStreamReader::kMaxPiece || std::memcmp(pKept, longText, nKept) != 0)
+        fail("long text", nKept);
+
+    std::printf("{\"check\":\"records\",\"sent\":%lu,\"damaged\":%lu,\"received\":%lu,\"lost\":%u,\"text_pieces\":%u}\n",
+        nSent, nDamaged, nReceived, unsigned(reader.getLost()), unsigned(reader.getTextPieces())
+        );
+    }
+
+/****************************************************************************\
+|
+|   The sketch
+|
+\****************************************************************************/
+
+// the console, as the host sees it.
+static std::string gConsole;
+
+static void captureText(const char *p)
+    {
+    gConsole += p;
+    }
+
+static void captureBytes(void *, const std::uint8_t *p, std::size_t n)
+    {
+    gConsole.append(reinterpret_cast<const char *>(p), n);
+    }
+
+// the readings the sketch was given.
+struct Reading
+    {
+    std::uint32_t   tMs;
+    Measurements16  m;
+    };
+static std::vector<Reading> gReadings;
+
+static void checkMeasurement(
+    void *pUserData,
+    const cPMS7003::Measurements<std::uint16_t> *pData,
+    bool fWarmedUp,
+    std::uint32_t tFrameMs
+    )
+    {
+    gReadings.push_back(Reading { tFrameMs, *pData });
+    cMeasurementLoopHostAccess::measurementAvailable(pUserData, pData, fWarmedUp, tFrameMs);
+    }
+
+static void testSketch(const char *pCapture)
+    {
+    cPms7003Sim sim { Serial2, gPmsHal, 1 };
+
+    gCatena.pfnConsole = captureText;
+    Serial.hostTx(captureBytes, nullptr);
+    gCatena.Vbus = 5.0f;
+
+    gLoRaWAN.begin(&gCatena);
+    gCatena.registerObject(&gLoRaWAN);
+    gMeasurementLoop.setTempRh(gTempRh.begin());
+    gPms7003.begin();
+    gMeasurementLoop.begin();
+    gMeasurementLoop.setTxCycleTime(60, 0);
+    gMeasurementLoop.requestActive(true);
+    gPms7003.setCallback(checkMeasurement, &gMeasurementLoop);
+
+    // the first uplink reads Vbus; continuous mode starts after it.
+    auto runFor = [&](std::uint32_t sec)
+        {
+        std::uint64_t const tEnd = gClock.getMicros() + std::uint64_t(sec) * 1000000;
+
+        while (gClock.getMicros() < tEnd)
+            {
+            gCatena.poll();
+            sim.poll();
+            yield();
+            }
+        };
+
+    runFor(120);
+    gReadings.clear();
+    gConsole.clear();
+
+    auto const stats0 = gPms7003.getRxStats();
+
+    gMeasurementLoop.setConsoleStream(true);
+    runFor(3600);
+    gMeasurementLoop.setConsoleStream(false);
+
+    auto const stats1 = gPms7003.getRxStats();
+
+    // read it back.
+    cConsoleStreamReader reader;
+    cPMS7003::RxStats sum {};
+    std::size_t iReading = 0;
+    unsigned nStarts = 0;
+    unsigned nRxStats = 0;
+
+    for (auto c : gConsole)
+        {
+        if (! reader.put(std::uint8_t(c)))
+            continue;
+
+        auto const &got = reader.getResult();
+
+        if (got.type == Record::kStart)
+            ++nStarts;
+        else if (got.type == Record::kRxStats)
+            {
+            sum.CharIn += got.rxStats.CharIn;
+            sum.CharDrops += got.rxStats.CharDrops;
+            sum.MsgDrops += got.rxStats.MsgDrops;
+            sum.BadChecksum += got.rxStats.BadChecksum;
+            sum.GoodMsg += got.rxStats.GoodMsg;
+            ++nRxStats;
+            }
+        else if (iReading == gReadings.size() ||
+                 got.tMs != gReadings[iReading].tMs ||
+                 std::memcmp(&got.m, &gReadings[iReading].m, sizeof(got.m)) != 0)
+            fail("reading differs", iReading++);
+        else
+            ++iReading;
+        }
+
+    if (nStarts != 1)
+        fail("starts", nStarts);
+    if (iReading != gReadings.size() || gReadings.size() < 3000)
+        fail("readings missing", gReadings.size() - iReading);
+    if (reader.getLost() != 0)
+        fail("records lost", reader.getLost());
+
+    cPMS7003::RxStats const expect =
+        {
+        stats1.CharIn - stats0.CharIn,
+        stats1.CharDrops - stats0.CharDrops,
+        stats1.MsgDrops - stats0.MsgDrops,
+        stats1.BadChecksum - stats0.BadChecksum,
+        stats1.GoodMsg - stats0.GoodMsg,
+        };
+
+    if (! isSameRxStats(sum, expect))
+        fail("RxStats deltas", sum.GoodMsg);
+    if (gConsole.find("Dust .3=") != std::string::npos)
+        fail("reading printed", 0);
+
+    if (pCapture != nullptr)
+        {
+        std::FILE * const fp = std::fopen(pCapture, "wb");
+
+        if (fp == nullptr ||
+            std::fwrite(gConsole.data(), 1, gConsole.size(), fp) != gConsole.size() ||
+            std::fclose(fp) != 0)
+            fail("can't write capture", 0);
+        }
+
+    // the same readings, printed.
+    std::size_t const nBinary = gConsole.size() - std::size_t(reader.getTextBytes());
+
+    gConsole.clear();
+    runFor(600);
+
+    std::size_t const nText = gConsole.size();
+    std::size_t const nTextReadings = gReadings.size() - iReading;
+
+    std::printf("{\"check\":\"sketch\",\"readings\":%u,\"rxstats\":%u,\"binary_bytes_per_reading\":%.1f,\"text_bytes_per_reading\":%.1f}\n",
+        unsigned(iReading), nRxStats,
+        double(nBinary) / iReading,
+        nTextReadings == 0 ? 0.0 : double(nText) / nTextReadings
+        );
+
+    gCatena.pfnConsole = nullptr;
+    Serial.hostTx(nullptr, nullptr);
+    }
+
+int main(int argc, char **argv)
+    {
+    std::uint32_t seed = 1;
+    const char *pCapture = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--seed=", 7) == 0)
+            seed = std::uint32_t(std::strtoul(argv[i] + 7, nullptr, 0));
+        else if (std::strncmp(argv[i], "--capture=", 10) == 0)
+            pCapture = argv[i] + 10;
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--seed=N] [--capture=file]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    testCobs(seed);
+    testRecords(seed);
+    testSketch(pCapture);
+
+    std::printf("%s\n", gnFailed == 0 ? "passed" : "FAILED");
+    return gnFailed == 0 ? 0 : 1;
+    }
@@ -0,0 +1,592 @@
+/*
+
+Module: test-flash-log.cpp
+
+Function:
+    Check cFlashLog, and the lora sketch's store-and-forward of
+    intervals through a network outage.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src -I examples/catena4630-revB-pms7003-lora \
+            extras/test-flash-log.cpp src/lib/cPMS7003.cpp \
+            examples/catena4630-revB-pms7003-lora/catena-pms7003-lora-cMeasurementLoop.cpp \
+            -o test-flash-log
+
+    Usage:
+        test-flash-log [--ops=N] [--batch=N] [--days=N]
+                       [--outage-start=DAYS] [--outage-days=DAYS]
+
+    First, a small log (four sectors, 512 records) in the host flash
+    stand-in gets --ops (default 200000) random operations -- appends,
+    marking records sent, looking for the oldest unsent record, resets
+    part way through an append, and remounts -- and after each one,
+    the log must agree with a simple model of what it should hold.
+    Then a record written by hand from the layout in
+    Catena-PMS7003-FlashLog.h, with a sequence number just short of
+    2^32, must be found on mount, and the log must carry on across the
+    wrap. Every sector must have been erased the same number of times,
+    give or take one.
+
+    Then the sketch runs for --days (default 3) against the simulated
+    PMS7003, with the flash present, --batch intervals per uplink
+    (default 1), and no network from --outage-start (default 0.5 days)
+    for --outage-days (default 1). In the first half of the outage the
+    uplinks can't be launched; in the second, they're launched and
+    fail. Every interval the sketch logged must reach the network
+    exactly once, unless it was still held for a batch at the end, or
+    dropped because the outage outlasted the log. Intervals that come
+    with sequence numbers must arrive in order of time.
+
+    Exits non-zero on any mismatch.
+
+*/
+
+#include <pms7003-lora-globals.h>
+#include <pms7003-sim.h>
+#include <pms7003-uplink-decoder.h>
+#include <Catena-PMS7003-FlashLog.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace McciCatena;
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaSht3x;
+using namespace McciCatenaHost;
+
+/****************************************************************************\
+|
+|   The log on its own
+|
+\****************************************************************************/
+
+constexpr std::uint32_t kSmallBase = 0x10000;
+using SmallLog_t = cFlashLog<Catena_Mx25v8035f, kSmallBase, 4>;
+
+struct ModelRecord
+    {
+    std::uint32_t   tMs;
+    std::uint8_t    boot;
+    bool            fValid;
+    bool            fSent;
+    std::uint16_t   uf[kReduceChannels];
+    };
+
+class cLogModel
+    {
+public:
+    std::map<std::uint32_t, ModelRecord>    m_records;
+    std::set<std::uint32_t>                 m_torn;
+    std::uint32_t                           m_nLost = 0;
+
+    // the sector that seq starts has just been erased: the records
+    // a trip round the ring before are gone, and so is any torn one.
+    void erase(std::uint32_t seq)
+        {
+        std::uint32_t const first = seq - SmallLog_t::kRecords;
+
+        for (std::uint32_t i = 0; i < SmallLog_t::kRecordsPerSector; ++i)
+            {
+            auto const it = this->m_records.find(first + i);
+
+            if (it != this->m_records.end())
+                {
+                if (! it->second.fSent)
+                    ++this->m_nLost;
+                this->m_records.erase(it);
+                }
+            this->m_torn.erase(first + i);
+            this->m_torn.erase(seq + i);
+            }
+        }
+
+    std::uint32_t unsent() const
+        {
+        std::uint32_t n = 0;
+
+        for (auto const &r : this->m_records)
+            n += ! r.second.fSent;
+        return n;
+        }
+    };
+
+static bool sameRecord(const SmallLog_t::Record &r, std::uint32_t seq, const ModelRecord &m)
+    {
+    return r.seq == seq && r.tMs == m.tMs && r.boot == m.boot &&
+           r.fValid == m.fValid && r.fSent == m.fSent &&
+           std::memcmp(r.uf, m.uf, sizeof(m.uf)) == 0;
+    }
+
+// the layout from Catena-PMS7003-FlashLog.h, written independently.
+static void encodeRecord(std::uint8_t (&buf)[32], std::uint32_t seq, const ModelRecord &m)
+    {
+    std::memset(buf, 0xFF, sizeof(buf));
+    buf[0] = m.fSent ? 0xFC : 0xFE;
+    buf[1] = m.fValid ? 0x01 : 0x00;
+    buf[2] = m.boot;
+    for (unsigned i = 0; i < 4; ++i)
+        {
+        buf[4 + i] = std::uint8_t(seq >> (8 * i));
+        buf[8 + i] = std::uint8_t(m.tMs >> (8 * i));
+        }
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        {
+        buf[12 + 2 * c] = std::uint8_t(m.uf[c]);
+        buf[13 + 2 * c] = std::uint8_t(m.uf[c] >> 8);
+        }
+
+    std::uint16_t crc = 0xFFFF;
+
+    for (unsigned i = 1; i < 30; ++i)
+        {
+        crc ^= std::uint16_t(buf[i] << 8);
+        for (unsigned k = 0; k < 8; ++k)
+            crc = (crc & 0x8000) ? std::uint16_t((crc << 1) ^ 0x1021) : std::uint16_t(crc << 1);
+        }
+    buf[30] = std::uint8_t(crc);
+    buf[31] = std::uint8_t(crc >> 8);
+    }
+
+static ModelRecord randomRecord(cRandom &r)
+    {
+    ModelRecord m;
+
+    m.tMs = r.next();
+    m.boot = std::uint8_t(r.next());
+    m.fValid = r.uniform(5) != 0;
+    m.fSent = false;
+    for (auto &uf : m.uf)
+        uf = std::uint16_t(r.next());
+    return m;
+    }
+
+static std::uint32_t slotAddr(std::uint32_t seq)
+    {
+    return kSmallBase + (seq & (SmallLog_t::kRecords - 1)) * 32;
+    }
+
+// check everything the log will tell us against the model.
+static void checkLog(SmallLog_t &log, const cLogModel &model, cRandom &r, unsigned long iOp)
+    {
+    std::uint32_t const next = log.getNextSeq();
+
+    if (log.getUnsentCount() != model.unsent())
+        fail("unsent count differs", iOp);
+    if (log.getLostCount() > model.m_nLost)
+        fail("lost count too high", iOp);
+
+    for (unsigned k = 0; k < 8; ++k)
+        {
+        std::uint32_t const seq = next - 1 - r.uniform(SmallLog_t::kRecords + 16);
+        SmallLog_t::Record rec;
+        auto const it = model.m_records.find(seq);
+        bool const fFound = log.read(seq, rec);
+
+        if (fFound != (it != model.m_records.end()))
+            fail(fFound ? "read found a record it shouldn't have" : "read didn't find a record", iOp);
+        else if (fFound && ! sameRecord(rec, seq, it->second))
+            fail("read gave the wrong record", iOp);
+        }
+
+    // the oldest unsent record below a random limit.
+    std::uint32_t const limit = next - r.uniform(32);
+    std::uint32_t seq;
+    bool fExpect = false;
+    std::uint32_t seqExpect = 0;
+
+    for (auto const &rec : model.m_records)
+        if (! rec.second.fSent && std::int32_t(limit - rec.first) > 0)
+            {
+            if (! fExpect || std::int32_t(seqExpect - rec.first) > 0)
+                seqExpect = rec.first;
+            fExpect = true;
+            }
+
+    bool const fFound = log.findUnsent(limit, seq);
+
+    if (fFound != fExpect || (fFound && seq != seqExpect))
+        fail("findUnsent differs", iOp);
+    }
+
+static void testRandom(unsigned long nOps)
+    {
+    Catena_Mx25v8035f flash;
+    SmallLog_t log;
+    cLogModel model;
+    cRandom r { 1 };
+    std::uint32_t seqNewest = 0;
+    bool fAny = false;
+
+    flash.fPresent = true;
+    flash.begin(nullptr, 0);
+    log.begin(flash);
+
+    for (unsigned long iOp = 0; iOp < nOps; ++iOp)
+        {
+        std::uint32_t const next = log.getNextSeq();
+        unsigned const op = r.uniform(100);
+
+        if (op < 50)
+            {
+            // append; the log may skip slots spoiled by a reset.
+            ModelRecord m = randomRecord(r);
+            std::uint32_t expect = next;
+            std::uint32_t seq;
+
+            for (;; ++expect)
+                {
+                if ((expect & (SmallLog_t::kRecordsPerSector - 1)) == 0)
+                    model.erase(expect);
+                if (model.m_torn.count(expect) == 0)
+                    break;
+                }
+
+            if (! log.append(m.tMs, m.boot, m.uf, m.fValid, seq))
+                fail("append failed", iOp);
+            if (seq != expect)
+                fail("append used the wrong sequence number", iOp);
+            model.m_records[seq] = m;
+            seqNewest = seq;
+            fAny = true;
+            }
+        else if (op < 85)
+            {
+            // mark a recent record (or a missing one) sent.
+            std::uint32_t const seq = next - 1 - r.uniform(SmallLog_t::kRecords / 2);
+            auto const it = model.m_records.find(seq);
+            bool const fOk = log.markSent(seq);
+
+            if (fOk != (it != model.m_records.end()))
+                fail("markSent differs", iOp);
+            if (it != model.m_records.end())
+                it->second.fSent = true;
+            }
+        else if (op < 97)
+            {
+            // remount.
+            log = SmallLog_t();
+            log.begin(flash);
+            if (fAny && log.getNextSeq() != seqNewest + 1)
+                fail("remount found the wrong next sequence number", iOp);
+            }
+        else
+            {
+            // a reset part way through an append: some of the body is
+            // written, but not the state byte. (At the start of a
+            // sector, the erase would wipe it anyway.)
+            std::uint32_t const seq = next;
+            ModelRecord const m = randomRecord(r);
+            std::uint8_t buf[32];
+
+            if ((seq & (SmallLog_t::kRecordsPerSector - 1)) == 0 || model.m_torn.count(seq) != 0)
+                continue;
+
+            encodeRecord(buf, seq, m);
+            flash.program(slotAddr(seq) + 1, buf + 1, 1 + r.uniform(31));
+            model.m_torn.insert(seq);
+
+            log = SmallLog_t();
+            log.begin(flash);
+            }
+
+        checkLog(log, model, r, iOp);
+        }
+
+    std::uint32_t lo = ~0u, hi = 0;
+
+    for (std::uint32_t s = 0; s < 4; ++s)
+        {
+        std::uint32_t const n = flash.getErases(kSmallBase + s * Catena_Mx25v8035f::kSectorSize);
+
+        lo = n < lo ? n : lo;
+        hi = n > hi ? n : hi;
+        }
+    if (hi - lo > 1)
+        fail("wear isn't level", hi - lo);
+    if (flash.nAccessErrors != 0)
+        fail("flash accessed out of range", flash.nAccessErrors);
+
+    std::printf("{\"check\":\"random\",\"ops\":%lu,\"next_seq\":%u,\"unsent\":%u,\"lost\":%u,\"erases_per_sector\":[%u,%u]}\n",
+        nOps, unsigned(log.getNextSeq()), unsigned(log.getUnsentCount()), unsigned(log.getLostCount()),
+        unsigned(lo), unsigned(hi)
+        );
+    }
+
+static void testWrap()
+    {
+    Catena_Mx25v8035f flash;
+    SmallLog_t log;
+    cRandom r { 2 };
+    std::uint32_t const seqStart = 0xFFFFFFFFu - 700;
+    ModelRecord m = randomRecord(r);
+    std::uint8_t buf[32];
+
+    flash.fPresent = true;
+    flash.begin(nullptr, 0);
+    encodeRecord(buf, seqStart, m);
+    flash.program(slotAddr(seqStart), buf, sizeof(buf));
+
+    log.begin(flash);
+
+    SmallLog_t::Record rec;
+
+    if (log.getNextSeq() != seqStart + 1 || log.getUnsentCount() != 1)
+        fail("mount didn't find the hand-written record", seqStart);
+    if (! log.read(seqStart, rec) || ! sameRecord(rec, seqStart, m))
+        fail("hand-written record reads back wrong", seqStart);
+
+    std::uint32_t seq;
+
+    if (! log.findUnsent(seqStart + 1, seq) || seq != seqStart)
+        fail("findUnsent didn't find the hand-written record", seqStart);
+
+    // carry on across the wrap, marking all but the last few sent.
+    std::vector<ModelRecord> records;
+
+    for (unsigned i = 0; i < 1400; ++i)
+        {
+        ModelRecord const mi = randomRecord(r);
+
+        if (! log.append(mi.tMs, mi.boot, mi.uf, mi.fValid, seq) || seq != seqStart + 1 + i)
+            fail("append across the wrap", i);
+        records.push_back(mi);
+        if (i < 1390)
+            log.markSent(seq);
+        }
+
+    log = SmallLog_t();
+    log.begin(flash);
+    if (log.getNextSeq() != seqStart + 1401)
+        fail("remount after the wrap", log.getNextSeq());
+    // the sector being filled, and the three before it.
+    std::uint32_t const nKept = 3 * SmallLog_t::kRecordsPerSector +
+                                ((seqStart + 1400) & (SmallLog_t::kRecordsPerSector - 1)) + 1;
+
+    for (unsigned i = 1400 - nKept; i < 1400; ++i)
+        {
+        records[i].fSent = i < 1390;
+        if (! log.read(seqStart + 1 + i, rec) || ! sameRecord(rec, seqStart + 1 + i, records[i]))
+            fail("record after the wrap reads back wrong", i);
+        }
+    if (! log.findUnsent(log.getNextSeq(), seq) || seq != seqStart + 1391)
+        fail("findUnsent after the wrap", seq);
+
+    std::printf("{\"check\":\"wrap\",\"first_seq\":%u,\"next_seq\":%u,\"unsent\":%u,\"lost\":%u}\n",
+        unsigned(seqStart), unsigned(log.getNextSeq()), unsigned(log.getUnsentCount()), unsigned(log.getLostCount())
+        );
+    }
+
+/****************************************************************************\
+|
+|   The sketch, through an outage
+|
+\****************************************************************************/
+
+// what an uplink carried: its intervals' times (by the virtual clock,
+// to the second; kUnknown if the age was saturated), and their first
+// sequence number if it came with one.
+constexpr std::uint64_t kUnknown = ~std::uint64_t(0);
+
+struct Uplink
+    {
+    std::uint64_t               tSec;
+    bool                        fSeq;
+    std::uint32_t               seq;
+    std::vector<std::uint64_t>  tIntervals;
+    };
+
+// the times and sequence number of an uplink, as the decoders see it.
+static bool parseUplink(const std::uint8_t *p, std::size_t n, std::uint64_t tSec, Uplink &u)
+    {
+    cUplinkDecoder decoder;
+
+    u.tSec = tSec;
+    u.tIntervals.clear();
+    if (! decoder.decode(p, n) || decoder.getSize() != n)
+        return false;
+
+    u.fSeq = decoder.getSeq(u.seq);
+    if (! decoder.isBatch())
+        {
+        // a single interval, just ended.
+        u.tIntervals.push_back(tSec);
+        return true;
+        }
+
+    if ((decoder.getMessage().getFlags() & 0x20) == 0)
+        return false;
+
+    for (std::size_t k = 0; k < decoder.getIntervalCount(); ++k)
+        {
+        std::uint32_t const age = decoder.getInterval(k).age;
+
+        u.tIntervals.push_back(age == 0xFFFF ? kUnknown : tSec - age);
+        }
+    return true;
+    }
+
+static void testSketch(unsigned nBatch, double days, double outageStart, double outageDays)
+    {
+    cPms7003Sim sim { Serial2, gPmsHal, 1 };
+
+    gCatena.fQuiet = true;
+    gCatena.OperatingFlags |= std::uint32_t(Catena::OPERATING_FLAGS::fUnattended);
+    gFlash.fPresent = true;
+    gfFlash = gFlash.begin(&gSPI2, 0);
+    gFlash.powerDown();
+
+    gLoRaWAN.begin(&gCatena);
+    gCatena.registerObject(&gLoRaWAN);
+    gMeasurementLoop.setTempRh(gTempRh.begin());
+    gPms7003.begin();
+    gMeasurementLoop.begin();
+    if (! gMeasurementLoop.setBatch(nBatch, cMeasurementLoop::kDefaultBatchLatencySec))
+        {
+        fail("bad batch size", nBatch);
+        return;
+        }
+    gMeasurementLoop.requestActive(true);
+
+    std::uint64_t const kDay = 86400ull * 1000 * 1000;
+    std::uint64_t const tOutage = std::uint64_t(outageStart * kDay);
+    std::uint64_t const tOutageMid = tOutage + std::uint64_t(outageDays * kDay / 2);
+    std::uint64_t const tRecover = tOutage + std::uint64_t(outageDays * kDay);
+    std::uint64_t const tEnd = std::uint64_t(days * kDay);
+    std::uint32_t nSends = 0;
+    std::size_t nDrainUplinks = 0;
+    bool fPendingOk = false;
+    std::vector<Uplink> delivered;
+    Uplink pending;
+
+    while (gClock.getMicros() < tEnd)
+        {
+        std::uint64_t const t = gClock.getMicros();
+
+        // change the network only between uplinks.
+        if (! gLoRaWAN.isTxActive())
+            {
+            gLoRaWAN.fLaunchOk = ! (t >= tOutage && t < tOutageMid);
+            gLoRaWAN.fTxOk = ! (t >= tOutageMid && t < tRecover);
+            }
+
+        bool const fWasActive = gLoRaWAN.isTxActive();
+
+        gCatena.poll();
+        sim.poll();
+        yield();
+
+        // the sketch may launch the next uplink from the callback of
+        // the last one.
+        if (gLoRaWAN.nSends != nSends)
+            {
+            if (fWasActive && fPendingOk)
+                delivered.push_back(pending);
+            nSends = gLoRaWAN.nSends;
+            fPendingOk = gLoRaWAN.fTxOk;
+            if (cMeasurementLoopHostAccess::getState(gMeasurementLoop) == cMeasurementLoopHostAccess::State::stDrain)
+                ++nDrainUplinks;
+            if (! parseUplink(gLoRaWAN.LastMessage, gLoRaWAN.nLastMessage, gClock.getMicros() / 1000000, pending))
+                fail("uplink doesn't parse", nSends);
+            }
+        else if (fWasActive && ! gLoRaWAN.isTxActive() && fPendingOk)
+            delivered.push_back(pending);
+        }
+
+    // tally: each interval logged must have got through once, be held
+    // for a batch, or have been dropped for lack of room.
+    auto const &log = cMeasurementLoopHostAccess::getLog(gMeasurementLoop);
+    std::uint32_t const nLogged = log.getNextSeq();
+    std::set<std::uint32_t> seqs;
+    std::size_t nUnnumbered = 0;
+    std::map<std::uint32_t, std::uint64_t> tBySeq;
+
+    for (auto const &u : delivered)
+        {
+        if (! u.fSeq)
+            {
+            nUnnumbered += u.tIntervals.size();
+            continue;
+            }
+        for (std::size_t k = 0; k < u.tIntervals.size(); ++k)
+            {
+            if (! seqs.insert(u.seq + k).second)
+                fail("interval delivered twice", u.seq + k);
+            tBySeq[u.seq + k] = u.tIntervals[k];
+            }
+        }
+
+    std::size_t const nHeld = cMeasurementLoopHostAccess::getBatchCount(gMeasurementLoop);
+
+    if (log.getUnsentCount() != nHeld)
+        fail("intervals left unsent at the end", log.getUnsentCount());
+    if (seqs.size() + nUnnumbered + nHeld + log.getLostCount() != nLogged)
+        fail("intervals lost or duplicated", nLogged);
+    if (nBatch > 1 && nUnnumbered != 0)
+        fail("batched uplink without a sequence number", nUnnumbered);
+
+    // the intervals with sequence numbers must be in time order; those
+    // from this boot have exact ages, so allow only rounding.
+    std::uint64_t tPrev = 0;
+
+    for (auto const &e : tBySeq)
+        {
+        if (e.second == kUnknown)
+            continue;
+        if (e.second + 1 < tPrev)
+            fail("intervals out of time order", e.first);
+        tPrev = e.second;
+        }
+
+    std::printf("{\"check\":\"sketch\",\"batch\":%u,\"days\":%g,\"outage_days\":%g,\"logged\":%u,\"delivered_with_seq\":%zu,\"delivered_without_seq\":%zu,\"held\":%zu,\"lost\":%u,\"uplinks\":%zu,\"drain_uplinks\":%zu}\n",
+        nBatch, days, outageDays, unsigned(nLogged), seqs.size(), nUnnumbered, nHeld,
+        unsigned(log.getLostCount()), delivered.size(), nDrainUplinks
+        );
+    }
+
+int main(int argc, char **argv)
+    {
+    unsigned long nOps = 200000;
+    unsigned nBatch = 1;
+    double days = 3;
+    double outageStart = 0.5;
+    double outageDays = 1;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--ops=", 6) == 0)
+            nOps = std::strtoul(argv[i] + 6, nullptr, 0);
+        else if (std::strncmp(argv[i], "--batch=", 8) == 0)
+            nBatch = unsigned(std::strtoul(argv[i] + 8, nullptr, 0));
+        else if (std::strncmp(argv[i], "--days=", 7) == 0)
+            days = std::strtod(argv[i] + 7, nullptr);
+        else if (std::strncmp(argv[i], "--outage-start=", 15) == 0)
+            outageStart = std::strtod(argv[i] + 15, nullptr);
+        else if (std::strncmp(argv[i], "--outage-days=", 14) == 0)
+            outageDays = std::strtod(argv[i] + 14, nullptr);
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--ops=N] [--batch=N] [--days=N] [--outage-start=DAYS] [--outage-days=DAYS]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    testRandom(nOps);
+    testWrap();
+    testSketch(nBatch, days, outageStart, outageDays);
+
+    std::printf("%s\n", gnFailed == 0 ? "passed" : "FAILED");
+    return gnFailed == 0 ? 0 : 1;
+    }
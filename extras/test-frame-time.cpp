@@ -0,0 +1,200 @@
+/*
+
+Module: test-frame-time.cpp
+
+Function:
+    Check the times cPMS7003 gives frames through its timed callback.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/test-frame-time.cpp src/lib/cPMS7003.cpp \
+            -o test-frame-time
+
+    Usage:
+        test-frame-time [--seed=N] [--frames=N]
+
+    Frames go down a clean line at 9600 baud, at random times, and
+    poll() runs either after every byte, or only now and then, with up
+    to most of the UART buffer waiting. Either way, each frame's time
+    must be millis() when its first byte reached the buffer, to within
+    a byte time and the rounding to ms: a frame read late is dated back
+    by the bytes behind it. The line moves the clock a byte time after
+    putting each byte in the buffer, so the time the library sees the
+    last byte arrive is a byte time late; that's the lateness allowed.
+
+    Last, the line is idle for up to 200 ms before each frame, and again
+    after it, and poll() runs only when that's over, as when the sketch
+    is busy. The library can then only place the frame between the two
+    polls; its time must be within half the idle time of the truth.
+
+    One JSON line is printed for each way of polling, with the errors
+    seen, in ms. Exits non-zero on any frame out of bounds, or lost.
+
+*/
+
+#include <pms7003-faulty-uart.h>
+#include <Catena-PMS7003Hal-4630.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+Catena gCatena;
+cPMS7003Hal_4630 gPmsHal { gCatena, 0 };
+cPMS7003 gPms7003 { Serial2, gPmsHal };
+
+static unsigned gnFailed;
+
+static void fail(const char *pWhat, long n)
+    {
+    if (gnFailed < 20)
+        std::printf("%s (%ld)\n", pWhat, n);
+    ++gnFailed;
+    }
+
+// the frames delivered since the last check, and their times.
+static std::uint32_t gnDelivered;
+static std::uint32_t gtFrame;
+static Measurements16 gLast;
+
+static void checkMeasurement(
+    void * /* pUserData */,
+    const cPMS7003::Measurements<std::uint16_t> *pData,
+    bool /* fWarmedUp */,
+    std::uint32_t tFrameMs
+    )
+    {
+    ++gnDelivered;
+    gtFrame = tFrameMs;
+    gLast = *pData;
+    }
+
+// maxBacklog 0 means no poll while the frame comes in; maxIdleMs, up
+// to how long the line is idle before the frame, and again after it
+// before the poll that reads it.
+static void runOne(
+    const char *pName,
+    std::uint32_t seed,
+    std::uint32_t nFrames,
+    unsigned maxBacklog,
+    std::uint32_t maxIdleMs = 0
+    )
+    {
+    cRandom r { seed };
+    cFaultyUart line { Serial2, seed, cFaultyUart::Faults {} };
+    std::uint8_t frame[kFrameSize];
+    unsigned nWaiting = 0;
+    unsigned nBacklog = 0;
+    long errMin = 0;
+    long errMax = 0;
+
+    // poll after each byte, or once maxBacklog bytes are waiting.
+    auto poll = [&]
+        {
+        if (maxBacklog != 0 && ++nWaiting >= nBacklog)
+            {
+            gPms7003.poll();
+            nWaiting = 0;
+            nBacklog = 1 + r.uniform(maxBacklog);
+            }
+        };
+
+    for (std::uint32_t i = 0; i < nFrames; ++i)
+        {
+        Measurements16 m;
+
+        // a gap, then the frame; whatever is still waiting is read
+        // when the gap ends, so the next frame starts on an empty
+        // buffer, as it would with the sensor's 200 ms or more
+        // between frames.
+        gClock.advanceMicros(r.uniform(2000000));
+        gPms7003.poll();
+        nWaiting = 0;
+        gnDelivered = 0;
+
+        makeMeasurement(r, 20, m);
+        m.cf1.m1p0 = std::uint16_t(i);
+        makeFrame(m, frame);
+
+        std::uint32_t const tPolled = millis();
+
+        gClock.advanceMicros(r.uniform(maxIdleMs * 1000 + 1));
+
+        std::uint32_t const tSent = millis();
+
+        line.sendFrame(frame, sizeof(frame), poll);
+        gClock.advanceMicros(r.uniform(maxIdleMs * 1000 + 1));
+
+        // with no poll during the frame, the library knows only that it
+        // came between the polls; it may be off by half the time the
+        // line could have been idle.
+        long const slack = maxBacklog != 0 ? 0
+            : long(millis() - tPolled - (kFrameSize * cFaultyUart::kByteMicros) / 1000) / 2;
+
+        gPms7003.poll();
+
+        if (gnDelivered != 1 || std::memcmp(&gLast, &m, sizeof(m)) != 0)
+            {
+            fail("frame lost", long(i));
+            continue;
+            }
+
+        long const err = long(std::int32_t(gtFrame - tSent));
+
+        if (i == 0 || err < errMin)
+            errMin = err;
+        if (i == 0 || err > errMax)
+            errMax = err;
+
+        // late by at most the byte time the line adds, rounded up; early
+        // by at most the rounding; and either by the slack.
+        if (err < -1 - slack || err > 2 + slack)
+            fail("frame time out of bounds", err);
+        }
+
+    std::printf("{\"poll\":\"%s\",\"frames\":%u,\"err_min_ms\":%ld,\"err_max_ms\":%ld}\n",
+        pName, unsigned(nFrames), errMin, errMax
+        );
+    }
+
+int main(int argc, char **argv)
+    {
+    std::uint32_t seed = 1;
+    std::uint32_t nFrames = 5000;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--seed=", 7) == 0)
+            seed = std::uint32_t(std::strtoul(argv[i] + 7, nullptr, 0));
+        else if (std::strncmp(argv[i], "--frames=", 9) == 0)
+            nFrames = std::uint32_t(std::strtoul(argv[i] + 9, nullptr, 0));
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--seed=N] [--frames=N]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    startPms7003(gPms7003, Serial2);
+    gPms7003.setCallback(checkMeasurement, nullptr);
+
+    runOne("every-byte", seed, nFrames, 1);
+    runOne("lazy", seed, nFrames, HardwareSerial::kRxBufferSize - 8);
+    runOne("late", seed, nFrames, 0, 200);
+
+    std::printf("%s\n", gnFailed == 0 ? "passed" : "FAILED");
+    return gnFailed == 0 ? 0 : 1;
+    }
@@ -0,0 +1,288 @@
+/*
+
+Module: test-keep-warm.cpp
+
+Function:
+    Check cKeepWarmPolicy, and the lora sketch's choice of how deeply to
+    put the PMS7003 to sleep between cycles.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src -I examples/catena4630-revB-pms7003-lora \
+            extras/test-keep-warm.cpp src/lib/cPMS7003.cpp \
+            examples/catena4630-revB-pms7003-lora/catena-pms7003-lora-cMeasurementLoop.cpp \
+            -o test-keep-warm
+
+    Usage:
+        test-keep-warm [--seed=N]
+
+    First, on random models, recovery times, masks and waits, choose()
+    must pick the allowed depth that costs least, computed in doubles,
+    preferring the lower depth on a tie; getBreakEvenMs() must be the
+    last wait at which a sleep beats power-off; and the recovery times
+    must follow the measurements as documented.
+
+    Then the RevB sketch runs against the simulated PMS7003 at uplink
+    intervals of one minute, six minutes and an hour, with the default
+    model. The sensor must be kept asleep by its SET pin between cycles
+    at the first two, and powered off at the last. The recovery times
+    the sketch measures must be those of the simulation, and the
+    uplinks must keep to the interval.
+
+    Exits non-zero on any mismatch.
+
+*/
+
+#include <pms7003-lora-globals.h>
+#include <pms7003-sim.h>
+#include <Catena-PMS7003-KeepWarm.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaSht3x;
+using namespace McciCatenaHost;
+
+using Depth = cKeepWarmPolicy::Depth;
+
+/****************************************************************************\
+|
+|   The policy
+|
+\****************************************************************************/
+
+static void testPolicy(std::uint32_t seed)
+    {
+    cRandom r { seed };
+    unsigned long nChecked = 0;
+
+    for (unsigned long iter = 0; iter < 200000; ++iter)
+        {
+        cKeepWarmPolicy policy;
+        cKeepWarmPolicy::Model model;
+
+        model.idleUa[0] = r.uniform(4) == 0 ? r.uniform(100) : 0;
+        for (std::size_t d = 1; d < cKeepWarmPolicy::kDepths; ++d)
+            model.idleUa[d] = model.idleUa[0] + 1 + r.uniform(2000);
+        model.recoverUa = 1000 + r.uniform(300000);
+        policy.setModel(model);
+
+        for (std::size_t d = 0; d < cKeepWarmPolicy::kDepths; ++d)
+            if (r.uniform(2))
+                policy.putRecovery(Depth(d), r.uniform(30000));
+
+        std::uint8_t const mask = std::uint8_t(r.uniform(8));
+
+        policy.setAllowed(mask);
+        if (policy.getAllowed() != (mask != 0 ? mask : 1))
+            fail("setAllowed()", mask);
+
+        // the cheapest, in doubles.
+        std::uint32_t const idleMs = r.uniform(4) == 0 ? r.uniform(60000) : r.uniform(4 * 3600000);
+        int best = -1;
+        double bestCost = 0;
+
+        for (std::size_t d = 0; d < cKeepWarmPolicy::kDepths; ++d)
+            {
+            double const cost = double(model.idleUa[d]) * idleMs +
+                                double(model.recoverUa) * policy.getRecoveryMs(Depth(d));
+
+            if (((policy.getAllowed() >> d) & 1) != 0 && (best < 0 || cost < bestCost))
+                {
+                best = int(d);
+                bestCost = cost;
+                }
+            }
+
+        Depth const chosen = policy.choose(idleMs);
+
+        if (chosen != Depth(best))
+            fail("choose()", iter);
+        if (policy.getChosenCount(chosen) != 1)
+            fail("getChosenCount()", iter);
+
+        // the break-even wait of each sleep, against power-off alone.
+        for (std::size_t d = 1; d < cKeepWarmPolicy::kDepths; ++d)
+            {
+            Depth const depth = Depth(d);
+            std::uint32_t const tBreak = policy.getBreakEvenMs(depth);
+
+            policy.setAllowed(std::uint8_t(1u | (1u << d)));
+            if (policy.getRecoveryMs(depth) >= policy.getRecoveryMs(Depth::Off))
+                {
+                if (tBreak != 0 || policy.getCheapest(0) != Depth::Off)
+                    fail("break-even of a slow sleep", iter);
+                }
+            else if (policy.getCheapest(tBreak) != depth ||
+                     (tBreak != UINT32_MAX && policy.getCheapest(tBreak + 1) != Depth::Off))
+                fail("getBreakEvenMs()", iter);
+            }
+        ++nChecked;
+        }
+
+    // the recovery times: the first measurement replaces the default,
+    // and later ones move it a quarter of the way.
+        {
+        cKeepWarmPolicy policy;
+
+        for (std::size_t d = 0; d < cKeepWarmPolicy::kDepths; ++d)
+            if (policy.isMeasured(Depth(d)) ||
+                policy.getRecoveryMs(Depth(d)) != cKeepWarmPolicy::kDefaultRecoveryMs[d])
+                fail("default recovery", d);
+
+        policy.putRecovery(Depth::HwSleep, 2000);
+        if (! policy.isMeasured(Depth::HwSleep) || policy.getRecoveryMs(Depth::HwSleep) != 2000)
+            fail("first recovery", policy.getRecoveryMs(Depth::HwSleep));
+        policy.putRecovery(Depth::HwSleep, 3000);
+        if (policy.getRecoveryMs(Depth::HwSleep) != 2250)
+            fail("second recovery", policy.getRecoveryMs(Depth::HwSleep));
+        policy.putRecovery(Depth::HwSleep, 1050);
+        if (policy.getRecoveryMs(Depth::HwSleep) != 1950)
+            fail("third recovery", policy.getRecoveryMs(Depth::HwSleep));
+        if (policy.isMeasured(Depth::Off) || policy.isMeasured(Depth::SwSleep))
+            fail("recovery of another depth", 0);
+
+        policy.reset();
+        if (policy.isMeasured(Depth::HwSleep) || policy.getAllowed() != cKeepWarmPolicy::kAllDepths)
+            fail("reset()", 0);
+        }
+
+    std::printf("{\"check\":\"policy\",\"cases\":%lu}\n", nChecked);
+    }
+
+/****************************************************************************\
+|
+|   The sketch
+|
+\****************************************************************************/
+
+static void testSketch()
+    {
+    cPms7003Sim sim { Serial2, gPmsHal, 1 };
+
+    gCatena.fQuiet = true;
+    gCatena.OperatingFlags |= std::uint32_t(Catena::OPERATING_FLAGS::fUnattended);
+
+    gLoRaWAN.begin(&gCatena);
+    gCatena.registerObject(&gLoRaWAN);
+    gMeasurementLoop.setTempRh(gTempRh.begin());
+    gPms7003.begin();
+    gMeasurementLoop.begin();
+    gMeasurementLoop.setTxCycleTime(60, 0);
+    gMeasurementLoop.requestActive(true);
+
+    auto const &policy = gMeasurementLoop.getKeepWarm();
+
+    // the interval, how long to run it, and how the sensor should wait.
+    struct Phase
+        {
+        std::uint32_t   txCycleSec;
+        std::uint32_t   hours;
+        cPms7003Sim::State expect;
+        };
+    static const Phase kPhases[] =
+        {
+        { 60,       2,  cPms7003Sim::State::HwSleep },
+        { 6 * 60,   6,  cPms7003Sim::State::HwSleep },
+        { 60 * 60,  12, cPms7003Sim::State::Off },
+        };
+
+    using State = cMeasurementLoopHostAccess::State;
+    auto statePrev = cMeasurementLoopHostAccess::getState(gMeasurementLoop);
+    auto simPrev = sim.getState();
+
+    for (auto const &phase : kPhases)
+        {
+        std::uint64_t const tEnd = gClock.getMicros() + std::uint64_t(phase.hours) * 3600 * 1000000;
+        std::uint32_t const nSends0 = gLoRaWAN.nSends;
+        unsigned nWaits = 0;
+        unsigned nWrong = 0;
+
+        gMeasurementLoop.setTxCycleTime(phase.txCycleSec, 0);
+        while (gClock.getMicros() < tEnd)
+            {
+            gCatena.poll();
+            sim.poll();
+            yield();
+
+            // each wait ends when the sketch wakes the sensor; how the
+            // sensor spent it is how it was just before.
+            auto const state = cMeasurementLoopHostAccess::getState(gMeasurementLoop);
+
+            if (statePrev == State::stSleeping && state == State::stWakePms)
+                {
+                ++nWaits;
+                if (simPrev != phase.expect)
+                    ++nWrong;
+                }
+            statePrev = state;
+            simPrev = sim.getState();
+            }
+
+        // the first wait of a phase was chosen for the interval before.
+        std::uint32_t const nSends = gLoRaWAN.nSends - nSends0;
+        std::uint32_t const nExpect = phase.hours * 3600 / phase.txCycleSec;
+
+        if (nWrong > 1)
+            fail("sensor not waiting as expected", phase.txCycleSec);
+        if (nSends + 1 < nExpect || nSends > nExpect + 1)
+            fail("uplinks not keeping to the interval", phase.txCycleSec);
+
+        std::printf("{\"check\":\"sketch\",\"tx_cycle_sec\":%u,\"hours\":%u,\"uplinks\":%u,\"waits\":%u,\"expected\":\"%s\",\"other\":%u}\n",
+            unsigned(phase.txCycleSec), unsigned(phase.hours), unsigned(nSends),
+            nWaits, phase.expect == cPms7003Sim::State::Off ? "off" : "hwsleep", nWrong
+            );
+        }
+
+    // the measured recovery times: to the first frame after power-on, or
+    // after the SET pin goes high, within a frame.
+    auto checkRecovery = [&](Depth d, std::uint32_t simMs)
+        {
+        std::uint32_t const ms = policy.getRecoveryMs(d);
+
+        if (! policy.isMeasured(d) || ms < simMs || ms > simMs + sim.m_frameMs)
+            fail("recovery time", ms);
+        };
+
+    checkRecovery(Depth::Off, sim.m_powerOnMs);
+    checkRecovery(Depth::HwSleep, sim.m_wakeMs);
+
+    std::printf("{\"check\":\"recovery\",\"off_ms\":%u,\"hwsleep_ms\":%u,\"hwsleep_break_even_sec\":%u}\n",
+        unsigned(policy.getRecoveryMs(Depth::Off)),
+        unsigned(policy.getRecoveryMs(Depth::HwSleep)),
+        unsigned(policy.getBreakEvenMs(Depth::HwSleep) / 1000)
+        );
+    }
+
+int main(int argc, char **argv)
+    {
+    std::uint32_t seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--seed=", 7) == 0)
+            seed = std::uint32_t(std::strtoul(argv[i] + 7, nullptr, 0));
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--seed=N]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    testPolicy(seed);
+    testSketch();
+
+    std::printf("%s\n", gnFailed == 0 ? "passed" : "FAILED");
+    return gnFailed == 0 ? 0 : 1;
+    }
@@ -0,0 +1,271 @@
+/*
+
+Module: test-nowcast.cpp
+
+Function:
+    Check cNowCast against the EPA NowCast computed from scratch, in
+    doubles, every hour.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -I extras/host -I src \
+            extras/test-nowcast.cpp -o test-nowcast
+
+    Usage:
+        test-nowcast [--hours=N] [--seed=N]
+
+    Random streams of intervals (cycles of 30 seconds to 20 minutes,
+    with outages of up to two days, and concentrations wandering over
+    four decades) are fed to cNowCast, with one, three or six as the
+    fewest intervals an hour needs. After each hour closes, the
+    NowCast, its truncated value and its AQI must be what the EPA
+    formula gives, in doubles, from the intervals of the last 12
+    hours. The truncated values may differ by one step where the double
+    is within 10^-4 µg/m^3 of a boundary; these are counted.
+
+    Exits non-zero on any other mismatch.
+
+*/
+
+#include <Catena-PMS7003-NowCast.h>
+#include <pms7003-host.h>
+#include <pms7003-uplink-decoder.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+static unsigned gnFailed;
+
+static void fail(const char *pWhat, unsigned long hour, double expect, double actual)
+    {
+    if (gnFailed < 20)
+        std::printf("%s (hour %lu): expected %.17g, got %.17g\n", pWhat, hour, expect, actual);
+    ++gnFailed;
+    }
+
+// the hours, as the reference sees them.
+struct Hour
+    {
+    double          sum[cNowCast::kLanes];
+    unsigned        count;
+    };
+
+// the NowCast of lane over the 12 hours ending at hours[iLast], or -1.
+static double referenceNowCast(const std::vector<Hour> &hours, std::size_t iLast, std::size_t lane, unsigned minSamples)
+    {
+    double c[cNowCast::kHours];
+    bool fValid[cNowCast::kHours];
+
+    for (std::size_t age = 0; age < cNowCast::kHours; ++age)
+        {
+        fValid[age] = age <= iLast && hours[iLast - age].count >= minSamples;
+        c[age] = fValid[age] ? hours[iLast - age].sum[lane] / hours[iLast - age].count : 0;
+        }
+
+    if (int(fValid[0]) + int(fValid[1]) + int(fValid[2]) < 2)
+        return -1;
+
+    double cMin = INFINITY;
+    double cMax = 0;
+
+    for (std::size_t age = 0; age < cNowCast::kHours; ++age)
+        {
+        if (fValid[age])
+            {
+            cMin = std::fmin(cMin, c[age]);
+            cMax = std::fmax(cMax, c[age]);
+            }
+        }
+
+    double const w = cMax == 0 ? 1 : std::fmax(cMin / cMax, 0.5);
+    double num = 0;
+    double den = 0;
+
+    for (std::size_t age = 0; age < cNowCast::kHours; ++age)
+        {
+        if (fValid[age])
+            {
+            num += std::pow(w, double(age)) * c[age];
+            den += std::pow(w, double(age));
+            }
+        }
+
+    return num / den;
+    }
+
+// true if x, in units of step µg/m^3, is within 10^-4 µg/m^3 of a
+// multiple of step.
+static bool nearBoundary(double x, double step)
+    {
+    return std::fabs(x - std::round(x)) * step < 1e-4;
+    }
+
+static void checkHour(const cNowCast &nc, const std::vector<Hour> &hours, unsigned minSamples, unsigned long &nNear)
+    {
+    std::size_t const iLast = hours.size() - 1;
+
+    for (std::size_t lane = 0; lane < cNowCast::kLanes; ++lane)
+        {
+        auto const l = cNowCast::Lane(lane);
+        double const ref = referenceNowCast(hours, iLast, lane, minSamples);
+        std::uint32_t v, c10, aqi;
+        bool const fNowCast = nc.getNowCast(l, v);
+
+        if (fNowCast != (ref >= 0))
+            {
+            fail("NowCast presence", iLast, ref >= 0, fNowCast);
+            continue;
+            }
+        if (! fNowCast)
+            continue;
+
+        double const got = std::ldexp(double(v), -int(cNowCast::kFracBits));
+
+        if (std::fabs(got - ref) > 1e-4 + ref * 1e-6)
+            fail("NowCast", iLast, ref, got);
+
+        // the truncated value, in tenths, and its AQI.
+        double const ref10 = lane == cNowCast::kPm2p5 ? ref * 10 : ref;
+
+        nc.getConcentration(l, c10);
+        if (double(lane == cNowCast::kPm2p5 ? c10 : c10 / 10) != std::floor(ref10))
+            {
+            if (nearBoundary(ref10, lane == cNowCast::kPm2p5 ? 0.1 : 1))
+                ++nNear;
+            else
+                fail("truncated NowCast", iLast, std::floor(ref10), lane == cNowCast::kPm2p5 ? c10 : c10 / 10);
+            }
+
+        double const refAqi = lane == cNowCast::kPm2p5 ? cUplinkDecoder::getAqi2p5(c10 / 10.0)
+                                                       : cUplinkDecoder::getAqi10(c10 / 10.0);
+
+        nc.getAqi(l, aqi);
+        if (aqi != refAqi)
+            fail("NowCast AQI", iLast, refAqi, aqi);
+        }
+    }
+
+static void testStream(std::uint32_t seed, unsigned long nHours, unsigned minSamples, unsigned long &nChecked, unsigned long &nNear)
+    {
+    cRandom r { seed };
+    cNowCast nc;
+    std::vector<Hour> hours;
+    std::uint32_t const t0 = r.next();
+    std::uint32_t t = t0;
+    double level = 20;
+
+    nc.setMinSamples(std::uint16_t(minSamples));
+    nc.start(t0);
+    hours.push_back(Hour {});
+
+    while (hours.size() < nHours)
+        {
+        // the next interval: usually a cycle later, sometimes after an
+        // outage.
+        std::uint32_t dt = 30000 + r.uniform(20 * 60000);
+
+        if (r.uniform(200) == 0)
+            dt = r.uniform(48 * cNowCast::kHourMs);
+        t += dt;
+
+        // close the hours before it, checking each.
+        std::uint32_t const nClosed = nc.advance(t);
+
+        for (std::uint32_t i = 0; i < nClosed; ++i)
+            {
+            // the reference keeps every hour; the engine, only the last
+            // 12, and only checks after the last of a gap.
+            if (i + 1 == nClosed)
+                checkHour(nc, hours, minSamples, nNear), ++nChecked;
+            hours.push_back(Hour {});
+            }
+
+        // a random walk, in steps of up to a factor of 2, from 0.1 to
+        // 1000 µg/m^3, with zeros now and then.
+        level *= std::exp2(r.uniform(2001) / 1000.0 - 1);
+        level = std::fmin(std::fmax(level, 0.1), 1000.0);
+
+        float const pm2p5 = r.uniform(50) == 0 ? 0.0f : float(level);
+        float const pm10 = float(level * (1 + r.uniform(1000) / 1000.0));
+        std::uint16_t const uf2p5 = uflt16Encode(pm2p5 / 65536.0f);
+        std::uint16_t const uf10 = uflt16Encode(pm10 / 65536.0f);
+
+        if (nc.put(uf2p5, uf10, t) != 0)
+            fail("put() closed an hour", hours.size(), 0, 1);
+
+        Hour &h = hours.back();
+
+        h.sum[cNowCast::kPm2p5] += cUplinkDecoder::getParticleValue(uf2p5);
+        h.sum[cNowCast::kPm10] += cUplinkDecoder::getParticleValue(uf10);
+        ++h.count;
+        }
+    }
+
+int main(int argc, char **argv)
+    {
+    unsigned long nHours = 200000;
+    std::uint32_t seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--hours=", 8) == 0)
+            nHours = std::strtoul(argv[i] + 8, nullptr, 0);
+        else if (std::strncmp(argv[i], "--seed=", 7) == 0)
+            seed = std::uint32_t(std::strtoul(argv[i] + 7, nullptr, 0));
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--hours=N] [--seed=N]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    // a steady level gives exactly that level.
+        {
+        cNowCast nc;
+
+        for (std::uint32_t t = 0; t < 13 * cNowCast::kHourMs; t += 6 * 60000)
+            nc.put(uflt16Encode(12.5f / 65536.0f), uflt16Encode(55.0f / 65536.0f), t);
+
+        std::uint32_t c10, aqi;
+
+        if (! nc.getConcentration(cNowCast::kPm2p5, c10) || c10 != 125)
+            fail("steady PM2.5", 12, 125, c10);
+        if (! nc.getConcentration(cNowCast::kPm10, c10) || c10 != 550)
+            fail("steady PM10", 12, 550, c10);
+        if (! nc.getAqi(aqi) || aqi != 52)
+            fail("steady AQI", 12, 52, aqi);
+        }
+
+    for (unsigned minSamples : { 1u, 3u, 6u })
+        {
+        unsigned long nChecked = 0;
+        unsigned long nNear = 0;
+
+        testStream(seed + minSamples, nHours, minSamples, nChecked, nNear);
+        std::printf("{\"check\":\"stream\",\"min_samples\":%u,\"hours\":%lu,\"checked\":%lu,\"near_boundary\":%lu}\n",
+            minSamples, nHours, nChecked, nNear
+            );
+        }
+
+    if (gnFailed != 0)
+        {
+        std::printf("%u failures\n", gnFailed);
+        return 1;
+        }
+
+    std::printf("passed\n");
+    return 0;
+    }
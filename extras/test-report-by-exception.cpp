@@ -0,0 +1,404 @@
+/*
+
+Module: test-report-by-exception.cpp
+
+Function:
+    Check cReportByException, and the lora sketch's report-by-exception
+    uplink scheduling in stable and changing air.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src -I examples/catena4630-revB-pms7003-lora \
+            extras/test-report-by-exception.cpp src/lib/cPMS7003.cpp \
+            examples/catena4630-revB-pms7003-lora/catena-pms7003-lora-cMeasurementLoop.cpp \
+            -o test-report-by-exception
+
+    Usage:
+        test-report-by-exception [--heartbeat=SEC] [--percent=N]
+                                 [--threshold=N] [--hours=N]
+
+    First, for every one of the 65536 uflt16 codes, the integer value
+    the policy compares must be the value the message decoders compute,
+    exactly; and the AQI category of the code as PM2.5 and as PM10 must
+    be the segment extras/calculate-aqi.js interpolates in. Then each
+    rule of the policy is checked on hand-made intervals, at and either
+    side of its limits.
+
+    Then the RevB sketch runs against the simulated PMS7003 with report
+    by exception on (by default, with the policy's defaults; the PM
+    threshold is --threshold, in µg/m^3), for --hours (default 24): a
+    third of the time at 20 µg/m^3, a sixth at 80, and the rest at 20
+    again. No two uplinks may be further apart than the heartbeat, and
+    each step must be reported by the second interval after it. The
+    number of uplinks is printed, with the number of measurement
+    intervals (the uplinks it would have sent otherwise).
+
+    Exits non-zero on any mismatch.
+
+*/
+
+#include <pms7003-lora-globals.h>
+#include <pms7003-sim.h>
+#include <Catena-PMS7003-Port1.h>
+#include <Catena-PMS7003-Report.h>
+#include <Catena-PMS7003-Uflt16.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace McciCatena;
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaSht3x;
+using namespace McciCatenaHost;
+
+using Reason = cReportByException::Reason;
+
+/****************************************************************************\
+|
+|   The values and categories of every code
+|
+\****************************************************************************/
+
+// the segment of t that CalculatePmAqi() interpolates v in.
+static unsigned jsSegment(double v, const double (&t)[7])
+    {
+    unsigned i;
+
+    for (i = 7 - 2; i > 0; --i)
+        if (t[i] <= v)
+            break;
+    return i;
+    }
+
+static void testCodes()
+    {
+    static const double t2p5[7] = { 0, 12.1, 35.5, 55.5, 150.5, 250.5, 350.5 };
+    static const double t10[7] = { 0, 55, 155, 255, 355, 425, 505 };
+
+    for (std::uint32_t uf = 0; uf < 0x10000; ++uf)
+        {
+        // as the decoders compute it.
+        double const v = double(uflt16Decode(std::uint16_t(uf))) * 65536.0;
+
+        if (double(cReportByException::getRawValue(std::uint16_t(uf))) != v * 2048.0)
+            fail("raw value differs from the decoders'", uf);
+        if (cReportByException::getPm2p5Category(std::uint16_t(uf)) != jsSegment(v, t2p5))
+            fail("PM2.5 category differs from calculate-aqi.js", uf);
+        if (cReportByException::getPm10Category(std::uint16_t(uf)) != jsSegment(v, t10))
+            fail("PM10 category differs from calculate-aqi.js", uf);
+        }
+
+    std::printf("{\"check\":\"codes\",\"codes\":65536}\n");
+    }
+
+/****************************************************************************\
+|
+|   The rules, one at a time
+|
+\****************************************************************************/
+
+// an interval with every channel at v µg/m^3 (or per 0.1 L).
+static void makeInterval(std::uint16_t (&uf)[kReduceChannels], double v)
+    {
+    for (auto &u : uf)
+        u = uflt16Encode(float(v / 65536.0));
+    }
+
+static void expect(Reason got, Reason want, unsigned long line)
+    {
+    if (got != want)
+        {
+        if (gnFailed < 20)
+            std::printf("line %lu: got %s, want %s\n",
+                line,
+                cReportByException::getReasonName(got),
+                cReportByException::getReasonName(want)
+                );
+        ++gnFailed;
+        }
+    }
+
+static void testPolicy()
+    {
+    cReportByException report;
+    std::uint16_t base[kReduceChannels];
+    std::uint16_t uf[kReduceChannels];
+    std::uint32_t const kCycle = 360 * 1000;
+    std::uint32_t const t0 = 0xFFFF0000u;   // millis() wraps in between
+
+    makeInterval(base, 20);
+
+    // the first interval is always reported.
+    expect(report.check(base, true, t0, kCycle), Reason::First, __LINE__);
+    report.setReported(base, true, t0);
+    expect(report.check(base, true, t0 + kCycle, kCycle), Reason::None, __LINE__);
+
+    // 20 -> 24: over 3 µg/m^3, but only 20%.
+    std::memcpy(uf, base, sizeof(uf));
+    makeInterval(uf, 24);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::None, __LINE__);
+    // 20 -> 26: over both.
+    makeInterval(uf, 26);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::Threshold, __LINE__);
+    // 20 -> 15 (down 5, 25%): not over 25%.
+    makeInterval(uf, 15);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::None, __LINE__);
+    makeInterval(uf, 14.5);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::Threshold, __LINE__);
+
+    // one PM channel is enough; the dust counts don't count.
+    std::memcpy(uf, base, sizeof(uf));
+    uf[0] = uflt16Encode(30 / 65536.0f);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::Threshold, __LINE__);
+    std::memcpy(uf, base, sizeof(uf));
+    for (std::size_t c = 3; c < kReduceChannels; ++c)
+        uf[c] = uflt16Encode(1000 / 65536.0f);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::None, __LINE__);
+    report.setThreshold(5, 100);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::Threshold, __LINE__);
+    report.setThreshold(5, 0);
+
+    // small values: 2 -> 4.5 is 125%, but under 3 µg/m^3.
+    makeInterval(uf, 2);
+    report.setReported(uf, true, t0);
+    makeInterval(uf, 4.5);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::None, __LINE__);
+    makeInterval(uf, 5.5);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::Threshold, __LINE__);
+
+    // a category change reports, however small: PM2.5 12 -> 12.125.
+    makeInterval(uf, 12);
+    report.setReported(uf, true, t0);
+    uf[cReportByException::kPm2p5Channel] = uflt16Encode(12.125f / 65536.0f);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::Category, __LINE__);
+    // ...and so does PM10 crossing 55, with PM2.5 unchanged.
+    makeInterval(uf, 54);
+    uf[cReportByException::kPm2p5Channel] = uflt16Encode(5.0f / 65536.0f);
+    report.setReported(uf, true, t0);
+    uf[cReportByException::kPm10Channel] = uflt16Encode(55.0f / 65536.0f);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::Category, __LINE__);
+
+    // particle data coming or going.
+    report.setReported(base, true, t0);
+    expect(report.check(base, false, t0 + kCycle, kCycle), Reason::Validity, __LINE__);
+    report.setReported(base, false, t0);
+    expect(report.check(base, true, t0 + kCycle, kCycle), Reason::Validity, __LINE__);
+    makeInterval(uf, 500);
+    expect(report.check(uf, false, t0 + kCycle, kCycle), Reason::None, __LINE__);
+
+    // the heartbeat: report when waiting another cycle would go over.
+    std::uint32_t const kHeartbeat = cReportByException::kDefaultHeartbeatSec * 1000;
+
+    report.setReported(base, true, t0);
+    expect(report.check(base, true, t0 + kHeartbeat - kCycle, kCycle), Reason::None, __LINE__);
+    expect(report.check(base, true, t0 + kHeartbeat - kCycle + 1, kCycle), Reason::Heartbeat, __LINE__);
+    report.setHeartbeat(0);
+    expect(report.check(base, true, t0, 0), Reason::None, __LINE__);
+    expect(report.check(base, true, t0 + 1, 0), Reason::Heartbeat, __LINE__);
+    report.setHeartbeat(cReportByException::kDefaultHeartbeatSec);
+
+    // the relative threshold alone.
+    report.setPercent(0);
+    makeInterval(uf, 23.5);
+    expect(report.check(uf, true, t0 + kCycle, kCycle), Reason::Threshold, __LINE__);
+    if (report.setPercent(256) || report.getPercent() != 0)
+        fail("percent out of range accepted", 256);
+    report.setPercent(cReportByException::kDefaultPercent);
+
+    // reset() forgets.
+    report.reset();
+    expect(report.check(base, true, t0 + kCycle, kCycle), Reason::First, __LINE__);
+
+    std::printf("{\"check\":\"policy\"}\n");
+    }
+
+/****************************************************************************\
+|
+|   The sketch
+|
+\****************************************************************************/
+
+struct Uplink
+    {
+    std::uint64_t   tSec;
+    double          pm2p5;  // negative if no particle data
+    };
+
+// the PM2.5 of a format 0x21 uplink.
+static bool parseUplink(const std::uint8_t *p, std::size_t n, std::uint64_t tSec, Uplink &u)
+    {
+    cPort1Message msg;
+
+    u.tSec = tSec;
+    u.pm2p5 = -1;
+    if (msg.decode(p, n) != n || msg.getFormat() != cMeasurementLoop::kMessageFormat)
+        return false;
+
+    if (msg.isPresent(cPort1Message::kPm2p5))
+        u.pm2p5 = msg.getValue(cPort1Message::kPm2p5);
+    return true;
+    }
+
+static void testSketch(std::uint32_t heartbeatSec, unsigned percent, unsigned threshold, double hours)
+    {
+    cPms7003Sim sim { Serial2, gPmsHal, 1 };
+
+    gCatena.fQuiet = true;
+    gCatena.OperatingFlags |= std::uint32_t(Catena::OPERATING_FLAGS::fUnattended);
+
+    gLoRaWAN.begin(&gCatena);
+    gCatena.registerObject(&gLoRaWAN);
+    gMeasurementLoop.setTempRh(gTempRh.begin());
+    gPms7003.begin();
+    gMeasurementLoop.begin();
+
+    auto &report = gMeasurementLoop.getReportPolicy();
+
+    report.setHeartbeat(heartbeatSec);
+    report.setPercent(percent);
+    for (std::size_t c = 0; c < 3; ++c)
+        report.setThreshold(c, std::uint16_t(threshold));
+    gMeasurementLoop.setReportByException(true);
+    gMeasurementLoop.requestActive(true);
+
+    std::uint64_t const kHour = 3600ull * 1000 * 1000;
+    std::uint64_t const tStepUp = std::uint64_t(hours * kHour / 3);
+    std::uint64_t const tStepDown = std::uint64_t(hours * kHour / 2);
+    std::uint64_t const tEnd = std::uint64_t(hours * kHour);
+    std::uint32_t nSends = 0;
+    std::size_t nIntervals = 0;
+    std::vector<Uplink> uplinks;
+    std::vector<std::uint64_t> tIntervals;
+    auto statePrev = cMeasurementLoopHostAccess::getState(gMeasurementLoop);
+
+    while (gClock.getMicros() < tEnd)
+        {
+        std::uint64_t const t = gClock.getMicros();
+
+        sim.m_pmBase = (t >= tStepUp && t < tStepDown) ? 80 : 20;
+
+        gCatena.poll();
+        sim.poll();
+        yield();
+
+        // an interval ends each time the sketch stops measuring; it
+        // can pass through stSleepPms and stTransmit within one poll.
+        using State = cMeasurementLoopHostAccess::State;
+        auto const state = cMeasurementLoopHostAccess::getState(gMeasurementLoop);
+        auto const isMeasuring = [](State s)
+            {
+            return s == State::stWakePms || s == State::stMeasurePms;
+            };
+
+        if (isMeasuring(statePrev) && ! isMeasuring(state))
+            {
+            ++nIntervals;
+            tIntervals.push_back(gClock.getMicros());
+            }
+        statePrev = state;
+
+        if (gLoRaWAN.nSends != nSends)
+            {
+            Uplink u;
+
+            nSends = gLoRaWAN.nSends;
+            if (! parseUplink(gLoRaWAN.LastMessage, gLoRaWAN.nLastMessage, gClock.getMicros() / 1000000, u))
+                fail("uplink doesn't parse", nSends);
+            uplinks.push_back(u);
+            }
+        }
+
+    if (uplinks.empty())
+        {
+        fail("no uplinks", 0);
+        return;
+        }
+
+    // no gap longer than the heartbeat, to the second.
+    std::uint64_t maxGap = 0;
+
+    for (std::size_t i = 1; i < uplinks.size(); ++i)
+        {
+        std::uint64_t const gap = uplinks[i].tSec - uplinks[i - 1].tSec;
+
+        if (gap > maxGap)
+            maxGap = gap;
+        if (gap > heartbeatSec + 1)
+            fail("uplinks further apart than the heartbeat", gap);
+        }
+    if ((tEnd / 1000000) - uplinks.back().tSec > heartbeatSec + 1)
+        fail("no uplink at the end for longer than the heartbeat", uplinks.size());
+
+    // each step must be reported by the end of the second interval
+    // that starts after it.
+    auto checkStep = [&](std::uint64_t tStep, bool fUp)
+        {
+        std::size_t k = 0;
+
+        while (k < tIntervals.size() && tIntervals[k] < tStep)
+            ++k;
+        if (k + 2 >= tIntervals.size())
+            return;
+
+        std::uint64_t const tBy = tIntervals[k + 1] / 1000000 + 1;
+
+        for (auto const &u : uplinks)
+            {
+            if (u.tSec > tStep / 1000000 && u.tSec <= tBy &&
+                (fUp ? u.pm2p5 > 50 : (u.pm2p5 >= 0 && u.pm2p5 < 35)))
+                return;
+            }
+        fail(fUp ? "step up not reported" : "step down not reported", tStep / 1000000);
+        };
+
+    checkStep(tStepUp, true);
+    checkStep(tStepDown, false);
+
+    std::printf("{\"check\":\"sketch\",\"hours\":%g,\"heartbeat\":%u,\"percent\":%u,\"threshold\":%u,\"intervals\":%zu,\"uplinks\":%zu,\"max_gap_sec\":%llu}\n",
+        hours, unsigned(heartbeatSec), percent, threshold,
+        nIntervals, uplinks.size(), (unsigned long long)maxGap
+        );
+    }
+
+int main(int argc, char **argv)
+    {
+    std::uint32_t heartbeatSec = cReportByException::kDefaultHeartbeatSec;
+    unsigned percent = cReportByException::kDefaultPercent;
+    unsigned threshold = cReportByException::kDefaultPmThreshold;
+    double hours = 24;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--heartbeat=", 12) == 0)
+            heartbeatSec = std::strtoul(argv[i] + 12, nullptr, 0);
+        else if (std::strncmp(argv[i], "--percent=", 10) == 0)
+            percent = unsigned(std::strtoul(argv[i] + 10, nullptr, 0));
+        else if (std::strncmp(argv[i], "--threshold=", 12) == 0)
+            threshold = unsigned(std::strtoul(argv[i] + 12, nullptr, 0));
+        else if (std::strncmp(argv[i], "--hours=", 8) == 0)
+            hours = std::strtod(argv[i] + 8, nullptr);
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--heartbeat=SEC] [--percent=N] [--threshold=N] [--hours=N]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    testCodes();
+    testPolicy();
+    testSketch(heartbeatSec, percent, threshold, hours);
+
+    std::printf("%s\n", gnFailed == 0 ? "passed" : "FAILED");
+    return gnFailed == 0 ? 0 : 1;
+    }
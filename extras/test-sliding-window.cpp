@@ -0,0 +1,176 @@
+/*
+
+Module: test-sliding-window.cpp
+
+Function:
+    Compare cSlidingWindow with cReductionWindow on the same readings.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/test-sliding-window.cpp -o test-sliding-window
+
+    Usage:
+        test-sliding-window [--data=path] [--synthetic=N]
+
+    The frames of the data run (default assets/data-run-1.txt), then N
+    synthetic frames (default 20000) with occasional spikes, are fed one
+    at a time to a cSlidingWindow, for a range of window lengths. After
+    every frame, the sliding window's results must equal those of a
+    cReductionWindow loaded with the most recent readings, for the IQR
+    mean and for the Hampel policy. The window length is also changed
+    partway through, as the sketch does when its "window" command is
+    used. Each frame is given a time, and the window's first and last
+    times must be those of its oldest and newest readings.
+
+    Exits non-zero on any mismatch; the last line gives the cost of
+    put().
+
+*/
+
+#include <Catena-PMS7003-Sliding.h>
+#include <pms7003-datarun.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+static constexpr std::size_t kMaxWindow = 60;
+
+// the time given to frame i: a second apart, from near the wrap of
+// millis().
+static std::uint32_t getFrameTime(std::size_t i)
+    {
+    return std::uint32_t(0xFFFF0000u + 1000u * i);
+    }
+
+// returns the number of frames after which the two reductions (or the
+// times) differ.
+template <typename TPolicy>
+static unsigned checkRun(const std::vector<Measurements16> &run, std::size_t nWindow)
+    {
+    static cSlidingWindow<kMaxWindow, TPolicy> sliding;
+    static cReductionWindow<kMaxWindow, TPolicy> exact;
+    unsigned nMismatch = 0;
+
+    sliding.reset(nWindow);
+    for (std::size_t i = 0; i < run.size(); ++i)
+        {
+        // halfway through, start over at a different length.
+        if (i == run.size() / 2)
+            {
+            nWindow = nWindow % kMaxWindow + 1;
+            sliding.reset(nWindow);
+            }
+
+        sliding.put(run[i], getFrameTime(i));
+
+        std::size_t const nCount = sliding.getCount();
+
+        if (sliding.getFirstTime() != getFrameTime(i + 1 - nCount) ||
+            sliding.getLastTime() != getFrameTime(i))
+            {
+            if (nMismatch < 10)
+                std::printf("window %zu, frame %zu: times differ\n", nWindow, i);
+            ++nMismatch;
+            }
+
+        std::uint16_t expect[kReduceChannels];
+        std::uint16_t actual[kReduceChannels];
+
+        exact.reset();
+        for (std::size_t j = 0; j < nCount; ++j)
+            exact.put(j, run[i + 1 - nCount + j]);
+        exact.reduceUflt16(expect);
+        sliding.reduceUflt16(actual);
+
+        if (std::memcmp(expect, actual, sizeof(expect)) != 0)
+            {
+            if (nMismatch < 10)
+                std::printf("window %zu, frame %zu: results differ\n", nWindow, i);
+            ++nMismatch;
+            }
+        }
+
+    return nMismatch;
+    }
+
+int main(int argc, char **argv)
+    {
+    const char *pData = "assets/data-run-1.txt";
+    std::size_t nSynthetic = 20000;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--data=", 7) == 0)
+            pData = argv[i] + 7;
+        else if (std::strncmp(argv[i], "--synthetic=", 12) == 0)
+            nSynthetic = std::strtoul(argv[i] + 12, nullptr, 0);
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--data=path] [--synthetic=N]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    std::vector<Measurements16> run;
+
+    if (! readDataRun(pData, run))
+        {
+        std::fprintf(stderr, "%s: can't read\n", pData);
+        return 1;
+        }
+
+    // synthetic frames: a mix of levels, with a spike (or a dropout)
+    // every so often, so the fences and the Hampel limits are exercised.
+    cRandom r { 1 };
+
+    for (std::size_t i = 0; i < nSynthetic; ++i)
+        {
+        Measurements16 m;
+
+        makeMeasurement(r, std::uint16_t(1 + r.uniform(400)), m);
+        if (r.uniform(20) == 0)
+            m.dust.m0p3 = 0xFFFF;
+        if (r.uniform(20) == 0)
+            m.atm.m2p5 = 0;
+        run.push_back(m);
+        }
+
+    static const std::size_t kWindows[] = { 1, 2, 3, 4, 7, 10, 16, 20, 31, 45, 60 };
+    unsigned nMismatch = 0;
+
+    for (auto nWindow : kWindows)
+        {
+        nMismatch += checkRun<cIqrMeanPolicy>(run, nWindow);
+        nMismatch += checkRun<cHampelPolicy<>>(run, nWindow);
+        }
+
+    // the cost of an update, at the longest window.
+    static cSlidingWindow<kMaxWindow> sliding;
+    auto const t0 = std::chrono::steady_clock::now();
+
+    sliding.reset(kMaxWindow);
+    for (auto const &m : run)
+        sliding.put(m);
+
+    auto const t1 = std::chrono::steady_clock::now();
+    double const ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+    std::printf("{\"frames\":%zu,\"ns_per_put\":%.1f}\n", run.size(), ns / run.size());
+    std::printf("%s\n", nMismatch == 0 ? "passed" : "FAILED");
+    return nMismatch == 0 ? 0 : 1;
+    }
@@ -0,0 +1,105 @@
+/*
+
+Module: test-sort.cpp
+
+Function:
+    Check sortWindow<N>() from Catena-PMS7003-Sort.h.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -I src extras/test-sort.cpp -o test-sort
+
+    For network sizes up to 20, every one of the 2^N vectors of zeros
+    and ones is sorted; by the 0-1 principle, that proves the network
+    sorts everything. Every size (including the std::sort() fallback)
+    is also checked against std::sort() on random data with many
+    duplicates. Exits non-zero on the first failure.
+
+*/
+
+#include <Catena-PMS7003-Sort.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+
+using namespace McciCatenaPMS7003;
+
+static bool fFailed = false;
+
+template <std::size_t N>
+static void checkZeroOne()
+    {
+    if constexpr (N <= 20)
+        {
+        std::uint16_t v[N];
+
+        for (std::uint32_t bits = 0; bits < (std::uint32_t(1) << N); ++bits)
+            {
+            for (std::size_t i = 0; i < N; ++i)
+                v[i] = (bits >> i) & 1;
+
+            sortWindow<N>(v);
+
+            if (! std::is_sorted(v, v + N))
+                {
+                std::printf("N=%zu: 0-1 vector %#x not sorted\n", N, unsigned(bits));
+                fFailed = true;
+                return;
+                }
+            }
+        }
+    }
+
+template <std::size_t N>
+static void checkRandom(std::mt19937 &rng)
+    {
+    std::uint16_t v[N];
+    std::uint16_t expect[N];
+
+    for (unsigned iTrial = 0; iTrial < 2000; ++iTrial)
+        {
+        // alternate between narrow ranges (lots of ties) and full range.
+        std::uint32_t const mask = (iTrial & 1) ? 0xFFFFu : 0x7u;
+
+        for (std::size_t i = 0; i < N; ++i)
+            expect[i] = v[i] = std::uint16_t(rng() & mask);
+
+        std::sort(expect, expect + N);
+        sortWindow<N>(v);
+
+        if (! std::equal(v, v + N, expect))
+            {
+            std::printf("N=%zu: random trial %u not sorted\n", N, iTrial);
+            fFailed = true;
+            return;
+            }
+        }
+    }
+
+template <std::size_t... I>
+static void checkAll(std::index_sequence<I...>)
+    {
+    std::mt19937 rng { 1 };
+
+    ((checkZeroOne<I + 1>(), checkRandom<I + 1>(rng)), ...);
+    }
+
+int main()
+    {
+    // one past kMaxNetworkSize and a bit more, to cover the fallback.
+    checkAll(std::make_index_sequence<kMaxNetworkSize + 8>{});
+
+    std::printf("N=10: %zu comparators\n", cSortingNetwork<10>::kSize);
+    std::printf("%s\n", fFailed ? "FAILED" : "passed");
+    return fFailed ? 1 : 0;
+    }
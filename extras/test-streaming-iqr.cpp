@@ -0,0 +1,243 @@
+/*
+
+Module: test-streaming-iqr.cpp
+
+Function:
+    Compare cStreamingIqrMean with the exact sort-based reduction.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/test-streaming-iqr.cpp -o test-streaming-iqr
+
+    Usage:
+        test-streaming-iqr [--window=N] [--data=path]
+
+    Random windows of up to cStreamingIqrMean<>::kMaxExact readings
+    are reduced both ways, and so is every channel of every 60-reading
+    window (the lora sketch's longest) of the data run (default
+    assets/data-run-1.txt). The results must be identical; the test
+    fails if any differs at all.
+
+    Then every window of --window readings (default 120) from the data
+    run and from synthetic data is reduced both ways. Up to kMaxExact
+    readings, the results must again be identical; beyond that, the
+    error is reported, along with the number of results that are off by
+    more than one count and by more than 5%.
+
+*/
+
+#include <Catena-PMS7003-Streaming.h>
+#include <pms7003-datarun.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+/****************************************************************************\
+|
+|   The reference: the sketch's original reduction, for any n
+|
+\****************************************************************************/
+
+// the lora sketch's longest window (its kMaxMeasurements).
+constexpr std::size_t kSketchWindow = 60;
+
+static float exactIqrMean(std::vector<std::uint16_t> v)
+    {
+    std::size_t const n = v.size();
+
+    std::sort(v.begin(), v.end());
+
+    std::size_t const iq1 = n / 4;
+    std::size_t const iq3 = n - n / 4 - 1;
+    std::int32_t const iqr15 = (3 * (std::int32_t(v[iq3]) - v[iq1])) >> 1;
+    std::int32_t const lowlim = std::int32_t(v[iq1]) - iqr15;
+    std::int32_t const highlim = std::int32_t(v[iq3]) + iqr15;
+    std::size_t i1, i2;
+
+    for (i1 = 0; i1 < iq1 && v[i1] < lowlim; ++i1)
+        ;
+    for (i2 = n - 1; iq3 < i2 && v[i2] > highlim; --i2)
+        ;
+
+    std::uint32_t sum = 0;
+    for (auto i = i1; i <= i2; ++i)
+        sum += v[i];
+
+    return float(sum) / float(i2 - i1 + 1);
+    }
+
+static float streamingIqrMean(const std::vector<std::uint16_t> &v)
+    {
+    cStreamingIqrMean<> s;
+    std::uint32_t sum;
+    std::uint16_t n;
+
+    s.reset();
+    for (auto x : v)
+        s.put(x);
+
+    s.getResult(sum, n);
+    return float(sum) / float(n);
+    }
+
+/****************************************************************************\
+|
+|   The checks
+|
+\****************************************************************************/
+
+struct ErrorStats
+    {
+    unsigned    nWindows = 0;
+    unsigned    nExactMismatch = 0;
+    unsigned    nFar = 0;
+    double      maxAbs = 0;
+    double      sumAbs = 0;
+    };
+
+static void check(ErrorStats &e, const std::vector<std::uint16_t> &v)
+    {
+    float const exact = exactIqrMean(v);
+    float const approx = streamingIqrMean(v);
+    double const err = std::fabs(double(approx) - exact);
+
+    ++e.nWindows;
+    e.sumAbs += err;
+    if (err > e.maxAbs)
+        e.maxAbs = err;
+    if (v.size() <= cStreamingIqrMean<>::kMaxExact && approx != exact)
+        ++e.nExactMismatch;
+    if (err > 1.0 && err > 0.05 * exact)
+        ++e.nFar;
+    }
+
+// every channel of every window of nWindow frames, stepping by nStep.
+static void checkRun(ErrorStats &e, const std::vector<Measurements16> &run, std::size_t nWindow, std::size_t nStep)
+    {
+    std::vector<std::uint16_t> v(nWindow);
+
+    for (std::size_t iBase = 0; iBase + nWindow <= run.size(); iBase += nStep)
+        {
+        auto const channel = [&](auto get)
+            {
+            for (std::size_t i = 0; i < nWindow; ++i)
+                v[i] = get(run[iBase + i]);
+            check(e, v);
+            };
+
+        channel([](const Measurements16 &m) { return m.atm.m1p0; });
+        channel([](const Measurements16 &m) { return m.atm.m2p5; });
+        channel([](const Measurements16 &m) { return m.atm.m10; });
+        channel([](const Measurements16 &m) { return m.dust.m0p3; });
+        channel([](const Measurements16 &m) { return m.dust.m0p5; });
+        channel([](const Measurements16 &m) { return m.dust.m1p0; });
+        channel([](const Measurements16 &m) { return m.dust.m2p5; });
+        channel([](const Measurements16 &m) { return m.dust.m5; });
+        channel([](const Measurements16 &m) { return m.dust.m10; });
+        }
+    }
+
+static void report(const char *pName, std::size_t nWindow, const ErrorStats &e)
+    {
+    std::printf(
+        "{\"data\":\"%s\",\"window\":%zu,\"windows\":%u,\"exact\":%s,\"far\":%u,\"max_abs_err\":%.3f,\"mean_abs_err\":%.4f}\n",
+        pName, nWindow, e.nWindows,
+        nWindow <= cStreamingIqrMean<>::kMaxExact ? (e.nExactMismatch == 0 ? "true" : "false") : "null",
+        e.nFar, e.maxAbs,
+        e.nWindows == 0 ? 0.0 : e.sumAbs / e.nWindows
+        );
+    }
+
+int main(int argc, char **argv)
+    {
+    std::size_t nWindow = 2 * kSketchWindow;
+    const char *pData = "assets/data-run-1.txt";
+    bool fFailed = false;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--window=", 9) == 0)
+            nWindow = std::strtoul(argv[i] + 9, nullptr, 0);
+        else if (std::strncmp(argv[i], "--data=", 7) == 0)
+            pData = argv[i] + 7;
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--window=N] [--data=path]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    // short random windows, with and without lots of ties.
+    cRandom r { 1 };
+    for (std::size_t n = 1; n <= cStreamingIqrMean<>::kMaxExact; ++n)
+        {
+        std::vector<std::uint16_t> v(n);
+
+        for (unsigned iTrial = 0; iTrial < 10000; ++iTrial)
+            {
+            for (auto &x : v)
+                x = std::uint16_t(r.uniform(iTrial & 1 ? 1000 : 8));
+
+            if (exactIqrMean(v) != streamingIqrMean(v))
+                {
+                std::printf("n=%zu: trial %u is not exact\n", n, iTrial);
+                fFailed = true;
+                break;
+                }
+            }
+        }
+
+    // recorded data.
+    std::vector<Measurements16> run;
+    if (! readDataRun(pData, run) || run.size() < std::max(nWindow, kSketchWindow))
+        {
+        std::printf("%s: can't read enough data\n", pData);
+        return 1;
+        }
+
+    // the sketch's window: no error at all.
+    ErrorStats sketch;
+    checkRun(sketch, run, kSketchWindow, 1);
+    report(pData, kSketchWindow, sketch);
+    if (sketch.maxAbs != 0 || sketch.nExactMismatch != 0)
+        {
+        std::printf("%s: not exact at %zu readings\n", pData, kSketchWindow);
+        fFailed = true;
+        }
+
+    ErrorStats recorded;
+    checkRun(recorded, run, nWindow, 1);
+    report(pData, nWindow, recorded);
+
+    // synthetic data, at a few levels.
+    ErrorStats synthetic;
+    for (std::uint16_t pmBase : { 5, 20, 100, 400 })
+        {
+        std::vector<Measurements16> fake(2000);
+
+        for (auto &m : fake)
+            makeMeasurement(r, pmBase, m);
+        checkRun(synthetic, fake, nWindow, nWindow);
+        }
+    report("synthetic", nWindow, synthetic);
+
+    fFailed = fFailed || recorded.nExactMismatch != 0 || synthetic.nExactMismatch != 0;
+    std::printf("%s\n", fFailed ? "FAILED" : "passed");
+    return fFailed ? 1 : 0;
+    }
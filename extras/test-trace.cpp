@@ -0,0 +1,459 @@
+/*
+
+Module: test-trace.cpp
+
+Function:
+    Check cTraceRing, and that the binary trace records format to the
+    text the library always printed.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/test-trace.cpp src/lib/cPMS7003.cpp \
+            -o test-trace
+
+    Usage:
+        test-trace [--seed=N]
+
+    First, random records go into rings of random sizes, and are read
+    out in random amounts; the ring must agree with a simple model of
+    which records it keeps and drops. Some rings are smaller than
+    kMaxTraceRecord; records that can't fit must be dropped, leaving the
+    ring intact.
+
+    Then each trace site's record, formatted by formatTrace(), must
+    match what the site printed with printf before it had a TraceId,
+    for every state, pin state and byte, and random words.
+
+    Last, the library runs twice against the same random stream of
+    frames and noise, with every trace enabled: once printing, and
+    once into a ring. The ring's records, formatted, must be exactly
+    the console text of the first run, in time order; and the second
+    run must print nothing.
+
+    Built with -DCATENA_PMS7003_DEBUG_MASK=0, the last check instead
+    requires that nothing is printed or kept at all, and that the
+    debug flags can't be set.
+
+    Exits non-zero on any mismatch.
+
+*/
+
+#include <pms7003-host.h>
+#include <Catena-PMS7003Hal-4630.h>
+#include <Catena-PMS7003-Trace.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace McciCatena;
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+Catena gCatena;
+
+static unsigned gnFailed;
+
+static void fail(const char *pWhat, unsigned long n)
+    {
+    if (gnFailed < 20)
+        std::printf("%s (%lu)\n", pWhat, n);
+    ++gnFailed;
+    }
+
+// format the records in pBuf, as the sites would have printed them.
+static std::string formatRecords(const std::uint8_t *pBuf, std::size_t nBuf, std::uint32_t *ptLast = nullptr)
+    {
+    std::string result;
+
+    for (std::size_t i = 0; i + kTraceHeaderSize <= nBuf; )
+        {
+        std::size_t const nArgs = pBuf[i + 1];
+        char text[128];
+
+        if (ptLast != nullptr)
+            {
+            std::uint32_t const t = pBuf[i + 2] | (pBuf[i + 3] << 8) | (pBuf[i + 4] << 16) | (std::uint32_t(pBuf[i + 5]) << 24);
+
+            if (t < *ptLast)
+                fail("record out of time order", t);
+            *ptLast = t;
+            }
+
+        formatTrace(text, sizeof(text), TraceId(pBuf[i]), pBuf + i + kTraceHeaderSize, nArgs);
+        result += text;
+        i += kTraceHeaderSize + nArgs;
+        }
+    return result;
+    }
+
+/****************************************************************************\
+|
+|   The ring
+|
+\****************************************************************************/
+
+static void testRing(std::uint32_t seed)
+    {
+    cRandom r { seed };
+    unsigned long nRecords = 0;
+    unsigned long nLost = 0;
+
+    for (unsigned iter = 0; iter < 2000; ++iter)
+        {
+        // now and then, a ring too small for the biggest records.
+        std::size_t const nBuf = r.uniform(8) == 0 ? 1 + r.uniform(kMaxTraceRecord - 1)
+                                                   : kMaxTraceRecord + r.uniform(4096);
+        std::vector<std::uint8_t> buf(nBuf);
+        cTraceRing ring { buf.data(), nBuf };
+        std::size_t capacity = 1;
+
+        while (capacity * 2 <= nBuf)
+            capacity *= 2;
+        if (ring.getCapacity() != capacity)
+            fail("getCapacity()", nBuf);
+
+        std::deque<std::vector<std::uint8_t>> model;
+        std::size_t nModelBytes = 0;
+        std::uint32_t nModelLost = 0;
+
+        for (unsigned step = 0; step < 200; ++step)
+            {
+            if (r.uniform(8) != 0)
+                {
+                // put a record.
+                std::uint8_t args[kMaxTraceArgs + 8];
+                std::size_t const nArgs = r.uniform(4) == 0 ? r.uniform(sizeof(args) + 1) : r.uniform(8);
+                TraceId const id = TraceId(r.uniform(std::uint32_t(TraceId::kMax)));
+                std::uint32_t const t = r.next();
+
+                for (std::size_t i = 0; i < nArgs; ++i)
+                    args[i] = std::uint8_t(r.next());
+                ring.put(id, t, args, nArgs);
+
+                std::size_t const nKept = nArgs < kMaxTraceArgs ? nArgs : kMaxTraceArgs;
+                std::vector<std::uint8_t> rec
+                    {
+                    std::uint8_t(id), std::uint8_t(nKept),
+                    std::uint8_t(t), std::uint8_t(t >> 8), std::uint8_t(t >> 16), std::uint8_t(t >> 24)
+                    };
+
+                rec.insert(rec.end(), args, args + nKept);
+                if (rec.size() > capacity)
+                    {
+                    ++nModelLost;
+                    ++nRecords;
+                    continue;
+                    }
+                while (nModelBytes + rec.size() > capacity)
+                    {
+                    nModelBytes -= model.front().size();
+                    model.pop_front();
+                    ++nModelLost;
+                    }
+                nModelBytes += rec.size();
+                model.push_back(rec);
+                ++nRecords;
+                }
+            else
+                {
+                // read some.
+                std::size_t const nRead = r.uniform(3 * kMaxTraceRecord);
+                std::vector<std::uint8_t> out(nRead + 1);
+                std::vector<std::uint8_t> expect;
+
+                while (! model.empty() && expect.size() + model.front().size() <= nRead)
+                    {
+                    expect.insert(expect.end(), model.front().begin(), model.front().end());
+                    nModelBytes -= model.front().size();
+                    model.pop_front();
+                    }
+
+                std::size_t const n = ring.read(out.data(), nRead);
+
+                if (n != expect.size() || std::memcmp(out.data(), expect.data(), n) != 0)
+                    fail("read()", iter);
+                }
+
+            if (ring.getRecords() != model.size() || ring.getBytes() != nModelBytes || ring.getLost() != nModelLost)
+                {
+                fail("ring contents", iter);
+                break;
+                }
+            }
+        nLost += nModelLost;
+        }
+
+    std::printf("{\"check\":\"ring\",\"records\":%lu,\"lost\":%lu}\n", nRecords, nLost);
+    }
+
+/****************************************************************************\
+|
+|   The formats
+|
+\****************************************************************************/
+
+static void testFormats(std::uint32_t seed)
+    {
+    static std::uint8_t sBuf[4096];
+    cTraceRing ring { sBuf, sizeof(sBuf) };
+    cPMS7003Hal_4630 hal { gCatena, 0 };
+    cRandom r { seed };
+    unsigned long nChecked = 0;
+    char expect[128];
+
+    hal.setTraceRing(&ring);
+
+    auto check = [&](const char *pWhat)
+        {
+        std::uint8_t rec[kMaxTraceRecord];
+        std::size_t const n = ring.read(rec, sizeof(rec));
+
+        if (ring.getRecords() != 0 || formatRecords(rec, n) != expect)
+            fail(pWhat, nChecked);
+        ++nChecked;
+        };
+
+    using State = cPMS7003::State;
+
+    for (unsigned s = 0; s <= unsigned(State::stFinal) + 1; ++s)
+        {
+        State const state = State(s);
+
+        hal.trace<TraceId::kPmsEnter>(state);
+        std::snprintf(expect, sizeof(expect), "cPMS7003::fsmDispatch: enter %s\n",
+                cPMS7003::getStateName(state)
+                );
+        check("kPmsEnter");
+
+        hal.trace<TraceId::kPmsUnknownState>(state, std::uint8_t(state));
+        std::snprintf(expect, sizeof(expect), "%s: unknown state %s (%u)\n",
+                "fsmDispatch", cPMS7003::getStateName(state), unsigned(state)
+                );
+        check("kPmsUnknownState");
+        }
+
+    for (unsigned i = 0; i < 1000; ++i)
+        {
+        std::uint32_t const a = i < 2 ? 0 : r.next() >> r.uniform(32);
+        std::uint32_t const b = i < 2 ? UINT32_MAX : r.next() >> r.uniform(32);
+
+        hal.trace<TraceId::kPmsRequests>(a, b);
+        std::snprintf(expect, sizeof(expect), "%s: oldRequests: 0x%x m_requests 0x%x\n",
+                "fsmDispatch", a, b
+                );
+        check("kPmsRequests");
+
+        std::uint8_t cmd[7];
+        std::size_t n = 0;
+
+        for (auto &c : cmd)
+            c = std::uint8_t(r.next());
+        hal.trace<TraceId::kPmsTx>(cmd[0], cmd[1], cmd[2], cmd[3], cmd[4], cmd[5], cmd[6]);
+        n = std::snprintf(expect, sizeof(expect), "TX:");
+        for (auto c : cmd)
+            n += std::snprintf(expect + n, sizeof(expect) - n, " %02x", c);
+        std::snprintf(expect + n, sizeof(expect) - n, "\n");
+        check("kPmsTx");
+        }
+
+    for (unsigned c = 0; c < 256; ++c)
+        {
+        hal.trace<TraceId::kPmsRxDiscard>(std::uint8_t(c));
+        std::snprintf(expect, sizeof(expect), "%02x ", c);
+        check("kPmsRxDiscard");
+        }
+
+    hal.trace<TraceId::kHalBegin>();
+    std::snprintf(expect, sizeof(expect), "hal begin\n");
+    check("kHalBegin");
+    hal.trace<TraceId::kHalEnd>();
+    std::snprintf(expect, sizeof(expect), "hal end\n");
+    check("kHalEnd");
+
+    for (unsigned f = 0; f < 2; ++f)
+        {
+        hal.trace<TraceId::kHalSet5v>(std::uint8_t(f));
+        std::snprintf(expect, sizeof(expect), "set5v: %u\n", f);
+        check("kHalSet5v");
+        }
+
+    for (auto v : { cPMS7003Hal::PinState::Zero, cPMS7003Hal::PinState::One, cPMS7003Hal::PinState::HighZ })
+        {
+        hal.trace<TraceId::kHalSetReset>(cPMS7003Hal_4630::pinStateName(v));
+        std::snprintf(expect, sizeof(expect), "setReset: %c\n", cPMS7003Hal_4630::pinStateName(v));
+        check("kHalSetReset");
+        hal.trace<TraceId::kHalSetMode>(cPMS7003Hal_4630::pinStateName(v));
+        std::snprintf(expect, sizeof(expect), "setMode: %c\n", cPMS7003Hal_4630::pinStateName(v));
+        check("kHalSetMode");
+        }
+
+    // text, which may take several records; printf() keeps at most
+    // 126 characters.
+    for (unsigned i = 0; i < 100; ++i)
+        {
+        std::uint8_t rec[4 * kMaxTraceRecord];
+        std::size_t const nText = r.uniform(sizeof(expect) - 1);
+
+        for (std::size_t j = 0; j < nText; ++j)
+            expect[j] = char(' ' + r.uniform(95));
+        expect[nText] = '\0';
+        hal.printf("%s", expect);
+
+        std::size_t const n = ring.read(rec, sizeof(rec));
+
+        if (ring.getRecords() != 0 || formatRecords(rec, n) != expect)
+            fail("kText", nText);
+        ++nChecked;
+        }
+
+    std::printf("{\"check\":\"formats\",\"cases\":%lu}\n", nChecked);
+    }
+
+/****************************************************************************\
+|
+|   The library, printing and into a ring
+|
+\****************************************************************************/
+
+static std::string gConsole;
+
+static void putConsole(const char *p)
+    {
+    gConsole += p;
+    }
+
+// run the library with every trace on; return what it printed.
+static std::string runLibrary(cPMS7003 &pms, std::uint32_t seed)
+    {
+    cRandom r { seed };
+
+    gConsole.clear();
+    gCatena.pfnConsole = putConsole;
+
+    startPms7003(pms, Serial2);
+    pms.requestPassive();
+
+    for (unsigned i = 0; i < 2000; ++i)
+        {
+        // a frame, sometimes with noise before it; and now and then,
+        // a change of mode, which sends a command.
+        Measurements16 m;
+        std::uint8_t frame[kFrameSize];
+        std::uint8_t bytes[HardwareSerial::kRxBufferSize];
+        std::size_t n = 0;
+
+        if (r.uniform(4) == 0)
+            for (std::size_t j = r.uniform(16); j > 0; --j)
+                bytes[n++] = std::uint8_t(r.next());
+
+        makeMeasurement(r, 20, m);
+        makeFrame(m, frame);
+        for (auto c : frame)
+            bytes[n++] = c;
+
+        for (std::size_t j = 0; j < n; ++j)
+            Serial2.hostRx(bytes[j]);
+        delay(n + 1);
+        pms.poll();
+
+        if (r.uniform(50) == 0)
+            {
+            if (r.uniform(2))
+                pms.requestNormal();
+            else
+                pms.requestPassive();
+            }
+        }
+
+    pms.requestOff();
+    for (unsigned i = 0; i < 20; ++i)
+        {
+        delay(100);
+        pms.poll();
+        }
+    pms.end();
+
+    gCatena.pfnConsole = nullptr;
+    return gConsole;
+    }
+
+static void testLibrary(std::uint32_t seed)
+    {
+    constexpr std::uint32_t kAll = 0x3F;
+
+    static cPMS7003Hal_4630 halPrint { gCatena, kAll };
+    static cPMS7003 pmsPrint { Serial2, halPrint };
+    std::string const text = runLibrary(pmsPrint, seed);
+
+    static std::uint8_t sBuf[1 << 20];
+    static cTraceRing ring { sBuf, sizeof(sBuf) };
+    static cPMS7003Hal_4630 halRing { gCatena, kAll };
+    static cPMS7003 pmsRing { Serial2, halRing };
+
+    halRing.setTraceRing(&ring);
+    std::string const console = runLibrary(pmsRing, seed);
+
+    std::uint32_t const nRecords = ring.getRecords();
+    std::size_t const nBytes = ring.getBytes();
+    std::vector<std::uint8_t> records(nBytes);
+    std::uint32_t tLast = 0;
+
+    if (ring.read(records.data(), records.size()) != nBytes || ring.getLost() != 0)
+        fail("reading the ring", nBytes);
+
+    std::string const decoded = formatRecords(records.data(), records.size(), &tLast);
+
+    if (! console.empty())
+        fail("printed with a ring", console.size());
+    if (decoded != text)
+        fail("decoded records differ from the text", decoded.size());
+    if (halPrint.getDebugFlags() != (kAll & kDebugMaskMax))
+        fail("debug flags beyond kDebugMaskMax", halPrint.getDebugFlags());
+    if (kDebugMaskMax == 0)
+        {
+        if (! text.empty() || nRecords != 0)
+            fail("traced with none compiled in", text.size());
+        }
+    else if (text.find("TX:") == std::string::npos || text.find("enter stPassive") == std::string::npos)
+        fail("too few traces", 0);
+
+    std::printf("{\"check\":\"library\",\"text_bytes\":%zu,\"records\":%u,\"record_bytes\":%zu}\n",
+        text.size(), unsigned(nRecords), nBytes
+        );
+    }
+
+int main(int argc, char **argv)
+    {
+    std::uint32_t seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--seed=", 7) == 0)
+            seed = std::uint32_t(std::strtoul(argv[i] + 7, nullptr, 0));
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--seed=N]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    testRing(seed);
+    testFormats(seed);
+    testLibrary(seed);
+
+    std::printf("%s\n", gnFailed == 0 ? "passed" : "FAILED");
+    return gnFailed == 0 ? 0 : 1;
+    }
@@ -0,0 +1,124 @@
+/*
+
+Module: test-uflt16-ratio.cpp
+
+Function:
+    Check that the integer uflt16 path matches the float path bit for
+    bit.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/test-uflt16-ratio.cpp -o test-uflt16-ratio
+
+    Usage:
+        test-uflt16-ratio [--max-n=N] [--samples=N]
+
+    For every count n from 1 to --max-n (default 60) and every sum from
+    0 to n * 65535 -- that is, every result a window of up to n readings
+    can have -- encodeReduceResult(sum, n) must equal the LMIC encoder
+    applied to scaleReduceResult(sum, n). --max-n=256 covers every
+    window cReductionBlock allows; that takes a few minutes.
+
+    Then --samples (default 50 million) random pairs of 32-bit operands
+    are checked against LMIC_f2uflt16(float(num) / float(den)), to
+    cover the streaming reducer's larger counts and the rounding of
+    operands that don't fit in a float.
+
+    Exits non-zero on any mismatch.
+
+*/
+
+#include <Catena_TxBuffer.h>
+#include <Catena-PMS7003-Reduce.h>
+#include <pms7003-host.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+static unsigned gnFailed;
+
+static void fail(const char *pWhat, std::uint32_t a, std::uint32_t b, std::uint16_t expect, std::uint16_t actual)
+    {
+    if (gnFailed < 20)
+        std::printf("%s(%u, %u): expected %#06x, got %#06x\n", pWhat, a, b, expect, actual);
+    ++gnFailed;
+    }
+
+int main(int argc, char **argv)
+    {
+    std::uint32_t nMax = 60;
+    unsigned long nSamples = 50000000;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--max-n=", 8) == 0)
+            nMax = std::strtoul(argv[i] + 8, nullptr, 0);
+        else if (std::strncmp(argv[i], "--samples=", 10) == 0)
+            nSamples = std::strtoul(argv[i] + 10, nullptr, 0);
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--max-n=N] [--samples=N]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    // every result of every window of up to nMax readings, and n == 0.
+    unsigned long long nChecked = 0;
+
+    if (encodeReduceResult(0, 0) != McciCatena::TxBuffer_t::f2uflt16(scaleReduceResult(0, 0)))
+        fail("encodeReduceResult", 0, 0, McciCatena::TxBuffer_t::f2uflt16(0.0f), encodeReduceResult(0, 0));
+
+    for (std::uint32_t n = 1; n <= nMax; ++n)
+        {
+        for (std::uint32_t sum = 0; sum <= n * 65535u; ++sum, ++nChecked)
+            {
+            std::uint16_t const expect = McciCatena::TxBuffer_t::f2uflt16(scaleReduceResult(sum, n));
+            std::uint16_t const actual = encodeReduceResult(sum, n);
+
+            if (actual != expect)
+                fail("encodeReduceResult", sum, n, expect, actual);
+            }
+        }
+
+    std::printf("{\"check\":\"windows\",\"max_n\":%u,\"inputs\":%llu}\n", nMax, nChecked);
+
+    // random operands, with magnitudes spread on a log scale, mostly
+    // with num < den.
+    cRandom r { 1 };
+
+    for (unsigned long i = 0; i < nSamples; ++i)
+        {
+        std::uint32_t const den = r.next() >> r.uniform(32);
+        std::uint32_t num = r.next() >> r.uniform(32);
+
+        if (den == 0 && num == 0)
+            continue;
+        if ((i & 3) != 0 && den != 0)
+            num %= den;
+        if (num == 0 && den == 0)
+            continue;
+
+        std::uint16_t const expect = McciCatena::TxBuffer_t::f2uflt16(float(num) / float(den));
+        std::uint16_t const actual = uflt16FromRatio(num, den);
+
+        if (actual != expect)
+            fail("uflt16FromRatio", num, den, expect, actual);
+        }
+
+    std::printf("{\"check\":\"random\",\"inputs\":%lu}\n", nSamples);
+    std::printf("%s\n", gnFailed == 0 ? "passed" : "FAILED");
+    return gnFailed == 0 ? 0 : 1;
+    }
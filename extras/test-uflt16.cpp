@@ -0,0 +1,219 @@
+/*
+
+Module: test-uflt16.cpp
+
+Function:
+    Check the integer uflt16 encoder and decoder against the LMIC
+    encoder and the message decoders.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/test-uflt16.cpp -o test-uflt16
+
+    Usage:
+        test-uflt16 [--all] [--samples=N]
+
+    For all 65536 codes, uflt16Decode() must give exactly the value the
+    TTN and Node-RED decoders compute, f / 4096 * 2^(b - 15); encoding
+    that value with uflt16Encode() must give what the LMIC encoder
+    gives; and every code the encoder can produce must come back
+    unchanged.
+
+    Then uflt16Encode() must equal the LMIC encoder for every float in
+    [2^-31, 1), and for --samples (default 20 million) random 32-bit
+    patterns. With --all, every one of the 2^32 patterns but the NaNs
+    is checked instead of the sample; that takes a minute or so. (The
+    LMIC encoder's result for a NaN is undefined; uflt16Encode() gives
+    0xFFFF, which is also checked.)
+
+    Exits non-zero on any mismatch; the last line before the verdict
+    gives the cost of each encoder.
+
+*/
+
+#include <Catena_TxBuffer.h>
+#include <Catena-PMS7003-Uflt16.h>
+#include <pms7003-host.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+static unsigned gnFailed;
+
+static void fail(const char *pWhat, std::uint32_t input, std::uint32_t expect, std::uint32_t actual)
+    {
+    if (gnFailed < 20)
+        std::printf("%s(%#010x): expected %#010x, got %#010x\n", pWhat, input, expect, actual);
+    ++gnFailed;
+    }
+
+static std::uint32_t floatBits(float f)
+    {
+    std::uint32_t bits;
+
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+    }
+
+static float bitsFloat(std::uint32_t bits)
+    {
+    float f;
+
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+    }
+
+static void checkEncode(std::uint32_t bits)
+    {
+    float const f = bitsFloat(bits);
+
+    if (std::isnan(f))
+        {
+        if (uflt16Encode(f) != 0xFFFF)
+            fail("uflt16Encode", bits, 0xFFFF, uflt16Encode(f));
+        return;
+        }
+
+    std::uint16_t const expect = McciCatena::TxBuffer_t::f2uflt16(f);
+    std::uint16_t const actual = uflt16Encode(f);
+
+    if (actual != expect)
+        fail("uflt16Encode", bits, expect, actual);
+    }
+
+int main(int argc, char **argv)
+    {
+    bool fAll = false;
+    unsigned long nSamples = 20000000;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strcmp(argv[i], "--all") == 0)
+            fAll = true;
+        else if (std::strncmp(argv[i], "--samples=", 10) == 0)
+            nSamples = std::strtoul(argv[i] + 10, nullptr, 0);
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--all] [--samples=N]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    // every code: decode as the JavaScript decoders do, and re-encode.
+    unsigned nCanonical = 0;
+
+    for (std::uint32_t code = 0; code <= 0xFFFF; ++code)
+        {
+        double const expectValue = (code & 0xFFF) / 4096.0 * std::pow(2.0, int(code >> 12) - 15);
+        float const value = uflt16Decode(std::uint16_t(code));
+
+        if (double(value) != expectValue)
+            fail("uflt16Decode", code, floatBits(float(expectValue)), floatBits(value));
+
+        std::uint16_t const expect = McciCatena::TxBuffer_t::f2uflt16(value);
+        std::uint16_t const actual = uflt16Encode(value);
+
+        if (actual != expect)
+            fail("uflt16Encode(uflt16Decode)", code, expect, actual);
+
+        // the encoder only produces normalized fractions, and 0xF000
+        // for zero.
+        if ((code & 0x800) != 0 || code == 0xF000)
+            {
+            ++nCanonical;
+            if (actual != code)
+                fail("round trip", code, code, actual);
+            }
+        }
+
+    std::printf("{\"check\":\"codes\",\"inputs\":65536,\"round_trip\":%u}\n", nCanonical);
+
+    // every float in [2^-31, 1), and the boundaries on either side.
+    unsigned long long nChecked = 0;
+
+    for (std::uint32_t bits = floatBits(0x1p-31f); bits < floatBits(1.0f); ++bits, ++nChecked)
+        checkEncode(bits);
+
+    static const float kEdges[] =
+        {
+        0.0f, -0.0f, 1.0f, -1.0f, 0x1p-149f, 0x1p-126f, 0x1.fffffcp-127f,
+        0x1p-16f, 0x1.fffp-17f, 0x1.fff8p-17f, 0x1.fff7fep-1f, 0x1.fff8p-1f,
+        std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN(),
+        };
+
+    for (auto f : kEdges)
+        checkEncode(floatBits(f));
+
+    std::printf("{\"check\":\"range\",\"inputs\":%llu}\n", nChecked);
+
+    // the rest of the float space.
+    if (fAll)
+        {
+        nChecked = 0;
+        for (std::uint64_t bits = 0; bits <= 0xFFFFFFFFu; ++bits, ++nChecked)
+            checkEncode(std::uint32_t(bits));
+
+        std::printf("{\"check\":\"all\",\"inputs\":%llu}\n", nChecked);
+        }
+    else
+        {
+        cRandom r { 1 };
+
+        for (unsigned long i = 0; i < nSamples; ++i)
+            checkEncode(r.next());
+
+        std::printf("{\"check\":\"random\",\"inputs\":%lu}\n", nSamples);
+        }
+
+    // the cost of each encoder, over values spread across the range.
+    static float values[4096];
+    cRandom r { 2 };
+    std::uint32_t sink = 0;
+
+    for (auto &v : values)
+        v = bitsFloat(floatBits(0x1p-20f) + r.uniform(floatBits(1.0f) - floatBits(0x1p-20f)));
+
+    constexpr unsigned kRounds = 2000;
+    auto const t0 = std::chrono::steady_clock::now();
+
+    for (unsigned k = 0; k < kRounds; ++k)
+        for (auto v : values)
+            sink += McciCatena::TxBuffer_t::f2uflt16(v);
+
+    auto const t1 = std::chrono::steady_clock::now();
+
+    for (unsigned k = 0; k < kRounds; ++k)
+        for (auto v : values)
+            sink += uflt16Encode(v);
+
+    auto const t2 = std::chrono::steady_clock::now();
+    double const n = double(kRounds) * (sizeof(values) / sizeof(values[0]));
+
+    std::printf(
+        "{\"ns_per_f2uflt16\":%.2f,\"ns_per_uflt16Encode\":%.2f,\"sink\":%u}\n",
+        std::chrono::duration<double, std::nano>(t1 - t0).count() / n,
+        std::chrono::duration<double, std::nano>(t2 - t1).count() / n,
+        sink
+        );
+
+    std::printf("%s\n", gnFailed == 0 ? "passed" : "FAILED");
+    return gnFailed == 0 ? 0 : 1;
+    }
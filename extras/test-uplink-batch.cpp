@@ -0,0 +1,361 @@
+/*
+
+Module: test-uplink-batch.cpp
+
+Function:
+    Check that cUplinkBatch packs intervals so that a decoder written
+    from the format description gets them back exactly.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Build from the top of the repo:
+
+        g++ -std=c++17 -O2 -DARDUINO_MCCI_CATENA_4630 \
+            -I extras/host -I src \
+            extras/test-uplink-batch.cpp -o test-uplink-batch
+
+    Usage:
+        test-uplink-batch [--data=path] [--trials=N] [--hex]
+
+    First, --trials (default 200000) random batches -- random lengths,
+    intervals with and without data, codes near and far from their
+    predecessors, and buffer limits that cut the batch short -- are
+    packed and decoded again. Every decoded code and age must match,
+    the decoder must use exactly the bytes the encoder wrote, and the
+    encoder must have packed as many intervals as fit.
+
+    Then the data run (default assets/data-run-1.txt) is reduced 10
+    readings at a time, as the sketch does, and the windows are packed
+    in batches of 1 to 8 six minutes apart. For each batch size, the
+    mean bytes per interval are printed, with what format 0x21 would
+    take for the same intervals (18 bytes each, plus 11 bytes of
+    housekeeping and 13 of LoRaWAN framing per uplink). With --hex, the
+    first batch of each size is printed as well.
+
+    Exits non-zero on any mismatch.
+
+*/
+
+#include <Catena-PMS7003-Batch.h>
+#include <pms7003-datarun.h>
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace McciCatenaPMS7003;
+using namespace McciCatenaHost;
+
+using Batch_t = cUplinkBatch<8>;
+
+static unsigned gnFailed;
+
+static void fail(unsigned long iTrial, const char *pWhat)
+    {
+    if (gnFailed < 20)
+        std::printf("trial %lu: %s\n", iTrial, pWhat);
+    ++gnFailed;
+    }
+
+// an interval, as decoded.
+struct Decoded
+    {
+    std::uint32_t   age;
+    bool            fValid;
+    std::uint16_t   uf[kReduceChannels];
+    };
+
+// decode field 5 of format 0x22/0x23, as the format description has it;
+// returns the number of bytes used, or 0 if the field is malformed.
+static std::size_t decodeBatch(const std::uint8_t *p, std::size_t n, std::vector<Decoded> &intervals)
+    {
+    std::size_t i = 0;
+
+    auto getVarint = [&](std::uint32_t &v) -> bool
+        {
+        v = 0;
+        for (unsigned shift = 0; i < n && shift < 32; shift += 7)
+            {
+            std::uint8_t const b = p[i++];
+
+            v |= std::uint32_t(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+            }
+        return false;
+        };
+
+    intervals.clear();
+    if (n < 5)
+        return 0;
+
+    unsigned const nIntervals = p[0];
+    std::uint8_t const validMap = p[1];
+    std::uint8_t const deltaMap = p[2];
+    std::uint32_t age = (std::uint32_t(p[3]) << 8) | p[4];
+    const std::uint16_t *pPrev = nullptr;
+
+    i = 5;
+    if (nIntervals < 1 || nIntervals > 8)
+        return 0;
+
+    intervals.resize(nIntervals);
+    for (unsigned iInterval = 0; iInterval < nIntervals; ++iInterval)
+        {
+        Decoded &d = intervals[iInterval];
+
+        if (iInterval > 0)
+            {
+            std::uint32_t delta;
+
+            if (! getVarint(delta) || delta > age)
+                return 0;
+            age -= delta;
+            }
+        d.age = age;
+        d.fValid = (validMap >> iInterval) & 1;
+
+        if (! d.fValid)
+            continue;
+
+        bool const fDelta = (deltaMap >> iInterval) & 1;
+
+        if (fDelta && pPrev == nullptr)
+            return 0;
+
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            {
+            if (! fDelta)
+                {
+                if (i + 2 > n)
+                    return 0;
+                d.uf[c] = std::uint16_t((p[i] << 8) | p[i + 1]);
+                i += 2;
+                }
+            else
+                {
+                std::uint32_t z;
+
+                if (! getVarint(z))
+                    return 0;
+
+                std::int32_t const delta = (z & 1) ? -std::int32_t((z + 1) >> 1) : std::int32_t(z >> 1);
+
+                d.uf[c] = std::uint16_t(pPrev[c] + delta);
+                }
+            }
+        pPrev = d.uf;
+        }
+
+    return i;
+    }
+
+struct Held
+    {
+    std::uint32_t   tMs;
+    bool            fValid;
+    std::uint16_t   uf[kReduceChannels];
+    };
+
+static void randomTrial(cRandom &r, unsigned long iTrial)
+    {
+    static Batch_t batch;
+    std::vector<Held> held;
+    std::uint32_t t = r.next();
+    std::size_t const nPut = 1 + r.uniform(12);
+
+    batch.reset();
+    for (std::size_t k = 0; k < nPut; ++k)
+        {
+        Held h;
+
+        // intervals from a second to an hour apart; sometimes equal.
+        t += r.uniform(8) == 0 ? 0 : 1000 + r.uniform(3600 * 1000);
+        h.tMs = t;
+        h.fValid = r.uniform(6) != 0;
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            {
+            std::uint16_t const prev = held.empty() ? std::uint16_t(r.next()) : held.back().uf[c];
+
+            switch (r.uniform(4))
+                {
+            case 0:     h.uf[c] = std::uint16_t(r.next()); break;
+            case 1:     h.uf[c] = prev; break;
+            default:    h.uf[c] = std::uint16_t(prev + r.uniform(257) - 128); break;
+                }
+            }
+
+        batch.put(h.tMs, h.uf, h.fValid);
+        held.push_back(h);
+        if (held.size() > Batch_t::kMaxIntervals)
+            held.erase(held.begin());
+        }
+
+    std::uint32_t const tNow = t + r.uniform(600 * 1000);
+    std::size_t const nBuf = r.uniform(3) == 0 ? r.uniform(120) : 256;
+    std::uint8_t buf[256];
+    std::size_t nPacked;
+    std::size_t const nBytes = batch.encode(buf, nBuf, tNow, nPacked);
+
+    if (nBytes > nBuf)
+        fail(iTrial, "overran the buffer");
+
+    if (nPacked == 0)
+        {
+        // the first interval must really not fit.
+        std::size_t const nFirst = 5 + (held[0].fValid ? 2 * kReduceChannels : 0);
+
+        if (nBytes != 0 || nFirst <= nBuf)
+            fail(iTrial, "packed nothing");
+        return;
+        }
+
+    std::vector<Decoded> decoded;
+
+    if (decodeBatch(buf, nBytes, decoded) != nBytes)
+        {
+        fail(iTrial, "decoder didn't use exactly the bytes written");
+        return;
+        }
+    if (decoded.size() != nPacked)
+        fail(iTrial, "wrong number of intervals");
+
+    for (std::size_t k = 0; k < decoded.size() && k < held.size(); ++k)
+        {
+        const Held &h = held[k];
+        const Decoded &d = decoded[k];
+        std::uint32_t const age = (tNow - h.tMs + 500) / 1000;
+
+        if (d.fValid != h.fValid)
+            fail(iTrial, "valid map differs");
+        else if (h.fValid && std::memcmp(d.uf, h.uf, sizeof(h.uf)) != 0)
+            fail(iTrial, "codes differ");
+        if (d.age != (age > 0xFFFF ? 0xFFFF : age))
+            fail(iTrial, "age differs");
+        }
+
+    // the batch must have been cut only for lack of room.
+    if (nPacked < held.size() && nBuf == sizeof(buf))
+        fail(iTrial, "batch cut short");
+    }
+
+int main(int argc, char **argv)
+    {
+    const char *pData = "assets/data-run-1.txt";
+    unsigned long nTrials = 200000;
+    bool fHex = false;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strncmp(argv[i], "--data=", 7) == 0)
+            pData = argv[i] + 7;
+        else if (std::strncmp(argv[i], "--trials=", 9) == 0)
+            nTrials = std::strtoul(argv[i] + 9, nullptr, 0);
+        else if (std::strcmp(argv[i], "--hex") == 0)
+            fHex = true;
+        else
+            {
+            std::fprintf(stderr, "usage: %s [--data=path] [--trials=N] [--hex]\n", argv[0]);
+            return 1;
+            }
+        }
+
+    cRandom r { 1 };
+
+    for (unsigned long iTrial = 0; iTrial < nTrials; ++iTrial)
+        randomTrial(r, iTrial);
+
+    std::printf("{\"check\":\"random\",\"trials\":%lu}\n", nTrials);
+
+    // the data run, a window of 10 at a time.
+    std::vector<Measurements16> run;
+
+    if (! readDataRun(pData, run))
+        {
+        std::fprintf(stderr, "%s: can't read\n", pData);
+        return 1;
+        }
+
+    static cReductionBlock<10> block;
+    std::vector<std::array<std::uint16_t, kReduceChannels>> windows(run.size() / 10);
+
+    for (std::size_t w = 0; w < windows.size(); ++w)
+        {
+        std::uint16_t uf[kReduceChannels];
+
+        block.reset();
+        for (std::size_t i = 0; i < 10; ++i)
+            block.put(i, run[w * 10 + i]);
+        block.reduceUflt16(uf);
+        std::memcpy(windows[w].data(), uf, sizeof(uf));
+        }
+
+    // housekeeping (format, flags, Vbat, Vbus, boot, T, RH) and LoRaWAN
+    // framing, per uplink.
+    constexpr std::size_t kHousekeeping = 11;
+    constexpr std::size_t kFraming = 13;
+
+    for (std::size_t nBatch = 1; nBatch <= Batch_t::kMaxIntervals; ++nBatch)
+        {
+        static Batch_t batch;
+        std::size_t nBytes = 0;
+        std::size_t nUplinks = 0;
+        std::size_t nIntervals = 0;
+
+        batch.reset();
+        for (std::size_t w = 0; w < windows.size(); ++w)
+            {
+            std::uint16_t uf[kReduceChannels];
+            std::uint32_t const tMs = std::uint32_t(w * 360 * 1000);
+
+            std::memcpy(uf, windows[w].data(), sizeof(uf));
+            batch.put(tMs, uf, true);
+
+            if (batch.getCount() < nBatch && w + 1 < windows.size())
+                continue;
+
+            std::uint8_t buf[256];
+            std::size_t nPacked;
+            std::size_t const n = batch.encode(buf, sizeof(buf), tMs, nPacked);
+            std::vector<Decoded> decoded;
+
+            if (decodeBatch(buf, n, decoded) != n || decoded.size() != nPacked)
+                fail(w, "data run batch doesn't decode");
+            for (std::size_t k = 0; k < decoded.size(); ++k)
+                if (std::memcmp(decoded[k].uf, windows[w + 1 - nPacked + k].data(), sizeof(uf)) != 0)
+                    fail(w, "data run codes differ");
+
+            if (fHex && nUplinks == 0)
+                {
+                std::printf("batch %zu:", nBatch);
+                for (std::size_t i = 0; i < n; ++i)
+                    std::printf(" %02x", buf[i]);
+                std::printf("\n");
+                }
+
+            nBytes += n;
+            nIntervals += nPacked;
+            ++nUplinks;
+            batch.drop(nPacked);
+            }
+
+        double const perInterval = double(nBytes + nUplinks * (kHousekeeping + kFraming)) / nIntervals;
+        double const single = 2 * kReduceChannels + kHousekeeping + kFraming;
+
+        std::printf(
+            "{\"batch\":%zu,\"intervals\":%zu,\"uplinks\":%zu,\"field_bytes_per_interval\":%.2f,\"bytes_per_interval\":%.2f,\"format_21_bytes_per_interval\":%.0f}\n",
+            nBatch, nIntervals, nUplinks,
+            double(nBytes) / nIntervals, perInterval, single
+            );
+        }
+
+    std::printf("%s\n", gnFailed == 0 ? "passed" : "FAILED");
+    return gnFailed == 0 ? 0 : 1;
+    }
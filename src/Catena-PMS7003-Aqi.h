@@ -0,0 +1,183 @@
+/*
+
+Module: Catena-PMS7003-Aqi.h
+
+Function:
+    cAqi: the US EPA air quality index of PM2.5 and PM10, from the
+    uflt16 codes the sketch uplinks, in integers only.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The breakpoint tables are those of extras/calculate-aqi.js, with
+    the concentrations in tenths of a µg/m^3. As there, segment i runs
+    from breakpoint i to breakpoint i + 1; concentrations below the
+    second breakpoint are in segment 0, and those above the last are
+    extrapolated from segment 5. The segment is the AQI category, from
+    0 (good) to 5 (hazardous).
+
+    A code with exponent b and fraction f is the concentration
+    f * 2^(b - 11) µg/m^3 exactly (see Catena-PMS7003-Report.h), so with
+    v = f << b, in units of 2^-11, the script's
+
+        floor(y0 + (c - x0) * (y1 - y0) / (x1 - x0) + 0.5)
+
+    is floor(((2 y0 + 1) D + 2 N) / 2 D), where D = 2048 (x1 - x0) and
+    N = (10 v - 2048 x0) (y1 - y0), with the x in tenths. That's exact,
+    and extras/test-aqi.cpp checks that the script's double arithmetic
+    gives the same for every one of the 65536 codes. As in the script,
+    the AQI isn't capped; the largest code gives more than 80000.
+
+    The same arithmetic, with v in whole tenths, gives the AQI of a
+    concentration that has been truncated to tenths, as the EPA's
+    NowCast is (see Catena-PMS7003-NowCast.h).
+
+*/
+
+#ifndef _Catena_PMS7003_Aqi_h_
+# define _Catena_PMS7003_Aqi_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatenaPMS7003 {
+
+struct AqiBreakpoint
+    {
+    std::uint16_t   c10;    // concentration, in tenths of a µg/m^3
+    std::uint16_t   aqi;
+    };
+
+class cAqi
+    {
+public:
+    static constexpr std::size_t kBreakpoints = 7;
+    static constexpr unsigned kCategories = kBreakpoints - 1;
+    using Table_t = AqiBreakpoint[kBreakpoints];
+
+    static constexpr Table_t kPm2p5 =
+        {
+        { 0, 0 }, { 121, 51 }, { 355, 101 }, { 555, 151 },
+        { 1505, 201 }, { 2505, 301 }, { 3505, 401 }
+        };
+    static constexpr Table_t kPm10 =
+        {
+        { 0, 0 }, { 550, 51 }, { 1550, 101 }, { 2550, 151 },
+        { 3550, 201 }, { 4250, 301 }, { 5050, 401 }
+        };
+
+    // the category of a concentration v, in units of 2^-shift tenths of
+    // a µg/m^3: the segment of t it falls in.
+    static constexpr unsigned getSegment(std::uint64_t v, unsigned shift, const Table_t &t)
+        {
+        unsigned i = kBreakpoints - 2;
+
+        while (i > 0 && v < std::uint64_t(t[i].c10) << shift)
+            --i;
+
+        return i;
+        }
+
+    // the AQI of a concentration v, in the same units, on table t.
+    static constexpr std::uint32_t interpolate(std::uint64_t v, unsigned shift, const Table_t &t)
+        {
+        unsigned const i = getSegment(v, shift, t);
+        std::uint64_t const dy = t[i + 1].aqi - t[i].aqi;
+        std::uint64_t const d = (std::uint64_t(t[i + 1].c10 - t[i].c10)) << shift;
+        std::uint64_t const n = (v - (std::uint64_t(t[i].c10) << shift)) * dy;
+
+        return std::uint32_t(((2 * t[i].aqi + 1) * d + 2 * n) / (2 * d));
+        }
+
+    // a code as a concentration in units of 2^-11 tenths of a µg/m^3:
+    // f * 2^(b - 11) µg/m^3 is 10 f 2^b of those.
+    static constexpr std::uint64_t getTenths11(std::uint16_t uf)
+        {
+        return std::uint64_t(uf & 0x0FFF) * 10 << (uf >> 12);
+        }
+
+    // the category and AQI of a code.
+    static constexpr unsigned getSegment(std::uint16_t uf, const Table_t &t)
+        {
+        return getSegment(getTenths11(uf), 11, t);
+        }
+    static constexpr std::uint32_t interpolate(std::uint16_t uf, const Table_t &t)
+        {
+        return interpolate(getTenths11(uf), 11, t);
+        }
+
+    static constexpr std::uint32_t getPm2p5Aqi(std::uint16_t uf)
+        {
+        return interpolate(uf, kPm2p5);
+        }
+    static constexpr std::uint32_t getPm10Aqi(std::uint16_t uf)
+        {
+        return interpolate(uf, kPm10);
+        }
+    // the AQI: the worse of the two.
+    static constexpr std::uint32_t getAqi(std::uint16_t uf2p5, std::uint16_t uf10)
+        {
+        std::uint32_t const a2p5 = getPm2p5Aqi(uf2p5);
+        std::uint32_t const a10 = getPm10Aqi(uf10);
+
+        return a2p5 > a10 ? a2p5 : a10;
+        }
+
+    // the AQI of a concentration in whole tenths of a µg/m^3, such as
+    // a NowCast (see Catena-PMS7003-NowCast.h).
+    static constexpr std::uint32_t getPm2p5AqiTenths(std::uint32_t c10)
+        {
+        return interpolate(std::uint64_t(c10), 0, kPm2p5);
+        }
+    static constexpr std::uint32_t getPm10AqiTenths(std::uint32_t c10)
+        {
+        return interpolate(std::uint64_t(c10), 0, kPm10);
+        }
+
+    static constexpr unsigned getPm2p5Category(std::uint16_t uf)
+        {
+        return getSegment(uf, kPm2p5);
+        }
+    static constexpr unsigned getPm10Category(std::uint16_t uf)
+        {
+        return getSegment(uf, kPm10);
+        }
+    // the category: the worse of the two.
+    static constexpr unsigned getCategory(std::uint16_t uf2p5, std::uint16_t uf10)
+        {
+        unsigned const c2p5 = getPm2p5Category(uf2p5);
+        unsigned const c10 = getPm10Category(uf10);
+
+        return c2p5 > c10 ? c2p5 : c10;
+        }
+
+    static constexpr const char *getCategoryName(unsigned c)
+        {
+        switch (c)
+            {
+        case 0: return "good";
+        case 1: return "moderate";
+        case 2: return "unhealthy for sensitive groups";
+        case 3: return "unhealthy";
+        case 4: return "very unhealthy";
+        case 5: return "hazardous";
+        default: return "<<unknown>>";
+            }
+        }
+    };
+
+// the values in the test vectors: 200 µg/m^3 is 0x7C80, 300 is 0x8960.
+static_assert(cAqi::getPm2p5Aqi(0x7C80) == 251, "PM2.5 AQI");
+static_assert(cAqi::getPm10Aqi(0x8960) == 174, "PM10 AQI");
+static_assert(cAqi::getPm2p5Category(0x7C80) == 4, "PM2.5 category");
+static_assert(cAqi::getPm2p5AqiTenths(2000) == 251, "PM2.5 AQI in tenths");
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_Aqi_h_
@@ -0,0 +1,273 @@
+/*
+
+Module: Catena-PMS7003-Batch.h
+
+Function:
+    cUplinkBatch: hold the results of several measurement intervals, and
+    pack them into one uplink.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Every LoRaWAN uplink costs 13 bytes of framing, a preamble, and
+    (where there's a duty-cycle limit) a wait before the next one. A
+    node that doesn't need its data at once can save most of that by
+    sending several intervals in one message.
+
+    The batch is the field 5 of port 1 formats 0x22 and 0x23 (see
+    extras/catena-message-port1-format-20.md):
+
+        uint8   number of intervals, n, from 1 to 8
+        uint8   bit i set if interval i has particle data
+        uint8   bit i set if interval i's codes are delta-coded
+        uint16  age in seconds of interval 0 (the oldest) at the uplink
+
+    then, for each interval i from 0 to n - 1:
+
+        varint  (if i > 0) the age of interval i - 1 less that of
+                interval i, in seconds
+        ...     (if it has particle data) the nine uflt16 codes, in the
+                order of format 0x21: either as nine uint16, or, if
+                delta-coded, as nine zigzag varints, each the
+                difference from the same channel's code in the previous
+                interval with data, as a signed 16-bit number.
+
+    A varint is a LEB128 unsigned number: seven bits per byte, least
+    significant first, with bit 7 set in every byte but the last. The
+    zigzag form of a signed d is 2d for d >= 0, and -2d - 1 otherwise.
+    The differences wrap around modulo 2^16, so zero (0xF000) is close
+    to the small values. The codes are exactly those format 0x21 would
+    have carried.
+
+    The 12-bit fraction of a uflt16 code is finer than the PMS7003's
+    noise, so deltas often need two bytes or more; an interval is
+    delta-coded only when that's shorter than the plain codes. The
+    batch saves most by sharing the framing and the housekeeping fields
+    among the intervals.
+
+    Ages are measured with millis(), so they're relative to the uplink;
+    the network's receive time gives the absolute time. Each age is
+    rounded to the nearest second separately, so errors don't add up.
+    Ages saturate at 65535 seconds.
+
+*/
+
+#ifndef _Catena_PMS7003_Batch_h_
+# define _Catena_PMS7003_Batch_h_
+
+#pragma once
+
+#include <Catena-PMS7003-Reduce.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace McciCatenaPMS7003 {
+
+template <std::size_t a_kMaxIntervals = 8>
+class cUplinkBatch
+    {
+public:
+    // the valid-interval map is one byte.
+    static_assert(a_kMaxIntervals >= 1 && a_kMaxIntervals <= 8, "batch must be 1 to 8 intervals");
+
+    static constexpr std::size_t kMaxIntervals = a_kMaxIntervals;
+
+    // the bytes the header of the field takes, and the most an interval
+    // can take: three for the age, and three for each code's delta.
+    static constexpr std::size_t kHeaderSize = 5;
+    static constexpr std::size_t kMaxIntervalSize = 3 + 3 * kReduceChannels;
+
+    // discard all the intervals.
+    void reset()
+        {
+        this->m_nIntervals = 0;
+        }
+
+    // add the results of an interval that ended at tMs (by millis()).
+    // fValid is false if the interval has no particle data. If the batch
+    // is full, the oldest interval is dropped to make room.
+    void put(std::uint32_t tMs, const std::uint16_t (&uf)[kReduceChannels], bool fValid)
+        {
+        if (this->m_nIntervals == kMaxIntervals)
+            this->drop(1);
+
+        Interval &i = this->m_intervals[this->m_nIntervals++];
+
+        i.tMs = tMs;
+        i.fValid = fValid;
+        std::memcpy(i.uf, uf, sizeof(i.uf));
+        }
+
+    // the number of intervals held.
+    std::size_t getCount() const
+        {
+        return this->m_nIntervals;
+        }
+
+    // the time in ms from the end of the oldest interval to tNow; zero
+    // if the batch is empty.
+    std::uint32_t getAgeMs(std::uint32_t tNow) const
+        {
+        return this->m_nIntervals == 0 ? 0 : tNow - this->m_intervals[0].tMs;
+        }
+
+    // pack as many intervals as fit in nBuf bytes, oldest first, as
+    // of tNow. Sets nIntervals to the number packed, and returns the
+    // number of bytes used; both are zero if not even one fits.
+    std::size_t encode(
+        std::uint8_t *pBuf,
+        std::size_t nBuf,
+        std::uint32_t tNow,
+        std::size_t &nIntervals
+        ) const;
+
+    // discard the oldest n intervals (once they've been sent).
+    void drop(std::size_t n)
+        {
+        if (n >= this->m_nIntervals)
+            {
+            this->m_nIntervals = 0;
+            return;
+            }
+
+        this->m_nIntervals -= n;
+        std::memmove(
+            this->m_intervals,
+            this->m_intervals + n,
+            this->m_nIntervals * sizeof(this->m_intervals[0])
+            );
+        }
+
+private:
+    struct Interval
+        {
+        std::uint32_t   tMs;
+        std::uint16_t   uf[kReduceChannels];
+        bool            fValid;
+        };
+
+    // the age of an interval in whole seconds, rounded, up to 65535.
+    static std::uint32_t ageSec(std::uint32_t tNow, std::uint32_t tMs)
+        {
+        std::uint32_t const age = (tNow - tMs + 500) / 1000;
+
+        return age > 0xFFFF ? 0xFFFF : age;
+        }
+
+    static std::uint8_t *putVarint(std::uint8_t *p, std::uint32_t v)
+        {
+        for (; v >= 0x80; v >>= 7)
+            *p++ = std::uint8_t(v | 0x80);
+        *p++ = std::uint8_t(v);
+        return p;
+        }
+
+    Interval        m_intervals[kMaxIntervals];
+    std::size_t     m_nIntervals = 0;
+    };
+
+/****************************************************************************\
+|
+|   The implementation
+|
+\****************************************************************************/
+
+template <std::size_t a_kMaxIntervals>
+std::size_t cUplinkBatch<a_kMaxIntervals>::encode(
+    std::uint8_t *pBuf,
+    std::size_t nBuf,
+    std::uint32_t tNow,
+    std::size_t &nIntervals
+    ) const
+    {
+    nIntervals = 0;
+    if (this->m_nIntervals == 0 || nBuf < kHeaderSize)
+        return 0;
+
+    std::uint8_t * const pEnd = pBuf + nBuf;
+    std::uint8_t *p = pBuf + kHeaderSize;
+    std::uint8_t validMap = 0;
+    std::uint8_t deltaMap = 0;
+    std::uint32_t prevAge = ageSec(tNow, this->m_intervals[0].tMs);
+    const std::uint16_t *pPrev = nullptr;
+
+    pBuf[3] = std::uint8_t(prevAge >> 8);
+    pBuf[4] = std::uint8_t(prevAge);
+
+    for (std::size_t iInterval = 0; iInterval < this->m_nIntervals; ++iInterval)
+        {
+        const Interval &i = this->m_intervals[iInterval];
+        std::uint8_t scratch[kMaxIntervalSize];
+        std::uint8_t *q = scratch;
+        bool fDelta = false;
+
+        if (iInterval > 0)
+            {
+            std::uint32_t const age = ageSec(tNow, i.tMs);
+
+            q = putVarint(q, prevAge > age ? prevAge - age : 0);
+            prevAge = age;
+            }
+
+        if (i.fValid)
+            {
+            std::uint8_t * const pCodes = q;
+
+            if (pPrev != nullptr)
+                {
+                for (std::size_t c = 0; c < kReduceChannels; ++c)
+                    {
+                    std::int32_t const d = std::int16_t(std::uint16_t(i.uf[c] - pPrev[c]));
+
+                    q = putVarint(q, d >= 0 ? std::uint32_t(d) << 1 : (std::uint32_t(-d) << 1) - 1);
+                    }
+
+                fDelta = std::size_t(q - pCodes) < 2 * kReduceChannels;
+                }
+
+            if (! fDelta)
+                {
+                q = pCodes;
+                for (std::size_t c = 0; c < kReduceChannels; ++c)
+                    {
+                    *q++ = std::uint8_t(i.uf[c] >> 8);
+                    *q++ = std::uint8_t(i.uf[c]);
+                    }
+                }
+            }
+
+        std::size_t const nInterval = q - scratch;
+
+        if (std::size_t(pEnd - p) < nInterval)
+            break;
+
+        std::memcpy(p, scratch, nInterval);
+        p += nInterval;
+        if (i.fValid)
+            {
+            validMap |= std::uint8_t(1u << iInterval);
+            if (fDelta)
+                deltaMap |= std::uint8_t(1u << iInterval);
+            pPrev = i.uf;
+            }
+        ++nIntervals;
+        }
+
+    if (nIntervals == 0)
+        return 0;
+
+    pBuf[0] = std::uint8_t(nIntervals);
+    pBuf[1] = validMap;
+    pBuf[2] = deltaMap;
+    return p - pBuf;
+    }
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_Batch_h_
@@ -0,0 +1,500 @@
+/*
+
+Module: Catena-PMS7003-ConsoleStream.h
+
+Function:
+    cConsoleStream: the readings of a PMS7003 as COBS-framed binary
+    records, for streaming on the console; and cConsoleStreamReader,
+    which gets them back.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Printed, a reading is about 150 characters on the console; its
+    information is 24 bytes. With streaming on, the sketches send each
+    reading as a record instead, of at most 33 bytes:
+
+        type        1 byte: a Record
+        seq         1 byte, one more than the last record's
+        time        4 bytes, little-endian: millis() when the reading's
+                    first byte arrived, or when the record was made
+        payload     by type; see below
+        crc         2 bytes, little-endian: CRC-16/CCITT-FALSE of all
+                    the bytes before it
+
+    The payloads are:
+
+        kStart          version (1 byte), then the boot count (4 bytes).
+                        Sent when streaming starts; seq starts at 0.
+        kMeasurement    flags (1 byte: kWarmedUp), then the 12 values
+                        (2 bytes each) in the order of
+                        cPMS7003::Measurements: cf1, atm, dust.
+        kRxStats        the change in each of the 5 RxStats counters (4
+                        bytes each) since the last kRxStats or kStart.
+                        Sent before a reading when the error counters
+                        have moved, and otherwise every
+                        kRxStatsIntervalMs while anything has.
+
+    Multi-byte values are little-endian. Each record is COBS-encoded, so
+    it has no zero bytes, and sent between two zero bytes. The console's
+    text never has a zero byte either, so a reader can split the stream
+    at the zeros, and a piece that doesn't decode to a record with a
+    good CRC is text (or damage). Records are whole, and text only falls
+    between them, because both are written from the same thread.
+
+*/
+
+#ifndef _Catena_PMS7003_ConsoleStream_h_
+# define _Catena_PMS7003_ConsoleStream_h_
+
+#pragma once
+
+#include <Catena-PMS7003.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatenaPMS7003 {
+
+/****************************************************************************\
+|
+|   COBS and the CRC
+|
+\****************************************************************************/
+
+// the most bytes COBS makes of n.
+constexpr std::size_t getCobsEncodedSize(std::size_t n)
+    {
+    return n + n / 254 + 1;
+    }
+
+// encode the n bytes at p in pOut, which must have room for
+// getCobsEncodedSize(n); returns the bytes written, none of them zero.
+inline std::size_t encodeCobs(const std::uint8_t *p, std::size_t n, std::uint8_t *pOut)
+    {
+    std::uint8_t *pCode = pOut;
+    std::uint8_t *q = pOut + 1;
+    std::uint8_t code = 1;
+
+    for (std::size_t i = 0; i < n; ++i)
+        {
+        if (p[i] != 0)
+            {
+            *q++ = p[i];
+            ++code;
+            }
+        if (p[i] == 0 || code == 0xFF)
+            {
+            *pCode = code;
+            pCode = q++;
+            code = 1;
+            }
+        }
+
+    // the last block has no zero after it; if the input ended with a
+    // full block of 254, this one is empty, which costs a byte but
+    // decodes the same.
+    *pCode = code;
+    return std::size_t(q - pOut);
+    }
+
+// decode the n bytes at p in pOut, of nOut bytes; returns false if
+// they aren't COBS, or don't fit.
+inline bool decodeCobs(
+    const std::uint8_t *p, std::size_t n,
+    std::uint8_t *pOut, std::size_t nOut,
+    std::size_t &nResult
+    )
+    {
+    std::size_t i = 0;
+
+    nResult = 0;
+    while (i < n)
+        {
+        std::uint8_t const code = p[i++];
+
+        if (code == 0 || i + code - 1 > n)
+            return false;
+        for (std::size_t j = 1; j < code; ++j)
+            {
+            if (p[i] == 0 || nResult == nOut)
+                return false;
+            pOut[nResult++] = p[i++];
+            }
+        if (code != 0xFF && i != n)
+            {
+            if (nResult == nOut)
+                return false;
+            pOut[nResult++] = 0;
+            }
+        }
+    return n != 0;
+    }
+
+// CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF.
+inline std::uint16_t computeStreamCrc(const std::uint8_t *p, std::size_t n)
+    {
+    std::uint16_t crc = 0xFFFF;
+
+    for (std::size_t i = 0; i < n; ++i)
+        {
+        crc ^= std::uint16_t(p[i] << 8);
+        for (unsigned iBit = 0; iBit < 8; ++iBit)
+            crc = std::uint16_t((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+        }
+    return crc;
+    }
+
+/****************************************************************************\
+|
+|   The records
+|
+\****************************************************************************/
+
+class cConsoleStream
+    {
+public:
+    using Measurements16 = cPMS7003::Measurements<std::uint16_t>;
+    using RxStats = cPMS7003::RxStats;
+
+    enum class Record : std::uint8_t
+        {
+        kStart,
+        kMeasurement,
+        kRxStats,
+
+        kMax
+        };
+
+    static constexpr std::uint8_t kVersion = 1;
+
+    // the flags of a kMeasurement.
+    static constexpr std::uint8_t kWarmedUp = 1 << 0;
+
+    static constexpr std::size_t kHeaderSize = 6;
+    static constexpr std::size_t kCrcSize = 2;
+    static constexpr std::size_t kMeasurementValues = 12;
+    static constexpr std::size_t kRxStatsValues = 5;
+
+    // the payload of each Record.
+    static constexpr std::size_t getPayloadSize(Record r)
+        {
+        return r == Record::kStart ? 1 + 4
+             : r == Record::kMeasurement ? 1 + 2 * kMeasurementValues
+             : r == Record::kRxStats ? 4 * kRxStatsValues
+             : 0;
+        }
+
+    static constexpr std::size_t kMaxRecord = kHeaderSize + 1 + 2 * kMeasurementValues + kCrcSize;
+    // a record on the wire: a zero, the record in COBS, and a zero.
+    static constexpr std::size_t kMaxFrame = 1 + getCobsEncodedSize(kMaxRecord) + 1;
+
+    static constexpr std::uint32_t kRxStatsIntervalMs = 60 * 1000;
+
+    typedef std::uint8_t Frame_t[kMaxFrame];
+
+    // start streaming, and make the kStart record in frame; returns its
+    // length. The RxStats deltas start from stats.
+    std::size_t encodeStart(Frame_t &frame, std::uint32_t tMs, std::uint32_t bootCount, const RxStats &stats)
+        {
+        this->m_fRunning = true;
+        this->m_seq = 0;
+        this->m_nRecords = 0;
+        this->m_tRxStats = tMs;
+        this->m_rxStats = stats;
+
+        std::uint8_t * const p = this->putHeader(Record::kStart, tMs);
+
+        p[0] = kVersion;
+        putUint32(p + 1, bootCount);
+        return this->finish(frame, Record::kStart);
+        }
+
+    void stop()
+        {
+        this->m_fRunning = false;
+        }
+    bool isRunning() const
+        {
+        return this->m_fRunning;
+        }
+
+    // a reading, as given to a timed callback.
+    std::size_t encodeMeasurement(Frame_t &frame, std::uint32_t tMs, const Measurements16 &m, bool fWarmedUp)
+        {
+        std::uint8_t * const p = this->putHeader(Record::kMeasurement, tMs);
+        std::uint16_t const v[kMeasurementValues] =
+            {
+            m.cf1.m1p0, m.cf1.m2p5, m.cf1.m10,
+            m.atm.m1p0, m.atm.m2p5, m.atm.m10,
+            m.dust.m0p3, m.dust.m0p5, m.dust.m1p0, m.dust.m2p5, m.dust.m5, m.dust.m10,
+            };
+
+        p[0] = fWarmedUp ? kWarmedUp : 0;
+        for (std::size_t i = 0; i < kMeasurementValues; ++i)
+            {
+            p[1 + 2 * i] = std::uint8_t(v[i]);
+            p[2 + 2 * i] = std::uint8_t(v[i] >> 8);
+            }
+        return this->finish(frame, Record::kMeasurement);
+        }
+
+    // true if a kRxStats record is due at tMs: the error counters have
+    // moved, or anything has, and the last was kRxStatsIntervalMs ago.
+    bool isRxStatsDue(std::uint32_t tMs, const RxStats &stats) const
+        {
+        RxStats const &last = this->m_rxStats;
+
+        if (stats.CharDrops != last.CharDrops ||
+            stats.MsgDrops != last.MsgDrops ||
+            stats.BadChecksum != last.BadChecksum)
+            return true;
+
+        return (stats.CharIn != last.CharIn || stats.GoodMsg != last.GoodMsg) &&
+               tMs - this->m_tRxStats >= kRxStatsIntervalMs;
+        }
+
+    // the change in stats since the last kRxStats or kStart.
+    std::size_t encodeRxStats(Frame_t &frame, std::uint32_t tMs, const RxStats &stats)
+        {
+        std::uint8_t * const p = this->putHeader(Record::kRxStats, tMs);
+        RxStats const &last = this->m_rxStats;
+
+        putUint32(p + 0, stats.CharIn - last.CharIn);
+        putUint32(p + 4, stats.CharDrops - last.CharDrops);
+        putUint32(p + 8, stats.MsgDrops - last.MsgDrops);
+        putUint32(p + 12, stats.BadChecksum - last.BadChecksum);
+        putUint32(p + 16, stats.GoodMsg - last.GoodMsg);
+
+        this->m_rxStats = stats;
+        this->m_tRxStats = tMs;
+        return this->finish(frame, Record::kRxStats);
+        }
+
+    // the records made since encodeStart().
+    std::uint32_t getRecords() const
+        {
+        return this->m_nRecords;
+        }
+
+    static void putUint32(std::uint8_t *p, std::uint32_t v)
+        {
+        for (unsigned i = 0; i < 4; ++i, v >>= 8)
+            p[i] = std::uint8_t(v);
+        }
+    static std::uint32_t getUint32(const std::uint8_t *p)
+        {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (std::uint32_t(p[3]) << 24);
+        }
+
+private:
+    // fill in the header of a record of type r; returns its payload.
+    std::uint8_t *putHeader(Record r, std::uint32_t tMs)
+        {
+        this->m_record[0] = std::uint8_t(r);
+        this->m_record[1] = this->m_seq;
+        putUint32(this->m_record + 2, tMs);
+        return this->m_record + kHeaderSize;
+        }
+
+    // add the CRC, and frame the record.
+    std::size_t finish(Frame_t &frame, Record r)
+        {
+        std::size_t const n = kHeaderSize + getPayloadSize(r);
+        std::uint16_t const crc = computeStreamCrc(this->m_record, n);
+
+        this->m_record[n] = std::uint8_t(crc);
+        this->m_record[n + 1] = std::uint8_t(crc >> 8);
+
+        std::size_t const nCobs = encodeCobs(this->m_record, n + kCrcSize, frame + 1);
+
+        frame[0] = 0;
+        frame[1 + nCobs] = 0;
+        ++this->m_seq;
+        ++this->m_nRecords;
+        return nCobs + 2;
+        }
+
+    std::uint8_t    m_record[kMaxRecord];
+    RxStats         m_rxStats {};
+    std::uint32_t   m_tRxStats = 0;
+    std::uint32_t   m_nRecords = 0;
+    std::uint8_t    m_seq = 0;
+    bool            m_fRunning = false;
+    };
+
+/****************************************************************************\
+|
+|   The reader
+|
+\****************************************************************************/
+
+class cConsoleStreamReader
+    {
+public:
+    using Record = cConsoleStream::Record;
+
+    // the most bytes kept between zeros: longer pieces are text, and
+    // only their start is kept.
+    static constexpr std::size_t kMaxPiece = 256;
+
+    // a record, decoded.
+    struct Result
+        {
+        Record          type;
+        std::uint8_t    seq;
+        std::uint32_t   tMs;
+        // kStart
+        std::uint8_t    version;
+        std::uint32_t   bootCount;
+        // kMeasurement
+        bool            fWarmedUp;
+        cConsoleStream::Measurements16 m;
+        // kRxStats
+        cConsoleStream::RxStats rxStats;
+        };
+
+    // take the next byte of the stream; true when it ends a record,
+    // which getResult() then gives. Anything else between zeros is
+    // counted as text.
+    bool put(std::uint8_t c)
+        {
+        if (c != 0)
+            {
+            if (this->m_nPiece < kMaxPiece)
+                this->m_piece[this->m_nPiece] = c;
+            ++this->m_nPiece;
+            return false;
+            }
+
+        std::size_t const nPiece = this->m_nPiece;
+
+        this->m_nPiece = 0;
+        if (nPiece == 0)
+            return false;
+        if (nPiece <= kMaxPiece && this->decode(nPiece))
+            return true;
+
+        this->keepText(nPiece);
+        this->m_nTextBytes += nPiece;
+        ++this->m_nTextPieces;
+        return false;
+        }
+
+    const Result &getResult() const
+        {
+        return this->m_result;
+        }
+
+    // the bytes of the last piece that wasn't a record, as far as they
+    // were kept.
+    const std::uint8_t *getText(std::size_t &n) const
+        {
+        n = this->m_nText;
+        return this->m_text;
+        }
+
+    std::uint32_t getRecords() const { return this->m_nRecords; }
+    // records missing, by their sequence numbers.
+    std::uint32_t getLost() const { return this->m_nLost; }
+    std::uint64_t getTextBytes() const { return this->m_nTextBytes; }
+    std::uint32_t getTextPieces() const { return this->m_nTextPieces; }
+
+private:
+    bool decode(std::size_t nPiece)
+        {
+        using Stream = cConsoleStream;
+
+        std::uint8_t rec[Stream::kMaxRecord];
+        std::size_t n;
+
+        if (! decodeCobs(this->m_piece, nPiece, rec, sizeof(rec), n) ||
+            n < Stream::kHeaderSize + Stream::kCrcSize ||
+            rec[0] >= std::uint8_t(Record::kMax) ||
+            n != Stream::kHeaderSize + Stream::getPayloadSize(Record(rec[0])) + Stream::kCrcSize ||
+            computeStreamCrc(rec, n - 2) != (rec[n - 2] | (rec[n - 1] << 8)))
+            {
+            return false;
+            }
+
+        Result &r = this->m_result;
+        const std::uint8_t * const p = rec + Stream::kHeaderSize;
+
+        r.type = Record(rec[0]);
+        r.seq = rec[1];
+        r.tMs = Stream::getUint32(rec + 2);
+
+        if (r.type == Record::kStart)
+            {
+            r.version = p[0];
+            r.bootCount = Stream::getUint32(p + 1);
+            }
+        else
+            {
+            if (this->m_fSeq)
+                this->m_nLost += std::uint8_t(r.seq - this->m_seqNext);
+            }
+        this->m_fSeq = true;
+        this->m_seqNext = std::uint8_t(r.seq + 1);
+
+        if (r.type == Record::kMeasurement)
+            {
+            std::uint16_t v[Stream::kMeasurementValues];
+
+            for (std::size_t i = 0; i < Stream::kMeasurementValues; ++i)
+                v[i] = std::uint16_t(p[1 + 2 * i] | (p[2 + 2 * i] << 8));
+
+            r.fWarmedUp = (p[0] & Stream::kWarmedUp) != 0;
+            r.m.cf1.m1p0 = v[0];
+            r.m.cf1.m2p5 = v[1];
+            r.m.cf1.m10 = v[2];
+            r.m.atm.m1p0 = v[3];
+            r.m.atm.m2p5 = v[4];
+            r.m.atm.m10 = v[5];
+            r.m.dust.m0p3 = v[6];
+            r.m.dust.m0p5 = v[7];
+            r.m.dust.m1p0 = v[8];
+            r.m.dust.m2p5 = v[9];
+            r.m.dust.m5 = v[10];
+            r.m.dust.m10 = v[11];
+            }
+        else if (r.type == Record::kRxStats)
+            {
+            r.rxStats.CharIn = Stream::getUint32(p + 0);
+            r.rxStats.CharDrops = Stream::getUint32(p + 4);
+            r.rxStats.MsgDrops = Stream::getUint32(p + 8);
+            r.rxStats.BadChecksum = Stream::getUint32(p + 12);
+            r.rxStats.GoodMsg = Stream::getUint32(p + 16);
+            }
+
+        ++this->m_nRecords;
+        return true;
+        }
+
+    void keepText(std::size_t nPiece)
+        {
+        this->m_nText = nPiece < kMaxPiece ? nPiece : kMaxPiece;
+        for (std::size_t i = 0; i < this->m_nText; ++i)
+            this->m_text[i] = this->m_piece[i];
+        }
+
+    std::uint8_t    m_piece[kMaxPiece];
+    std::size_t     m_nPiece = 0;
+    std::uint8_t    m_text[kMaxPiece];
+    std::size_t     m_nText = 0;
+    Result          m_result {};
+    std::uint32_t   m_nRecords = 0;
+    std::uint32_t   m_nLost = 0;
+    std::uint64_t   m_nTextBytes = 0;
+    std::uint32_t   m_nTextPieces = 0;
+    std::uint8_t    m_seqNext = 0;
+    bool            m_fSeq = false;
+    };
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_ConsoleStream_h_
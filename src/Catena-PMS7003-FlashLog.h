@@ -0,0 +1,423 @@
+/*
+
+Module: Catena-PMS7003-FlashLog.h
+
+Function:
+    cFlashLog: a log of measurement intervals in SPI NOR flash, kept
+    until they've been sent.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The log is a ring of fixed-size records in a region of the flash,
+    written in order of sequence number. Record seq always lives in
+    slot seq mod kRecords, so finding a record by sequence number is a
+    single read; the number of records is a power of two so that this
+    holds across the wrap of the 32-bit sequence number.
+
+    Records are only ever appended. When the next record starts a new
+    sector, that sector is erased first, dropping the oldest
+    kRecordsPerSector records; so every sector is erased once per trip
+    around the ring, and the wear is spread evenly over the region.
+    Marking a record sent clears a bit in its state byte, which NOR
+    flash allows without an erase.
+
+    Each record is 32 bytes:
+
+        uint8   state: 0xFF erased, 0xFE written, 0xFC sent
+        uint8   bit 0 set if the interval has particle data
+        uint8   boot count, modulo 256
+        uint8   0xFF, reserved
+        uint32  sequence number
+        uint32  millis() at the end of the interval
+        uint16  the nine uflt16 codes, in the order of format 0x21
+        uint16  CRC-16/CCITT of bytes 1 to 29
+
+    Multi-byte fields are little-endian. The state byte is programmed
+    after the rest, so a record torn by a reset is either blank-looking
+    (and skipped) or fails its CRC; either way it's ignored.
+
+    begin() reads the whole region once to find the newest record and
+    the oldest one not yet sent. After that, each operation touches
+    one record, except for the erase at the start of a sector.
+
+    The flash driver (a_Flash) needs read(addr, p, n), program(addr,
+    p, n) and eraseSector(addr), as Catena_Mx25v8035f has. The caller
+    powers the flash up and down around calls.
+
+*/
+
+#ifndef _Catena_PMS7003_FlashLog_h_
+# define _Catena_PMS7003_FlashLog_h_
+
+#pragma once
+
+#include <Catena-PMS7003-Reduce.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace McciCatenaPMS7003 {
+
+template <
+    typename a_Flash,
+    std::uint32_t a_kBase,
+    std::uint32_t a_kSectors,
+    std::uint32_t a_kSectorSize = 4096
+    >
+class cFlashLog
+    {
+public:
+    using Flash_t = a_Flash;
+
+    static constexpr std::uint32_t kRecordSize = 32;
+    static constexpr std::uint32_t kRecordsPerSector = a_kSectorSize / kRecordSize;
+    static constexpr std::uint32_t kRecords = kRecordsPerSector * a_kSectors;
+
+    static_assert(a_kSectors >= 2, "the log needs at least two sectors");
+    static_assert(a_kSectorSize % kRecordSize == 0, "records must tile the sector");
+    static_assert((kRecords & (kRecords - 1)) == 0, "the number of records must be a power of two");
+    static_assert(a_kBase % a_kSectorSize == 0, "the log must start on a sector");
+
+    // an interval, as held in the log.
+    struct Record
+        {
+        std::uint32_t   seq;
+        std::uint32_t   tMs;
+        std::uint8_t    boot;
+        bool            fValid;
+        bool            fSent;
+        std::uint16_t   uf[kReduceChannels];
+        };
+
+    // find the newest record and the oldest unsent one.
+    void begin(Flash_t &flash);
+
+    bool isRunning() const
+        {
+        return this->m_pFlash != nullptr;
+        }
+
+    // add an interval that ended at tMs (by millis()), with its
+    // particle data if fValid. Sets seq to the sequence number used,
+    // even if writing fails (in which case it returns false). If the
+    // ring is full, the oldest records are dropped, sent or not.
+    bool append(
+        std::uint32_t tMs,
+        std::uint8_t boot,
+        const std::uint16_t (&uf)[kReduceChannels],
+        bool fValid,
+        std::uint32_t &seq
+        );
+
+    // get record seq; false if it's not in the log.
+    bool read(std::uint32_t seq, Record &r) const;
+
+    // note that record seq got to the network.
+    bool markSent(std::uint32_t seq);
+
+    // find the oldest record not yet sent with a sequence number below
+    // seqLimit; false if there isn't one.
+    bool findUnsent(std::uint32_t seqLimit, std::uint32_t &seq);
+
+    // the sequence number the next record will get.
+    std::uint32_t getNextSeq() const
+        {
+        return this->m_seqNext;
+        }
+
+    // the number of records not yet sent.
+    std::uint32_t getUnsentCount() const
+        {
+        return this->m_nUnsent;
+        }
+
+    // the number of unsent records dropped to make room.
+    std::uint32_t getLostCount() const
+        {
+        return this->m_nLost;
+        }
+
+private:
+    static constexpr std::uint8_t kStateErased = 0xFF;
+    static constexpr std::uint8_t kStateWritten = 0xFE;
+    static constexpr std::uint8_t kStateSent = 0xFC;
+
+    static constexpr std::uint32_t kCrcOffset = kRecordSize - 2;
+
+    static std::uint32_t slotAddr(std::uint32_t seq)
+        {
+        return a_kBase + (seq & (kRecords - 1)) * kRecordSize;
+        }
+
+    // true if a is later than b, allowing for wrap.
+    static bool after(std::uint32_t a, std::uint32_t b)
+        {
+        return std::int32_t(a - b) > 0;
+        }
+
+    static std::uint16_t crc16(const std::uint8_t *p, std::size_t n)
+        {
+        std::uint16_t crc = 0xFFFF;
+
+        while (n-- != 0)
+            {
+            crc ^= std::uint16_t(*p++) << 8;
+            for (unsigned i = 0; i < 8; ++i)
+                crc = (crc & 0x8000) ? std::uint16_t((crc << 1) ^ 0x1021) : std::uint16_t(crc << 1);
+            }
+        return crc;
+        }
+
+    static std::uint32_t get32(const std::uint8_t *p)
+        {
+        return p[0] | (std::uint32_t(p[1]) << 8) | (std::uint32_t(p[2]) << 16) | (std::uint32_t(p[3]) << 24);
+        }
+
+    static void put32(std::uint8_t *p, std::uint32_t v)
+        {
+        p[0] = std::uint8_t(v);
+        p[1] = std::uint8_t(v >> 8);
+        p[2] = std::uint8_t(v >> 16);
+        p[3] = std::uint8_t(v >> 24);
+        }
+
+    // decode the record in a slot, whatever its sequence number.
+    bool decodeSlot(const std::uint8_t (&buf)[kRecordSize], std::uint32_t slot, Record &r) const;
+
+    // make room for a record in the slot for seq.
+    void prepareSlot(std::uint32_t seq);
+
+    Flash_t *       m_pFlash = nullptr;
+    std::uint32_t   m_seqNext = 0;
+    std::uint32_t   m_seqUnsent = 0;
+    std::uint32_t   m_nUnsent = 0;
+    std::uint32_t   m_nLost = 0;
+    };
+
+/****************************************************************************\
+|
+|   The implementation
+|
+\****************************************************************************/
+
+template <typename a_Flash, std::uint32_t a_kBase, std::uint32_t a_kSectors, std::uint32_t a_kSectorSize>
+bool cFlashLog<a_Flash, a_kBase, a_kSectors, a_kSectorSize>::decodeSlot(
+    const std::uint8_t (&buf)[kRecordSize],
+    std::uint32_t slot,
+    Record &r
+    ) const
+    {
+    if ((buf[0] & 1) != 0)
+        return false;
+    if (crc16(buf + 1, kCrcOffset - 1) != (buf[kCrcOffset] | (buf[kCrcOffset + 1] << 8)))
+        return false;
+
+    r.seq = get32(buf + 4);
+    if ((r.seq & (kRecords - 1)) != slot)
+        return false;
+
+    r.fSent = (buf[0] & 2) == 0;
+    r.fValid = (buf[1] & 1) != 0;
+    r.boot = buf[2];
+    r.tMs = get32(buf + 8);
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        r.uf[c] = std::uint16_t(buf[12 + 2 * c] | (buf[13 + 2 * c] << 8));
+    return true;
+    }
+
+template <typename a_Flash, std::uint32_t a_kBase, std::uint32_t a_kSectors, std::uint32_t a_kSectorSize>
+void cFlashLog<a_Flash, a_kBase, a_kSectors, a_kSectorSize>::begin(Flash_t &flash)
+    {
+    bool fAny = false;
+    bool fAnyUnsent = false;
+    std::uint32_t seqNewest = 0;
+    std::uint32_t seqOldestUnsent = 0;
+
+    this->m_pFlash = &flash;
+    this->m_nUnsent = 0;
+    this->m_nLost = 0;
+
+    for (std::uint32_t slot = 0; slot < kRecords; ++slot)
+        {
+        std::uint8_t buf[kRecordSize];
+        Record r;
+
+        flash.read(a_kBase + slot * kRecordSize, buf, sizeof(buf));
+        if (! this->decodeSlot(buf, slot, r))
+            continue;
+
+        if (! fAny || after(r.seq, seqNewest))
+            seqNewest = r.seq;
+        fAny = true;
+
+        if (! r.fSent)
+            {
+            if (! fAnyUnsent || after(seqOldestUnsent, r.seq))
+                seqOldestUnsent = r.seq;
+            fAnyUnsent = true;
+            ++this->m_nUnsent;
+            }
+        }
+
+    this->m_seqNext = fAny ? seqNewest + 1 : 0;
+    this->m_seqUnsent = fAnyUnsent ? seqOldestUnsent : this->m_seqNext;
+    }
+
+template <typename a_Flash, std::uint32_t a_kBase, std::uint32_t a_kSectors, std::uint32_t a_kSectorSize>
+void cFlashLog<a_Flash, a_kBase, a_kSectors, a_kSectorSize>::prepareSlot(std::uint32_t seq)
+    {
+    std::uint32_t const slot = seq & (kRecords - 1);
+
+    if (slot % kRecordsPerSector != 0)
+        return;
+
+    // count the unsent records we're about to lose.
+    for (std::uint32_t i = 0; i < kRecordsPerSector; ++i)
+        {
+        std::uint8_t buf[kRecordSize];
+        Record r;
+
+        this->m_pFlash->read(slotAddr(seq + i), buf, sizeof(buf));
+        if (this->decodeSlot(buf, slot + i, r) && ! r.fSent)
+            {
+            --this->m_nUnsent;
+            ++this->m_nLost;
+            }
+        }
+
+    this->m_pFlash->eraseSector(slotAddr(seq));
+    }
+
+template <typename a_Flash, std::uint32_t a_kBase, std::uint32_t a_kSectors, std::uint32_t a_kSectorSize>
+bool cFlashLog<a_Flash, a_kBase, a_kSectors, a_kSectorSize>::append(
+    std::uint32_t tMs,
+    std::uint8_t boot,
+    const std::uint16_t (&uf)[kReduceChannels],
+    bool fValid,
+    std::uint32_t &seq
+    )
+    {
+    std::uint8_t buf[kRecordSize];
+
+    // skip slots spoiled by a torn write; the next sector is erased
+    // before use, so this ends there at the latest.
+    for (;;)
+        {
+        seq = this->m_seqNext++;
+        if (this->m_pFlash == nullptr)
+            return false;
+
+        this->prepareSlot(seq);
+        this->m_pFlash->read(slotAddr(seq), buf, sizeof(buf));
+
+        bool fBlank = true;
+        for (auto b : buf)
+            fBlank = fBlank && b == 0xFF;
+        if (fBlank)
+            break;
+        }
+
+    buf[0] = kStateWritten;
+    buf[1] = fValid ? 0xFF : 0xFE;
+    buf[2] = boot;
+    buf[3] = 0xFF;
+    put32(buf + 4, seq);
+    put32(buf + 8, tMs);
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        {
+        buf[12 + 2 * c] = std::uint8_t(uf[c]);
+        buf[13 + 2 * c] = std::uint8_t(uf[c] >> 8);
+        }
+
+    std::uint16_t const crc = crc16(buf + 1, kCrcOffset - 1);
+
+    buf[kCrcOffset] = std::uint8_t(crc);
+    buf[kCrcOffset + 1] = std::uint8_t(crc >> 8);
+
+    // the body first, then the state byte that makes it valid.
+    this->m_pFlash->program(slotAddr(seq) + 1, buf + 1, kRecordSize - 1);
+    this->m_pFlash->program(slotAddr(seq), buf, 1);
+
+    Record r;
+
+    if (! this->read(seq, r))
+        return false;
+
+    ++this->m_nUnsent;
+    return true;
+    }
+
+template <typename a_Flash, std::uint32_t a_kBase, std::uint32_t a_kSectors, std::uint32_t a_kSectorSize>
+bool cFlashLog<a_Flash, a_kBase, a_kSectors, a_kSectorSize>::read(std::uint32_t seq, Record &r) const
+    {
+    if (this->m_pFlash == nullptr)
+        return false;
+
+    // only the last kRecords sequence numbers can be present.
+    if (! after(this->m_seqNext, seq) || this->m_seqNext - seq > kRecords)
+        return false;
+
+    std::uint8_t buf[kRecordSize];
+
+    this->m_pFlash->read(slotAddr(seq), buf, sizeof(buf));
+    return this->decodeSlot(buf, seq & (kRecords - 1), r) && r.seq == seq;
+    }
+
+template <typename a_Flash, std::uint32_t a_kBase, std::uint32_t a_kSectors, std::uint32_t a_kSectorSize>
+bool cFlashLog<a_Flash, a_kBase, a_kSectors, a_kSectorSize>::markSent(std::uint32_t seq)
+    {
+    Record r;
+
+    if (! this->read(seq, r))
+        return false;
+    if (r.fSent)
+        return true;
+
+    std::uint8_t const state = kStateSent;
+
+    this->m_pFlash->program(slotAddr(seq), &state, 1);
+    --this->m_nUnsent;
+    return true;
+    }
+
+template <typename a_Flash, std::uint32_t a_kBase, std::uint32_t a_kSectors, std::uint32_t a_kSectorSize>
+bool cFlashLog<a_Flash, a_kBase, a_kSectors, a_kSectorSize>::findUnsent(
+    std::uint32_t seqLimit,
+    std::uint32_t &seq
+    )
+    {
+    if (this->m_nUnsent == 0)
+        {
+        this->m_seqUnsent = this->m_seqNext;
+        return false;
+        }
+
+    // anything older than the ring is gone.
+    if (this->m_seqNext - this->m_seqUnsent > kRecords)
+        this->m_seqUnsent = this->m_seqNext - kRecords;
+
+    // step over records sent (or lost) since we last looked; they
+    // needn't be looked at again.
+    for (; after(seqLimit, this->m_seqUnsent); ++this->m_seqUnsent)
+        {
+        Record r;
+
+        if (this->read(this->m_seqUnsent, r) && ! r.fSent)
+            {
+            seq = this->m_seqUnsent;
+            return true;
+            }
+        }
+
+    return false;
+    }
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_FlashLog_h_
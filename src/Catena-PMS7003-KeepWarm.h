@@ -0,0 +1,248 @@
+/*
+
+Module: Catena-PMS7003-KeepWarm.h
+
+Function:
+    cKeepWarmPolicy: choose how deeply to put the PMS7003 to sleep
+    between measurement cycles.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Between cycles, the sensor can be powered off (requestOff()), held
+    asleep by its SET pin (requestHwSleep()), or told to sleep by
+    command (requestSleep()). Powered off, it costs nothing until the
+    next cycle, but then it has to be powered on and reset before it
+    sends its first frame. Asleep, its 5V rail stays up and it draws a
+    little current all the while, but it wakes sooner. During recovery,
+    the fan runs and the MCU waits, so every second of recovery costs
+    far more than a second of sleep.
+
+    For an idle interval of T ms until the next cycle, the charge for
+    each depth d is
+
+        idle[d] * T + recover * recovery[d]
+
+    in µA ms, where idle[d] is the battery current in depth d,
+    recover the battery current while the sensor recovers, and
+    recovery[d] the time from the wake to the first frame. The warmup
+    that follows takes the same frames whatever the depth, so it's left
+    out: it adds the same to every cost.
+    choose() picks the depth that costs least. The currents are a
+    Model, set with setModel(); the defaults are the datasheet values
+    the energy model (extras/pms7003-energy-model.cpp) uses.
+
+    The recovery times start at the datasheet values, and then follow
+    the measured ones: the first measurement replaces the default, and
+    each later one moves the estimate a quarter of the way. The sketch
+    measures one each cycle, for the depth it used.
+
+    Everything is in integers; a day of sleep at 1 mA is about 2^36
+    µA ms, so the products fit.
+
+*/
+
+#ifndef _Catena_PMS7003_KeepWarm_h_
+# define _Catena_PMS7003_KeepWarm_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatenaPMS7003 {
+
+class cKeepWarmPolicy
+    {
+public:
+    // how the sensor waits for the next cycle. On a tie, choose()
+    // prefers power-off, then the SET pin, which needs no UART.
+    enum class Depth : std::uint8_t
+        {
+        Off,        // 5V off; power-on and reset to wake
+        HwSleep,    // SET pin low
+        SwSleep,    // sleep command
+        };
+    static constexpr std::size_t kDepths = 3;
+
+    static constexpr const char *getDepthName(Depth d)
+        {
+        switch (d)
+            {
+        case Depth::Off: return "off";
+        case Depth::HwSleep: return "hwsleep";
+        case Depth::SwSleep: return "swsleep";
+        default: return "<<unknown>>";
+            }
+        }
+
+    // the currents, at the battery, in µA.
+    struct Model
+        {
+        std::uint32_t   idleUa[kDepths];    // between cycles, in each depth
+        std::uint32_t   recoverUa;          // sensor recovering, MCU waiting
+        };
+
+    // the energy model's defaults: 0.2 mA at 5V asleep, 100 mA at 5V
+    // with the fan running, both through an 85% boost from 3.9 V; and
+    // 6 mA for the MCU.
+    static constexpr Model kDefaultModel =
+        {
+        { 0, 302, 302 },
+        150830 + 6000
+        };
+
+    // the recovery times, in ms, until measured: power-on (6 s) and
+    // reset, or wake (3 s), then the first frame.
+    static constexpr std::uint32_t kDefaultRecoveryMs[kDepths] =
+        {
+        6000 + 10 + 1000,
+        3000 + 1000,
+        3000 + 1000,
+        };
+
+    // the depths choose() may pick: a bit for each.
+    static constexpr std::uint8_t kAllDepths = (1u << kDepths) - 1;
+
+    cKeepWarmPolicy()
+        {
+        this->reset();
+        }
+
+    // forget the measurements, and allow every depth.
+    void reset()
+        {
+        for (std::size_t d = 0; d < kDepths; ++d)
+            {
+            this->m_recoveryMs[d] = kDefaultRecoveryMs[d];
+            this->m_nChosen[d] = 0;
+            }
+        this->m_fMeasured = 0;
+        this->m_allowed = kAllDepths;
+        }
+
+    void setModel(const Model &model)
+        {
+        this->m_model = model;
+        }
+    const Model &getModel() const
+        {
+        return this->m_model;
+        }
+
+    // limit choose() to the depths in mask; with one bit, that depth
+    // is always used. With none, power-off is.
+    void setAllowed(std::uint8_t mask)
+        {
+        mask &= kAllDepths;
+        this->m_allowed = mask != 0 ? mask : 1u;
+        }
+    std::uint8_t getAllowed() const
+        {
+        return this->m_allowed;
+        }
+
+    // a measured recovery time for depth d.
+    void putRecovery(Depth d, std::uint32_t ms)
+        {
+        std::size_t const i = std::size_t(d);
+        std::uint8_t const bit = std::uint8_t(1u << i);
+
+        if ((this->m_fMeasured & bit) == 0)
+            this->m_recoveryMs[i] = ms;
+        else
+            this->m_recoveryMs[i] = std::uint32_t(
+                    std::int64_t(this->m_recoveryMs[i]) + (std::int64_t(ms) - std::int64_t(this->m_recoveryMs[i])) / 4
+                    );
+        this->m_fMeasured |= bit;
+        }
+    std::uint32_t getRecoveryMs(Depth d) const
+        {
+        return this->m_recoveryMs[std::size_t(d)];
+        }
+    bool isMeasured(Depth d) const
+        {
+        return ((this->m_fMeasured >> std::size_t(d)) & 1) != 0;
+        }
+
+    // the charge, in µA ms, of waiting idleMs in depth d and then
+    // recovering.
+    std::uint64_t getCost(Depth d, std::uint32_t idleMs) const
+        {
+        std::size_t const i = std::size_t(d);
+
+        return std::uint64_t(this->m_model.idleUa[i]) * idleMs +
+               std::uint64_t(this->m_model.recoverUa) * this->m_recoveryMs[i];
+        }
+
+    // the cheapest depth for idleMs until the next cycle, counted.
+    Depth choose(std::uint32_t idleMs)
+        {
+        Depth const d = this->getCheapest(idleMs);
+
+        ++this->m_nChosen[std::size_t(d)];
+        return d;
+        }
+    Depth getCheapest(std::uint32_t idleMs) const
+        {
+        Depth best = Depth::Off;
+        std::uint64_t bestCost = UINT64_MAX;
+
+        for (std::size_t i = 0; i < kDepths; ++i)
+            {
+            Depth const d = Depth(i);
+            std::uint64_t const cost = this->getCost(d, idleMs);
+
+            if (((this->m_allowed >> i) & 1) != 0 && cost < bestCost)
+                {
+                best = d;
+                bestCost = cost;
+                }
+            }
+        return best;
+        }
+
+    // the longest idle interval, in ms, for which depth d is cheaper
+    // than power-off; 0 if it never is, and UINT32_MAX if it always is
+    // (or for longer than that).
+    std::uint32_t getBreakEvenMs(Depth d) const
+        {
+        std::size_t const i = std::size_t(d);
+        std::uint32_t const offMs = this->m_recoveryMs[std::size_t(Depth::Off)];
+        std::uint32_t const idleUa = this->m_model.idleUa[i];
+        std::uint32_t const idleOffUa = this->m_model.idleUa[std::size_t(Depth::Off)];
+
+        if (this->m_recoveryMs[i] >= offMs)
+            return 0;
+
+        std::uint64_t const saved = std::uint64_t(this->m_model.recoverUa) * (offMs - this->m_recoveryMs[i]);
+
+        if (idleUa <= idleOffUa)
+            return UINT32_MAX;
+
+        std::uint64_t const t = (saved - 1) / (idleUa - idleOffUa);
+
+        return t < UINT32_MAX ? std::uint32_t(t) : UINT32_MAX;
+        }
+
+    // how many times choose() has picked depth d.
+    std::uint32_t getChosenCount(Depth d) const
+        {
+        return this->m_nChosen[std::size_t(d)];
+        }
+
+private:
+    Model           m_model = kDefaultModel;
+    std::uint32_t   m_recoveryMs[kDepths];
+    std::uint32_t   m_nChosen[kDepths];
+    std::uint8_t    m_fMeasured;
+    std::uint8_t    m_allowed;
+    };
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_KeepWarm_h_
@@ -0,0 +1,322 @@
+/*
+
+Module: Catena-PMS7003-NowCast.h
+
+Function:
+    cNowCast: the US EPA NowCast of PM2.5 and PM10, kept up to date
+    hour by hour from the measurement intervals.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The NowCast is a weighted average of the last 12 hourly averages,
+    c1 (the most recent complete hour) to c12:
+
+        w* = min(c) / max(c); w = max(w*, 1/2)
+        NowCast = sum(w^(i-1) ci) / sum(w^(i-1))
+
+    where the sums and the min and max are over the hours that have
+    data. There's no NowCast unless at least two of c1, c2 and c3 have
+    data. For reporting, the PM2.5 NowCast is truncated to 0.1 µg/m^3
+    and the PM10 NowCast to 1 µg/m^3, and the AQI is computed from the
+    truncated value.
+
+    The intervals are fed in as the uflt16 codes the sketch uplinks,
+    with the time (by millis()) at which each ended. Each interval
+    goes to the hour it ended in; hours run from the first interval,
+    or from start(). An hour with fewer than getMinSamples() intervals
+    (one, by default) has no data. Times must not go backwards; a gap
+    of 12 hours or more just leaves the ring with no data.
+
+    The ring holds the 12 hourly averages of each pollutant; nothing
+    else is kept from closed hours. Closing an hour costs one pass over
+    the ring, which is at most 12 steps however long the history, and
+    a gap of n hours costs at most 12 more; the NowCast is computed
+    then and kept, so reading it costs nothing. Everything is in
+    integers, rounded at each step, so a host job over decoded uplinks
+    gets exactly what the node gets: the averages and the NowCast are
+    in units of 2^-15 µg/m^3, and the weight w in units of 2^-24. The
+    truncated NowCast agrees with the same formula in doubles except
+    within about 10^-4 µg/m^3 of a boundary (extras/test-nowcast.cpp).
+
+*/
+
+#ifndef _Catena_PMS7003_NowCast_h_
+# define _Catena_PMS7003_NowCast_h_
+
+#pragma once
+
+#include <Catena-PMS7003-Aqi.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace McciCatenaPMS7003 {
+
+class cNowCast
+    {
+public:
+    static constexpr std::size_t kHours = 12;
+    static constexpr std::uint32_t kHourMs = 60 * 60 * 1000;
+
+    // the averages and the NowCast are in units of 2^-kFracBits µg/m^3.
+    static constexpr unsigned kFracBits = 15;
+    // the weight is in units of 2^-kWeightBits.
+    static constexpr unsigned kWeightBits = 24;
+    // the weighted sums carry this many more bits than the averages.
+    static constexpr unsigned kGuardBits = 4;
+
+    enum Lane : std::uint8_t
+        {
+        kPm2p5,
+        kPm10,
+
+        kLanes
+        };
+
+    cNowCast()
+        {
+        this->reset();
+        }
+
+    // forget everything; the next interval starts the first hour.
+    void reset()
+        {
+        this->m_fStarted = false;
+        this->m_iNewest = 0;
+        this->m_valid = 0;
+        this->m_fNowCast = 0;
+        std::memset(this->m_avg, 0, sizeof(this->m_avg));
+        std::memset(this->m_nowCast, 0, sizeof(this->m_nowCast));
+        this->clearHour();
+        }
+
+    // forget everything, and start the first hour at tMs: for example,
+    // on the hour by the wall clock.
+    void start(std::uint32_t tMs)
+        {
+        this->reset();
+        this->m_tHourStart = tMs;
+        this->m_fStarted = true;
+        }
+
+    // the fewest intervals an hour needs to count, from 1.
+    void setMinSamples(std::uint16_t n)
+        {
+        this->m_minSamples = n != 0 ? n : 1;
+        }
+    std::uint16_t getMinSamples() const
+        {
+        return this->m_minSamples;
+        }
+
+    // close the hours that have ended by tMs, and return how many.
+    std::uint32_t advance(std::uint32_t tMs)
+        {
+        if (! this->m_fStarted)
+            return 0;
+
+        std::uint32_t const nHours = (tMs - this->m_tHourStart) / kHourMs;
+
+        if (nHours == 0)
+            return 0;
+
+        // the hour being filled, then the empty ones (as many as can
+        // still be in the ring).
+        this->closeHour(this->m_count >= this->m_minSamples);
+        for (std::uint32_t i = 1; i < nHours && i < kHours; ++i)
+            this->closeHour(false);
+
+        this->m_tHourStart += nHours * kHourMs;
+        this->update();
+        return nHours;
+        }
+
+    // add an interval that ended at tMs, given the codes of its PM2.5
+    // and PM10 results. Returns the number of hours closed first.
+    std::uint32_t put(std::uint16_t uf2p5, std::uint16_t uf10, std::uint32_t tMs)
+        {
+        if (! this->m_fStarted)
+            this->start(tMs);
+
+        std::uint32_t const nHours = this->advance(tMs);
+
+        if (this->m_count != 0xFFFF)
+            {
+            this->m_sum[kPm2p5] += getRawValue(uf2p5);
+            this->m_sum[kPm10] += getRawValue(uf10);
+            ++this->m_count;
+            }
+        return nHours;
+        }
+
+    // the start of the hour being filled.
+    std::uint32_t getHourStart() const
+        {
+        return this->m_tHourStart;
+        }
+
+    // the average of the hour that closed age hours ago, from 0 to 11;
+    // false if it has no data.
+    bool getHourlyAverage(Lane lane, std::size_t age, std::uint32_t &avg) const
+        {
+        std::size_t const i = (this->m_iNewest + kHours - age) % kHours;
+
+        avg = this->m_avg[lane][i];
+        return age < kHours && ((this->m_valid >> i) & 1) != 0;
+        }
+
+    // the NowCast as of the last hour closed, untruncated; false if
+    // there isn't one.
+    bool getNowCast(Lane lane, std::uint32_t &v) const
+        {
+        v = this->m_nowCast[lane];
+        return ((this->m_fNowCast >> lane) & 1) != 0;
+        }
+
+    // the NowCast truncated for reporting, in tenths of a µg/m^3.
+    bool getConcentration(Lane lane, std::uint32_t &c10) const
+        {
+        std::uint32_t v;
+        bool const fResult = this->getNowCast(lane, v);
+
+        if (lane == kPm2p5)
+            c10 = std::uint32_t((std::uint64_t(v) * 10) >> kFracBits);
+        else
+            c10 = (v >> kFracBits) * 10;
+        return fResult;
+        }
+
+    // the AQI of the truncated NowCast.
+    bool getAqi(Lane lane, std::uint32_t &aqi) const
+        {
+        std::uint32_t c10;
+        bool const fResult = this->getConcentration(lane, c10);
+
+        aqi = lane == kPm2p5 ? cAqi::getPm2p5AqiTenths(c10) : cAqi::getPm10AqiTenths(c10);
+        return fResult;
+        }
+
+    // the NowCast AQI: the worse of the pollutants that have one.
+    bool getAqi(std::uint32_t &aqi) const
+        {
+        std::uint32_t a2p5, a10;
+        bool const f2p5 = this->getAqi(kPm2p5, a2p5);
+        bool const f10 = this->getAqi(kPm10, a10);
+
+        aqi = ! f10 || (f2p5 && a2p5 > a10) ? a2p5 : a10;
+        return f2p5 || f10;
+        }
+
+    // the value of a uflt16 code, in units of 2^-11 µg/m^3, exactly.
+    static std::uint32_t getRawValue(std::uint16_t uf)
+        {
+        return std::uint32_t(uf & 0x0FFF) << (uf >> 12);
+        }
+
+private:
+    void clearHour()
+        {
+        this->m_sum[kPm2p5] = 0;
+        this->m_sum[kPm10] = 0;
+        this->m_count = 0;
+        }
+
+    // move the ring on by an hour, with the hour being filled.
+    void closeHour(bool fValid)
+        {
+        std::uint16_t const bit = std::uint16_t(1u << ((this->m_iNewest + 1) % kHours));
+
+        this->m_iNewest = std::uint8_t((this->m_iNewest + 1) % kHours);
+        for (std::size_t lane = 0; lane < kLanes; ++lane)
+            {
+            this->m_avg[lane][this->m_iNewest] = fValid
+                ? std::uint32_t(((this->m_sum[lane] << (kFracBits - 11)) + this->m_count / 2) / this->m_count)
+                : 0;
+            }
+        this->m_valid = fValid ? (this->m_valid | bit) : (this->m_valid & ~bit);
+        this->clearHour();
+        }
+
+    // compute the NowCast of each lane from the ring.
+    void update()
+        {
+        auto const isValid = [this](std::size_t age) -> bool
+            {
+            return ((this->m_valid >> ((this->m_iNewest + kHours - age) % kHours)) & 1) != 0;
+            };
+
+        this->m_fNowCast = 0;
+        if (int(isValid(0)) + int(isValid(1)) + int(isValid(2)) < 2)
+            return;
+
+        for (std::size_t lane = 0; lane < kLanes; ++lane)
+            {
+            std::uint32_t const *const pAvg = this->m_avg[lane];
+            std::uint32_t cMin = UINT32_MAX;
+            std::uint32_t cMax = 0;
+
+            for (std::size_t i = 0; i < kHours; ++i)
+                {
+                if ((this->m_valid >> i) & 1)
+                    {
+                    cMin = pAvg[i] < cMin ? pAvg[i] : cMin;
+                    cMax = pAvg[i] > cMax ? pAvg[i] : cMax;
+                    }
+                }
+
+            // the weight, then the sums by Horner's rule, oldest hour
+            // first, rounding each step. num carries kGuardBits more
+            // than the averages; it's at most 12 * 2^35 before it's
+            // weighted, so num * w fits.
+            constexpr std::uint64_t kOne = std::uint64_t(1) << kWeightBits;
+            constexpr std::uint64_t kHalf = kOne / 2;
+            std::uint64_t w = cMax == 0 ? kOne : (std::uint64_t(cMin) << kWeightBits) / cMax;
+            std::uint64_t num = 0;
+            std::uint64_t den = 0;
+
+            if (w < kOne / 2)
+                w = kOne / 2;
+
+            for (std::size_t age = kHours; age-- > 0;)
+                {
+                std::size_t const i = (this->m_iNewest + kHours - age) % kHours;
+                bool const fValid = ((this->m_valid >> i) & 1) != 0;
+
+                num = ((num * w + kHalf) >> kWeightBits) + (fValid ? std::uint64_t(pAvg[i]) << kGuardBits : 0);
+                den = ((den * w + kHalf) >> kWeightBits) + (fValid ? kOne : 0);
+                }
+
+            std::uint64_t const d = den << kGuardBits;
+
+            this->m_nowCast[lane] = std::uint32_t(((num << kWeightBits) + d / 2) / d);
+            this->m_fNowCast |= std::uint8_t(1u << lane);
+            }
+        }
+
+    // the hour being filled.
+    std::uint64_t   m_sum[kLanes];
+    std::uint32_t   m_tHourStart = 0;
+    std::uint16_t   m_count;
+    std::uint16_t   m_minSamples = 1;
+
+    // the closed hours: m_iNewest is the last one closed; bit i of
+    // m_valid is set if slot i has data.
+    std::uint32_t   m_avg[kLanes][kHours];
+    std::uint16_t   m_valid;
+    std::uint8_t    m_iNewest;
+    bool            m_fStarted;
+
+    // the NowCast of each lane, and a bit for each lane that has one.
+    std::uint32_t   m_nowCast[kLanes];
+    std::uint8_t    m_fNowCast;
+    };
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_NowCast_h_
@@ -0,0 +1,334 @@
+/*
+
+Module: Catena-PMS7003-Port1.h
+
+Function:
+    cPort1Message: the layout of port 1 formats 0x20 to 0x23, as one
+    constexpr table, with the encoder and decoder it drives.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Each value in the message is a row of kSchema: the bitmap bit (the
+    field) that says it's there, how it goes on the wire, and how to
+    get from the wire to the value the decoders report. A value is
+    wire * mul / div, where wire is the integer sent (for uflt16, the
+    number in [0, 1) that the code stands for). The rows are in the
+    order the values are sent. See extras/catena-message-port1-format-20.md.
+
+    Some values aren't in every format: pressure is only in the formats
+    with bit 0 clear (0x20 and 0x22), and the particle data of fields 5
+    to 7 only in those with bit 1 clear (0x20 and 0x21; the batched
+    formats carry their own fields 5 and 6, which follow the ones
+    encoded here). formatMask says which bits of the format byte must
+    be clear.
+
+    The sketches, the test vector generator and the host decoders all
+    use the table, so they can't disagree. encode() has no
+    data-dependent branches: every value is written at the output
+    pointer, which then moves on by the value's width if the value is
+    present, and by zero if not. The bytes written for absent values
+    land in the space the later values (or the end of the buffer)
+    take, so the buffer needs only kMaxSize bytes.
+
+    Values are rounded to the nearest wire value (halves up), and
+    clamped to the range of the wire type. getValue() does the
+    arithmetic in the same order as the JavaScript decoders, so it
+    gets the same double.
+
+*/
+
+#ifndef _Catena_PMS7003_Port1_h_
+# define _Catena_PMS7003_Port1_h_
+
+#pragma once
+
+#include <Catena-PMS7003-Uflt16.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace McciCatenaPMS7003 {
+
+// how a value goes on the wire.
+enum class Port1Codec : std::uint8_t
+    {
+    Uint8,      // one byte
+    Int16,      // two bytes, big-endian, two's complement
+    Uint16,     // two bytes, big-endian
+    Uflt16,     // two bytes, big-endian; see Catena-PMS7003-Uflt16.h
+    };
+
+// one value in the message.
+struct Port1Value
+    {
+    std::uint8_t    field;      // the bitmap bit
+    Port1Codec      codec;
+    std::uint8_t    formatMask; // bits of the format byte that must be clear
+    std::uint32_t   mul;        // value = wire * mul / div
+    std::uint32_t   div;
+    const char *    pGroup;     // the decoders' name: pGroup.pName, or
+    const char *    pName;      //   pName if pGroup is nullptr
+    };
+
+// the number of bytes a codec puts on the wire.
+constexpr std::size_t getPort1Width(Port1Codec codec)
+    {
+    return codec == Port1Codec::Uint8 ? 1 : 2;
+    }
+
+// the bytes a message takes with every value of schema present, with
+// the format byte and the bitmap.
+template <std::size_t N>
+constexpr std::size_t getPort1Size(const Port1Value (&schema)[N])
+    {
+    std::size_t n = 2;
+
+    for (std::size_t i = 0; i < N; ++i)
+        n += getPort1Width(schema[i].codec);
+    return n;
+    }
+
+class cPort1Message
+    {
+public:
+    // the values, in the order they're sent.
+    enum Slot : std::uint8_t
+        {
+        kVbat,
+        kVsys,
+        kVbus,
+        kBoot,
+        kTempC,
+        kP,
+        kRh,
+        kPm1p0,
+        kPm2p5,
+        kPm10,
+        kDust0p3,
+        kDust0p5,
+        kDust1p0,
+        kDust2p5,
+        kDust5,
+        kDust10,
+        kAqi,
+
+        kSlots
+        };
+
+    static constexpr Port1Value kSchema[kSlots] =
+        {
+        { 0, Port1Codec::Int16,  0,    1,  4096, nullptr, "vBat" },
+        { 1, Port1Codec::Int16,  0,    1,  4096, nullptr, "vSys" },
+        { 2, Port1Codec::Int16,  0,    1,  4096, nullptr, "vBus" },
+        { 3, Port1Codec::Uint8,  0,    1,  1,    nullptr, "boot" },
+        { 4, Port1Codec::Int16,  0,    1,  256,  nullptr, "tempC" },
+        { 4, Port1Codec::Uint16, 0x01, 1,  25,   nullptr, "p" },
+        { 4, Port1Codec::Uint16, 0,    100, 65535, nullptr, "rh" },
+        { 5, Port1Codec::Uflt16, 0x02, 65536, 1, "pm",    "1.0" },
+        { 5, Port1Codec::Uflt16, 0x02, 65536, 1, "pm",    "2.5" },
+        { 5, Port1Codec::Uflt16, 0x02, 65536, 1, "pm",    "10" },
+        { 6, Port1Codec::Uflt16, 0x02, 65536, 1, "dust",  "0.3" },
+        { 6, Port1Codec::Uflt16, 0x02, 65536, 1, "dust",  "0.5" },
+        { 6, Port1Codec::Uflt16, 0x02, 65536, 1, "dust",  "1.0" },
+        { 6, Port1Codec::Uflt16, 0x02, 65536, 1, "dust",  "2.5" },
+        { 6, Port1Codec::Uflt16, 0x02, 65536, 1, "dust",  "5" },
+        { 6, Port1Codec::Uflt16, 0x02, 65536, 1, "dust",  "10" },
+        { 7, Port1Codec::Uint16, 0x02, 1,  1,    nullptr, "aqi" },
+        };
+
+    // the fields, by bitmap bit, as the test vector files name them.
+    static constexpr std::size_t kFields = 8;
+    static constexpr const char *kFieldKeys[kFields] =
+        { "Vbat", "Vsys", "Vbus", "Boot", "Env", "Pm", "Dust", "Aqi" };
+
+    static constexpr std::size_t getWidth(Port1Codec codec)
+        {
+        return getPort1Width(codec);
+        }
+
+    // the format byte, the bitmap, and every value.
+    static constexpr std::size_t kMaxSize = getPort1Size(kSchema);
+
+    cPort1Message()
+        {
+        this->reset(0x20);
+        }
+    explicit cPort1Message(std::uint8_t format)
+        {
+        this->reset(format);
+        }
+
+    // start again, with no values.
+    void reset(std::uint8_t format)
+        {
+        this->m_format = format;
+        this->m_flags = 0;
+        std::memset(this->m_wire, 0, sizeof(this->m_wire));
+        }
+
+    std::uint8_t getFormat() const
+        {
+        return this->m_format;
+        }
+    // change the format, keeping the values: for example, once it's
+    // known whether values gathered earlier go out in a batch.
+    void setFormat(std::uint8_t format)
+        {
+        this->m_format = format;
+        }
+    std::uint8_t getFlags() const
+        {
+        return this->m_flags;
+        }
+
+    // true if the format carries value s, and its field is present.
+    bool isPresent(std::size_t s) const
+        {
+        return ((this->m_flags >> kSchema[s].field) & 1) != 0 &&
+               (this->m_format & kSchema[s].formatMask) == 0;
+        }
+
+    // set value s from a number in the value's units, with the codec
+    // chosen at compile time. Setting a value marks its field present,
+    // so set all the values of a field.
+    template <Slot s>
+    void set(float v)
+        {
+        this->setCode(s, encodeValue<kSchema[s].codec>(v * float(kSchema[s].div) / float(kSchema[s].mul)));
+        }
+
+    // the same, with the codec chosen at run time.
+    void set(std::size_t s, float v)
+        {
+        float const x = v * float(kSchema[s].div) / float(kSchema[s].mul);
+        std::uint16_t code;
+
+        switch (kSchema[s].codec)
+            {
+        case Port1Codec::Uint8:     code = encodeValue<Port1Codec::Uint8>(x); break;
+        case Port1Codec::Int16:     code = encodeValue<Port1Codec::Int16>(x); break;
+        case Port1Codec::Uint16:    code = encodeValue<Port1Codec::Uint16>(x); break;
+        default:                    code = encodeValue<Port1Codec::Uflt16>(x); break;
+            }
+        this->setCode(s, code);
+        }
+
+    // set the wire value of s directly: for example, a uflt16 code that
+    // has already been computed.
+    void setCode(std::size_t s, std::uint16_t code)
+        {
+        this->m_wire[s] = code;
+        this->m_flags |= std::uint8_t(1u << kSchema[s].field);
+        }
+    std::uint16_t getCode(std::size_t s) const
+        {
+        return this->m_wire[s];
+        }
+
+    // the value of s, as the decoders compute it.
+    double getValue(std::size_t s) const
+        {
+        Port1Value const &v = kSchema[s];
+        std::uint16_t const w = this->m_wire[s];
+        double x;
+
+        switch (v.codec)
+            {
+        case Port1Codec::Int16:     x = double(std::int16_t(w)); break;
+        case Port1Codec::Uflt16:    x = double(uflt16Decode(w)); break;
+        default:                    x = double(w); break;
+            }
+
+        return x * double(v.mul) / double(v.div);
+        }
+
+    // write the message to pBuf, which must have room for kMaxSize
+    // bytes; returns the number of bytes used.
+    std::size_t encode(std::uint8_t *pBuf) const
+        {
+        std::uint8_t *p = pBuf + 2;
+
+        pBuf[0] = this->m_format;
+        pBuf[1] = this->m_flags;
+        for (std::size_t s = 0; s < kSlots; ++s)
+            {
+            std::size_t const n = getWidth(kSchema[s].codec);
+            std::uint16_t const w = this->m_wire[s];
+
+            p[0] = std::uint8_t(w >> (8 * (n - 1)));
+            p[n - 1] = std::uint8_t(w);
+            p += n & (std::size_t(0) - std::size_t(this->isPresent(s)));
+            }
+
+        return p - pBuf;
+        }
+
+    // read a message of nBuf bytes at pBuf. Returns the number of bytes
+    // used, or 0 if the format is unknown or the message is too short.
+    // In the batched formats, fields 5 and 6 start there.
+    std::size_t decode(const std::uint8_t *pBuf, std::size_t nBuf)
+        {
+        if (nBuf < 2 || (pBuf[0] & 0xFC) != 0x20)
+            return 0;
+
+        this->reset(pBuf[0]);
+        this->m_flags = pBuf[1];
+
+        std::size_t i = 2;
+
+        for (std::size_t s = 0; s < kSlots; ++s)
+            {
+            if (! this->isPresent(s))
+                continue;
+
+            std::size_t const n = getWidth(kSchema[s].codec);
+
+            if (nBuf - i < n)
+                return 0;
+
+            this->m_wire[s] = n == 1 ? pBuf[i] : std::uint16_t((pBuf[i] << 8) | pBuf[i + 1]);
+            i += n;
+            }
+
+        return i;
+        }
+
+    // round x to the nearest wire value, and clamp it to the codec's
+    // range.
+    template <Port1Codec codec>
+    static std::uint16_t encodeValue(float x)
+        {
+        if (codec == Port1Codec::Uflt16)
+            return uflt16Encode(x);
+        else
+            {
+            constexpr float kMin = codec == Port1Codec::Int16 ? -32768.0f : 0.0f;
+            constexpr float kMax = codec == Port1Codec::Int16 ? 32767.0f
+                                 : codec == Port1Codec::Uint16 ? 65535.0f
+                                 : 255.0f;
+            float const r = std::floor(x + 0.5f);
+
+            if (! (r >= kMin))
+                return std::uint16_t(std::int32_t(kMin));
+            if (r > kMax)
+                return std::uint16_t(std::int32_t(kMax));
+            return std::uint16_t(std::int32_t(r));
+            }
+        }
+
+private:
+    std::uint8_t    m_format;
+    std::uint8_t    m_flags;
+    std::uint16_t   m_wire[kSlots];
+    };
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_Port1_h_
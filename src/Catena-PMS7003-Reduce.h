@@ -0,0 +1,595 @@
+/*
+
+Module: Catena-PMS7003-Reduce.h
+
+Function:
+    cReductionBlock and cReductionWindow: reduce a window of PMS7003
+    measurements to one estimate per channel (by default, the
+    IQR-filtered mean), all channels at once.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The window is stored as a structure of arrays: one row per reading,
+    one lane per channel (the three atmospheric PM values, then the six
+    dust counts). Every step of the reduction -- the sorting network,
+    the quartiles and fences, and the filtered sums -- works on whole
+    rows, so all nine channels go through it in lockstep, with no
+    data-dependent branches.
+
+    On hosts with SSE2 or NEON, a row is a pair of 8-lane GCC vectors,
+    and each step compiles to a few SIMD instructions. Elsewhere (for
+    example, the Cortex-M0+ in the Catena 4630) a row is nine uint16_t,
+    and each step is unrolled across the lanes at compile time.
+
+    The results are the same as the sketch's original per-channel
+    reduction, bit for bit.
+
+    The estimator is a policy (see Catena-PMS7003-ReducePolicy.h). The
+    default, cIqrMeanPolicy, runs in lockstep as above; for any other
+    policy, the rows are still sorted in lockstep, and then the policy
+    is applied to each channel in turn.
+
+    cReductionBlock<N> holds exactly N readings, and its sorting network
+    is unrolled for that N. cReductionWindow<kMax> holds however many
+    readings were put, up to kMax, in storage sized for kMax. It sorts
+    with the smallest power-of-two network that covers them, run from
+    its table, skipping the comparators beyond the readings it has.
+    That lets a sketch choose its window length at run time without a
+    heap, and with a handful of comparator tables rather than a network
+    for every length.
+
+*/
+
+#ifndef _Catena_PMS7003_Reduce_h_
+# define _Catena_PMS7003_Reduce_h_
+
+#pragma once
+
+#include <Catena-PMS7003.h>
+#include <Catena-PMS7003-ReducePolicy.h>
+#include <Catena-PMS7003-Sort.h>
+#include <Catena-PMS7003-Uflt16.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// define as 0 on the command line to use the portable code on a host.
+#ifndef CATENA_PMS7003_REDUCE_SIMD
+# if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+#  define CATENA_PMS7003_REDUCE_SIMD 1
+# else
+#  define CATENA_PMS7003_REDUCE_SIMD 0
+# endif
+#endif
+
+namespace McciCatenaPMS7003 {
+
+/****************************************************************************\
+|
+|   The channels
+|
+\****************************************************************************/
+
+// the number of channels the lora sketches reduce.
+static constexpr std::size_t kReduceChannels = 9;
+
+// the channels of m, in lane order.
+inline void getReduceChannels(
+    const cPMS7003::Measurements<std::uint16_t> &m,
+    std::uint16_t (&v)[kReduceChannels]
+    )
+    {
+    v[0] = m.atm.m1p0;
+    v[1] = m.atm.m2p5;
+    v[2] = m.atm.m10;
+    v[3] = m.dust.m0p3;
+    v[4] = m.dust.m0p5;
+    v[5] = m.dust.m1p0;
+    v[6] = m.dust.m2p5;
+    v[7] = m.dust.m5;
+    v[8] = m.dust.m10;
+    }
+
+// store the channels of r from v, in lane order. r.cf1 is not changed.
+inline void setReduceChannels(
+    cPMS7003::Measurements<float> &r,
+    const float (&v)[kReduceChannels]
+    )
+    {
+    r.atm.m1p0 = v[0];
+    r.atm.m2p5 = v[1];
+    r.atm.m10 = v[2];
+    r.dust.m0p3 = v[3];
+    r.dust.m0p5 = v[4];
+    r.dust.m1p0 = v[5];
+    r.dust.m2p5 = v[6];
+    r.dust.m5 = v[7];
+    r.dust.m10 = v[8];
+    }
+
+// the sketch scales each mean by 1/65535 so it can be encoded as uflt16.
+inline float scaleReduceResult(std::uint32_t sum, std::uint32_t n)
+    {
+    // divide by n * 65535.0
+    float const div = n * 65535.0f;
+
+    return n == 0 ? 0.0f : sum / div;
+    }
+
+// the uflt16 encoding of scaleReduceResult(sum, n), as the sketch
+// uplinks it, without floating point. See Catena-PMS7003-Uflt16.h.
+inline std::uint16_t encodeReduceResult(std::uint32_t sum, std::uint32_t n)
+    {
+    return n == 0 ? uflt16FromRatio(0, 1) : uflt16FromRatio(sum, n * 65535u);
+    }
+
+/****************************************************************************\
+|
+|   The rows
+|
+\****************************************************************************/
+
+// the storage and the lockstep steps shared by cReductionBlock and
+// cReductionWindow; a_kRows is the most readings the storage holds.
+template <std::size_t a_kRows>
+class cReductionRows
+    {
+public:
+    static_assert(a_kRows >= 1, "window can't be empty");
+
+    static constexpr std::size_t kRows = a_kRows;
+
+#if CATENA_PMS7003_REDUCE_SIMD
+    // a row: one reading of every channel, padded to two 128-bit
+    // vectors. (Wider GCC vectors would be split by the compiler, but
+    // it falls back to scalar code for their comparisons.) Readings are
+    // stored biased by -32768, because SSE2 has signed 16-bit min/max,
+    // but not unsigned.
+    typedef std::int16_t Lanes __attribute__((vector_size(16)));
+    typedef std::uint16_t ULanes __attribute__((vector_size(16)));
+    static constexpr std::size_t kLanesPerVector = sizeof(Lanes) / sizeof(std::int16_t);
+    static constexpr std::size_t kVectors = 2;
+    static constexpr std::size_t kLanes = kVectors * kLanesPerVector;
+    static constexpr std::uint16_t kBias = 0x8000;
+
+    struct Row
+        {
+        Lanes   v[kVectors];
+        };
+
+    // the sums are accumulated in 16 bits, a byte at a time.
+    static_assert(a_kRows <= 256, "window too long for 16-bit byte sums");
+#else
+    static constexpr std::size_t kLanes = kReduceChannels;
+    struct Row
+        {
+        std::uint16_t   lane[kLanes];
+        };
+#endif
+
+    // store reading i directly.
+    void putRow(std::size_t i, const std::uint16_t (&v)[kReduceChannels]);
+
+protected:
+    Row     m_rows[a_kRows];
+
+    // the lockstep compare-exchange, for the sorting network.
+    static void compareExchangeRows(Row &a, Row &b);
+    // reading i of lane c.
+    std::uint16_t getLane(std::size_t i, std::size_t c) const;
+    // the IQR mean of the sorted rows [0, nRows), in lockstep.
+    void reduceIqr(std::size_t nRows, std::uint32_t (&sum)[kLanes], std::uint16_t (&n)[kLanes]) const;
+    // any other policy, a lane at a time.
+    template <typename TPolicy>
+    void reduceLanes(std::size_t nRows, std::uint32_t (&sum)[kLanes], std::uint16_t (&n)[kLanes]) const;
+
+    // the sorted rows [0, nRows) reduced by TPolicy.
+    template <typename TPolicy>
+    void reduceSorted(std::size_t nRows, std::uint32_t (&sum)[kLanes], std::uint16_t (&n)[kLanes]) const
+        {
+        this->template reduceSorted<TPolicy>(nRows, sum, n, std::is_same<TPolicy, cIqrMeanPolicy>{});
+        }
+
+    template <typename TPolicy>
+    void reduceSorted(std::size_t nRows, std::uint32_t (&sum)[kLanes], std::uint16_t (&n)[kLanes], std::true_type /* IQR */) const
+        {
+        this->reduceIqr(nRows, sum, n);
+        }
+
+    template <typename TPolicy>
+    void reduceSorted(std::size_t nRows, std::uint32_t (&sum)[kLanes], std::uint16_t (&n)[kLanes], std::false_type /* IQR */) const
+        {
+        this->template reduceLanes<TPolicy>(nRows, sum, n);
+        }
+
+    // the scaled means, as the sketch uplinks them.
+    static void scaleLanes(
+        const std::uint32_t (&sum)[kLanes],
+        const std::uint16_t (&n)[kLanes],
+        cPMS7003::Measurements<float> &r
+        )
+        {
+        float v[kReduceChannels];
+
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            v[c] = scaleReduceResult(sum[c], n[c]);
+
+        setReduceChannels(r, v);
+        }
+
+    // the uflt16 encodings of the scaled means.
+    static void encodeLanes(
+        const std::uint32_t (&sum)[kLanes],
+        const std::uint16_t (&n)[kLanes],
+        std::uint16_t (&uf)[kReduceChannels]
+        )
+        {
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            uf[c] = encodeReduceResult(sum[c], n[c]);
+        }
+
+#if ! CATENA_PMS7003_REDUCE_SIMD
+    template <std::size_t... L>
+    static inline void compareExchangeLanes(Row &a, Row &b, std::index_sequence<L...>)
+        {
+        auto const ce = [](std::uint16_t &x, std::uint16_t &y)
+            {
+            std::uint16_t const lo = x < y ? x : y;
+            std::uint16_t const hi = x < y ? y : x;
+
+            x = lo;
+            y = hi;
+            };
+
+        using expand = int[];
+        (void) expand { 0, (ce(a.lane[L], b.lane[L]), 0)... };
+        }
+#endif
+    };
+
+/****************************************************************************\
+|
+|   The block: a fixed window
+|
+\****************************************************************************/
+
+template <std::size_t N, typename TPolicy = cIqrMeanPolicy>
+class cReductionBlock : public cReductionRows<N>
+    {
+    using Super = cReductionRows<N>;
+
+public:
+    static constexpr std::size_t kWindow = N;
+    typedef TPolicy Policy;
+
+    using Super::kLanes;
+
+    // the block needs no setup; it's filled by put() and consumed by
+    // reduce().
+    void reset()
+        {}
+
+    // store m as reading i.
+    void put(std::size_t i, const cPMS7003::Measurements<std::uint16_t> &m)
+        {
+        std::uint16_t v[kReduceChannels];
+
+        getReduceChannels(m, v);
+        this->putRow(i, v);
+        }
+
+    // compute the sum and count of the readings the policy keeps, for
+    // each lane. This sorts the rows in place.
+    void reduce(std::uint32_t (&sum)[kLanes], std::uint16_t (&n)[kLanes])
+        {
+        cSortingNetwork<N>::sort(this->m_rows, Super::compareExchangeRows);
+        this->template reduceSorted<TPolicy>(N, sum, n);
+        }
+
+    // compute the scaled mean of every channel, as the sketch uplinks
+    // them. This sorts the rows in place.
+    void reduce(cPMS7003::Measurements<float> &r)
+        {
+        std::uint32_t sum[kLanes];
+        std::uint16_t n[kLanes];
+
+        this->reduce(sum, n);
+        Super::scaleLanes(sum, n, r);
+        }
+
+    // compute the uflt16 encoding of every channel's scaled mean, in
+    // lane order, using only integer arithmetic. This sorts the rows in
+    // place.
+    void reduceUflt16(std::uint16_t (&uf)[kReduceChannels])
+        {
+        std::uint32_t sum[kLanes];
+        std::uint16_t n[kLanes];
+
+        this->reduce(sum, n);
+        Super::encodeLanes(sum, n, uf);
+        }
+    };
+
+/****************************************************************************\
+|
+|   The window: a length chosen at run time
+|
+\****************************************************************************/
+
+template <std::size_t a_kMaxWindow, typename TPolicy = cIqrMeanPolicy>
+class cReductionWindow : public cReductionRows<a_kMaxWindow>
+    {
+    using Super = cReductionRows<a_kMaxWindow>;
+
+public:
+    static constexpr std::size_t kMaxWindow = a_kMaxWindow;
+    typedef TPolicy Policy;
+
+    using Super::kLanes;
+
+    // start a new window.
+    void reset()
+        {
+        this->m_nRows = 0;
+        }
+
+    // store m as reading i. The window holds readings [0, i]; readings
+    // beyond kMaxWindow are ignored.
+    void put(std::size_t i, const cPMS7003::Measurements<std::uint16_t> &m)
+        {
+        std::uint16_t v[kReduceChannels];
+
+        if (i >= kMaxWindow)
+            return;
+
+        getReduceChannels(m, v);
+        this->putRow(i, v);
+        if (i >= this->m_nRows)
+            this->m_nRows = i + 1;
+        }
+
+    // the number of readings in the window.
+    std::size_t getCount() const
+        {
+        return this->m_nRows;
+        }
+
+    // compute the sum and count of the readings the policy keeps, for
+    // each lane; an empty window gives zero counts. This sorts the rows
+    // in place.
+    void reduce(std::uint32_t (&sum)[kLanes], std::uint16_t (&n)[kLanes])
+        {
+        if (this->m_nRows == 0)
+            {
+            for (std::size_t c = 0; c < kLanes; ++c)
+                {
+                sum[c] = 0;
+                n[c] = 0;
+                }
+            return;
+            }
+
+        this->sortRows<2>();
+        this->template reduceSorted<TPolicy>(this->m_nRows, sum, n);
+        }
+
+    // compute the scaled mean of every channel, as the sketch uplinks
+    // them. This sorts the rows in place.
+    void reduce(cPMS7003::Measurements<float> &r)
+        {
+        std::uint32_t sum[kLanes];
+        std::uint16_t n[kLanes];
+
+        this->reduce(sum, n);
+        Super::scaleLanes(sum, n, r);
+        }
+
+    // compute the uflt16 encoding of every channel's scaled mean, in
+    // lane order, using only integer arithmetic. This sorts the rows in
+    // place.
+    void reduceUflt16(std::uint16_t (&uf)[kReduceChannels])
+        {
+        std::uint32_t sum[kLanes];
+        std::uint16_t n[kLanes];
+
+        this->reduce(sum, n);
+        Super::encodeLanes(sum, n, uf);
+        }
+
+private:
+    std::size_t m_nRows = 0;
+
+    // sort the rows with the smallest power-of-two network (or the
+    // kMaxWindow network) that covers them; a short window doesn't pay
+    // for the comparators of a long one.
+    template <std::size_t P>
+    void sortRows()
+        {
+        this->sortRows<P>(std::integral_constant<bool, (P >= kMaxWindow)>{});
+        }
+
+    template <std::size_t P>
+    void sortRows(std::true_type /* P >= kMaxWindow */)
+        {
+        cSortingNetwork<kMaxWindow>::sortPrefix(this->m_rows, this->m_nRows, Super::compareExchangeRows);
+        }
+
+    template <std::size_t P>
+    void sortRows(std::false_type /* P >= kMaxWindow */)
+        {
+        if (this->m_nRows <= P)
+            cSortingNetwork<P>::sortPrefix(this->m_rows, this->m_nRows, Super::compareExchangeRows);
+        else
+            this->sortRows<2 * P>();
+        }
+    };
+
+/****************************************************************************\
+|
+|   The implementation
+|
+\****************************************************************************/
+
+template <std::size_t a_kRows>
+inline void cReductionRows<a_kRows>::putRow(std::size_t i, const std::uint16_t (&v)[kReduceChannels])
+    {
+#if CATENA_PMS7003_REDUCE_SIMD
+    std::uint16_t lanes[kLanes] = {};
+
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        lanes[c] = v[c] ^ kBias;
+
+    std::memcpy(&this->m_rows[i], lanes, sizeof(lanes));
+#else
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        this->m_rows[i].lane[c] = v[c];
+#endif
+    }
+
+template <std::size_t a_kRows>
+inline void cReductionRows<a_kRows>::compareExchangeRows(Row &a, Row &b)
+    {
+#if CATENA_PMS7003_REDUCE_SIMD
+    for (std::size_t j = 0; j < kVectors; ++j)
+        {
+        Lanes const lo = a.v[j] < b.v[j] ? a.v[j] : b.v[j];
+        Lanes const hi = a.v[j] < b.v[j] ? b.v[j] : a.v[j];
+
+        a.v[j] = lo;
+        b.v[j] = hi;
+        }
+#else
+    compareExchangeLanes(a, b, std::make_index_sequence<kLanes>{});
+#endif
+    }
+
+template <std::size_t a_kRows>
+inline std::uint16_t cReductionRows<a_kRows>::getLane(std::size_t i, std::size_t c) const
+    {
+#if CATENA_PMS7003_REDUCE_SIMD
+    return std::uint16_t(this->m_rows[i].v[c / kLanesPerVector][c % kLanesPerVector]) ^ kBias;
+#else
+    return this->m_rows[i].lane[c];
+#endif
+    }
+
+template <std::size_t a_kRows>
+template <typename TPolicy>
+inline void cReductionRows<a_kRows>::reduceLanes(std::size_t nRows, std::uint32_t (&sum)[kLanes], std::uint16_t (&n)[kLanes]) const
+    {
+    for (std::size_t c = 0; c < kLanes; ++c)
+        {
+        sum[c] = 0;
+        n[c] = 0;
+        }
+
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        {
+        std::uint16_t v[a_kRows];
+
+        for (std::size_t i = 0; i < nRows; ++i)
+            v[i] = this->getLane(i, c);
+
+        TPolicy::reduceSorted(v, nRows, sum[c], n[c]);
+        }
+    }
+
+template <std::size_t a_kRows>
+inline void cReductionRows<a_kRows>::reduceIqr(std::size_t nRows, std::uint32_t (&sum)[kLanes], std::uint16_t (&n)[kLanes]) const
+    {
+    // as in cIqrMeanPolicy: q1 is the reading with rank nRows/4 from the
+    // bottom, and q3 is the reading with the same rank from the top.
+    std::size_t const iq1 = nRows / 4;
+    std::size_t const iq3 = nRows - nRows / 4 - 1;
+
+#if CATENA_PMS7003_REDUCE_SIMD
+    ULanes const bias = ULanes{} + kBias;
+    ULanes const ones = ULanes{} - 1;
+    ULanes const byte = ULanes{} + 0xFF;
+
+    for (std::size_t j = 0; j < kVectors; ++j)
+        {
+        // the fences, once per window, for all lanes. iqr15 is
+        // (3 * d) >> 1, which is d + (d >> 1). The fences are clamped to
+        // the range of a reading, which doesn't change which readings
+        // pass, so the whole computation stays in 16 bits.
+        ULanes const q1 = ULanes(this->m_rows[iq1].v[j]) ^ bias;
+        ULanes const q3 = ULanes(this->m_rows[iq3].v[j]) ^ bias;
+        ULanes const d = q3 - q1;
+        ULanes const h = d >> 1;
+        ULanes lo = q1 < d ? ULanes{} : q1 - d;
+        ULanes hi = ones - q3 < d ? ones : q3 + d;
+
+        lo = lo < h ? ULanes{} : lo - h;
+        hi = ones - hi < h ? ones : hi + h;
+
+        Lanes const lowlim = Lanes(lo ^ bias);
+        Lanes const highlim = Lanes(hi ^ bias);
+
+        // the rows are sorted, so the readings that pass the fences are
+        // exactly those the sketch's scans from each end would keep. The
+        // sums are kept a byte at a time, so they fit in 16 bits.
+        ULanes vSumLo = {};
+        ULanes vSumHi = {};
+        Lanes vCount = {};
+
+        for (std::size_t i = 0; i < nRows; ++i)
+            {
+            Lanes const row = this->m_rows[i].v[j];
+            Lanes const mask = (row >= lowlim) & (row <= highlim);
+            ULanes const x = (ULanes(row) ^ bias) & ULanes(mask);
+
+            vSumLo += x & byte;
+            vSumHi += x >> 8;
+            vCount -= mask;
+            }
+
+        for (std::size_t k = 0; k < kLanesPerVector; ++k)
+            {
+            std::size_t const c = j * kLanesPerVector + k;
+
+            sum[c] = (std::uint32_t(vSumHi[k]) << 8) + vSumLo[k];
+            n[c] = std::uint16_t(vCount[k]);
+            }
+        }
+#else
+    std::int32_t lowlim[kLanes];
+    std::int32_t highlim[kLanes];
+
+    for (std::size_t c = 0; c < kLanes; ++c)
+        {
+        std::int32_t const q1 = this->m_rows[iq1].lane[c];
+        std::int32_t const q3 = this->m_rows[iq3].lane[c];
+        std::int32_t const iqr15 = (3 * (q3 - q1)) >> 1;
+
+        lowlim[c] = q1 - iqr15;
+        highlim[c] = q3 + iqr15;
+        sum[c] = 0;
+        n[c] = 0;
+        }
+
+    for (std::size_t i = 0; i < nRows; ++i)
+        {
+        for (std::size_t c = 0; c < kLanes; ++c)
+            {
+            std::int32_t const x = this->m_rows[i].lane[c];
+            bool const fKeep = lowlim[c] <= x && x <= highlim[c];
+
+            sum[c] += fKeep ? x : 0;
+            n[c] += fKeep;
+            }
+        }
+#endif
+    }
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_Reduce_h_
@@ -0,0 +1,204 @@
+/*
+
+Module: Catena-PMS7003-ReducePolicy.h
+
+Function:
+    The estimators cReductionBlock can use to reduce a window of
+    PMS7003 readings.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    A policy is a class with one static member function:
+
+        static void reduceSorted(
+            const std::uint16_t *pv,
+            std::size_t nv,
+            std::uint32_t &sum,
+            std::uint16_t &n
+            );
+
+    pv[0..nv-1] is one channel of the window, in ascending order; nv is
+    at least one. The policy sets sum and n so that sum / n is the
+    estimate; the sketch divides and scales as before. Everything is
+    integer arithmetic, and nothing needs scratch space, so the same
+    code serves fixed and run-time window lengths.
+
+    The policy is a template argument of cReductionBlock and
+    cReductionWindow, so only the estimator the sketch names is
+    compiled in.
+
+    The windows here are at most 256 readings, so sums of readings fit
+    in 32 bits.
+
+*/
+
+#ifndef _Catena_PMS7003_ReducePolicy_h_
+# define _Catena_PMS7003_ReducePolicy_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatenaPMS7003 {
+
+// the mean of the readings within [q1 - 1.5 IQR, q3 + 1.5 IQR]: what
+// the sketch has always uplinked. q1 is the reading with rank nv/4 from
+// the bottom, and q3 the one with the same rank from the top. The
+// reduction classes have a lockstep version of this; this one is the
+// reference for it.
+class cIqrMeanPolicy
+    {
+public:
+    static void reduceSorted(const std::uint16_t *pv, std::size_t nv, std::uint32_t &sum, std::uint16_t &n)
+        {
+        std::int32_t const q1 = pv[nv / 4];
+        std::int32_t const q3 = pv[nv - nv / 4 - 1];
+        std::int32_t const iqr15 = (3 * (q3 - q1)) >> 1;
+        std::int32_t const lowlim = q1 - iqr15;
+        std::int32_t const highlim = q3 + iqr15;
+
+        sum = 0;
+        n = 0;
+        for (std::size_t i = 0; i < nv; ++i)
+            {
+            std::int32_t const x = pv[i];
+            bool const fKeep = lowlim <= x && x <= highlim;
+
+            sum += fKeep ? x : 0;
+            n += fKeep;
+            }
+        }
+    };
+
+// the median; for an even window, the mean of the middle two.
+class cMedianPolicy
+    {
+public:
+    static void reduceSorted(const std::uint16_t *pv, std::size_t nv, std::uint32_t &sum, std::uint16_t &n)
+        {
+        if (nv & 1)
+            {
+            sum = pv[nv / 2];
+            n = 1;
+            }
+        else
+            {
+            sum = std::uint32_t(pv[nv / 2 - 1]) + pv[nv / 2];
+            n = 2;
+            }
+        }
+    };
+
+// the mean after dropping a_kPercent of the readings (rounded down) from
+// each end.
+template <unsigned a_kPercent = 10>
+class cTrimmedMeanPolicy
+    {
+public:
+    static_assert(a_kPercent < 50, "can't trim half from each end");
+
+    static void reduceSorted(const std::uint16_t *pv, std::size_t nv, std::uint32_t &sum, std::uint16_t &n)
+        {
+        std::size_t const k = nv * a_kPercent / 100;
+
+        sum = 0;
+        for (std::size_t i = k; i < nv - k; ++i)
+            sum += pv[i];
+        n = std::uint16_t(nv - 2 * k);
+        }
+    };
+
+// the mean after replacing a_kPercent of the readings (rounded down) at
+// each end with the nearest reading that's kept.
+template <unsigned a_kPercent = 10>
+class cWinsorizedMeanPolicy
+    {
+public:
+    static_assert(a_kPercent < 50, "can't replace half from each end");
+
+    static void reduceSorted(const std::uint16_t *pv, std::size_t nv, std::uint32_t &sum, std::uint16_t &n)
+        {
+        std::size_t const k = nv * a_kPercent / 100;
+
+        sum = std::uint32_t(k) * (std::uint32_t(pv[k]) + pv[nv - 1 - k]);
+        for (std::size_t i = k; i < nv - k; ++i)
+            sum += pv[i];
+        n = std::uint16_t(nv);
+        }
+    };
+
+// the Hampel identifier: the mean of the readings within
+// a_kSigmaTenths/10 scaled MADs of the median, where the scaled MAD is
+// 1.4826 times the median absolute deviation (which makes it estimate
+// the standard deviation of normal data). If more than half the
+// readings are equal, the MAD is zero, and only those are kept.
+template <unsigned a_kSigmaTenths = 30>
+class cHampelPolicy
+    {
+public:
+    static void reduceSorted(const std::uint16_t *pv, std::size_t nv, std::uint32_t &sum, std::uint16_t &n)
+        {
+        // work in doubled units, so that even windows stay exact: m2 is
+        // twice the median, and mad2 is four times the MAD.
+        std::size_t const iMid = (nv - 1) / 2;
+        std::int32_t const m2 = std::int32_t(pv[iMid]) + pv[nv / 2];
+
+        // the deviations of pv[iMid], pv[iMid-1], ... ascend, and so do
+        // those of pv[iMid+1], pv[iMid+2], ...; merge them until we have
+        // the two middle ones.
+        std::size_t iLeft = iMid + 1;
+        std::size_t iRight = iMid + 1;
+        std::uint32_t devLow = 0;
+        std::uint32_t devHigh = 0;
+
+        for (std::size_t k = 0; k <= nv / 2; ++k)
+            {
+            std::uint32_t const dLeft = iLeft > 0 ? std::uint32_t(m2 - 2 * std::int32_t(pv[iLeft - 1])) : UINT32_MAX;
+            std::uint32_t const dRight = iRight < nv ? std::uint32_t(2 * std::int32_t(pv[iRight]) - m2) : UINT32_MAX;
+            std::uint32_t d;
+
+            if (dLeft <= dRight)
+                {
+                d = dLeft;
+                --iLeft;
+                }
+            else
+                {
+                d = dRight;
+                ++iRight;
+                }
+
+            if (k == iMid)
+                devLow = d;
+            devHigh = d;
+            }
+
+        std::uint64_t const mad2 = std::uint64_t(devLow) + devHigh;
+
+        // keep pv[i] if its deviation is at most sigma * 1.4826 * MAD;
+        // in doubled units, if dev2 * 20000 <= a_kSigmaTenths * 1482.6 * mad2.
+        std::uint64_t const limit = mad2 * a_kSigmaTenths * 14826 / 10;
+
+        sum = 0;
+        n = 0;
+        for (std::size_t i = 0; i < nv; ++i)
+            {
+            std::int32_t const d = 2 * std::int32_t(pv[i]) - m2;
+            std::uint64_t const dev2 = std::uint64_t(d < 0 ? -d : d);
+            bool const fKeep = dev2 * 20000 <= limit;
+
+            sum += fKeep ? pv[i] : 0;
+            n += fKeep;
+            }
+        }
+    };
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_ReducePolicy_h_
@@ -0,0 +1,241 @@
+/*
+
+Module: Catena-PMS7003-Report.h
+
+Function:
+    cReportByException: decide whether a measurement interval differs
+    enough from the last one reported to be worth an uplink.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    In stable air, most uplinks repeat the one before. A node that
+    reports by exception sends an interval only when:
+
+    - it's the first since reset() (for example, after boot);
+    - it has particle data and the last one reported didn't, or the
+      other way round;
+    - the AQI category of its PM2.5 or PM10 differs from that of the
+      last one reported;
+    - any channel with a threshold has moved from the value last
+      reported by more than that threshold, and by more than the
+      relative threshold (a percentage of the value last reported); or
+    - waiting another cycle would leave more than the heartbeat
+      interval since the last report.
+
+    Requiring both thresholds keeps the decision quiet in clean air,
+    where the sensor's noise is a large fraction of a small value, and
+    in dirty air, where it's a small fraction of a large one.
+
+    The intervals are compared as the uflt16 codes the sketch uplinks
+    (see Catena-PMS7003-Reduce.h), without floating point: a code with
+    exponent b and fraction f is the value f * 2^(b - 11), in µg/m^3 for
+    the PM channels and in particles per 0.1 L for the dust counts, so
+    f << b is the value in units of 2^-11, exactly.
+
+    The AQI categories are those of cAqi (Catena-PMS7003-Aqi.h):
+    category i is the segment of the breakpoint tables in
+    extras/calculate-aqi.js that the script interpolates in, from 0
+    (good, AQI 0 to 50) to 5 (hazardous, AQI 301 and up).
+
+*/
+
+#ifndef _Catena_PMS7003_Report_h_
+# define _Catena_PMS7003_Report_h_
+
+#pragma once
+
+#include <Catena-PMS7003-Aqi.h>
+#include <Catena-PMS7003-Reduce.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace McciCatenaPMS7003 {
+
+class cReportByException
+    {
+public:
+    enum class Reason : std::uint8_t
+        {
+        None,       // nothing worth an uplink
+        First,      // nothing reported since reset()
+        Validity,   // particle data has come or gone
+        Category,   // the AQI category has changed
+        Threshold,  // a channel has moved past its thresholds
+        Heartbeat,  // it's been too long since the last report
+        };
+
+    static constexpr const char *getReasonName(Reason r)
+        {
+        switch (r)
+            {
+        case Reason::None: return "none";
+        case Reason::First: return "first";
+        case Reason::Validity: return "validity";
+        case Reason::Category: return "category";
+        case Reason::Threshold: return "threshold";
+        case Reason::Heartbeat: return "heartbeat";
+        default: return "<<unknown>>";
+            }
+        }
+
+    // the channels the AQI uses, in lane order.
+    static constexpr std::size_t kPm2p5Channel = 1;
+    static constexpr std::size_t kPm10Channel = 2;
+
+    // the defaults: a report at least hourly, or when a PM channel moves
+    // by more than 3 µg/m^3 and 25%. The dust counts are ignored.
+    static constexpr std::uint32_t kDefaultHeartbeatSec = 60 * 60;
+    static constexpr unsigned kDefaultPercent = 25;
+    static constexpr std::uint16_t kDefaultPmThreshold = 3;
+
+    cReportByException()
+        {
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            this->m_threshold[c] = c < 3 ? kDefaultPmThreshold : 0;
+        }
+
+    // forget the last report, so the next interval is reported.
+    void reset()
+        {
+        this->m_fReported = false;
+        }
+
+    // the longest time between reports, in seconds.
+    void setHeartbeat(std::uint32_t sec)
+        {
+        this->m_heartbeatSec = sec;
+        }
+    std::uint32_t getHeartbeat() const
+        {
+        return this->m_heartbeatSec;
+        }
+
+    // the relative threshold, as a percentage of the value last
+    // reported, from 0 to 255.
+    bool setPercent(unsigned percent)
+        {
+        if (percent > 255)
+            return false;
+        this->m_percent = std::uint8_t(percent);
+        return true;
+        }
+    unsigned getPercent() const
+        {
+        return this->m_percent;
+        }
+
+    // the absolute threshold for a channel, in the channel's units; 0
+    // means changes in the channel don't count.
+    bool setThreshold(std::size_t channel, std::uint16_t threshold)
+        {
+        if (channel >= kReduceChannels)
+            return false;
+        this->m_threshold[channel] = threshold;
+        return true;
+        }
+    std::uint16_t getThreshold(std::size_t channel) const
+        {
+        return channel < kReduceChannels ? this->m_threshold[channel] : 0;
+        }
+
+    // decide whether the interval ending at tNow (by millis()) should be
+    // reported, given that the next one will end cycleMs later. fValid
+    // is false if the interval has no particle data.
+    Reason check(
+        const std::uint16_t (&uf)[kReduceChannels],
+        bool fValid,
+        std::uint32_t tNow,
+        std::uint32_t cycleMs
+        ) const
+        {
+        if (! this->m_fReported)
+            return Reason::First;
+        if (fValid != this->m_fValid)
+            return Reason::Validity;
+
+        if (fValid)
+            {
+            if (getCategory(uf) != getCategory(this->m_uf))
+                return Reason::Category;
+
+            for (std::size_t c = 0; c < kReduceChannels; ++c)
+                {
+                if (this->m_threshold[c] != 0 && this->exceeds(c, uf[c]))
+                    return Reason::Threshold;
+                }
+            }
+
+        if (std::uint64_t(tNow - this->m_tReported) + cycleMs >
+                std::uint64_t(this->m_heartbeatSec) * 1000)
+            return Reason::Heartbeat;
+
+        return Reason::None;
+        }
+
+    // note that the interval ending at tNow has been reported.
+    void setReported(
+        const std::uint16_t (&uf)[kReduceChannels],
+        bool fValid,
+        std::uint32_t tNow
+        )
+        {
+        std::memcpy(this->m_uf, uf, sizeof(this->m_uf));
+        this->m_fValid = fValid;
+        this->m_tReported = tNow;
+        this->m_fReported = true;
+        }
+
+    // the value of a uflt16 code, in units of 2^-11, exactly.
+    static std::uint32_t getRawValue(std::uint16_t uf)
+        {
+        return std::uint32_t(uf & 0x0FFF) << (uf >> 12);
+        }
+
+    // the AQI category of a PM2.5 or PM10 code, from 0 to 5.
+    static unsigned getPm2p5Category(std::uint16_t uf)
+        {
+        return cAqi::getPm2p5Category(uf);
+        }
+    static unsigned getPm10Category(std::uint16_t uf)
+        {
+        return cAqi::getPm10Category(uf);
+        }
+
+    // the AQI category of an interval: the worse of the two.
+    static unsigned getCategory(const std::uint16_t (&uf)[kReduceChannels])
+        {
+        return cAqi::getCategory(uf[kPm2p5Channel], uf[kPm10Channel]);
+        }
+
+private:
+    bool exceeds(std::size_t c, std::uint16_t uf) const
+        {
+        std::uint32_t const vOld = getRawValue(this->m_uf[c]);
+        std::uint32_t const vNew = getRawValue(uf);
+        std::uint32_t const d = vNew > vOld ? vNew - vOld : vOld - vNew;
+
+        return d > std::uint32_t(this->m_threshold[c]) << 11 &&
+               std::uint64_t(d) * 100 > std::uint64_t(vOld) * this->m_percent;
+        }
+
+    std::uint16_t   m_threshold[kReduceChannels];
+    std::uint32_t   m_heartbeatSec = kDefaultHeartbeatSec;
+    std::uint8_t    m_percent = kDefaultPercent;
+
+    // the last interval reported.
+    std::uint16_t   m_uf[kReduceChannels] = {};
+    std::uint32_t   m_tReported = 0;
+    bool            m_fValid = false;
+    bool            m_fReported = false;
+    };
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_Report_h_
@@ -0,0 +1,212 @@
+/*
+
+Module: Catena-PMS7003-Sliding.h
+
+Function:
+    cSlidingWindow: reduce the most recent readings of a PMS7003 that's
+    left running, updating as each reading arrives.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    A node with power to spare can leave the PMS7003 running and report
+    on the last N readings whenever it likes, rather than waking the
+    sensor, waiting for it to warm up, and collecting a fresh window.
+
+    The window keeps the readings twice: in a ring, in arrival order, so
+    it knows which reading to drop next; and as one sorted column per
+    channel. Each put() drops the oldest value from each column and
+    inserts the new one, by binary search and a move of at most N - 1
+    values, so the columns are always sorted, and reduce() applies the
+    policy directly (see Catena-PMS7003-ReducePolicy.h), without
+    sorting. reduce() doesn't change the window.
+
+    The results are the same as those of cReductionBlock, given the
+    same readings, for every policy.
+
+    Each reading can carry its time (as given by cPMS7003's timed
+    callback), so the sketch knows the span of readings it reduced.
+
+*/
+
+#ifndef _Catena_PMS7003_Sliding_h_
+# define _Catena_PMS7003_Sliding_h_
+
+#pragma once
+
+#include <Catena-PMS7003-Reduce.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace McciCatenaPMS7003 {
+
+template <std::size_t a_kMaxWindow, typename TPolicy = cIqrMeanPolicy>
+class cSlidingWindow
+    {
+public:
+    static_assert(a_kMaxWindow >= 1, "window can't be empty");
+    // the policies sum readings in 32 bits.
+    static_assert(a_kMaxWindow <= 256, "window too long");
+
+    static constexpr std::size_t kMaxWindow = a_kMaxWindow;
+    typedef TPolicy Policy;
+
+    // empty the window, and set the number of readings it keeps, from 1
+    // to kMaxWindow (values out of range are clamped).
+    void reset(std::size_t nWindow)
+        {
+        this->m_nWindow = nWindow < 1 ? 1 : nWindow > kMaxWindow ? kMaxWindow : nWindow;
+        this->m_nCount = 0;
+        this->m_iNext = 0;
+        }
+
+    // add m as the newest reading, taken at tMs, dropping the oldest if
+    // the window is full.
+    void put(const cPMS7003::Measurements<std::uint16_t> &m, std::uint32_t tMs = 0);
+
+    // the number of readings in the window.
+    std::size_t getCount() const
+        {
+        return this->m_nCount;
+        }
+
+    // the times of the oldest and newest readings in the window;
+    // meaningless if it's empty.
+    std::uint32_t getFirstTime() const
+        {
+        return this->m_tRing[this->m_nCount == this->m_nWindow ? this->m_iNext : 0];
+        }
+    std::uint32_t getLastTime() const
+        {
+        return this->m_tRing[(this->m_iNext == 0 ? this->m_nWindow : this->m_iNext) - 1];
+        }
+
+    // the number of readings the window keeps when full.
+    std::size_t getLength() const
+        {
+        return this->m_nWindow;
+        }
+
+    // compute the sum and count of the readings the policy keeps, for
+    // each channel; an empty window gives zero counts.
+    void reduce(
+        std::uint32_t (&sum)[kReduceChannels],
+        std::uint16_t (&n)[kReduceChannels]
+        ) const;
+
+    // compute the scaled mean of every channel, as the sketch uplinks
+    // them.
+    void reduce(cPMS7003::Measurements<float> &r) const
+        {
+        std::uint32_t sum[kReduceChannels];
+        std::uint16_t n[kReduceChannels];
+        float v[kReduceChannels];
+
+        this->reduce(sum, n);
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            v[c] = scaleReduceResult(sum[c], n[c]);
+
+        setReduceChannels(r, v);
+        }
+
+    // compute the uflt16 encoding of every channel's scaled mean, in
+    // lane order, using only integer arithmetic.
+    void reduceUflt16(std::uint16_t (&uf)[kReduceChannels]) const
+        {
+        std::uint32_t sum[kReduceChannels];
+        std::uint16_t n[kReduceChannels];
+
+        this->reduce(sum, n);
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            uf[c] = encodeReduceResult(sum[c], n[c]);
+        }
+
+private:
+    // the readings, in arrival order; slot m_iNext is the next to be
+    // written, and holds the oldest reading once the window is full.
+    std::uint16_t   m_ring[kMaxWindow][kReduceChannels];
+    // their times, by the same index.
+    std::uint32_t   m_tRing[kMaxWindow];
+    // the same readings, sorted, a channel at a time.
+    std::uint16_t   m_sorted[kReduceChannels][kMaxWindow];
+    std::size_t     m_nWindow = kMaxWindow;
+    std::size_t     m_nCount = 0;
+    std::size_t     m_iNext = 0;
+    };
+
+/****************************************************************************\
+|
+|   The implementation
+|
+\****************************************************************************/
+
+template <std::size_t a_kMaxWindow, typename TPolicy>
+inline void cSlidingWindow<a_kMaxWindow, TPolicy>::put(
+    const cPMS7003::Measurements<std::uint16_t> &m,
+    std::uint32_t tMs
+    )
+    {
+    std::uint16_t v[kReduceChannels];
+    std::uint16_t (&slot)[kReduceChannels] = this->m_ring[this->m_iNext];
+    bool const fFull = this->m_nCount == this->m_nWindow;
+
+    getReduceChannels(m, v);
+
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        {
+        std::uint16_t * const pv = this->m_sorted[c];
+        std::size_t n = this->m_nCount;
+
+        if (fFull)
+            {
+            // drop one copy of the oldest value.
+            std::uint16_t * const pOld = std::lower_bound(pv, pv + n, slot[c]);
+
+            std::memmove(pOld, pOld + 1, (pv + n - (pOld + 1)) * sizeof(*pv));
+            --n;
+            }
+
+        // insert the new value after any equal ones.
+        std::uint16_t * const pNew = std::upper_bound(pv, pv + n, v[c]);
+
+        std::memmove(pNew + 1, pNew, (pv + n - pNew) * sizeof(*pv));
+        *pNew = v[c];
+        slot[c] = v[c];
+        }
+
+    this->m_tRing[this->m_iNext] = tMs;
+    if (! fFull)
+        ++this->m_nCount;
+
+    if (++this->m_iNext == this->m_nWindow)
+        this->m_iNext = 0;
+    }
+
+template <std::size_t a_kMaxWindow, typename TPolicy>
+inline void cSlidingWindow<a_kMaxWindow, TPolicy>::reduce(
+    std::uint32_t (&sum)[kReduceChannels],
+    std::uint16_t (&n)[kReduceChannels]
+    ) const
+    {
+    for (std::size_t c = 0; c < kReduceChannels; ++c)
+        {
+        if (this->m_nCount == 0)
+            {
+            sum[c] = 0;
+            n[c] = 0;
+            }
+        else
+            TPolicy::reduceSorted(this->m_sorted[c], this->m_nCount, sum[c], n[c]);
+        }
+    }
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_Sliding_h_
@@ -0,0 +1,250 @@
+/*
+
+Module: Catena-PMS7003-Sort.h
+
+Function:
+    Sorting for the small, fixed-size windows of measurements that
+    clients of the PMS7003 library reduce.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    For windows up to kMaxNetworkSize, sortWindow<N>() expands (at
+    compile time) into straight-line compare-exchange code, using
+    Batcher's merge-exchange network (Knuth, TAOCP vol. 3, 5.2.2
+    Algorithm M). That network is optimal for N <= 8 and within a few
+    comparators of the best known networks up to 16 or so; more to the
+    point, it has no data-dependent branches and no calls through a
+    comparison function. Larger windows use std::sort(), which is an
+    introsort, with the comparison inlined.
+
+*/
+
+#ifndef _Catena_PMS7003_Sort_h_
+# define _Catena_PMS7003_Sort_h_
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace McciCatenaPMS7003 {
+
+/****************************************************************************\
+|
+|   The sorting network
+|
+\****************************************************************************/
+
+template <std::size_t N>
+class cSortingNetwork
+    {
+public:
+    struct Comparator
+        {
+        std::uint8_t    i;
+        std::uint8_t    j;
+        };
+
+    static_assert(N <= 256, "network indices are 8 bits");
+
+private:
+    // ceil(log2(n)), for n >= 1
+    static constexpr unsigned ceilLog2(std::size_t n)
+        {
+        unsigned t = 0;
+
+        while ((std::size_t(1) << t) < n)
+            ++t;
+        return t;
+        }
+
+    // Knuth's Algorithm M. Stores each comparator in order in pOut[]
+    // (unless pOut is null), and returns the number of comparators.
+    static constexpr std::size_t generate(Comparator *pOut)
+        {
+        std::size_t nComparators = 0;
+
+        if (N < 2)
+            return 0;
+
+        // N >= 2 here, so t >= 1; but the shifts below are compiled for
+        // every N, so keep them well-defined.
+        unsigned const t = N < 2 ? 1 : ceilLog2(N);
+
+        for (std::size_t p = std::size_t(1) << (t - 1); p > 0; p >>= 1)
+            {
+            std::size_t q = std::size_t(1) << (t - 1);
+            std::size_t r = 0;
+            std::size_t d = p;
+
+            while (d > 0)
+                {
+                for (std::size_t i = 0; i + d < N; ++i)
+                    {
+                    if ((i & p) == r)
+                        {
+                        if (pOut != nullptr)
+                            {
+                            pOut[nComparators].i = std::uint8_t(i);
+                            pOut[nComparators].j = std::uint8_t(i + d);
+                            }
+                        ++nComparators;
+                        }
+                    }
+                d = q - p;
+                q >>= 1;
+                r = p;
+                }
+            }
+
+        return nComparators;
+        }
+
+public:
+    static constexpr std::size_t kSize = generate(nullptr);
+
+private:
+    // the comparators, built in a plain array (std::array can't be
+    // written in a C++14 constant expression).
+    struct Table
+        {
+        Comparator  c[kSize == 0 ? 1 : kSize];
+        };
+
+    static constexpr Table makeTable()
+        {
+        Table result {};
+
+        generate(result.c);
+        return result;
+        }
+
+    template <std::size_t... I>
+    static constexpr std::array<Comparator, kSize> makeComparators(
+        const Table &table,
+        std::index_sequence<I...>
+        )
+        {
+        return {{ table.c[I]... }};
+        }
+
+public:
+    static constexpr std::array<Comparator, kSize> kComparators =
+        makeComparators(makeTable(), std::make_index_sequence<kSize>{});
+
+    // sort pv[0..N-1] into ascending order.
+    template <typename T>
+    static void sort(T *pv)
+        {
+        sort(pv, [](T &a, T &b) { compareExchange(a, b); });
+        }
+
+    // apply the network to pv[0..N-1], using ce(pv[i], pv[j]) to put
+    // the lesser of each pair in pv[i] and the greater in pv[j]. Small
+    // networks are unrolled; big ones are run from the table.
+    template <typename T, typename TCompareExchange>
+    static void sort(T *pv, TCompareExchange ce)
+        {
+        sort(pv, ce, std::integral_constant<bool, (N <= kMaxUnrolled)>{});
+        }
+
+    // sort pv[0..n-1] into ascending order, for any n <= N, using the
+    // comparators of this network that lie within the first n elements.
+    // (That's the network with the rest of pv[] taken as larger than
+    // anything, and those comparators never exchange.) This runs from
+    // the table, so one network serves every window length up to N.
+    template <typename T, typename TCompareExchange>
+    static void sortPrefix(T *pv, std::size_t n, TCompareExchange ce)
+        {
+        for (auto const &c : kComparators)
+            {
+            if (c.j < n)
+                ce(pv[c.i], pv[c.j]);
+            }
+        }
+
+    // the largest network that's unrolled.
+    static constexpr std::size_t kMaxUnrolled = 32;
+
+private:
+    template <typename T>
+    static inline void compareExchange(T &a, T &b)
+        {
+        T const lo = a < b ? a : b;
+        T const hi = a < b ? b : a;
+
+        a = lo;
+        b = hi;
+        }
+
+    template <typename T, typename TCompareExchange>
+    static void sort(T *pv, TCompareExchange ce, std::true_type /* unrolled */)
+        {
+        apply(pv, ce, std::make_index_sequence<kSize>{});
+        }
+
+    template <typename T, typename TCompareExchange>
+    static void sort(T *pv, TCompareExchange ce, std::false_type /* unrolled */)
+        {
+        for (auto const &c : kComparators)
+            ce(pv[c.i], pv[c.j]);
+        }
+
+    template <typename T, typename TCompareExchange, std::size_t... I>
+    static inline void apply(T *pv, TCompareExchange ce, std::index_sequence<I...>)
+        {
+        using expand = int[];
+
+        // the comparators, in order.
+        (void) expand { 0, (ce(pv[kComparators[I].i], pv[kComparators[I].j]), 0)... };
+        (void) pv;
+        (void) ce;
+        }
+    };
+
+// the table is odr-used by the loops above; before C++17, that takes a
+// definition at namespace scope.
+template <std::size_t N>
+constexpr std::array<typename cSortingNetwork<N>::Comparator, cSortingNetwork<N>::kSize>
+cSortingNetwork<N>::kComparators;
+
+/****************************************************************************\
+|
+|   The entry point
+|
+\****************************************************************************/
+
+// the largest window that's sorted with a network.
+static constexpr std::size_t kMaxNetworkSize = 32;
+
+template <std::size_t N, typename T>
+inline void sortWindow(T *pv, std::true_type /* network */)
+    {
+    cSortingNetwork<N>::sort(pv);
+    }
+
+template <std::size_t N, typename T>
+inline void sortWindow(T *pv, std::false_type /* network */)
+    {
+    std::sort(pv, pv + N);
+    }
+
+// sort a window of N values in place, ascending.
+template <std::size_t N, typename T>
+inline void sortWindow(T *pv)
+    {
+    sortWindow<N>(pv, std::integral_constant<bool, (N <= kMaxNetworkSize)>{});
+    }
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_Sort_h_
@@ -0,0 +1,369 @@
+/*
+
+Module: Catena-PMS7003-Streaming.h
+
+Function:
+    cStreamingIqrMean: an online estimate of the IQR-filtered mean of a
+    stream of PMS7003 readings, in constant space.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The lora sketches reduce each channel by sorting a window of
+    readings, finding the quartiles q1 and q3, and averaging the values
+    that lie within [q1 - 1.5 IQR, q3 + 1.5 IQR]. That needs the whole
+    window in RAM.
+
+    This class gets the same result from a fixed amount of state,
+    whatever the window size, as readings arrive:
+
+    - The sum and count of all readings are kept.
+    - The kTail lowest and kTail highest readings are kept exactly.
+    - q1 and q3 are also tracked with the extended P-squared algorithm
+      (Jain and Chlamtac, CACM 28(10), 1985; Raatikainen, 1987), using
+      seven markers at probabilities 0, 1/8, 1/4, 1/2, 3/4, 7/8 and 1.
+      The marker heights are fixed point, with 8 fraction bits, and the
+      desired positions are counted in eighths, so there's no floating
+      point (the Cortex-M0+ has no FPU); only the parabolic prediction
+      needs 64-bit intermediates.
+
+    At the end, the fences are computed from the quartiles, and the tail
+    readings that lie outside them are subtracted from the sums. The
+    sketch only ever rejects readings below q1 or above q3, so if the
+    quartiles themselves are in the tails (that is, up to kMaxExact
+    readings), the result is exactly the sketch's. For longer windows,
+    the P-squared estimates (clamped to what the tails tell us) are
+    used, and at most kTail readings are rejected at each end; the
+    result is then an approximation, and a poor one if the window has
+    more than kTail outliers at an end. extras/test-streaming-iqr.cpp
+    checks the exact range and measures the error beyond it.
+
+    The default kTail, 16, makes the result exact up to 63 readings,
+    which covers the lora sketch's longest window (60). Each instance
+    is then 112 bytes on the Catena, so nine channels take about as
+    much RAM as a 56-reading cReductionWindow; the streaming window
+    stays that size however long the window.
+
+    cStreamingIqrWindow puts one of these on each channel, with the
+    same interface as cReductionBlock, so the sketch can use either.
+
+*/
+
+#ifndef _Catena_PMS7003_Streaming_h_
+# define _Catena_PMS7003_Streaming_h_
+
+#pragma once
+
+#include <Catena-PMS7003-Reduce.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatenaPMS7003 {
+
+template <std::size_t a_kTail = 16>
+class cStreamingIqrMean
+    {
+public:
+    // number of P-squared markers.
+    static constexpr std::size_t kMarkers = 7;
+    // number of readings kept at each end.
+    static constexpr std::size_t kTail = a_kTail;
+    // the largest number of readings for which the result is exact.
+    static constexpr std::size_t kMaxExact = 4 * kTail - 1;
+    // the fraction bits of the marker heights.
+    static constexpr unsigned kFracBits = 8;
+
+    static_assert(kTail >= kMarkers, "markers are initialized from m_low[]");
+
+    // reset to the empty state.
+    void reset()
+        {
+        this->m_nIn = 0;
+        this->m_sum = 0;
+        }
+
+    // add a reading.
+    void put(std::uint16_t v);
+
+    // number of readings so far.
+    std::uint16_t getCount() const
+        {
+        return this->m_nIn;
+        }
+
+    // compute the sum and count of the readings that pass the fences.
+    // Returns false (and sets both to zero) if there are no readings.
+    bool getResult(std::uint32_t &sum, std::uint16_t &n) const;
+
+private:
+    void startMarkers();
+    void updateMarkers(std::uint16_t v);
+
+    // the lowest readings, ascending, and the highest, descending.
+    std::uint16_t   m_low[kTail];
+    std::uint16_t   m_high[kTail];
+    // marker positions (1-origin, as in the paper).
+    std::uint16_t   m_pos[kMarkers];
+    // number of readings.
+    std::uint16_t   m_nIn = 0;
+    // sum of all readings.
+    std::uint32_t   m_sum = 0;
+    // marker heights, with kFracBits fraction bits.
+    std::int32_t    m_q[kMarkers];
+    };
+
+/****************************************************************************\
+|
+|   The implementation
+|
+\****************************************************************************/
+
+template <std::size_t a_kTail>
+inline void cStreamingIqrMean<a_kTail>::put(std::uint16_t v)
+    {
+    // saturate rather than wrap; the window is far shorter than this.
+    if (this->m_nIn == UINT16_MAX)
+        return;
+
+    std::size_t const nKept = this->m_nIn < kTail ? this->m_nIn : kTail;
+
+    ++this->m_nIn;
+    this->m_sum += v;
+
+    // insert into the tails, dropping the least extreme if full.
+    std::size_t i;
+
+    for (i = nKept; i > 0 && v < this->m_low[i - 1]; --i)
+        {
+        if (i < kTail)
+            this->m_low[i] = this->m_low[i - 1];
+        }
+    if (i < kTail)
+        this->m_low[i] = v;
+
+    for (i = nKept; i > 0 && v > this->m_high[i - 1]; --i)
+        {
+        if (i < kTail)
+            this->m_high[i] = this->m_high[i - 1];
+        }
+    if (i < kTail)
+        this->m_high[i] = v;
+
+    // the first kMarkers readings seed the markers.
+    if (this->m_nIn == kMarkers)
+        this->startMarkers();
+    else if (this->m_nIn > kMarkers)
+        this->updateMarkers(v);
+    }
+
+template <std::size_t a_kTail>
+inline void cStreamingIqrMean<a_kTail>::startMarkers()
+    {
+    // all the readings so far are in m_low[], in order.
+    for (std::size_t i = 0; i < kMarkers; ++i)
+        {
+        this->m_q[i] = std::int32_t(this->m_low[i]) << kFracBits;
+        this->m_pos[i] = std::uint16_t(i + 1);
+        }
+    }
+
+template <std::size_t a_kTail>
+inline void cStreamingIqrMean<a_kTail>::updateMarkers(std::uint16_t v)
+    {
+    // marker probabilities, in eighths.
+    static constexpr std::uint8_t kP8[kMarkers] = { 0, 1, 2, 4, 6, 7, 8 };
+    std::int32_t * const q = this->m_q;
+    std::uint16_t * const n = this->m_pos;
+    std::int32_t const x = std::int32_t(v) << kFracBits;
+    std::size_t k;
+
+    // find the cell, stretching the extreme markers if needed.
+    if (x < q[0])
+        {
+        q[0] = x;
+        k = 0;
+        }
+    else if (x >= q[kMarkers - 1])
+        {
+        q[kMarkers - 1] = x;
+        k = kMarkers - 2;
+        }
+    else
+        {
+        for (k = 0; ! (x < q[k + 1]); ++k)
+            ;
+        }
+
+    for (std::size_t i = k + 1; i < kMarkers; ++i)
+        ++n[i];
+
+    // the desired position of marker i is 1 + (nIn - 1) * p[i]; d8 is
+    // how far marker i is from it, in eighths.
+    std::int32_t const nm1 = std::int32_t(this->m_nIn) - 1;
+
+    for (std::size_t i = 1; i < kMarkers - 1; ++i)
+        {
+        std::int32_t const d8 = 8 + nm1 * kP8[i] - 8 * std::int32_t(n[i]);
+        std::int32_t const nLeft = std::int32_t(n[i]) - n[i - 1];
+        std::int32_t const nRight = std::int32_t(n[i + 1]) - n[i];
+
+        if ((d8 >= 8 && nRight > 1) || (d8 <= -8 && nLeft > 1))
+            {
+            std::int32_t const ds = d8 >= 0 ? 1 : -1;
+
+            // piecewise-parabolic prediction, over a common denominator:
+            // ds / (nL + nR) * ((nL + ds) * dqR / nR + (nR - ds) * dqL / nL)
+            std::int64_t const num =
+                std::int64_t(nLeft + ds) * nLeft * (q[i + 1] - q[i]) +
+                std::int64_t(nRight - ds) * nRight * (q[i] - q[i - 1]);
+            std::int64_t const den = std::int64_t(nLeft + nRight) * nLeft * nRight;
+            std::int32_t const qp = q[i] + ds * std::int32_t(num / den);
+
+            if (q[i - 1] < qp && qp < q[i + 1])
+                q[i] = qp;
+            else
+                {
+                // linear prediction
+                std::size_t const j = ds > 0 ? i + 1 : i - 1;
+
+                q[i] += ds * (q[j] - q[i]) / (std::int32_t(n[j]) - std::int32_t(n[i]));
+                }
+
+            n[i] = std::uint16_t(n[i] + ds);
+            }
+        }
+    }
+
+template <std::size_t a_kTail>
+inline bool cStreamingIqrMean<a_kTail>::getResult(std::uint32_t &sum, std::uint16_t &n) const
+    {
+    sum = 0;
+    n = 0;
+
+    if (this->m_nIn == 0)
+        return false;
+
+    // as in the sketch, q1 is the reading with rank nIn/4 from the
+    // bottom, and q3 is the one with that rank from the top. Nothing
+    // between them is ever rejected.
+    std::size_t const iq = this->m_nIn / 4;
+    std::int32_t lowlim;
+    std::int32_t highlim;
+
+    if (iq < kTail)
+        {
+        // the quartiles are in the tails: this is exact.
+        std::int32_t const q1 = this->m_low[iq];
+        std::int32_t const q3 = this->m_high[iq];
+        std::int32_t const iqr15 = (3 * (q3 - q1)) >> 1;
+
+        lowlim = q1 - iqr15;
+        highlim = q3 + iqr15;
+        }
+    else
+        {
+        // use the estimates, but they can't be inside the tails.
+        std::int32_t const q1 = std::max(this->m_q[2], std::int32_t(this->m_low[kTail - 1]) << kFracBits);
+        std::int32_t const q3 = std::min(this->m_q[4], std::int32_t(this->m_high[kTail - 1]) << kFracBits);
+
+        // the fences, q1 - 1.5 IQR and q3 + 1.5 IQR, with one more
+        // fraction bit, so they're exact.
+        std::int32_t const low2 = 5 * q1 - 3 * q3;
+        std::int32_t const high2 = 5 * q3 - 3 * q1;
+
+        // readings are integers, so rounding the limits inward is
+        // the same as comparing against the exact values.
+        lowlim = -((-low2) >> (kFracBits + 1));
+        highlim = high2 >> (kFracBits + 1);
+        }
+
+    std::size_t const nReject = iq < kTail ? iq : kTail;
+
+    sum = this->m_sum;
+    n = this->m_nIn;
+    for (std::size_t i = 0; i < nReject && this->m_low[i] < lowlim; ++i)
+        {
+        sum -= this->m_low[i];
+        --n;
+        }
+    for (std::size_t i = 0; i < nReject && this->m_high[i] > highlim; ++i)
+        {
+        sum -= this->m_high[i];
+        --n;
+        }
+
+    return true;
+    }
+
+/****************************************************************************\
+|
+|   A whole window
+|
+\****************************************************************************/
+
+template <std::size_t a_kTail = 16>
+class cStreamingIqrWindow
+    {
+public:
+    void reset()
+        {
+        for (auto &channel : this->m_channel)
+            channel.reset();
+        }
+
+    // add m to the window; the index is ignored, as the readings are
+    // consumed in order.
+    void put(std::size_t /* i */, const cPMS7003::Measurements<std::uint16_t> &m)
+        {
+        std::uint16_t v[kReduceChannels];
+
+        getReduceChannels(m, v);
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            this->m_channel[c].put(v[c]);
+        }
+
+    // compute the scaled mean of every channel, as the sketch uplinks
+    // them.
+    void reduce(cPMS7003::Measurements<float> &r) const
+        {
+        float v[kReduceChannels];
+
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            {
+            std::uint32_t sum;
+            std::uint16_t n;
+
+            this->m_channel[c].getResult(sum, n);
+            v[c] = scaleReduceResult(sum, n);
+            }
+
+        setReduceChannels(r, v);
+        }
+
+    // compute the uflt16 encoding of every channel's scaled mean, in
+    // lane order, using only integer arithmetic.
+    void reduceUflt16(std::uint16_t (&uf)[kReduceChannels]) const
+        {
+        for (std::size_t c = 0; c < kReduceChannels; ++c)
+            {
+            std::uint32_t sum;
+            std::uint16_t n;
+
+            this->m_channel[c].getResult(sum, n);
+            uf[c] = encodeReduceResult(sum, n);
+            }
+        }
+
+private:
+    cStreamingIqrMean<a_kTail>  m_channel[kReduceChannels];
+    };
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_Streaming_h_
@@ -0,0 +1,295 @@
+/*
+
+Module: Catena-PMS7003-Trace.h
+
+Function:
+    The library's trace messages as one constexpr table, and
+    cTraceRing, which keeps them in binary for the host to format.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Each trace site in the library has a TraceId, and a row of
+    kTraceFormats: the printf format of its message, and the kind of
+    each argument, one letter per conversion:
+
+        b   a byte, printed as a number
+        c   a byte, printed as a character
+        h   two bytes
+        w   four bytes
+        s   a byte holding a cPMS7003::State, printed by name
+        t   the rest of the record, as text
+
+    A site calls cPMS7003Hal::trace<id>(args...), which packs the
+    arguments, little-endian, in as many bytes as their types take,
+    and hands them to the HAL's putTrace(). The template checks at
+    compile time that the argument types match the row, so the table
+    and the sites can't disagree. By default, putTrace() formats the
+    message with formatTrace() and prints it, as the sites always
+    have; a HAL can instead keep the record, and let a host tool
+    format it later with the same table (extras/pms7003-trace.cpp).
+
+    A record in the ring is the id, the number of argument bytes, the
+    time in millis() (four bytes, little-endian), then the arguments.
+    Putting one costs a few byte stores; nothing is formatted on the
+    node. When the ring is full, the oldest whole records are dropped
+    to make room, and counted. Messages that aren't in the table go in
+    as kText, already formatted, split into records of at most
+    kMaxTraceArgs bytes.
+
+*/
+
+#ifndef _Catena_PMS7003_Trace_h_
+# define _Catena_PMS7003_Trace_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace McciCatenaPMS7003 {
+
+// the trace sites.
+enum class TraceId : std::uint8_t
+    {
+    kText,              // a message formatted on the node
+    kPmsEnter,          // cPMS7003 FSM entered a state
+    kPmsRequests,       // requests dropped on entering stNormal
+    kPmsUnknownState,   // cPMS7003 FSM in a state it doesn't know
+    kPmsTx,             // a command sent to the sensor
+    kPmsRxDiscard,      // a byte received out of frame
+    kHalBegin,
+    kHalEnd,
+    kHalSet5v,
+    kHalSetReset,
+    kHalSetMode,
+
+    kMax
+    };
+
+// the message of a trace site.
+struct TraceFormat
+    {
+    const char *    pFormat;    // printf format, one conversion per argument
+    const char *    pArgs;      // the kind of each argument
+    };
+
+static constexpr TraceFormat kTraceFormats[std::size_t(TraceId::kMax)] =
+    {
+    { "%s",                                                 "t" },
+    { "cPMS7003::fsmDispatch: enter %s\n",                  "s" },
+    { "fsmDispatch: oldRequests: 0x%x m_requests 0x%x\n",   "ww" },
+    { "fsmDispatch: unknown state %s (%u)\n",               "sb" },
+    { "TX: %02x %02x %02x %02x %02x %02x %02x\n",           "bbbbbbb" },
+    { "%02x ",                                              "b" },
+    { "hal begin\n",                                        "" },
+    { "hal end\n",                                          "" },
+    { "set5v: %u\n",                                        "b" },
+    { "setReset: %c\n",                                     "c" },
+    { "setMode: %c\n",                                      "c" },
+    };
+
+// the most argument bytes in a record, and the bytes before them.
+static constexpr std::size_t kMaxTraceArgs = 58;
+static constexpr std::size_t kTraceHeaderSize = 6;
+static constexpr std::size_t kMaxTraceRecord = kTraceHeaderSize + kMaxTraceArgs;
+
+// the bytes an argument of a kind takes; 0 for 't', which takes the
+// rest.
+constexpr std::size_t getTraceKindSize(char kind)
+    {
+    return kind == 'h' ? 2 : kind == 'w' ? 4 : kind == 't' ? 0 : 1;
+    }
+
+// true if arguments of types Args can go in a record of id.
+template <typename... Args>
+constexpr bool isTraceArgsMatch(TraceId id)
+    {
+    constexpr std::size_t kSizes[] = { sizeof(Args)..., 0 };
+    const char *p = kTraceFormats[std::size_t(id)].pArgs;
+
+    for (std::size_t i = 0; i < sizeof...(Args); ++i, ++p)
+        {
+        if (*p == '\0' || *p == 't' || getTraceKindSize(*p) != kSizes[i])
+            return false;
+        }
+    return *p == '\0';
+    }
+
+// the bytes taken by arguments of types Args.
+template <typename... Args>
+constexpr std::size_t getTraceArgsSize()
+    {
+    constexpr std::size_t kSizes[] = { sizeof(Args)..., 0 };
+    std::size_t n = 0;
+
+    for (std::size_t i = 0; i < sizeof...(Args); ++i)
+        n += kSizes[i];
+    return n;
+    }
+
+// the value of an argument, as an integer.
+template <typename T>
+inline std::uint32_t getTraceArgValue(T v, std::true_type /* enum */)
+    {
+    return std::uint32_t(static_cast<typename std::underlying_type<T>::type>(v));
+    }
+
+template <typename T>
+inline std::uint32_t getTraceArgValue(T v, std::false_type /* enum */)
+    {
+    return std::uint32_t(v);
+    }
+
+// pack an argument, little-endian, in the bytes its type takes.
+template <typename T>
+inline std::uint8_t *putTraceArg(std::uint8_t *p, T v)
+    {
+    static_assert(sizeof(T) <= 4, "trace arguments are at most 4 bytes");
+    std::uint32_t u = getTraceArgValue(v, std::is_enum<T>{});
+
+    for (std::size_t i = 0; i < sizeof(T); ++i, u >>= 8)
+        *p++ = std::uint8_t(u);
+    return p;
+    }
+
+// format a record as text in pBuf, as the site would have printed it;
+// returns the length (truncated to nBuf - 1). Defined in cPMS7003.cpp,
+// as it needs the state names.
+std::size_t formatTrace(
+    char *pBuf, std::size_t nBuf,
+    TraceId id, const std::uint8_t *pArgs, std::size_t nArgs
+    );
+
+/****************************************************************************\
+|
+|   The ring
+|
+\****************************************************************************/
+
+class cTraceRing
+    {
+public:
+    // a ring in the nBuf bytes at pBuf. Only a power of two is used; it
+    // should be at least kMaxTraceRecord, as records that don't fit are
+    // dropped.
+    cTraceRing(std::uint8_t *pBuf, std::size_t nBuf)
+        : m_pBuf(pBuf)
+        {
+        std::size_t n = 1;
+
+        while (n * 2 <= nBuf)
+            n *= 2;
+        this->m_mask = std::uint32_t(n - 1);
+        this->clear();
+        }
+
+    void clear()
+        {
+        this->m_head = 0;
+        this->m_tail = 0;
+        this->m_nRecords = 0;
+        this->m_nLost = 0;
+        }
+
+    // add a record, dropping the oldest ones if there's no room. nArgs
+    // beyond kMaxTraceArgs are cut off. A record bigger than the whole
+    // ring is dropped, and counted as lost.
+    void put(TraceId id, std::uint32_t tMs, const std::uint8_t *pArgs, std::size_t nArgs)
+        {
+        if (nArgs > kMaxTraceArgs)
+            nArgs = kMaxTraceArgs;
+
+        std::uint32_t const n = std::uint32_t(kTraceHeaderSize + nArgs);
+
+        if (n > this->getCapacity())
+            {
+            ++this->m_nLost;
+            return;
+            }
+
+        while (this->getCapacity() - this->getBytes() < n)
+            this->drop();
+
+        this->putByte(std::uint8_t(id));
+        this->putByte(std::uint8_t(nArgs));
+        for (unsigned i = 0; i < 4; ++i, tMs >>= 8)
+            this->putByte(std::uint8_t(tMs));
+        for (std::size_t i = 0; i < nArgs; ++i)
+            this->putByte(pArgs[i]);
+        ++this->m_nRecords;
+        }
+
+    // move the oldest whole records that fit to pBuf, and return the
+    // number of bytes. With nBuf at least kMaxTraceRecord, that's at
+    // least one record, if there are any.
+    std::size_t read(std::uint8_t *pBuf, std::size_t nBuf)
+        {
+        std::size_t nResult = 0;
+
+        while (this->m_nRecords != 0)
+            {
+            std::size_t const n = this->getRecordSize();
+
+            if (nBuf - nResult < n)
+                break;
+            for (std::size_t i = 0; i < n; ++i)
+                pBuf[nResult++] = this->m_pBuf[(this->m_tail + i) & this->m_mask];
+            this->m_tail += std::uint32_t(n);
+            --this->m_nRecords;
+            }
+        return nResult;
+        }
+
+    std::size_t getCapacity() const
+        {
+        return std::size_t(this->m_mask) + 1;
+        }
+    std::size_t getBytes() const
+        {
+        return this->m_head - this->m_tail;
+        }
+    std::uint32_t getRecords() const
+        {
+        return this->m_nRecords;
+        }
+    // the records dropped to make room, since clear().
+    std::uint32_t getLost() const
+        {
+        return this->m_nLost;
+        }
+
+private:
+    void putByte(std::uint8_t c)
+        {
+        this->m_pBuf[this->m_head++ & this->m_mask] = c;
+        }
+    std::size_t getRecordSize() const
+        {
+        return kTraceHeaderSize + this->m_pBuf[(this->m_tail + 1) & this->m_mask];
+        }
+    void drop()
+        {
+        this->m_tail += std::uint32_t(this->getRecordSize());
+        --this->m_nRecords;
+        ++this->m_nLost;
+        }
+
+    std::uint8_t *  m_pBuf;
+    std::uint32_t   m_mask;
+    // free-running byte counts: m_head - m_tail bytes are in use.
+    std::uint32_t   m_head;
+    std::uint32_t   m_tail;
+    std::uint32_t   m_nRecords;
+    std::uint32_t   m_nLost;
+    };
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_Trace_h_
@@ -0,0 +1,260 @@
+/*
+
+Module: Catena-PMS7003-Uflt16.h
+
+Function:
+    Integer-only uflt16 encoding and decoding.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    The lora sketches uplink each channel as LMIC_f2uflt16(sum / div),
+    where sum and div are integers converted to float. The STM32L0 has
+    no FPU, so that's a software divide followed by frexp() and ldexp().
+
+    uflt16FromRatio() gets the same 16 bits with 32-bit integer
+    arithmetic. It rounds each operand to a 24-bit significand, as the
+    conversion to float would; divides by shift-and-subtract, rounding
+    the quotient as an IEEE float divide would; and then follows the
+    LMIC encoder step for step, including its handling of zero and of
+    values below its range. extras/test-uflt16-ratio.cpp checks every
+    input a reduction block can produce, and a sample of the rest.
+
+    uflt16Encode() is LMIC_f2uflt16() for a float that's already been
+    computed: it takes the significand and exponent from the IEEE bits
+    (normalizing denormals with a count of leading zeros) instead of
+    calling frexp() and ldexp(). uflt16Decode() is the inverse, as the
+    message decoders compute it: f / 4096 * 2^(b - 15). It builds the
+    float's bits directly; every uflt16 value is exactly representable.
+    extras/test-uflt16.cpp checks all 65536 codes, and the encoder
+    against the LMIC code on a sample (or all) of the 2^32 floats.
+
+    The encoder keeps the LMIC encoder's quirks, so that it can replace
+    it anywhere: zero (and -0) encode as 0xF000; negative values as 0;
+    values of one or more, and NaN, as 0xFFFF; and values below 2^-16
+    get exponent 0 with the fraction of their normalized significand.
+    Codes with exponent 0 and a fraction below 2048 are never produced.
+
+*/
+
+#ifndef _Catena_PMS7003_Uflt16_h_
+# define _Catena_PMS7003_Uflt16_h_
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace McciCatenaPMS7003 {
+
+// the number of leading zeros in a non-zero 32-bit value.
+inline unsigned uflt16Clz(std::uint32_t v)
+    {
+#if defined(__GNUC__)
+    return unsigned(__builtin_clz(v));
+#else
+    unsigned n = 0;
+
+    for (; (v & 0x80000000u) == 0; v <<= 1)
+        ++n;
+
+    return n;
+#endif
+    }
+
+// round v (non-zero) to a float, as (uint32_t -> float) conversion does:
+// v becomes m * 2^k, with m in [2^23, 2^24).
+inline void uflt16RoundToFloat(std::uint32_t v, std::uint32_t &m, int &k)
+    {
+    int const nBits = 32 - int(uflt16Clz(v));
+
+    if (nBits <= 24)
+        {
+        m = v << (24 - nBits);
+        k = nBits - 24;
+        return;
+        }
+
+    // round to nearest, ties to even.
+    unsigned const shift = unsigned(nBits - 24);
+    std::uint32_t const half = std::uint32_t(1) << (shift - 1);
+    std::uint32_t const lost = v & ((half << 1) - 1);
+
+    m = v >> shift;
+    k = int(shift);
+    if (lost > half || (lost == half && (m & 1) != 0))
+        {
+        ++m;
+        if (m == (std::uint32_t(1) << 24))
+            {
+            m >>= 1;
+            ++k;
+            }
+        }
+    }
+
+// the last steps of LMIC_f2uflt16(): the value is q * 2^(iExp - 24), with
+// q in [2^23, 2^24) -- that is, frexp() returned q * 2^-24 and iExp.
+inline std::uint16_t uflt16Pack(std::uint32_t q, int iExp)
+    {
+    // f2uflt16() saturates at one.
+    if (iExp > 0)
+        return 0xFFFF;
+
+    // and from here, it's step for step.
+    iExp += 15;
+    if (iExp < 0)
+        iExp = 0;
+
+    std::uint32_t outputFraction = (q + (1u << 11)) >> 12;
+
+    if (outputFraction >= (1u << 12))
+        {
+        outputFraction = 1u << 11;
+        ++iExp;
+        }
+
+    if (iExp > 15)
+        return 0xFFFF;
+
+    return std::uint16_t((unsigned(iExp) << 12u) | outputFraction);
+    }
+
+// LMIC_f2uflt16(f), without using floating point.
+inline std::uint16_t uflt16Encode(float f)
+    {
+    std::uint32_t bits;
+
+    std::memcpy(&bits, &f, sizeof(bits));
+
+    std::uint32_t const magnitude = bits & 0x7FFFFFFFu;
+    unsigned const biasedExp = unsigned(magnitude >> 23);
+    std::uint32_t q = magnitude & 0x7FFFFFu;
+
+    // zero of either sign: frexp() gives a zero fraction and exponent.
+    if (magnitude == 0)
+        return 0xF000;
+
+    // NaN of either sign.
+    if (magnitude > 0x7F800000u)
+        return 0xFFFF;
+
+    if (bits & 0x80000000u)
+        return 0;
+
+    // infinity, and everything from one up.
+    if (biasedExp >= 127)
+        return 0xFFFF;
+
+    // the value is q * 2^(iExp - 24), with q normalized.
+    int iExp;
+
+    if (biasedExp != 0)
+        {
+        q |= 1u << 23;
+        iExp = int(biasedExp) - 126;
+        }
+    else
+        {
+        // a denormal: q * 2^-149.
+        unsigned const shift = uflt16Clz(q) - 8;
+
+        q <<= shift;
+        iExp = -125 - int(shift);
+        }
+
+    return uflt16Pack(q, iExp);
+    }
+
+// the value of a uflt16 code, f / 4096 * 2^(b - 15), without using
+// floating-point arithmetic.
+inline float uflt16Decode(std::uint16_t uf)
+    {
+    std::uint32_t const fraction = uf & 0xFFFu;
+    int const b = uf >> 12;
+    std::uint32_t bits = 0;
+
+    if (fraction != 0)
+        {
+        // fraction * 2^(b - 27), with fraction's leading one at bit
+        // nBits - 1; always a normal float.
+        int const nBits = 32 - int(uflt16Clz(fraction));
+
+        bits = (std::uint32_t(nBits + b - 27 - 1 + 127) << 23) |
+               ((fraction << (24 - nBits)) & 0x7FFFFFu);
+        }
+
+    float f;
+
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+    }
+
+// LMIC_f2uflt16(float(num) / float(den)), without using floating point.
+inline std::uint16_t uflt16FromRatio(std::uint32_t num, std::uint32_t den)
+    {
+    // frexp(0) gives a zero fraction and a zero exponent, which the
+    // encoder biases to 15. (0/0 is the caller's problem.)
+    if (num == 0)
+        return 0xF000;
+
+    // a positive number divided by zero is infinite.
+    if (den == 0)
+        return 0xFFFF;
+
+    // the operands, as floats: num = mNum * 2^kNum, den = mDen * 2^kDen.
+    std::uint32_t mNum, mDen;
+    int kNum, kDen;
+
+    uflt16RoundToFloat(num, mNum, kNum);
+    uflt16RoundToFloat(den, mDen, kDen);
+
+    // mNum / mDen is in (1/2, 2); make it [1, 2). mNum is then below
+    // 2^25, and the remainders below stay below 2^25.
+    int iExp = kNum - kDen;
+
+    if (mNum < mDen)
+        {
+        mNum <<= 1;
+        --iExp;
+        }
+
+    // the 24-bit significand, as the float divide computes it: the
+    // leading bit is one, and 23 more come from long division.
+    std::uint32_t rem = mNum - mDen;
+    std::uint32_t q = 1;
+
+    for (unsigned i = 0; i < 23; ++i)
+        {
+        // the quotient bits are random; don't branch on them.
+        rem <<= 1;
+
+        std::uint32_t const bit = rem >= mDen;
+
+        rem -= mDen & (0 - bit);
+        q = (q << 1) | bit;
+        }
+
+    // round to nearest, ties to even.
+    if (2 * rem > mDen || (2 * rem == mDen && (q & 1) != 0))
+        {
+        ++q;
+        if (q == (std::uint32_t(1) << 24))
+            {
+            q >>= 1;
+            ++iExp;
+            }
+        }
+
+    // the quotient is now exactly q * 2^(iExp - 23), with q in
+    // [2^23, 2^24). frexp() would return q * 2^-24 and iExp + 1.
+    return uflt16Pack(q, iExp + 1);
+    }
+
+} // namespace McciCatenaPMS7003
+
+#endif // _Catena_PMS7003_Uflt16_h_
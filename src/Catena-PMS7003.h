@@ -37,11 +37,16 @@ class cPMS7003 : public McciCatena::cPollableObject
     // Forward references, etc.
     //*******************************************
 private:
+    // host-side harnesses (see extras/host) get at the internals this way.
+    friend class cPMS7003HostAccess;
+
     typedef decltype(Serial1) cSerial;
     // get minimum reset time in millis.
     static constexpr std::uint32_t getTresetMin() { return 10; }
     // return the number of messages needed for valid data.
     static constexpr std::uint32_t getWarmupMessages() { return 11; }
+    // the time a byte takes on the wire, in micros: 9600 baud, 8N1.
+    static constexpr std::uint32_t kRxByteMicros = 10 * 1000 * 1000 / 9600;
 
     //*******************************************
     // Constructor, etc.
@@ -315,11 +320,29 @@ public:
 
     typedef void MeasurementCb_t(void *pUserData, const Measurements<std::uint16_t> *pData, bool fWarmedUp);
 
-    // Set the callback function
+    // the same, with the time of the frame: millis() when its first
+    // byte arrived. poll() may run well after that, with the frame (and
+    // more) waiting in the UART buffer. The byte arrived after the last
+    // poll(), plus a byte time for each byte ahead of it, and before
+    // now, less a byte time for each byte behind it; the frame is dated
+    // in the middle. So the time is within a ms or so when poll() runs
+    // often, and off by at most half the time between polls otherwise.
+    typedef void TimedMeasurementCb_t(void *pUserData, const Measurements<std::uint16_t> *pData, bool fWarmedUp, std::uint32_t tFrameMs);
+
+    // Set the callback function; only one is kept, of either kind.
     bool setCallback(MeasurementCb_t *pFn, void *pUserData)
         {
         this->m_pMeasurementCb = pFn;
+        this->m_pTimedMeasurementCb = nullptr;
+        this->m_pMeasurementUserData = pUserData;
+        return true;
+        }
+    bool setCallback(TimedMeasurementCb_t *pFn, void *pUserData)
+        {
+        this->m_pMeasurementCb = nullptr;
+        this->m_pTimedMeasurementCb = pFn;
         this->m_pMeasurementUserData = pUserData;
+        return true;
         }
 
     virtual void poll(void) override;
@@ -380,6 +403,7 @@ private:
         const std::uint32_t m = evMask(e);
         this->m_events |= m;
         this->m_fsm.eval();
+        return true;
         }
 
     static std::uint32_t evMask(Event e) { return 1 << std::uint32_t(e); }
@@ -422,6 +446,7 @@ private:
         const std::uint32_t m = rqMask(r);
         this->m_requests |= m;
         this->m_fsm.eval();
+        return true;
         }
 
     void allowRequests(std::uint32_t rmask)
@@ -453,6 +478,9 @@ private:
     // send a command.
     void sendCommand(const WireCommand &cmd);
 
+    // the time of the frame starting at a byte read now.
+    std::uint32_t getRxFrameTime(std::uint32_t tNow, std::uint32_t nBefore, std::uint32_t nAfter) const;
+
     //*******************************************
     // The instance data
     //*******************************************
@@ -468,6 +496,7 @@ private:
     cPMS7003Hal *           m_hal;
 
     MeasurementCb_t *       m_pMeasurementCb;
+    TimedMeasurementCb_t *  m_pTimedMeasurementCb = nullptr;
     void *                  m_pMeasurementUserData;
 
     std::uint32_t           m_requests;
@@ -475,6 +504,10 @@ private:
 
     WireData                m_rxBuffer;
     std::uint32_t           m_iRxData;
+    // millis() when the first byte of m_rxBuffer arrived.
+    std::uint32_t           m_tRxFrame = 0;
+    // millis() when poll() last emptied the UART buffer.
+    std::uint32_t           m_tRxPoll = 0;
     RxStats                 m_RxStats;
     std::uint32_t           m_txempty_avail;
 
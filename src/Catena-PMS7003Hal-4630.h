@@ -25,6 +25,8 @@ Author:
 #include <Catena-PMS7003.h>
 #include <Catena_FSM.h>
 #include <Catena_PollableInterface.h>
+#include <algorithm>
+#include <cstring>
 
 namespace McciCatenaPMS7003 {
 
@@ -63,13 +65,13 @@ public:
     // constructor
     cPMS7003Hal_4630(McciCatena::Catena4630 &aCatena, std::uint32_t debugMask)
         : m_Catena(aCatena)
-        , m_debugMask(debugMask)
+        , m_debugMask(debugMask & kDebugMaskMax)
         {}
 
     virtual bool begin() override
         {
-        if (this->isEnabled(cPMS7003::DebugFlags::kTrace))
-            this->printf("hal begin\n");
+        if (this->isTraceEnabled<cPMS7003::DebugFlags::kTrace>())
+            this->trace<TraceId::kHalBegin>();
         pinWrite(kVddPin, 0);
         setPinMode(kVddPin, OUTPUT);
 
@@ -80,8 +82,8 @@ public:
 
     virtual void end() override
         {
-        if (this->isEnabled(cPMS7003::DebugFlags::kTrace))
-            this->printf("hal end\n");
+        if (this->isTraceEnabled<cPMS7003::DebugFlags::kTrace>())
+            this->trace<TraceId::kHalEnd>();
         pinWrite(kVddPin, 0);
         setPinMode(kVddPin, INPUT);
         this->setReset(PinState::HighZ);
@@ -93,8 +95,8 @@ public:
         if (this->m_f5vState == fEnable)
             return 0;
 
-        if (this->isEnabled(cPMS7003::DebugFlags::kTrace))
-            this->printf("set5v: %u\n", unsigned(fEnable));
+        if (this->isTraceEnabled<cPMS7003::DebugFlags::kTrace>())
+            this->trace<TraceId::kHalSet5v>(std::uint8_t(fEnable));
 
         this->m_f5vState = fEnable;
         pinWrite(kVddPin, fEnable);
@@ -143,8 +145,8 @@ public:
         if (old == v)
             return;
 
-        if (this->isEnabled(cPMS7003::DebugFlags::kTrace))
-            this->printf("setReset: %c\n", pinStateName(v));
+        if (this->isTraceEnabled<cPMS7003::DebugFlags::kTrace>())
+            this->trace<TraceId::kHalSetReset>(pinStateName(v));
 
         this->m_reset = v;
         updatePin(v, old);
@@ -162,8 +164,8 @@ public:
         if (old == v)
             return;
 
-        if (this->isEnabled(cPMS7003::DebugFlags::kTrace))
-            this->printf("setMode: %c\n", pinStateName(v));
+        if (this->isTraceEnabled<cPMS7003::DebugFlags::kTrace>())
+            this->trace<TraceId::kHalSetMode>(pinStateName(v));
 
         this->m_mode = v;
         updatePin(v, old);
@@ -182,14 +184,47 @@ public:
         {
         std::va_list ap;
         char buf[128];
-        if (! Serial)
+        if (! Serial && this->m_pTraceRing == nullptr)
             return;
 
         va_start(ap, pFmt);
         vsnprintf(buf, sizeof(buf)-1, pFmt, ap);
         buf[sizeof(buf)-1] = 0;
+        va_end(ap);
 
-        this->m_Catena.SafePrintf("%s", buf);
+        if (this->m_pTraceRing == nullptr)
+            {
+            this->m_Catena.SafePrintf("%s", buf);
+            return;
+            }
+
+        // with a ring, the text goes in as kText records.
+        std::uint32_t const tMs = millis();
+        auto const pText = reinterpret_cast<const std::uint8_t *>(buf);
+
+        for (std::size_t i = 0, n = std::strlen(buf); i < n; i += kMaxTraceArgs)
+            this->m_pTraceRing->put(TraceId::kText, tMs, pText + i, std::min(n - i, kMaxTraceArgs));
+        }
+
+    // with a ring, keep the record; otherwise, print it.
+    virtual void putTrace(TraceId id, const std::uint8_t *pArgs, std::size_t nArgs) override
+        {
+        if (this->m_pTraceRing != nullptr)
+            this->m_pTraceRing->put(id, millis(), pArgs, nArgs);
+        else
+            cPMS7003Hal::putTrace(id, pArgs, nArgs);
+        }
+
+    // keep trace records in pRing rather than printing them; or, with
+    // nullptr, print them again.
+    void setTraceRing(cTraceRing *pRing)
+        {
+        this->m_pTraceRing = pRing;
+        }
+
+    cTraceRing *getTraceRing() const
+        {
+        return this->m_pTraceRing;
         }
 
     virtual bool isEnabled(std::uint32_t mask) const override
@@ -197,9 +232,10 @@ public:
         return (mask == 0) || (mask & this->m_debugMask);
         }
 
+    // set the debug flags; those not in kDebugMaskMax stay clear.
     void setDebugFlags(std::uint32_t mask)
         {
-        this->m_debugMask = mask;
+        this->m_debugMask = mask & kDebugMaskMax;
         }
 
     std::uint32_t getDebugFlags() const
@@ -225,6 +261,7 @@ private:
 private:
     McciCatena::Catena4630 &m_Catena;
     std::uint32_t m_debugMask;
+    cTraceRing  *m_pTraceRing = nullptr;
     bool        m_f5vState;
     PinState    m_reset;
     PinState    m_mode;
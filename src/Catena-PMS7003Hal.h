@@ -20,11 +20,23 @@ Author:
 
 #include <Arduino.h>
 #include <Catena-PMS7003-version.h>
+#include <Catena-PMS7003-Trace.h>
 #include <Catena_PollableInterface.h>
 #include <cstdint>
 
+// the debug flags (cPMS7003::DebugFlags) that can ever be enabled. Trace
+// sites for the others compile away, along with their messages, and the
+// runtime mask can't turn them on. Define on the command line to trim a
+// release build: for example, 0x1 keeps only the errors, and 0 keeps
+// nothing.
+#ifndef CATENA_PMS7003_DEBUG_MASK
+# define CATENA_PMS7003_DEBUG_MASK 0xFFFFFFFFu
+#endif
+
 namespace McciCatenaPMS7003 {
 
+static constexpr std::uint32_t kDebugMaskMax = CATENA_PMS7003_DEBUG_MASK;
+
 /****************************************************************************\
 |
 |   HAL for PMS7003 sensor
@@ -86,6 +98,32 @@ public:
 
     // determine whether a print is enabled
     virtual bool isEnabled(std::uint32_t mask) const = 0;
+
+    // the same, for trace sites: false at compile time if none of the
+    // flags in mask is in kDebugMaskMax, so the site compiles away.
+    template <std::uint32_t mask>
+    bool isTraceEnabled() const
+        {
+        return (mask & kDebugMaskMax) == 0 ? false : this->isEnabled(mask & kDebugMaskMax);
+        }
+
+    // handle a trace record (see Catena-PMS7003-Trace.h). By default,
+    // it's formatted and printed.
+    virtual void putTrace(TraceId id, const std::uint8_t *pArgs, std::size_t nArgs);
+
+    // trace site id, with its arguments.
+    template <TraceId id, typename... Args>
+    void trace(Args... args)
+        {
+        static_assert(isTraceArgsMatch<Args...>(id), "arguments don't match kTraceFormats");
+        std::uint8_t buf[getTraceArgsSize<Args...>() + 1];
+        std::uint8_t *p = buf;
+        using expand = int[];
+
+        // the arguments, in order.
+        (void) expand { 0, ((p = putTraceArg(p, args)), 0)... };
+        this->putTrace(id, buf, p - buf);
+        }
     };
 
 } // namespace McciCatenaPMS7003
@@ -0,0 +1,40 @@
+/*
+
+Module: cPMS7003-constexpr.cpp
+
+Function:
+    Definitions of the static constexpr members of the header-only
+    classes, for C++14.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   October 2026
+
+Notes:
+    Before C++17, a static constexpr data member that is odr-used (an
+    array indexed at run time, or a value bound to a reference) needs
+    a definition in exactly one translation unit, or the link fails.
+    In C++17 these members are inline, and the definitions here are
+    redundant; so they're compiled only for older dialects.
+
+*/
+
+#include <Catena-PMS7003-Aqi.h>
+#include <Catena-PMS7003-KeepWarm.h>
+#include <Catena-PMS7003-Port1.h>
+
+using namespace McciCatenaPMS7003;
+
+#if __cplusplus < 201703L
+
+constexpr cAqi::Table_t cAqi::kPm2p5;
+constexpr cAqi::Table_t cAqi::kPm10;
+
+constexpr std::uint32_t cKeepWarmPolicy::kDefaultRecoveryMs[cKeepWarmPolicy::kDepths];
+
+constexpr Port1Value cPort1Message::kSchema[cPort1Message::kSlots];
+constexpr const char *cPort1Message::kFieldKeys[cPort1Message::kFields];
+
+#endif // __cplusplus < 201703L
@@ -15,6 +15,8 @@ Author:
 
 #include <Catena-PMS7003.h>
 
+#include <cstdio>
+
 using namespace McciCatenaPMS7003;
 
 // see http://aqicn.org/sensor/pms5003-7003/ for some useful
@@ -75,12 +77,8 @@ cPMS7003::State cPMS7003::fsmDispatch(
     {
     State newState = State::stNoChange;
 
-    if (fEntry && this->m_hal->isEnabled(DebugFlags::kTrace))
-        {
-        this->m_hal->printf("cPMS7003::fsmDispatch: enter %s\n",
-                this->getStateName(currentState)
-                );
-        }
+    if (fEntry && this->m_hal->isTraceEnabled<DebugFlags::kTrace>())
+        this->m_hal->trace<TraceId::kPmsEnter>(currentState);
 
     // first we try to handle the outer states.
     switch (currentState)
@@ -130,6 +128,7 @@ cPMS7003::State cPMS7003::fsmDispatch(
             this->m_port->begin(9600);
             this->m_flags.b.RxTxEnabled = true;
             this->m_iRxData = 0;
+            this->m_tRxPoll = millis();
             this->m_txempty_avail = this->m_port->availableForWrite();
             }
         break;
@@ -204,12 +203,10 @@ cPMS7003::State cPMS7003::fsmDispatch(
                         rqMask(Request::Passive)
                         );
 
-                if (oldRequests != 0 && this->m_hal->isEnabled(DebugFlags::kTrace))
+                if (oldRequests != 0 && this->m_hal->isTraceEnabled<DebugFlags::kTrace>())
                     {
-                    this->m_hal->printf(
-                            "%s: oldRequests: 0x%x m_requests 0x%x\n",
-                            __func__,
-                            oldRequests,
+                    this->m_hal->trace<TraceId::kPmsRequests>(
+                            std::uint32_t(oldRequests),
                             this->m_requests
                             );
                     }
@@ -346,13 +343,11 @@ cPMS7003::State cPMS7003::fsmDispatch(
                 break;
 
             default:
-                if (this->m_hal->isEnabled(DebugFlags::kError))
+                if (this->m_hal->isTraceEnabled<DebugFlags::kError>())
                     {
-                    this->m_hal->printf(
-                            "%s: unknown state %s (%u)\n",
-                            __func__,
-                            this->getStateName(currentState),
-                            unsigned(currentState)
+                    this->m_hal->trace<TraceId::kPmsUnknownState>(
+                            currentState,
+                            std::uint8_t(currentState)
                             );
                     }
                 break;
@@ -370,24 +365,39 @@ void cPMS7003::sendCommand(const WireCommand &cmd)
     this->resetEvent(Event::TxDone);
     this->m_port->write(cmd.getBuffer(), sizeof(cmd));
 
-    if (this->m_hal->isEnabled(DebugFlags::kTxData))
+    if (this->m_hal->isTraceEnabled<DebugFlags::kTxData>())
         {
-        this->m_hal->printf("TX:");
-        auto p = cmd.getBuffer();
-        for (auto n = sizeof(cmd); n > 0; ++p, --n)
-            {
-            this->m_hal->printf(" %02x", *p);
-            }
-        this->m_hal->printf("\n");
+        auto const p = cmd.getBuffer();
+
+        this->m_hal->trace<TraceId::kPmsTx>(p[0], p[1], p[2], p[3], p[4], p[5], p[6]);
         }
     }
 
+// the time of a frame whose first byte was read at tNow, with nBefore
+// bytes ahead of it in the buffer and nAfter behind. The byte arrived no
+// later than nAfter byte times before tNow (if the last byte arrived just
+// now), and no earlier than nBefore byte times after the last poll (if
+// the first byte waiting arrived just then). Without a time from the
+// UART, take the middle: off by at most half the difference, which is
+// under a ms when poll() runs often.
+std::uint32_t cPMS7003::getRxFrameTime(std::uint32_t tNow, std::uint32_t nBefore, std::uint32_t nAfter) const
+    {
+    std::uint32_t const tLatest = tNow - (nAfter * kRxByteMicros + 500) / 1000;
+    std::uint32_t const tEarliest = this->m_tRxPoll + (nBefore * kRxByteMicros + 500) / 1000;
+    std::int32_t const dt = std::int32_t(tLatest - tEarliest);
+
+    return dt > 0 ? tEarliest + std::uint32_t(dt) / 2 : tLatest;
+    }
+
 void cPMS7003::poll(void)
     {
     if (this->m_flags.b.RxTxEnabled)
         {
-        // handle serial receives
+        // handle serial receives. Everything waiting arrived since the
+        // last poll emptied the buffer, and by now.
         auto const nRx = this->m_port->available();
+        std::uint32_t const tNow = millis();
+
         for (auto i = nRx; i > 0; --i)
             {
             auto iBuffer = this->m_iRxData;
@@ -397,8 +407,8 @@ void cPMS7003::poll(void)
 
             if (expected >= 0 && c != expected)
                 {
-                if (this->m_hal->isEnabled(DebugFlags::kRxDiscard))
-                    this->m_hal->printf("%02x ", c);
+                if (this->m_hal->isTraceEnabled<DebugFlags::kRxDiscard>())
+                    this->m_hal->trace<TraceId::kPmsRxDiscard>(c);
                 this->m_iRxData = 0;
                 this->m_RxStats.CharDrops += iBuffer + 1;
                 if (iBuffer > 0)
@@ -407,6 +417,9 @@ void cPMS7003::poll(void)
             else
                 {
                 pBuffer[iBuffer] = c;
+                if (iBuffer == 0)
+                    this->m_tRxFrame = this->getRxFrameTime(tNow, std::uint32_t(nRx - i), std::uint32_t(i - 1));
+
                 if (iBuffer == sizeof(this->m_rxBuffer) - 1)
                     {
                     auto cs = computeChecksum(pBuffer, sizeof(this->m_rxBuffer) - 2);
@@ -420,7 +433,8 @@ void cPMS7003::poll(void)
                         ++this->m_RxStats.GoodMsg;
                         ++this->m_nMessages;
                         this->setEvent(Event::NewData);
-                        if (this->m_pMeasurementCb != nullptr)
+                        if (this->m_pMeasurementCb != nullptr ||
+                            this->m_pTimedMeasurementCb != nullptr)
                             {
                             Measurements<std::uint16_t> m;
                             Measurements<std::uint8_t[2]> &r = this->m_rxBuffer.Data;
@@ -439,11 +453,21 @@ void cPMS7003::poll(void)
                             m.dust.m5   = getUint16Be(r.dust.m5  );
                             m.dust.m10  = getUint16Be(r.dust.m10 );
 
-                            (this->m_pMeasurementCb)(
-                                this->m_pMeasurementUserData,
-                                &m,
-                                this->m_fsm.getState() != State::stWarmup
-                                );
+                            bool const fWarmedUp = this->m_fsm.getState() != State::stWarmup;
+
+                            if (this->m_pTimedMeasurementCb != nullptr)
+                                (this->m_pTimedMeasurementCb)(
+                                    this->m_pMeasurementUserData,
+                                    &m,
+                                    fWarmedUp,
+                                    this->m_tRxFrame
+                                    );
+                            else
+                                (this->m_pMeasurementCb)(
+                                    this->m_pMeasurementUserData,
+                                    &m,
+                                    fWarmedUp
+                                    );
                             }
                         }
                     this->m_iRxData = 0;
@@ -455,6 +479,8 @@ void cPMS7003::poll(void)
                 }
             }
 
+        this->m_tRxPoll = tNow;
+
         // handle serial transmit completions
         if (this->m_flags.b.TxActive)
             {
@@ -491,3 +517,115 @@ void cPMS7003::clearTimer()
     this->m_flags.b.TimerActive = false;
     this->resetEvent(Event::Timer);
     }
+
+/****************************************************************************\
+|
+|   The HAL
+|
+\****************************************************************************/
+
+// by default, there's nowhere to register; a HAL for a platform that
+// polls objects overrides this.
+void cPMS7003Hal::registerPollableObject(McciCatena::cPollableObject *)
+    {}
+
+/****************************************************************************\
+|
+|   Trace records
+|
+\****************************************************************************/
+
+std::size_t McciCatenaPMS7003::formatTrace(
+    char *pBuf, std::size_t nBuf,
+    TraceId id, const std::uint8_t *pArgs, std::size_t nArgs
+    )
+    {
+    if (nBuf == 0)
+        return 0;
+
+    std::size_t nResult = 0;
+    auto const put = [&](const char *p, std::size_t n)
+        {
+        for (; n > 0 && *p != '\0' && nResult < nBuf - 1; ++p, --n)
+            pBuf[nResult++] = *p;
+        };
+
+    if (std::size_t(id) >= std::size_t(TraceId::kMax))
+        {
+        char text[32];
+
+        std::snprintf(text, sizeof(text), "<<unknown trace %u>>\n", unsigned(id));
+        put(text, sizeof(text));
+        pBuf[nResult] = '\0';
+        return nResult;
+        }
+
+    TraceFormat const &f = kTraceFormats[std::size_t(id)];
+    const char *pKind = f.pArgs;
+    std::size_t iArg = 0;
+
+    for (const char *p = f.pFormat; *p != '\0'; )
+        {
+        if (p[0] != '%' || p[1] == '%')
+            {
+            put(p, 1);
+            p += p[0] == '%' ? 2 : 1;
+            continue;
+            }
+
+        // copy one conversion, and format it with the next argument.
+        char spec[8];
+        std::size_t nSpec = 0;
+
+        spec[nSpec++] = *p++;
+        while (*p != '\0')
+            {
+            char const c = *p++;
+
+            if (nSpec < sizeof(spec) - 1)
+                spec[nSpec++] = c;
+            if (std::strchr("csuxX", c) != nullptr)
+                break;
+            }
+        spec[nSpec] = '\0';
+
+        char const kind = *pKind != '\0' ? *pKind++ : 'b';
+        char text[24];
+
+        if (kind == 't')
+            {
+            put(reinterpret_cast<const char *>(pArgs) + iArg, nArgs - iArg);
+            iArg = nArgs;
+            continue;
+            }
+
+        std::size_t const n = getTraceKindSize(kind);
+        std::uint32_t v = 0;
+
+        for (std::size_t i = 0; i < n; ++i)
+            v |= std::uint32_t(iArg + i < nArgs ? pArgs[iArg + i] : 0) << (8 * i);
+        iArg += n;
+
+        if (kind == 's')
+            std::snprintf(text, sizeof(text), spec, cPMS7003::getStateName(cPMS7003::State(v)));
+        else
+            std::snprintf(text, sizeof(text), spec, unsigned(v));
+        put(text, sizeof(text));
+        }
+
+    pBuf[nResult] = '\0';
+    return nResult;
+    }
+
+void cPMS7003Hal::putTrace(TraceId id, const std::uint8_t *pArgs, std::size_t nArgs)
+    {
+    // with no traces compiled in, there's nothing to format; and then
+    // the optimizer drops formatTrace() and the table.
+    if (kDebugMaskMax == 0)
+        return;
+
+    char buf[128];
+
+    formatTrace(buf, sizeof(buf), id, pArgs, nArgs);
+    this->printf("%s", buf);
+    }